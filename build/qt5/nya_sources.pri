@@ -11,8 +11,10 @@ QMAKE_OBJECTIVE_CXXFLAGS_WARN_ON = -Wall -Wno-unused-parameter -Wno-reorder
 SOURCES += \
     $${NYA_ENGINE_PATH}/formats/dds.cpp \
     $${NYA_ENGINE_PATH}/formats/ktx.cpp \
+    $${NYA_ENGINE_PATH}/formats/mip_chain.cpp \
     $${NYA_ENGINE_PATH}/formats/math_expr_parser.cpp \
     $${NYA_ENGINE_PATH}/formats/nms.cpp \
+    $${NYA_ENGINE_PATH}/formats/pixel_convert.cpp \
     $${NYA_ENGINE_PATH}/formats/string_convert.cpp \
     $${NYA_ENGINE_PATH}/formats/text_parser.cpp \
     $${NYA_ENGINE_PATH}/formats/tga.cpp \
@@ -26,7 +28,13 @@ SOURCES += \
     $${NYA_ENGINE_PATH}/math/matrix.cpp \
     $${NYA_ENGINE_PATH}/math/quadtree.cpp \
     $${NYA_ENGINE_PATH}/math/quaternion.cpp \
+    $${NYA_ENGINE_PATH}/memory/frame_arena.cpp \
+    $${NYA_ENGINE_PATH}/memory/lz4.cpp \
+    $${NYA_ENGINE_PATH}/memory/mem_accounting.cpp \
     $${NYA_ENGINE_PATH}/memory/memory.cpp \
+    $${NYA_ENGINE_PATH}/memory/mutex.cpp \
+    $${NYA_ENGINE_PATH}/memory/name_id.cpp \
+    $${NYA_ENGINE_PATH}/memory/thread_pool.cpp \
     $${NYA_ENGINE_PATH}/memory/tmp_buffer.cpp \
     $${NYA_ENGINE_PATH}/render/animation.cpp \
     $${NYA_ENGINE_PATH}/render/debug_draw.cpp \
@@ -42,9 +50,12 @@ SOURCES += \
     $${NYA_ENGINE_PATH}/render/vbo.cpp \
     $${NYA_ENGINE_PATH}/resources/composite_resources_provider.cpp \
     $${NYA_ENGINE_PATH}/resources/file_resources_provider.cpp \
+    $${NYA_ENGINE_PATH}/resources/pack_resources_provider.cpp \
     $${NYA_ENGINE_PATH}/resources/resources.cpp \
     $${NYA_ENGINE_PATH}/scene/animation.cpp \
+    $${NYA_ENGINE_PATH}/scene/async_loader.cpp \
     $${NYA_ENGINE_PATH}/scene/camera.cpp \
+    $${NYA_ENGINE_PATH}/scene/hot_reload.cpp \
     $${NYA_ENGINE_PATH}/scene/material.cpp \
     $${NYA_ENGINE_PATH}/scene/mesh.cpp \
     $${NYA_ENGINE_PATH}/scene/postprocess.cpp \
@@ -69,8 +80,10 @@ macx: SOURCES -= $${NYA_ENGINE_PATH}/render/platform_specific_gl.cpp
 HEADERS += \
     $${NYA_ENGINE_PATH}/formats/dds.h \
     $${NYA_ENGINE_PATH}/formats/ktx.h \
+    $${NYA_ENGINE_PATH}/formats/mip_chain.h \
     $${NYA_ENGINE_PATH}/formats/math_expr_parser.h \
     $${NYA_ENGINE_PATH}/formats/nms.h \
+    $${NYA_ENGINE_PATH}/formats/pixel_convert.h \
     $${NYA_ENGINE_PATH}/formats/string_convert.h \
     $${NYA_ENGINE_PATH}/formats/text_parser.h \
     $${NYA_ENGINE_PATH}/formats/tga.h \
@@ -88,11 +101,20 @@ HEADERS += \
     $${NYA_ENGINE_PATH}/math/quadtree.h \
     $${NYA_ENGINE_PATH}/math/quaternion.h \
     $${NYA_ENGINE_PATH}/math/vector.h \
+    $${NYA_ENGINE_PATH}/memory/atomic.h \
+    $${NYA_ENGINE_PATH}/memory/frame_arena.h \
+    $${NYA_ENGINE_PATH}/memory/hash.h \
     $${NYA_ENGINE_PATH}/memory/indexed_map.h \
+    $${NYA_ENGINE_PATH}/memory/lru.h \
+    $${NYA_ENGINE_PATH}/memory/lz4.h \
     $${NYA_ENGINE_PATH}/memory/invalid_object.h \
+    $${NYA_ENGINE_PATH}/memory/mem_accounting.h \
     $${NYA_ENGINE_PATH}/memory/memory.h \
     $${NYA_ENGINE_PATH}/memory/memory_reader.h \
     $${NYA_ENGINE_PATH}/memory/memory_writer.h \
+    $${NYA_ENGINE_PATH}/memory/mutex.h \
+    $${NYA_ENGINE_PATH}/memory/name_id.h \
+    $${NYA_ENGINE_PATH}/memory/thread_pool.h \
     $${NYA_ENGINE_PATH}/memory/optional.h \
     $${NYA_ENGINE_PATH}/memory/pool.h \
     $${NYA_ENGINE_PATH}/memory/shared_ptr.h \
@@ -112,10 +134,13 @@ HEADERS += \
     $${NYA_ENGINE_PATH}/render/vbo.h \
     $${NYA_ENGINE_PATH}/resources/composite_resources_provider.h \
     $${NYA_ENGINE_PATH}/resources/file_resources_provider.h \
+    $${NYA_ENGINE_PATH}/resources/pack_resources_provider.h \
     $${NYA_ENGINE_PATH}/resources/resources.h \
     $${NYA_ENGINE_PATH}/resources/shared_resources.h \
     $${NYA_ENGINE_PATH}/scene/animation.h \
+    $${NYA_ENGINE_PATH}/scene/async_loader.h \
     $${NYA_ENGINE_PATH}/scene/camera.h \
+    $${NYA_ENGINE_PATH}/scene/hot_reload.h \
     $${NYA_ENGINE_PATH}/scene/material.h \
     $${NYA_ENGINE_PATH}/scene/mesh.h \
     $${NYA_ENGINE_PATH}/scene/postprocess.h \
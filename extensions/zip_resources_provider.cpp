@@ -3,6 +3,8 @@
 #include "zip_resources_provider.h"
 #include "memory/tmp_buffer.h"
 #include "memory/memory_reader.h"
+#include "memory/thread_pool.h"
+#include <string.h>
 #include "zlib.h"
 
 //ToDo: log
@@ -49,6 +51,8 @@ bool zip_resources_provider::open_archive(nya_resources::resource_data *data)
     if(!data)
         return false;
 
+    close_archive();
+
     typedef unsigned int uint;
     typedef unsigned short ushort;
 
@@ -98,6 +102,7 @@ bool zip_resources_provider::open_archive(nya_resources::resource_data *data)
         entry.offset=reader.read<uint>();
 
         entry.name=std::string((const char *)reader.get_data(),file_name_len);
+        entry.data_offset=0;
         reader.skip(file_name_len+extra_len+comment_len);
 
         if(entry.unpacked_size==0)
@@ -116,139 +121,385 @@ bool zip_resources_provider::open_archive(nya_resources::resource_data *data)
     return true;
 }
 
-namespace
+void zip_resources_provider::close_archive()
 {
+    if(m_res)
+        m_res->release();
 
-class zip_resource: public resource_data
+    m_res=0;
+    m_entries.clear();
+    clear_cache();
+}
+
+int zip_resources_provider::find_entry(const char *resource_name) const
 {
-public:
-    size_t get_size() { return m_unpacked_size; }
+    std::string name=fix_name(resource_name);
+    if(name.empty())
+        return -1;
 
-    bool read_all(void*data)
+    for(int i=0;i<(int)m_entries.size();++i)
     {
-        if(m_compression==0)
-            return m_res?m_res->read_all(data):false;
+        if(m_entries[i].name==name)
+            return i;
+    }
 
-        if(m_data.get_size()>0)
-            return m_data.copy_to(data,m_data.get_size());
+    return -1;
+}
 
-        return unpack_to(data);
-    }
+bool zip_resources_provider::get_data_offset(int idx,size_t &offset)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
 
-    bool read_chunk(void *data,size_t size,size_t offset)
+    zip_entry &e=m_entries[idx];
+    if(e.data_offset)
     {
-        if(m_compression==0)
-            return m_res?m_res->read_chunk(data,size,offset):false;
+        offset=e.data_offset;
+        return true;
+    }
 
-        m_data.allocate(m_unpacked_size);
-        if(!unpack_to(m_data.get_data()))
-        {
-            m_data.free();
-            return false;
-        }
+    if(!m_res)
+        return false;
+
+    struct { unsigned int sign; char skip[22]; unsigned short file_name_len,extra_field_len; } header;
+    if(!m_res->read_chunk(&header,30,e.offset))
+        return false;
+
+    if(header.sign!=0x04034b50)
+        return false;
+
+    e.data_offset=e.offset+30+header.file_name_len+header.extra_field_len;
+    offset=e.data_offset;
+    return true;
+}
+
+bool zip_resources_provider::read_packed(void *data,size_t size,size_t offset)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    return m_res?m_res->read_chunk(data,size,offset):false;
+}
+
+bool zip_resources_provider::unpack(int idx,void *data)
+{
+    if(!data)
+        return false;
+
+    const zip_entry &e=m_entries[idx];
+    if(!e.unpacked_size)
+        return true;
+
+    size_t offset;
+    if(!get_data_offset(idx,offset))
+        return false;
+
+    if(e.compression==0)
+        return read_packed(data,e.unpacked_size,offset);
+
+    if(e.compression!=8)
+        return false;
+
+    nya_memory::tmp_buffer_scoped packed_buf(e.packed_size);
+    if(!read_packed(packed_buf.get_data(),e.packed_size,offset))
+        return false;
+
+    z_stream infstream;
+    infstream.zalloc=Z_NULL;
+    infstream.zfree=Z_NULL;
+    infstream.opaque=Z_NULL;
+    infstream.avail_in=(uInt)e.packed_size;
+    infstream.next_in=(Bytef *)packed_buf.get_data();
+    infstream.avail_out=(uInt)e.unpacked_size;
+    infstream.next_out=(Bytef *)data;
+
+    if(inflateInit2(&infstream,-MAX_WBITS)!=Z_OK)
+        return false;
+
+    const int result=inflate(&infstream,Z_FINISH);
+    inflateEnd(&infstream);
+    return result==Z_STREAM_END && infstream.avail_out==0;
+}
+
+bool zip_resources_provider::cache_read(int idx,void *data,size_t size,size_t offset)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+
+    std::map<int,cache_list::iterator>::iterator it=m_cache_map.find(idx);
+    if(it==m_cache_map.end())
+        return false;
+
+    m_cache.splice(m_cache.begin(),m_cache,it->second);
+    memcpy(data,&it->second->data[offset],size);
+    return true;
+}
+
+void zip_resources_provider::cache_add(int idx,const void *data,size_t size)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+
+    if(!size || size>m_cache_limit || m_cache_map.find(idx)!=m_cache_map.end())
+        return;
 
-        return m_data.copy_to(data,size,offset);
+    cache_shrink(m_cache_limit-size);
+
+    m_cache.push_front(cache_entry());
+    m_cache.front().idx=idx;
+    m_cache.front().data.assign((const char *)data,(const char *)data+size);
+    m_cache_map[idx]=m_cache.begin();
+    m_cache_used+=size;
+}
+
+void zip_resources_provider::cache_shrink(size_t limit)
+{
+    while(m_cache_used>limit && !m_cache.empty())
+    {
+        m_cache_used-=m_cache.back().data.size();
+        m_cache_map.erase(m_cache.back().idx);
+        m_cache.pop_back();
     }
+}
+
+void zip_resources_provider::set_cache_size(size_t size)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    m_cache_limit=size;
+    cache_shrink(size);
+}
 
-    void release() { m_data.free(); delete this; }
+size_t zip_resources_provider::get_cache_used() const
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    return m_cache_used;
+}
+
+void zip_resources_provider::clear_cache()
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    cache_shrink(0);
+}
 
+//deflated entries are inflated sequentially, read_chunk continues the stream
+//when offset is ahead of it and restarts it otherwise
+class zip_resources_provider::zip_resource: public resource_data
+{
 public:
-    zip_resource(nya_resources::resource_data *res,unsigned int compression,unsigned int offset,unsigned int packed_size,unsigned int unpacked_size):
-                 m_res(res),m_compression(compression),m_offset(offset),m_packed_size(packed_size),m_unpacked_size(unpacked_size) {}
-private:
-    bool unpack_to(void *data)
+    size_t get_size() { return m_provider.m_entries[m_idx].unpacked_size; }
+
+    bool read_all(void*data)
     {
-        if(!data || !m_res)
+        if(!data)
             return false;
 
-        if(m_compression!=8)
+        const size_t size=get_size();
+        if(!size || m_provider.cache_read(m_idx,data,size,0))
+            return true;
+
+        if(!m_provider.unpack(m_idx,data))
             return false;
 
-        size_t offset=m_offset;
+        if(m_provider.m_entries[m_idx].compression!=0)
+            m_provider.cache_add(m_idx,data,size);
 
-        unsigned int sign;
-        if(!m_res->read_chunk(&sign,sizeof(sign),offset))
-            return false;
+        return true;
+    }
 
-        if(sign!=0x04034b50)
+    bool read_chunk(void *data,size_t size,size_t offset)
+    {
+        if(!data || !size || offset+size>get_size())
             return false;
 
-        offset+=26;
+        const zip_entry &e=m_provider.m_entries[m_idx];
+        size_t data_offset;
+        if(!m_provider.get_data_offset(m_idx,data_offset))
+            return false;
 
-        struct { unsigned short file_name_len,extra_field_len; } header;
+        if(e.compression==0)
+            return m_provider.read_packed(data,size,data_offset+offset);
 
-        if(!m_res->read_chunk(&header,sizeof(header),offset))
+        if(e.compression!=8)
             return false;
 
-        offset+=sizeof(header);
+        if(m_provider.cache_read(m_idx,data,size,offset))
+            return true;
 
-        std::string name;
-        name.resize(header.file_name_len);
+        if(!m_stream_started || offset<m_out_pos)
+        {
+            end_stream();
+            m_stream.zalloc=Z_NULL;
+            m_stream.zfree=Z_NULL;
+            m_stream.opaque=Z_NULL;
+            m_stream.next_in=Z_NULL;
+            m_stream.avail_in=0;
+            if(inflateInit2(&m_stream,-MAX_WBITS)!=Z_OK)
+                return false;
+
+            m_stream_started=true;
+            m_in_pos=m_out_pos=0;
+            m_in_buf.allocate(e.packed_size<stream_buffer_size?e.packed_size:stream_buffer_size);
+        }
 
-        if(!m_res->read_chunk(&name[0],header.file_name_len,offset))
-            return false;
+        while(m_out_pos<offset)
+        {
+            const size_t skip_size=offset-m_out_pos<stream_buffer_size?offset-m_out_pos:stream_buffer_size;
+            m_skip_buf.allocate(stream_buffer_size);
+            if(!inflate_to(m_skip_buf.get_data(),skip_size,data_offset))
+                return false;
+        }
 
-        offset+=header.file_name_len+header.extra_field_len;
+        return inflate_to(data,size,data_offset);
+    }
 
-        nya_memory::tmp_buffer_scoped packed_buf(m_packed_size);
-        m_res->read_chunk(packed_buf.get_data(),m_packed_size,offset);
+    void release() { end_stream(); delete this; }
 
-        z_stream infstream;
-        infstream.zalloc=Z_NULL;
-        infstream.zfree=Z_NULL;
-        infstream.opaque=Z_NULL;
-        infstream.avail_in=(uInt)packed_buf.get_size();
-        infstream.next_in=(Bytef *)packed_buf.get_data();
-        infstream.avail_out=(uInt)m_unpacked_size;
-        infstream.next_out=(Bytef *)data;
+public:
+    zip_resource(zip_resources_provider &provider,int idx): m_provider(provider),m_idx(idx),
+                                                        m_stream_started(false),m_in_pos(0),m_out_pos(0) {}
 
-        inflateInit2(&infstream,-MAX_WBITS);
-        if(inflate(&infstream,Z_NO_FLUSH)!=Z_OK)
-            return false;
+private:
+    bool inflate_to(void *data,size_t size,size_t data_offset)
+    {
+        const zip_entry &e=m_provider.m_entries[m_idx];
+
+        m_stream.next_out=(Bytef *)data;
+        m_stream.avail_out=(uInt)size;
+        while(m_stream.avail_out)
+        {
+            if(!m_stream.avail_in && m_in_pos<e.packed_size)
+            {
+                const size_t in_size=e.packed_size-m_in_pos<m_in_buf.get_size()?e.packed_size-m_in_pos:m_in_buf.get_size();
+                if(!m_provider.read_packed(m_in_buf.get_data(),in_size,data_offset+m_in_pos))
+                    return fail_stream();
+
+                m_in_pos+=in_size;
+                m_stream.next_in=(Bytef *)m_in_buf.get_data();
+                m_stream.avail_in=(uInt)in_size;
+            }
+
+            const int result=inflate(&m_stream,Z_NO_FLUSH);
+            if(result==Z_STREAM_END)
+            {
+                if(m_stream.avail_out)
+                    return fail_stream();
+
+                break;
+            }
+
+            if(result!=Z_OK)
+                return fail_stream();
+        }
 
-        inflateEnd(&infstream);
+        m_out_pos+=size;
         return true;
     }
 
+    bool fail_stream() { end_stream(); return false; }
+
+    void end_stream()
+    {
+        if(m_stream_started)
+            inflateEnd(&m_stream);
+
+        m_stream_started=false;
+        m_in_buf.free();
+        m_skip_buf.free();
+    }
+
 private:
-    nya_resources::resource_data *m_res;
-    nya_memory::tmp_buffer_ref m_data;
-    unsigned int m_compression,m_offset,m_packed_size,m_unpacked_size;
+    static const size_t stream_buffer_size=16*1024;
+
+    zip_resources_provider &m_provider;
+    int m_idx;
+
+    z_stream m_stream;
+    bool m_stream_started;
+    size_t m_in_pos;
+    size_t m_out_pos;
+    nya_memory::tmp_buffer_ref m_in_buf;
+    nya_memory::tmp_buffer_ref m_skip_buf;
+};
+
+resource_data *zip_resources_provider::access(const char *resource_name)
+{
+    const int idx=find_entry(resource_name);
+    if(idx<0)
+        return 0;
+
+    return new zip_resource(*this,idx);
+}
+
+namespace
+{
+
+struct preload_data
+{
+    zip_resources_provider *provider;
+    int idx;
 };
 
 }
 
-resource_data *zip_resources_provider::access(const char *resource_name)
+void zip_resources_provider::preload_task(void *data)
 {
-    std::string name=fix_name(resource_name);
-    if(name.empty())
+    const preload_data &d=*(preload_data *)data;
+    zip_resources_provider &p=*d.provider;
+    const zip_entry &e=p.m_entries[d.idx];
+
+    nya_memory::tmp_buffer_scoped buf(e.unpacked_size);
+    if(p.unpack(d.idx,buf.get_data()))
+        p.cache_add(d.idx,buf.get_data(),e.unpacked_size);
+}
+
+int zip_resources_provider::preload(const char **names,int count,unsigned int threads_count)
+{
+    if(!names || count<=0 || !m_cache_limit)
         return 0;
 
-    for(int i=0;i<(int)m_entries.size();++i)
+    std::vector<preload_data> tasks;
+    for(int i=0;i<count;++i)
     {
-        const zip_entry &e=m_entries[i];
-        if(e.name==name)
-            return new zip_resource(m_res,e.compression,e.offset,e.packed_size,e.unpacked_size);
+        const int idx=find_entry(names[i]);
+        if(idx<0 || !m_entries[idx].unpacked_size || m_entries[idx].unpacked_size>m_cache_limit)
+            continue;
+
+        preload_data d;
+        d.provider=this;
+        d.idx=idx;
+        tasks.push_back(d);
     }
 
-    return 0;
-}
+    if(tasks.empty())
+        return 0;
 
-bool zip_resources_provider::has(const char *resource_name)
-{
-    std::string name=fix_name(resource_name);
-    if(name.empty())
-        return false;
+    if(!threads_count)
+        threads_count=nya_memory::thread_pool::get_hardware_threads_count();
+    if(threads_count>tasks.size())
+        threads_count=(unsigned int)tasks.size();
 
-    for(int i=0;i<(int)m_entries.size();++i)
+    nya_memory::thread_pool pool;
+    if(threads_count>1 && pool.start(threads_count))
     {
-        if(m_entries[i].name==name)
-            return true;
+        for(size_t i=0;i<tasks.size();++i)
+            pool.add_task(preload_task,&tasks[i]);
+
+        pool.stop();
+    }
+    else
+    {
+        for(size_t i=0;i<tasks.size();++i)
+            preload_task(&tasks[i]);
     }
 
-    return false;
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    int cached=0;
+    for(size_t i=0;i<tasks.size();++i)
+    {
+        if(m_cache_map.find(tasks[i].idx)!=m_cache_map.end())
+            ++cached;
+    }
+
+    return cached;
 }
 
+bool zip_resources_provider::has(const char *resource_name) { return find_entry(resource_name)>=0; }
+
 int zip_resources_provider::get_resources_count() { return (int)m_entries.size(); }
 
 const char *zip_resources_provider::get_resource_name(int idx)
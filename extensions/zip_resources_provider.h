@@ -3,8 +3,11 @@
 #pragma once
 
 #include "resources/resources.h"
+#include "memory/mutex.h"
 #include <vector>
 #include <string>
+#include <list>
+#include <map>
 
 namespace nya_resources
 {
@@ -14,7 +17,7 @@ class zip_resources_provider: public resources_provider
 public:
     bool open_archive(const char *archive_name);
     bool open_archive(nya_resources::resource_data *data);
-    void close_archive() { if(m_res) m_res->release(); m_entries.clear(); }
+    void close_archive();
 
 public:
     resource_data *access(const char *resource_name);
@@ -25,9 +28,38 @@ public:
     const char *get_resource_name(int idx);
 
 public:
-    zip_resources_provider(): m_res(0) {}
+    //decompressed entries are kept in a lru cache up to size bytes, 0 disables the cache
+    void set_cache_size(size_t size);
+    size_t get_cache_size() const { return m_cache_limit; }
+    size_t get_cache_used() const;
+    void clear_cache();
+
+    //decompresses entries into the cache on threads_count threads, 0 for hardware threads count
+    //returns count of entries cached, entries over the cache size are skipped
+    int preload(const char **names,int count,unsigned int threads_count=0);
+
+public:
+    zip_resources_provider(): m_res(0),m_cache_used(0),m_cache_limit(0) {}
     ~zip_resources_provider() { close_archive(); }
 
+private:
+    zip_resources_provider(const zip_resources_provider &);
+    void operator = (const zip_resources_provider &);
+
+private:
+    class zip_resource;
+
+    int find_entry(const char *name) const;
+    bool get_data_offset(int idx,size_t &offset); //local header is read once
+    bool read_packed(void *data,size_t size,size_t offset);
+    bool unpack(int idx,void *data);
+
+    bool cache_read(int idx,void *data,size_t size,size_t offset);
+    void cache_add(int idx,const void *data,size_t size);
+    void cache_shrink(size_t limit);
+
+    static void preload_task(void *data);
+
 private:
     nya_resources::resource_data *m_res;
 
@@ -38,9 +70,25 @@ private:
         unsigned int offset;
         unsigned int packed_size;
         unsigned int unpacked_size;
+        unsigned int data_offset; //0 if not yet known
     };
 
     std::vector<zip_entry> m_entries;
+
+    struct cache_entry
+    {
+        int idx;
+        std::vector<char> data;
+    };
+
+    typedef std::list<cache_entry> cache_list; //most recently used first
+    cache_list m_cache;
+    std::map<int,cache_list::iterator> m_cache_map;
+    size_t m_cache_used;
+    size_t m_cache_limit;
+
+    //guards archive reads and the cache, inflate runs unlocked
+    mutable nya_memory::mutex m_mutex;
 };
 
 }
@@ -1,10 +1,18 @@
 //https://code.google.com/p/nya-engine/
 
 #include "dds.h"
+#include "pixel_convert.h"
 #include "memory/memory_reader.h"
 #include "memory/tmp_buffer.h"
 #include "resources/resources.h"
+#include "memory/thread_pool.h"
 #include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+#endif
 
 namespace nya_formats
 {
@@ -183,6 +191,67 @@ void dds::flip_vertical(const void *from_data,void *to_data)
     }
 }
 
+size_t dds::get_row_size(pixel_format pf,unsigned int width)
+{
+    switch(pf)
+    {
+        case bgra: return width*4;
+        case bgr: return width*3;
+        case greyscale: return width;
+        case dxt1: return (width+3)/4*8;
+        case dxt2:
+        case dxt3:
+        case dxt4:
+        case dxt5: return (width+3)/4*16;
+        default: return 0;
+    }
+}
+
+unsigned int dds::get_rows_count(pixel_format pf,unsigned int height)
+{
+    return pf<=dxt5?(height+3)/4:height;
+}
+
+void dds::flip_rows(pixel_format pf,unsigned int height,void *rows,size_t row_size,unsigned int count)
+{
+    if(!rows || !count)
+        return;
+
+    nya_formats::flip_rows(rows,rows,row_size,count);
+    if(pf>dxt5 || height==1)
+        return;
+
+    //same block flips as flip_dxt
+    unsigned char *d=(unsigned char *)rows;
+    const size_t size=row_size*count;
+    switch(pf)
+    {
+        case dxt1:
+            if(height==2)
+            {
+                for(size_t k=0;k<size;k+=8)
+                    std::swap((d+k)[4],(d+k)[5]);
+            }
+            else
+            {
+                for(size_t k=0;k<size;k+=8)
+                    flip_dxt1_block_full(d+k);
+            }
+            break;
+
+        case dxt2:
+        case dxt3:
+            for(size_t k=0;k<size;k+=16)
+                flip_dxt3_block_full(d+k);
+            break;
+
+        default:
+            for(size_t k=0;k<size;k+=16)
+                flip_dxt5_block_full(d+k);
+            break;
+    }
+}
+
 size_t dds::get_decoded_size() const
 {
     size_t size=0;
@@ -207,12 +276,17 @@ void dds::decode_palette8_rgba(void *decoded_data) const
         memcpy(out,&palette[*inds],4);
 }
 
-inline int unpack565(const unsigned char* src,unsigned char* dst)
+namespace
 {
-    typedef unsigned char uchar;
 
-    int value=(int)src[0] | ((int)src[1]<<8);
+typedef unsigned char uchar;
+typedef uint32_t uint;
 
+//byte order of decoded pixels is rgba, alpha is the last byte on any endianness
+inline uint alpha_bits(uchar a) { uint v=0; ((uchar *)&v)[3]=a; return v; }
+
+inline void unpack565(int value,uchar *dst)
+{
     const uchar r=(uchar)((value >> 11) & 0x1f);
     const uchar g=(uchar)((value >> 5) & 0x3f);
     const uchar b=(uchar)(value & 0x1f);
@@ -221,26 +295,22 @@ inline int unpack565(const unsigned char* src,unsigned char* dst)
     dst[1]=(g << 2) | (g >> 4);
     dst[2]=(b << 3) | (b >> 2);
     dst[3]=255;
-
-    return value;
 }
 
-inline void decompress_color(const void *src,void *dst,bool is_dxt1)
+inline void make_color_palette(const uchar *src,bool is_dxt1,uint *palette)
 {
-    typedef unsigned char uchar;
-
-    const uchar* src_buf=(uchar *)src;
-    if(!is_dxt1)
-        src_buf+=8;
+    const int a=(int)src[0] | ((int)src[1]<<8), b=(int)src[2] | ((int)src[3]<<8);
 
     uchar codes[16];
-    const int a=unpack565(src_buf,codes), b=unpack565(src_buf+2,codes+4);
+    unpack565(a,codes);
+    unpack565(b,codes+4);
 
+    const bool three_colors=is_dxt1 && a<=b;
     for(int i=0;i<3;++i)
     {
         const int c=codes[i], d=codes[i+4];
 
-        if(is_dxt1 && a<=b)
+        if(three_colors)
         {
             codes[i+8]=(uchar)((c+d)/2);
             codes[i+12]=0;
@@ -253,126 +323,525 @@ inline void decompress_color(const void *src,void *dst,bool is_dxt1)
     }
 
     codes[8+3]=255;
-    codes[12+3]=(is_dxt1 && a<=b)?0:255;
+    codes[12+3]=three_colors?0:255;
 
-    uchar indices[16];
-    for(int i=0;i<4;++i)
-    {
-        const uchar packed=src_buf[i+4];
-        uchar* ind=indices + i*4;
+    memcpy(palette,codes,sizeof(codes));
+}
 
-        ind[0]=packed & 0x3;
-        ind[1]=(packed >> 2) & 0x3;
-        ind[2]=(packed >> 4) & 0x3;
-        ind[3]=(packed >> 6) & 0x3;
+//alpha values are placed as alpha_bits
+inline void decode_dxt3_alpha(const uchar *src,uint *alpha)
+{
+    for(int i=0;i<16;i+=2,++src)
+    {
+        const uchar lo= *src & 0x0f, hi= *src & 0xf0;
+        alpha[i]=alpha_bits(lo | (lo<<4));
+        alpha[i+1]=alpha_bits(hi | (hi>>4));
     }
+}
 
-    for(int i=0;i<16;++i)
+inline void decode_dxt5_alpha(const uchar *src,uint *alpha)
+{
+    const int alpha0=src[0], alpha1=src[1];
+
+    uint codes[8];
+    codes[0]=alpha_bits(src[0]), codes[1]=alpha_bits(src[1]);
+    if(alpha0<=alpha1)
+    {
+        for(int i=1;i<5;++i)
+            codes[i+1]=alpha_bits((uchar)(((5-i)*alpha0 + i*alpha1 )/5));
+
+        codes[6]=alpha_bits(0), codes[7]=alpha_bits(255);
+    }
+    else
     {
-        const uchar offset=indices[i]*4;
-        for(int j=0;j<4;++j)
-            ((uchar *)dst)[i*4 + j]=codes[offset+j];
+        for(int i=1;i<7;++i)
+            codes[i+1]=alpha_bits((uchar)(((7-i)*alpha0 + i*alpha1 )/7));
     }
+
+    uint64_t indices=0;
+    for(int i=0;i<6;++i)
+        indices|=(uint64_t)src[i+2] << 8*i;
+
+    for(int i=0;i<16;++i,indices>>=3)
+        alpha[i]=codes[indices & 0x7];
 }
 
-inline void decompress_dxt3_alpha(const void *src,void *dst)
+//four pixels wide primitives, a neon port only needs another set of these
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP>=2)
+    #define DDS_SIMD
+
+    typedef __m128i pixels4;
+
+    inline pixels4 splat4(uint v) { return _mm_set1_epi32((int)v); }
+    inline pixels4 load4(const uint *src) { return _mm_loadu_si128((const __m128i *)src); }
+    inline void store4(uint *dst,pixels4 p) { _mm_storeu_si128((__m128i *)dst,p); }
+    inline pixels4 and4(pixels4 a,pixels4 b) { return _mm_and_si128(a,b); }
+    inline pixels4 or4(pixels4 a,pixels4 b) { return _mm_or_si128(a,b); }
+    inline pixels4 select4(pixels4 mask,pixels4 a,pixels4 b) { return _mm_or_si128(_mm_and_si128(mask,a),_mm_andnot_si128(mask,b)); }
+    inline pixels4 bits4(uint b0,uint b1,uint b2,uint b3) { return _mm_set_epi32((int)b3,(int)b2,(int)b1,(int)b0); }
+    inline pixels4 test4(pixels4 v,pixels4 bits) { return _mm_cmpeq_epi32(_mm_and_si128(v,bits),bits); } //all ones where bits are set
+#endif
+
+//decodes a 4x4 color block to dst rows, alpha replaces the color alpha if not 0
+inline void decode_color(const uchar *src,bool is_dxt1,const uint *alpha,uint *dst,size_t pitch)
 {
-    typedef unsigned char uchar;
+    uint palette[4];
+    make_color_palette(src,is_dxt1,palette);
+
+    const uchar *indices=src+4;
 
-    const uchar *src_buf=(uchar *)src;
-    uchar *dst_buf=(uchar *)dst;
+#ifdef DDS_SIMD
+    const pixels4 c0=splat4(palette[0]), c1=splat4(palette[1]), c2=splat4(palette[2]), c3=splat4(palette[3]);
+    const pixels4 low_bits=bits4(0x01,0x04,0x10,0x40), high_bits=bits4(0x02,0x08,0x20,0x80);
+    const pixels4 rgb_mask=splat4(~alpha_bits(255));
 
-    for(int i=0;i<8*8;i+=8,++src_buf)
+    for(int y=0;y<4;++y,dst+=pitch)
     {
-        const uchar lo= *src_buf & 0x0f, hi= *src_buf & 0xf0;
-        dst_buf[i+3] = lo | (lo<<4);
-        dst_buf[i+7] = hi | (hi>>4);
+        const pixels4 idx=splat4(indices[y]);
+        const pixels4 low=test4(idx,low_bits);
+        pixels4 p=select4(test4(idx,high_bits),select4(low,c3,c2),select4(low,c1,c0));
+        if(alpha)
+            p=or4(and4(p,rgb_mask),load4(alpha+y*4));
+
+        store4(dst,p);
     }
+#else
+    const uint rgb_mask=~alpha_bits(255);
+    for(int y=0;y<4;++y,dst+=pitch)
+    {
+        for(int x=0;x<4;++x)
+        {
+            const uint p=palette[(indices[y] >> 2*x) & 0x3];
+            dst[x]=alpha?((p & rgb_mask) | alpha[y*4+x]):p;
+        }
+    }
+#endif
 }
 
-inline void decompress_dxt5_alpha(const void *src,void *dst)
+inline void decode_block(dds::pixel_format pf,const uchar *src,uint *dst,size_t pitch)
 {
-    typedef unsigned char uchar;
+    uint alpha[16];
+    switch(pf)
+    {
+        case dds::dxt1: decode_color(src,true,0,dst,pitch); break;
 
-    const uchar *src_buf=(uchar *)src;
-    uchar *dst_buf=(uchar *)dst;
+        case dds::dxt2:
+        case dds::dxt3:
+            decode_dxt3_alpha(src,alpha);
+            decode_color(src+8,false,alpha,dst,pitch);
+            break;
 
-    const int alpha0=src_buf[0], alpha1=src_buf[1];
+        case dds::dxt4:
+        case dds::dxt5:
+            decode_dxt5_alpha(src,alpha);
+            decode_color(src+8,false,alpha,dst,pitch);
+            break;
 
-    uchar codes[8];
-    codes[0]=src_buf[0], codes[1]=src_buf[1];
-    if(alpha0<=alpha1)
+        default: break;
+    }
+}
+
+struct dxt_image
+{
+    const uchar *src;
+    uint *dst;
+    uint width;
+    uint height;
+};
+
+struct dxt_task
+{
+    dds::pixel_format pf;
+    dxt_image image;
+    uint block_row_from;
+    uint block_row_to;
+};
+
+void decode_dxt_rows(const dxt_task &t)
+{
+    const uint bpb=t.pf==dds::dxt1?8:16;
+    const uint w=t.image.width, h=t.image.height;
+    const uint blocks_w=(w+3)/4;
+
+    const uchar *src=t.image.src+(size_t)t.block_row_from*blocks_w*bpb;
+    for(uint by=t.block_row_from;by<t.block_row_to;++by)
     {
-        for(int i=1;i<5;++i)
-            codes[i+1]=(uchar)(((5-i)*alpha0 + i*alpha1 )/5);
+        const uint y=by*4;
+        const uint rows=h-y<4?h-y:4;
+        uint *dst=t.image.dst+(size_t)y*w;
+
+        for(uint x=0;x<w;x+=4,src+=bpb)
+        {
+            if(rows==4 && x+4<=w)
+            {
+                decode_block(t.pf,src,dst+x,w);
+                continue;
+            }
 
-        codes[6]=0, codes[7]=255;
+            //edge blocks of images with sizes not multiple of 4
+            uint block[16];
+            decode_block(t.pf,src,block,4);
+            for(uint py=0;py<rows;++py)
+                memcpy(dst+py*w+x,block+py*4,((x+4<w)?4:(w-x))*sizeof(uint));
+        }
     }
-    else
+}
+
+void decode_dxt_task(void *data) { decode_dxt_rows(*(const dxt_task *)data); }
+
+const size_t min_parallel_blocks=16384; //smaller textures are decoded faster than threads start
+const size_t task_blocks=4096;
+
+//on the caller's pool if given, otherwise on a pool of threads_count threads started for the call
+template<typename t> void run_tasks(std::vector<t> &tasks,nya_memory::thread_pool::task_function function,bool parallel,
+                                    nya_memory::thread_pool *pool,unsigned int threads_count)
+{
+    nya_memory::thread_pool call_pool;
+    if(parallel && tasks.size()>1 && !pool)
     {
-        for(int i=1;i<7;++i)
-            codes[i+1]=(uchar)(((7-i)*alpha0 + i*alpha1 )/7);
+        if(!threads_count)
+            threads_count=nya_memory::thread_pool::get_hardware_threads_count();
+
+        if(threads_count>1 && call_pool.start(threads_count))
+            pool=&call_pool;
     }
 
-    src_buf+=2;
-    uchar indices[16];
-    uchar* dest=indices;
-    for(int i=0;i<2;++i)
+    if(parallel && tasks.size()>1 && pool && pool->is_started())
     {
-        unsigned int value=0;
-        for(int j=0;j<3;++j)
-            value|=((*src_buf++) << 8*j);
+        for(size_t i=0;i<tasks.size();++i)
+        {
+            if(!pool->add_task(function,&tasks[i]))
+                function(&tasks[i]);
+        }
 
-        for(int j=0;j<8;++j)
-            *dest++ = (uchar)(value >> 3*j) & 0x7;
+        pool->wait_idle();
+        return;
     }
 
-    for(int i=0;i<16;++i)
-        dst_buf[4*i+3]=codes[indices[i]];
+    for(size_t i=0;i<tasks.size();++i)
+        function(&tasks[i]);
+}
+
 }
 
-void dds::decode_dxt(void *decoded_data) const
+void dds::decode_dxt(void *decoded_data,unsigned int threads_count) const { decode_dxt(decoded_data,0,threads_count); }
+void dds::decode_dxt(void *decoded_data,nya_memory::thread_pool &pool) const { decode_dxt(decoded_data,&pool,0); }
+
+void dds::decode_dxt(void *decoded_data,nya_memory::thread_pool *pool,unsigned int threads_count) const
 {
-    typedef unsigned int uint;
-    const char* src_buf=(char *)data;
+    if(pf!=dxt1 && pf!=dxt2 && pf!=dxt3 && pf!=dxt4 && pf!=dxt5)
+        return;
+
     const uint bpb=pf==dxt1?8:16;
 
+    //split faces and mipmaps into tasks of block rows
+    std::vector<dxt_task> tasks;
+    size_t blocks_count=0;
+    const uchar *src=(const uchar *)data;
+    uint *dst=(uint *)decoded_data;
     for(int f=0;f<(type==texture_cube?6:1);++f)
     {
         for(uint i=0,w=width,h=height;i<mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
         {
-            for(uint y=0;y<h;y+=4) for(uint x=0;x<w;x+=4)
+            const uint blocks_w=(w+3)/4, blocks_h=(h+3)/4;
+            const uint rows_per_task=blocks_w<task_blocks?uint(task_blocks/blocks_w):1;
+
+            dxt_task t;
+            t.pf=pf;
+            t.image.src=src;
+            t.image.dst=dst;
+            t.image.width=w;
+            t.image.height=h;
+            for(uint by=0;by<blocks_h;by+=rows_per_task)
             {
-                uint rgba[16];
+                t.block_row_from=by;
+                t.block_row_to=by+rows_per_task<blocks_h?by+rows_per_task:blocks_h;
+                tasks.push_back(t);
+            }
 
-                switch(pf)
-                {
-                    case dxt1: decompress_color(src_buf,rgba,true); break;
+            blocks_count+=blocks_w*blocks_h;
+            src+=(size_t)blocks_w*blocks_h*bpb;
+            dst+=(size_t)w*h;
+        }
+    }
 
-                    case dxt2:
-                    case dxt3:
-                        decompress_color(src_buf,rgba,false);
-                        decompress_dxt3_alpha(src_buf,rgba);
-                        break;
+    run_tasks(tasks,decode_dxt_task,blocks_count>=min_parallel_blocks,pool,threads_count);
+}
 
-                    case dxt4:
-                    case dxt5:
-                        decompress_color(src_buf,rgba,false);
-                        decompress_dxt5_alpha(src_buf,rgba);
-                        break;
+namespace
+{
 
-                    default: return;
-                }
+inline int pack565(const uchar *c)
+{
+    return ((c[0]*31+127)/255)<<11 | ((c[1]*63+127)/255)<<5 | ((c[2]*31+127)/255);
+}
+
+inline int color_distance(const uchar *a,const uchar *b)
+{
+    const int r=a[0]-b[0], g=a[1]-b[1], bl=a[2]-b[2];
+    return r*r+g*g+bl*bl;
+}
+
+//endpoints are the block pixels farthest along the principal axis of colors
+void find_endpoints(const uchar *px,const bool *used,const uchar *&c0,const uchar *&c1)
+{
+    float mean[3]={0.0f,0.0f,0.0f};
+    int count=0;
+    for(int i=0;i<16;++i)
+    {
+        if(!used[i])
+            continue;
+
+        for(int j=0;j<3;++j)
+            mean[j]+=px[i*4+j];
+        ++count;
+    }
+
+    for(int j=0;j<3;++j)
+        mean[j]/=count;
+
+    float cov[3][3]={{0.0f}};
+    for(int i=0;i<16;++i)
+    {
+        if(!used[i])
+            continue;
+
+        const float d[3]={px[i*4]-mean[0],px[i*4+1]-mean[1],px[i*4+2]-mean[2]};
+        for(int j=0;j<3;++j)
+        {
+            for(int k=0;k<3;++k)
+                cov[j][k]+=d[j]*d[k];
+        }
+    }
+
+    //power iteration starting from the row of the largest variance
+    int row=0;
+    for(int j=1;j<3;++j)
+    {
+        if(cov[j][j]>cov[row][row])
+            row=j;
+    }
+
+    float axis[3]={cov[row][0],cov[row][1],cov[row][2]};
+    for(int it=0;it<4;++it)
+    {
+        float a[3],m=0.0f;
+        for(int j=0;j<3;++j)
+        {
+            a[j]=cov[j][0]*axis[0]+cov[j][1]*axis[1]+cov[j][2]*axis[2];
+            const float abs_a=a[j]<0.0f?-a[j]:a[j];
+            if(abs_a>m)
+                m=abs_a;
+        }
+
+        if(m<1e-6f)
+            break;
+
+        for(int j=0;j<3;++j)
+            axis[j]=a[j]/m;
+    }
 
-                for(uint py=0,sy=y; py<16 && sy<h; py+=4,++sy)
-                    memcpy((uint *)decoded_data+w*sy+x,&rgba[py],((x+4<w)?4:(w-x))*sizeof(uint));
-                
-                src_buf+=bpb;
+    float min_dot=0.0f,max_dot=0.0f;
+    c0=c1=0;
+    for(int i=0;i<16;++i)
+    {
+        if(!used[i])
+            continue;
+
+        const float d=px[i*4]*axis[0]+px[i*4+1]*axis[1]+px[i*4+2]*axis[2];
+        if(!c0 || d>max_dot)
+            max_dot=d,c0=px+i*4;
+        if(!c1 || d<min_dot)
+            min_dot=d,c1=px+i*4;
+    }
+}
+
+//px is 16 rgba pixels, transparent pixels of dxt1 are encoded with the three colors mode
+void encode_color(const uchar *px,bool is_dxt1,uchar *dst)
+{
+    bool used[16],transparent=false,any=false;
+    for(int i=0;i<16;++i)
+    {
+        used[i]=!is_dxt1 || px[i*4+3]>=128;
+        transparent|=!used[i];
+        any|=used[i];
+    }
+
+    if(!any)
+    {
+        memset(dst,0,4);
+        memset(dst+4,0xff,4);
+        return;
+    }
+
+    const uchar *c0,*c1;
+    find_endpoints(px,used,c0,c1);
+
+    int a=pack565(c0),b=pack565(c1);
+    if(transparent?a>b:a<b)
+        std::swap(a,b);
+
+    dst[0]=(uchar)(a&0xff), dst[1]=(uchar)(a>>8);
+    dst[2]=(uchar)(b&0xff), dst[3]=(uchar)(b>>8);
+
+    uint palette[4];
+    make_color_palette(dst,is_dxt1,palette);
+    const uchar *colors=(const uchar *)palette;
+    const int colors_count=is_dxt1 && a<=b?3:4;
+
+    memset(dst+4,0,4);
+    for(int i=0;i<16;++i)
+    {
+        int idx=3;
+        if(used[i])
+        {
+            int best=-1;
+            for(int j=0;j<colors_count;++j)
+            {
+                const int d=color_distance(px+i*4,colors+j*4);
+                if(best<0 || d<best)
+                    best=d,idx=j;
             }
+        }
 
-            decoded_data=(char *)decoded_data+(w*h)*4;
+        dst[4+i/4]|=(uchar)(idx<<(i%4)*2);
+    }
+}
+
+void encode_dxt5_alpha(const uchar *px,uchar *dst)
+{
+    int min_a=255,max_a=0;
+    for(int i=0;i<16;++i)
+    {
+        const int a=px[i*4+3];
+        if(a<min_a)
+            min_a=a;
+        if(a>max_a)
+            max_a=a;
+    }
+
+    dst[0]=(uchar)max_a, dst[1]=(uchar)min_a;
+
+    int codes[8];
+    codes[0]=max_a, codes[1]=min_a;
+    for(int i=1;i<7;++i)
+        codes[i+1]=((7-i)*max_a + i*min_a)/7;
+
+    uint64_t indices=0;
+    for(int i=0;i<16 && max_a>min_a;++i)
+    {
+        const int a=px[i*4+3];
+        int idx=0,best=256;
+        for(int j=0;j<8;++j)
+        {
+            const int d=a>codes[j]?a-codes[j]:codes[j]-a;
+            if(d<best)
+                best=d,idx=j;
         }
+
+        indices|=(uint64_t)idx << 3*i;
+    }
+
+    for(int i=0;i<6;++i)
+        dst[i+2]=(uchar)(indices >> 8*i);
+}
+
+void encode_block(dds::pixel_format pf,const uchar *px,uchar *dst)
+{
+    if(pf==dds::dxt1)
+    {
+        encode_color(px,true,dst);
+        return;
     }
+
+    encode_dxt5_alpha(px,dst);
+    encode_color(px,false,dst+8);
+}
+
+struct dxt_encode_task
+{
+    dds::pixel_format pf;
+    const uchar *src;
+    uchar *dst;
+    uint width;
+    uint height;
+    uint block_row_from;
+    uint block_row_to;
+};
+
+void encode_dxt_rows(const dxt_encode_task &t)
+{
+    const uint bpb=t.pf==dds::dxt1?8:16;
+    const uint w=t.width, h=t.height;
+    const uint blocks_w=(w+3)/4;
+
+    uchar *dst=t.dst+(size_t)t.block_row_from*blocks_w*bpb;
+    for(uint by=t.block_row_from;by<t.block_row_to;++by)
+    {
+        for(uint x=0;x<w;x+=4,dst+=bpb)
+        {
+            //edge pixels are repeated in blocks of images with sizes not multiple of 4
+            uchar block[16*4];
+            for(uint py=0;py<4;++py)
+            {
+                const uint y=by*4+py<h?by*4+py:h-1;
+                for(uint px=0;px<4;++px)
+                    memcpy(block+(py*4+px)*4,t.src+((size_t)y*w+(x+px<w?x+px:w-1))*4,4);
+            }
+
+            encode_block(t.pf,block,dst);
+        }
+    }
+}
+
+void encode_dxt_task(void *data) { encode_dxt_rows(*(const dxt_encode_task *)data); }
+
+}
+
+size_t dds::get_dxt_size(pixel_format pf,unsigned int width,unsigned int height)
+{
+    if(pf!=dxt1 && pf!=dxt3 && pf!=dxt5)
+        return 0;
+
+    return (size_t)((width+3)/4)*((height+3)/4)*(pf==dxt1?8:16);
+}
+
+void dds::encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,unsigned int threads_count)
+{
+    encode_dxt(pf,rgba,width,height,encoded_data,0,threads_count);
+}
+
+void dds::encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,nya_memory::thread_pool &pool)
+{
+    encode_dxt(pf,rgba,width,height,encoded_data,&pool,0);
+}
+
+void dds::encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,
+                     nya_memory::thread_pool *pool,unsigned int threads_count)
+{
+    if(pf!=dxt1 && pf!=dxt5)
+        return;
+
+    dxt_encode_task t;
+    t.pf=pf;
+    t.src=(const uchar *)rgba;
+    t.dst=(uchar *)encoded_data;
+    t.width=width;
+    t.height=height;
+
+    const uint blocks_w=(width+3)/4, blocks_h=(height+3)/4;
+    const uint rows_per_task=blocks_w<task_blocks?uint(task_blocks/blocks_w):1;
+
+    std::vector<dxt_encode_task> tasks;
+    for(uint by=0;by<blocks_h;by+=rows_per_task)
+    {
+        t.block_row_from=by;
+        t.block_row_to=by+rows_per_task<blocks_h?by+rows_per_task:blocks_h;
+        tasks.push_back(t);
+    }
+
+    //encoding is several times slower than decoding, so threads pay off earlier
+    run_tasks(tasks,encode_dxt_task,(size_t)blocks_w*blocks_h>=min_parallel_blocks/4,pool,threads_count);
 }
 
 size_t dds::decode_header(const void *data,size_t size)
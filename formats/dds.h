@@ -4,6 +4,8 @@
 
 #include <stddef.h>
 
+namespace nya_memory { class thread_pool; }
+
 namespace nya_formats
 {
 
@@ -50,9 +52,30 @@ public:
     size_t decode_header(const void *data,size_t size); //0 if invalid
     void flip_vertical(const void *from_data,void *to_data);
 
+    //vertical flip of a single mip level in chunks, a row is a line of pixels or of 4x4 blocks for dxt
+    //rows r..r+count-1 are copied to rows rows_count-r-count..rows_count-r-1 and flipped there in place
+    static size_t get_row_size(pixel_format pf,unsigned int width); //0 if not supported
+    static unsigned int get_rows_count(pixel_format pf,unsigned int height);
+    static void flip_rows(pixel_format pf,unsigned int height,void *rows,size_t row_size,unsigned int count);
+
     size_t get_decoded_size() const;
     void decode_palette8_rgba(void *decoded_data) const; //width*height*4 to_data buf required
-    void decode_dxt(void *decoded_data) const; //decoded_data must be allocated with get_decoded_size()
+    //decoded_data must be allocated with get_decoded_size(), rgba
+    //large textures are decoded on threads_count threads, 0 for hardware threads count
+    void decode_dxt(void *decoded_data,unsigned int threads_count=0) const;
+    void decode_dxt(void *decoded_data,nya_memory::thread_pool &pool) const; //on a started pool kept between calls
+
+public:
+    static size_t get_dxt_size(pixel_format pf,unsigned int width,unsigned int height); //0 if not dxt1, dxt3 or dxt5
+    //encodes rgba image to dxt1 or dxt5, encoded_data must be allocated with get_dxt_size
+    //large images are encoded on threads_count threads, 0 for hardware threads count
+    static void encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,unsigned int threads_count=0);
+    static void encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,nya_memory::thread_pool &pool);
+
+private:
+    void decode_dxt(void *decoded_data,nya_memory::thread_pool *pool,unsigned int threads_count) const;
+    static void encode_dxt(pixel_format pf,const void *rgba,unsigned int width,unsigned int height,void *encoded_data,
+                           nya_memory::thread_pool *pool,unsigned int threads_count);
 };
 
 }
@@ -3,7 +3,10 @@
 #include "ktx.h"
 #include "memory/memory_reader.h"
 #include "resources/resources.h"
+#include "memory/thread_pool.h"
 #include <stdint.h>
+#include <string.h>
+#include <vector>
 
 namespace nya_formats
 {
@@ -114,4 +117,298 @@ size_t ktx::decode_header(const void *data,size_t size)
     return reader.get_offset();
 }
 
+namespace
+{
+
+typedef unsigned char uchar;
+typedef uint32_t uint;
+
+inline uchar clamp255(int v) { return (uchar)(v<0?0:(v>255?255:v)); }
+inline int extend4(int v) { return v*17; }
+inline int extend5(int v) { return (v<<3)|(v>>2); }
+inline int extend6(int v) { return (v<<2)|(v>>4); }
+inline int extend7(int v) { return (v<<1)|(v>>6); }
+inline int signed3(int v) { return v&4?v-8:v; }
+
+const int etc_modifiers[8][2]={{2,8},{5,17},{9,29},{13,42},{18,60},{24,80},{33,106},{47,183}};
+const int etc_distances[8]={3,6,11,16,23,32,41,64};
+
+const int eac_modifiers[16][8]=
+{
+    {-3,-6,-9,-15,2,5,8,14},{-3,-7,-10,-13,2,6,9,12},{-2,-5,-8,-13,1,4,7,12},{-2,-4,-6,-13,1,3,5,12},
+    {-3,-6,-8,-12,2,5,7,11},{-3,-7,-9,-11,2,6,8,10},{-4,-7,-8,-11,3,6,7,10},{-3,-5,-8,-11,2,4,7,10},
+    {-2,-6,-8,-10,1,5,7,9},{-2,-5,-8,-10,1,4,7,9},{-2,-4,-8,-10,1,3,7,9},{-2,-5,-7,-10,1,4,6,9},
+    {-3,-4,-7,-10,2,3,6,9},{-1,-2,-3,-10,0,1,2,9},{-4,-6,-8,-9,3,5,7,8},{-3,-5,-7,-9,2,4,6,8}
+};
+
+inline void set_color(uchar *dst,int r,int g,int b)
+{
+    dst[0]=clamp255(r), dst[1]=clamp255(g), dst[2]=clamp255(b), dst[3]=255;
+}
+
+//4x4 etc1/etc2 rgb block to 16 rgba pixels in rows, punchthrough uses the differential bit as opaque flag
+void decode_etc_block(const uchar *src,bool punchthrough,uchar *dst)
+{
+    const uint hi=(uint(src[0])<<24)|(uint(src[1])<<16)|(uint(src[2])<<8)|src[3];
+    const uint lo=(uint(src[4])<<24)|(uint(src[5])<<16)|(uint(src[6])<<8)|src[7];
+    const bool differential=punchthrough || (hi&2);
+    const bool opaque=!punchthrough || (hi&2);
+
+    //pixel indices are stored by columns, msb and lsb in separate halves
+    int indices[16];
+    for(int i=0;i<16;++i)
+        indices[(i&3)*4+(i>>2)]=int((lo>>(i+15))&2)|int((lo>>i)&1);
+
+    int paint[4][3];
+    bool paint_mode=true;
+
+    const int r=src[0]>>3, g=src[1]>>3, b=src[2]>>3;
+    const int r2=r+signed3(src[0]&7), g2=g+signed3(src[1]&7), b2=b+signed3(src[2]&7);
+
+    if(!differential || (r2>=0 && r2<32 && g2>=0 && g2<32 && b2>=0 && b2<32))
+    {
+        int base[2][3];
+        if(differential)
+        {
+            base[0][0]=extend5(r), base[0][1]=extend5(g), base[0][2]=extend5(b);
+            base[1][0]=extend5(r2), base[1][1]=extend5(g2), base[1][2]=extend5(b2);
+        }
+        else
+        {
+            for(int i=0;i<3;++i)
+                base[0][i]=extend4(src[i]>>4), base[1][i]=extend4(src[i]&0xf);
+        }
+
+        const int *tables[2]={etc_modifiers[(hi>>5)&7],etc_modifiers[(hi>>2)&7]};
+        const bool flip=(hi&1)!=0;
+
+        for(int y=0;y<4;++y)
+        {
+            for(int x=0;x<4;++x)
+            {
+                uchar *p=dst+(y*4+x)*4;
+                const int sub=flip?(y>=2):(x>=2);
+                const int idx=indices[y*4+x];
+                if(!opaque && idx==2)
+                {
+                    memset(p,0,4);
+                    continue;
+                }
+
+                const int *t=tables[sub];
+                const int m=idx==0?(opaque?t[0]:0):(idx==1?t[1]:(idx==2?-t[0]:-t[1]));
+                set_color(p,base[sub][0]+m,base[sub][1]+m,base[sub][2]+m);
+            }
+        }
+
+        return;
+    }
+
+    if(r2<0 || r2>31) //t mode
+    {
+        const int c1[3]={extend4(((src[0]>>1)&0xc)|(src[0]&3)),extend4(src[1]>>4),extend4(src[1]&0xf)};
+        const int c2[3]={extend4(src[2]>>4),extend4(src[2]&0xf),extend4(src[3]>>4)};
+        const int d=etc_distances[((src[3]>>1)&6)|(src[3]&1)];
+        for(int i=0;i<3;++i)
+            paint[0][i]=c1[i], paint[1][i]=c2[i]+d, paint[2][i]=c2[i], paint[3][i]=c2[i]-d;
+    }
+    else if(g2<0 || g2>31) //h mode
+    {
+        const int c1[3]={(src[0]>>3)&0xf,((src[0]&7)<<1)|((src[1]>>4)&1),(src[1]&8)|((src[1]&3)<<1)|(src[2]>>7)};
+        const int c2[3]={(src[2]>>3)&0xf,((src[2]&7)<<1)|(src[3]>>7),(src[3]>>3)&0xf};
+        const bool order=((c1[0]<<8)|(c1[1]<<4)|c1[2])>=((c2[0]<<8)|(c2[1]<<4)|c2[2]);
+        const int d=etc_distances[(src[3]&4)|((src[3]&1)<<1)|(order?1:0)];
+        for(int i=0;i<3;++i)
+        {
+            const int e1=extend4(c1[i]), e2=extend4(c2[i]);
+            paint[0][i]=e1+d, paint[1][i]=e1-d, paint[2][i]=e2+d, paint[3][i]=e2-d;
+        }
+    }
+    else //planar mode
+    {
+        paint_mode=false;
+
+        const int o[3]={extend6((src[0]>>1)&0x3f),extend7(((src[0]&1)<<6)|((src[1]>>1)&0x3f)),
+                        extend6(((src[1]&1)<<5)|(((src[2]>>3)&3)<<3)|((src[2]&3)<<1)|(src[3]>>7))};
+        const int h[3]={extend6((((src[3]>>2)&0x1f)<<1)|(src[3]&1)),extend7(src[4]>>1),extend6(((src[4]&1)<<5)|(src[5]>>3))};
+        const int v[3]={extend6(((src[5]&7)<<3)|(src[6]>>5)),extend7(((src[6]&0x1f)<<2)|(src[7]>>6)),extend6(src[7]&0x3f)};
+
+        for(int y=0;y<4;++y)
+        {
+            for(int x=0;x<4;++x)
+            {
+                int c[3];
+                for(int i=0;i<3;++i)
+                    c[i]=(x*(h[i]-o[i])+y*(v[i]-o[i])+4*o[i]+2)>>2;
+                set_color(dst+(y*4+x)*4,c[0],c[1],c[2]);
+            }
+        }
+    }
+
+    if(!paint_mode)
+        return;
+
+    for(int i=0;i<16;++i)
+    {
+        const int idx=indices[i];
+        if(!opaque && idx==2)
+            memset(dst+i*4,0,4);
+        else
+            set_color(dst+i*4,paint[idx][0],paint[idx][1],paint[idx][2]);
+    }
+}
+
+void decode_eac_alpha(const uchar *src,uchar *dst)
+{
+    const int base=src[0], multiplier=src[1]>>4;
+    const int *t=eac_modifiers[src[1]&0xf];
+
+    uint64_t bits=0;
+    for(int i=2;i<8;++i)
+        bits=(bits<<8)|src[i];
+
+    for(int i=0;i<16;++i)
+        dst[((i&3)*4+(i>>2))*4+3]=clamp255(base+t[(bits>>(45-3*i))&7]*multiplier);
+}
+
+void decode_block(ktx::pixel_format pf,const uchar *src,uchar *dst)
+{
+    if(pf==ktx::etc2_eac)
+    {
+        decode_etc_block(src+8,false,dst);
+        decode_eac_alpha(src,dst);
+        return;
+    }
+
+    decode_etc_block(src,pf==ktx::etc2_a1,dst);
+}
+
+struct etc_task
+{
+    ktx::pixel_format pf;
+    const uchar *src;
+    uchar *dst;
+    uint width;
+    uint height;
+    uint block_row_from;
+    uint block_row_to;
+};
+
+void decode_etc_rows(const etc_task &t)
+{
+    const uint bpb=t.pf==ktx::etc2_eac?16:8;
+    const uint w=t.width, h=t.height;
+    const uint blocks_w=(w+3)/4;
+
+    const uchar *src=t.src+(size_t)t.block_row_from*blocks_w*bpb;
+    for(uint by=t.block_row_from;by<t.block_row_to;++by)
+    {
+        const uint y=by*4;
+        const uint rows=h-y<4?h-y:4;
+        uchar *dst=t.dst+(size_t)y*w*4;
+
+        for(uint x=0;x<w;x+=4,src+=bpb)
+        {
+            uchar block[16*4];
+            decode_block(t.pf,src,block);
+            for(uint py=0;py<rows;++py)
+                memcpy(dst+((size_t)py*w+x)*4,block+py*16,((x+4<w)?4:(w-x))*4);
+        }
+    }
+}
+
+void decode_etc_task(void *data) { decode_etc_rows(*(const etc_task *)data); }
+
+const size_t min_parallel_blocks=16384; //smaller textures are decoded faster than threads start
+const size_t task_blocks=4096;
+
+//on the caller's pool if given, otherwise on a pool of threads_count threads started for the call
+template<typename t> void run_tasks(std::vector<t> &tasks,nya_memory::thread_pool::task_function function,bool parallel,
+                                    nya_memory::thread_pool *pool,unsigned int threads_count)
+{
+    nya_memory::thread_pool call_pool;
+    if(parallel && tasks.size()>1 && !pool)
+    {
+        if(!threads_count)
+            threads_count=nya_memory::thread_pool::get_hardware_threads_count();
+
+        if(threads_count>1 && call_pool.start(threads_count))
+            pool=&call_pool;
+    }
+
+    if(parallel && tasks.size()>1 && pool && pool->is_started())
+    {
+        for(size_t i=0;i<tasks.size();++i)
+        {
+            if(!pool->add_task(function,&tasks[i]))
+                function(&tasks[i]);
+        }
+
+        pool->wait_idle();
+        return;
+    }
+
+    for(size_t i=0;i<tasks.size();++i)
+        function(&tasks[i]);
+}
+
+}
+
+size_t ktx::get_decoded_size() const
+{
+    if(pf<etc1 || pf>etc2_a1)
+        return 0;
+
+    size_t size=0;
+    for(unsigned int i=0,w=width,h=height;i<mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+        size+=(size_t)w*h*4;
+
+    return size;
+}
+
+void ktx::decode_etc(void *decoded_data,unsigned int threads_count) const { decode_etc(decoded_data,0,threads_count); }
+void ktx::decode_etc(void *decoded_data,nya_memory::thread_pool &pool) const { decode_etc(decoded_data,&pool,0); }
+
+void ktx::decode_etc(void *decoded_data,nya_memory::thread_pool *pool,unsigned int threads_count) const
+{
+    if(pf<etc1 || pf>etc2_a1 || !decoded_data)
+        return;
+
+    const uint bpb=pf==etc2_eac?16:8;
+
+    //split mipmaps into tasks of block rows
+    std::vector<etc_task> tasks;
+    size_t blocks_count=0;
+    nya_memory::memory_reader reader(data,data_size);
+    uchar *dst=(uchar *)decoded_data;
+    for(uint i=0,w=width,h=height;i<mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+    {
+        const uint blocks_w=(w+3)/4, blocks_h=(h+3)/4;
+        const uint rows_per_task=blocks_w<task_blocks?uint(task_blocks/blocks_w):1;
+
+        const uint size=reader.read<uint>();
+        if(size<(size_t)blocks_w*blocks_h*bpb || !reader.check_remained(size))
+            return;
+
+        etc_task t;
+        t.pf=pf;
+        t.src=(const uchar *)reader.get_data();
+        t.dst=dst;
+        t.width=w;
+        t.height=h;
+        for(uint by=0;by<blocks_h;by+=rows_per_task)
+        {
+            t.block_row_from=by;
+            t.block_row_to=by+rows_per_task<blocks_h?by+rows_per_task:blocks_h;
+            tasks.push_back(t);
+        }
+
+        blocks_count+=blocks_w*blocks_h;
+        reader.skip(size);
+        dst+=(size_t)w*h*4;
+    }
+
+    run_tasks(tasks,decode_etc_task,blocks_count>=min_parallel_blocks,pool,threads_count);
+}
+
 }
@@ -4,6 +4,8 @@
 
 #include <stddef.h>
 
+namespace nya_memory { class thread_pool; }
+
 namespace nya_formats
 {
 
@@ -40,6 +42,15 @@ struct ktx
 
 public:
     size_t decode_header(const void *data,size_t size); //0 if invalid
+
+    size_t get_decoded_size() const; //rgba, 0 if not etc
+    //decoded_data must be allocated with get_decoded_size(), rgba
+    //large textures are decoded on threads_count threads, 0 for hardware threads count
+    void decode_etc(void *decoded_data,unsigned int threads_count=0) const;
+    void decode_etc(void *decoded_data,nya_memory::thread_pool &pool) const; //on a started pool kept between calls
+
+private:
+    void decode_etc(void *decoded_data,nya_memory::thread_pool *pool,unsigned int threads_count) const;
 };
 
 }
@@ -0,0 +1,500 @@
+//https://code.google.com/p/nya-engine/
+
+#include "mip_chain.h"
+#include "memory/tmp_buffer.h"
+#include "memory/thread_pool.h"
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define MIP_CHAIN_SIMD
+#endif
+
+namespace nya_formats
+{
+
+namespace
+{
+
+typedef unsigned char uchar;
+typedef unsigned int uint;
+
+int get_channels(mip_chain::pixel_format pf)
+{
+    switch(pf)
+    {
+        case mip_chain::greyscale: return 1;
+        case mip_chain::rgb:
+        case mip_chain::rgb32f: return 3;
+        case mip_chain::rgba:
+        case mip_chain::rgba32f: return 4;
+    }
+
+    return 0;
+}
+
+bool is_float(mip_chain::pixel_format pf) { return pf==mip_chain::rgb32f || pf==mip_chain::rgba32f; }
+bool has_alpha(mip_chain::pixel_format pf) { return pf==mip_chain::rgba || pf==mip_chain::rgba32f; }
+size_t get_pixel_size(mip_chain::pixel_format pf) { return get_channels(pf)*(is_float(pf)?4:1); }
+uint half(uint v) { return v>1?v/2:1; }
+
+struct srgb_tables
+{
+    enum { encode_size=4096 };
+
+    float to_linear[256];
+    uchar to_srgb[encode_size+1]; //by linear value
+
+    srgb_tables()
+    {
+        for(int i=0;i<256;++i)
+        {
+            const double c=i/255.0;
+            to_linear[i]=float(c<=0.04045?c/12.92:pow((c+0.055)/1.055,2.4));
+        }
+
+        for(int i=0;i<=encode_size;++i)
+        {
+            const double l=double(i)/encode_size;
+            const double c=l<=0.0031308?l*12.92:1.055*pow(l,1.0/2.4)-0.055;
+            to_srgb[i]=uchar(c*255.0+0.5);
+        }
+    }
+};
+
+const srgb_tables srgb;
+
+inline float clamp01(float v) { return v<0.0f?0.0f:(v>1.0f?1.0f:v); }
+inline uchar to_unorm8(float v) { return uchar(clamp01(v)*255.0f+0.5f); }
+inline uchar to_srgb8(float v) { return srgb.to_srgb[int(clamp01(v)*srgb_tables::encode_size+0.5f)]; }
+
+double sinc(double x)
+{
+    if(fabs(x)<1e-6)
+        return 1.0;
+
+    x*=3.14159265358979323846;
+    return sin(x)/x;
+}
+
+double bessel_i0(double x)
+{
+    double sum=1.0,term=1.0;
+    for(int k=1;k<32;++k)
+    {
+        term*=(x*0.5/k)*(x*0.5/k);
+        sum+=term;
+    }
+
+    return sum;
+}
+
+const double filter_radius=3.0; //kaiser and lanczos, in destination pixels
+
+double kaiser(double x)
+{
+    const double alpha=4.0, t=x/filter_radius;
+    if(t*t>=1.0)
+        return 0.0;
+
+    return sinc(x)*bessel_i0(alpha*sqrt(1.0-t*t))/bessel_i0(alpha);
+}
+
+double lanczos(double x)
+{
+    if(fabs(x)>=filter_radius)
+        return 0.0;
+
+    return sinc(x)*sinc(x/filter_radius);
+}
+
+//every destination pixel takes taps source pixels, edges are clamped
+struct axis_weights
+{
+    int taps;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+void build_weights(mip_chain::filter f,uint src,uint dst,axis_weights &w)
+{
+    const double scale=double(src)/dst;
+    const double support=f==mip_chain::filter_box?scale*0.5:filter_radius*scale;
+
+    w.taps=int(ceil(support*2.0))+1;
+    w.indices.resize(dst*w.taps);
+    w.weights.resize(dst*w.taps);
+
+    for(uint i=0;i<dst;++i)
+    {
+        const double center=(i+0.5)*scale;
+        const int first=int(floor(center-support));
+        int *idx=&w.indices[i*w.taps];
+        float *wt=&w.weights[i*w.taps];
+
+        double sum=0.0;
+        for(int t=0;t<w.taps;++t)
+        {
+            const int s=first+t;
+            double v;
+            if(f==mip_chain::filter_box)
+            {
+                //coverage of the source pixel by the destination one
+                const double from=s>center-support?s:center-support;
+                const double to=s+1<center+support?s+1:center+support;
+                v=to>from?to-from:0.0;
+            }
+            else
+            {
+                const double x=(s+0.5-center)/scale;
+                v=f==mip_chain::filter_kaiser?kaiser(x):lanczos(x);
+            }
+
+            idx[t]=s<0?0:(s>=int(src)?int(src)-1:s);
+            wt[t]=float(v);
+            sum+=v;
+        }
+
+        for(int t=0;t<w.taps;++t)
+            wt[t]=sum>0.0?float(wt[t]/sum):(t==0?1.0f:0.0f);
+    }
+}
+
+struct level_job
+{
+    mip_chain::pixel_format pf;
+    int channels;
+    bool srgb;
+
+    const void *src;
+    uint src_width;
+    uint src_height;
+
+    void *dst;
+    uint dst_width;
+    uint dst_height;
+
+    axis_weights x;
+    axis_weights y;
+
+    float *horizontal; //dst_width*src_height
+    float *filtered; //dst_width*dst_height
+    float alpha_scale;
+};
+
+inline float load_channel(const level_job &job,size_t idx,int c)
+{
+    if(is_float(job.pf))
+        return ((const float *)job.src)[idx];
+
+    const uchar v=((const uchar *)job.src)[idx];
+    const bool alpha=c==3;
+    return job.srgb && !alpha?srgb.to_linear[v]:v*(1.0f/255.0f);
+}
+
+void filter_horizontal(const level_job &job,uint from,uint to)
+{
+    const int ch=job.channels;
+    std::vector<float> row(job.src_width*ch);
+    for(uint y=from;y<to;++y)
+    {
+        const size_t offset=(size_t)y*job.src_width*ch;
+        for(uint i=0;i<job.src_width*ch;++i)
+            row[i]=load_channel(job,offset+i,i%ch);
+
+        float *out=job.horizontal+(size_t)y*job.dst_width*ch;
+        for(uint x=0;x<job.dst_width;++x,out+=ch)
+        {
+            const int *idx=&job.x.indices[x*job.x.taps];
+            const float *wt=&job.x.weights[x*job.x.taps];
+            for(int c=0;c<ch;++c)
+                out[c]=0.0f;
+
+            for(int t=0;t<job.x.taps;++t)
+            {
+                const float *p=&row[idx[t]*ch];
+                for(int c=0;c<ch;++c)
+                    out[c]+=p[c]*wt[t];
+            }
+        }
+    }
+}
+
+void filter_vertical(const level_job &job,uint from,uint to)
+{
+    const size_t row_size=(size_t)job.dst_width*job.channels;
+    for(uint y=from;y<to;++y)
+    {
+        float *out=job.filtered+y*row_size;
+        memset(out,0,row_size*sizeof(float));
+
+        const int *idx=&job.y.indices[y*job.y.taps];
+        const float *wt=&job.y.weights[y*job.y.taps];
+        for(int t=0;t<job.y.taps;++t)
+        {
+            if(wt[t]==0.0f)
+                continue;
+
+            const float *in=job.horizontal+idx[t]*row_size;
+            for(size_t i=0;i<row_size;++i)
+                out[i]+=in[i]*wt[t];
+        }
+    }
+}
+
+void store(const level_job &job,uint from,uint to)
+{
+    const int ch=job.channels;
+    const size_t row_size=(size_t)job.dst_width*ch;
+    for(uint y=from;y<to;++y)
+    {
+        const float *in=job.filtered+y*row_size;
+        if(is_float(job.pf))
+        {
+            float *out=(float *)job.dst+y*row_size;
+            for(size_t i=0;i<row_size;++i)
+                out[i]=(ch==4 && i%4==3)?in[i]*job.alpha_scale:in[i];
+            continue;
+        }
+
+        uchar *out=(uchar *)job.dst+y*row_size;
+        for(size_t i=0;i<row_size;++i)
+        {
+            if(ch==4 && i%4==3)
+                out[i]=to_unorm8(in[i]*job.alpha_scale);
+            else
+                out[i]=job.srgb?to_srgb8(in[i]):to_unorm8(in[i]);
+        }
+    }
+}
+
+//exact 2x2 average of even sized rgba8 levels, the common case
+void box_rgba8(const level_job &job,uint from,uint to)
+{
+    const uint sw=job.src_width, dw=job.dst_width;
+    for(uint y=from;y<to;++y)
+    {
+        const uchar *r0=(const uchar *)job.src+(size_t)y*2*sw*4;
+        const uchar *r1=r0+sw*4;
+        uchar *out=(uchar *)job.dst+(size_t)y*dw*4;
+
+        uint x=0;
+#ifdef MIP_CHAIN_SIMD
+        const __m128i zero=_mm_setzero_si128(), two=_mm_set1_epi16(2);
+        for(;x+2<=dw;x+=2,r0+=16,r1+=16,out+=8)
+        {
+            const __m128i a=_mm_loadu_si128((const __m128i *)r0), b=_mm_loadu_si128((const __m128i *)r1);
+            const __m128i lo=_mm_add_epi16(_mm_unpacklo_epi8(a,zero),_mm_unpacklo_epi8(b,zero));
+            const __m128i hi=_mm_add_epi16(_mm_unpackhi_epi8(a,zero),_mm_unpackhi_epi8(b,zero));
+            const __m128i sum=_mm_add_epi16(_mm_unpacklo_epi64(lo,hi),_mm_unpackhi_epi64(lo,hi));
+            const __m128i avg=_mm_srli_epi16(_mm_add_epi16(sum,two),2);
+            _mm_storel_epi64((__m128i *)out,_mm_packus_epi16(avg,avg));
+        }
+#endif
+        for(;x<dw;++x,r0+=8,r1+=8,out+=4)
+        {
+            for(int c=0;c<4;++c)
+                out[c]=uchar((r0[c]+r0[c+4]+r1[c]+r1[c+4]+2)>>2);
+        }
+    }
+}
+
+typedef void (*rows_function)(const level_job &job,uint from,uint to);
+
+struct rows_task
+{
+    rows_function function;
+    const level_job *job;
+    uint from;
+    uint to;
+};
+
+void rows_task_function(void *data)
+{
+    const rows_task &t=*(const rows_task *)data;
+    t.function(*t.job,t.from,t.to);
+}
+
+const size_t min_parallel_pixels=256*256;
+const size_t task_pixels=64*1024;
+
+void run_rows(nya_memory::thread_pool *pool,rows_function function,const level_job &job,uint rows,uint row_pixels)
+{
+    if(!pool || (size_t)rows*row_pixels<min_parallel_pixels)
+    {
+        function(job,0,rows);
+        return;
+    }
+
+    const uint rows_per_task=row_pixels<task_pixels?uint(task_pixels/row_pixels):1;
+    std::vector<rows_task> tasks;
+    for(uint y=0;y<rows;y+=rows_per_task)
+    {
+        rows_task t;
+        t.function=function;
+        t.job=&job;
+        t.from=y;
+        t.to=y+rows_per_task<rows?y+rows_per_task:rows;
+        tasks.push_back(t);
+    }
+
+    for(size_t i=0;i<tasks.size();++i)
+    {
+        if(!pool->add_task(rows_task_function,&tasks[i]))
+            rows_task_function(&tasks[i]);
+    }
+
+    pool->wait_idle();
+}
+
+float get_coverage(mip_chain::pixel_format pf,const void *data,size_t pixels,float reference)
+{
+    size_t count=0;
+    if(is_float(pf))
+    {
+        const float *a=(const float *)data+3;
+        for(size_t i=0;i<pixels;++i,a+=4)
+            count+= *a>reference;
+    }
+    else
+    {
+        const uchar *a=(const uchar *)data+3;
+        for(size_t i=0;i<pixels;++i,a+=4)
+            count+= *a>reference*255.0f;
+    }
+
+    return pixels?float(count)/pixels:0.0f;
+}
+
+//alpha scale that gives the filtered level the target coverage, found by bisection
+float get_alpha_scale(const level_job &job,float reference,float target)
+{
+    const size_t pixels=(size_t)job.dst_width*job.dst_height;
+    float from=0.0f,to=4.0f,scale=1.0f;
+    for(int i=0;i<16;++i)
+    {
+        size_t count=0;
+        const float *a=job.filtered+3;
+        for(size_t j=0;j<pixels;++j,a+=4)
+            count+= *a*scale>reference;
+
+        const float coverage=float(count)/pixels;
+        if(coverage==target)
+            break;
+
+        if(coverage<target)
+            from=scale;
+        else
+            to=scale;
+
+        scale=(from+to)*0.5f;
+    }
+
+    return scale;
+}
+
+void downsample_level(const mip_chain &settings,mip_chain::pixel_format pf,const void *from,uint width,uint height,
+                      void *to,float coverage,nya_memory::thread_pool *pool)
+{
+    level_job job;
+    job.pf=pf;
+    job.channels=get_channels(pf);
+    job.srgb=settings.srgb && !is_float(pf);
+    job.src=from;
+    job.src_width=width;
+    job.src_height=height;
+    job.dst=to;
+    job.dst_width=half(width);
+    job.dst_height=half(height);
+    job.alpha_scale=1.0f;
+
+    const bool alpha_test=coverage>=0.0f && has_alpha(pf);
+    if(pf==mip_chain::rgba && settings.mip_filter==mip_chain::filter_box && !job.srgb && !alpha_test
+       && width%2==0 && height%2==0)
+    {
+        run_rows(pool,box_rgba8,job,job.dst_height,job.dst_width);
+        return;
+    }
+
+    build_weights(settings.mip_filter,width,job.dst_width,job.x);
+    build_weights(settings.mip_filter,height,job.dst_height,job.y);
+
+    const size_t row_size=(size_t)job.dst_width*job.channels*sizeof(float);
+    nya_memory::tmp_buffer_scoped horizontal(row_size*height);
+    nya_memory::tmp_buffer_scoped filtered(row_size*job.dst_height);
+    job.horizontal=(float *)horizontal.get_data();
+    job.filtered=(float *)filtered.get_data();
+
+    run_rows(pool,filter_horizontal,job,height,width);
+    run_rows(pool,filter_vertical,job,job.dst_height,job.dst_width);
+
+    if(alpha_test)
+        job.alpha_scale=get_alpha_scale(job,settings.alpha_coverage,coverage);
+
+    run_rows(pool,store,job,job.dst_height,job.dst_width);
+}
+
+}
+
+unsigned int mip_chain::get_mip_count(unsigned int width,unsigned int height)
+{
+    unsigned int count=1;
+    for(;width>1 || height>1;++count)
+        width=half(width),height=half(height);
+
+    return count;
+}
+
+size_t mip_chain::get_size(pixel_format pf,unsigned int width,unsigned int height,unsigned int mip_count)
+{
+    size_t size=0;
+    for(unsigned int i=0;i<mip_count;++i,width=half(width),height=half(height))
+        size+=(size_t)width*height;
+
+    return size*get_pixel_size(pf);
+}
+
+bool mip_chain::generate(pixel_format pf,void *data,unsigned int width,unsigned int height,unsigned int mip_count) const
+{
+    if(!data || !width || !height || !get_channels(pf) || !mip_count || mip_count>get_mip_count(width,height))
+        return false;
+
+    float coverage=-1.0f;
+    if(alpha_coverage>=0.0f && has_alpha(pf))
+        coverage=get_coverage(pf,data,(size_t)width*height,alpha_coverage);
+
+    const unsigned int threads=threads_count?threads_count:nya_memory::thread_pool::get_hardware_threads_count();
+    nya_memory::thread_pool pool;
+    const bool parallel=threads>1 && (size_t)width*height>=min_parallel_pixels && pool.start(threads);
+
+    uchar *level=(uchar *)data;
+    for(unsigned int i=1;i<mip_count;++i,width=half(width),height=half(height))
+    {
+        uchar *next=level+(size_t)width*height*get_pixel_size(pf);
+        downsample_level(*this,pf,level,width,height,next,coverage,parallel?&pool:0);
+        level=next;
+    }
+
+    return true;
+}
+
+bool mip_chain::downsample(pixel_format pf,const void *from,unsigned int width,unsigned int height,void *to) const
+{
+    if(!from || !to || !width || !height || !get_channels(pf))
+        return false;
+
+    float coverage=-1.0f;
+    if(alpha_coverage>=0.0f && has_alpha(pf))
+        coverage=get_coverage(pf,from,(size_t)width*height,alpha_coverage);
+
+    const unsigned int threads=threads_count?threads_count:nya_memory::thread_pool::get_hardware_threads_count();
+    nya_memory::thread_pool pool;
+    const bool parallel=threads>1 && (size_t)width*height>=min_parallel_pixels && pool.start(threads);
+
+    downsample_level(*this,pf,from,width,height,to,coverage,parallel?&pool:0);
+    return true;
+}
+
+}
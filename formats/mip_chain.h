@@ -0,0 +1,50 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//cpu mipmap chain generation, usable without a gpu from tools and loader threads
+//each level is half of the previous one rounded down, at least one pixel
+//odd sizes are filtered with fractional weights, so no row or column is dropped
+
+#include <stddef.h>
+
+namespace nya_formats
+{
+
+struct mip_chain
+{
+    enum pixel_format
+    {
+        greyscale,
+        rgb,
+        rgba, //or bgra, alpha is the last channel
+        rgb32f,
+        rgba32f
+    };
+
+    enum filter
+    {
+        filter_box,
+        filter_kaiser,
+        filter_lanczos
+    };
+
+    filter mip_filter;
+    bool srgb; //8-bit color channels are averaged in linear space
+    float alpha_coverage; //alpha test reference to keep the coverage of mip 0 at, negative to disable
+    unsigned int threads_count; //large levels are filtered on threads, 0 for hardware threads count
+
+    mip_chain(): mip_filter(filter_box),srgb(false),alpha_coverage(-1.0f),threads_count(0) {}
+
+public:
+    static unsigned int get_mip_count(unsigned int width,unsigned int height); //full chain down to 1x1
+    static size_t get_size(pixel_format pf,unsigned int width,unsigned int height,unsigned int mip_count);
+
+    //data starts with mip 0 and must be allocated with get_size, levels 1..mip_count-1 are written after it
+    bool generate(pixel_format pf,void *data,unsigned int width,unsigned int height,unsigned int mip_count) const;
+
+    //next level only, to must be allocated with get_size(pf,width/2,height/2,1), sizes are at least 1
+    bool downsample(pixel_format pf,const void *from,unsigned int width,unsigned int height,void *to) const;
+};
+
+}
@@ -51,11 +51,11 @@ size_t nms::read_header(header &out_header,const void *data,size_t size)
     if(!reader.test(nms_sign,sizeof(nms_sign)))
         return 0;
 
-    out_header.version=reader.read<uint32_t>();
+    out_header.version=reader.read_le<uint32_t>();
     if(!out_header.version)
         return 0;
 
-    out_header.chunks_count=reader.read<uint32_t>();
+    out_header.chunks_count=reader.read_le<uint32_t>();
 
     return reader.get_offset();
 }
@@ -67,8 +67,8 @@ size_t nms::read_chunk_info(chunk_info &out_chunk_info,const void *data,size_t s
 
     out_chunk_info.type=out_chunk_info.size=0;
     nya_memory::memory_reader reader(data,size);
-    out_chunk_info.type=reader.read<uint32_t>();
-    out_chunk_info.size=reader.read<uint32_t>();
+    out_chunk_info.type=reader.read_le<uint32_t>();
+    out_chunk_info.size=reader.read_le<uint32_t>();
     out_chunk_info.data=reader.get_data();
 
     return reader.get_offset();
@@ -88,20 +88,28 @@ size_t nms::write_to_buf(void *data,size_t size)
     if(!data)
         return 0;
 
-    char *cdata=(char *)data;
-    const char *const data_end=cdata+size;
+    nya_memory::memory_writer writer(data,size);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
 
+bool nms::write(nya_memory::memory_writer &writer)
+{
     header h;
     h.version=version;
     h.chunks_count=(unsigned int)chunks.size();
-    cdata+=write_header_to_buf(h,data,size);
-    if(data==cdata)
-        return 0;
+    if(!write_header(h,writer))
+        return false;
 
     for(size_t i=0;i<chunks.size();++i)
-        cdata+=write_chunk_to_buf(chunks[i],cdata,data_end-cdata);
+    {
+        if(!write_chunk(chunks[i],writer))
+            return false;
+    }
 
-    return cdata-(char *)data;
+    return writer.flush();
 }
 
 size_t nms::write_header_to_buf(const header &h,void *to_data,size_t to_size)
@@ -110,11 +118,19 @@ size_t nms::write_header_to_buf(const header &h,void *to_data,size_t to_size)
         return 0;
 
     nya_memory::memory_writer writer(to_data,to_size);
+    if(!write_header(h,writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
+bool nms::write_header(const header &h,nya_memory::memory_writer &writer)
+{
     writer.write(nms_sign,sizeof(nms_sign));
     writer.write_uint(h.version);
     writer.write_uint(h.chunks_count);
 
-    return writer.get_offset();
+    return !writer.is_failed();
 }
 
 size_t nms::get_chunk_write_size(size_t chunk_data_size) { return chunk_data_size+sizeof(uint32_t)*2; }
@@ -125,18 +141,34 @@ size_t nms::write_chunk_to_buf(const chunk_info &chunk,void *to_data,size_t to_s
         return 0;
 
     nya_memory::memory_writer writer(to_data,to_size);
-    writer.write_uint(chunk.type);
-    writer.write_uint(chunk.size);
-    if(!chunk.size)
-        return writer.get_offset();
-
-    if(!chunk.data)
+    if(!write_chunk(chunk,writer))
         return 0;
 
-    writer.write(chunk.data,chunk.size);
     return writer.get_offset();
 }
 
+bool nms::write_chunk(const chunk_info &chunk,nya_memory::memory_writer &writer)
+{
+    if(chunk.size && !chunk.data)
+        return false;
+
+    if(!write_chunk_header(chunk.type,chunk.size,writer))
+        return false;
+
+    if(chunk.size)
+        writer.write(chunk.data,chunk.size);
+
+    return !writer.is_failed();
+}
+
+bool nms::write_chunk_header(unsigned int type,size_t chunk_data_size,nya_memory::memory_writer &writer)
+{
+    writer.write_uint(type);
+    writer.write_uint((unsigned int)chunk_data_size);
+
+    return !writer.is_failed();
+}
+
 size_t nms_mesh_chunk::read_header(const void *data, size_t size, int version)
 {
     *this=nms_mesh_chunk();
@@ -243,10 +275,26 @@ size_t nms_mesh_chunk::read_header(const void *data, size_t size, int version)
     return reader.get_offset();
 }
 
+size_t nms_mesh_chunk::get_chunk_size()
+{
+    nya_memory::memory_writer writer(nya_memory::memory_writer::sink_callback(0),0);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
 size_t nms_mesh_chunk::write_to_buf(void *to_data,size_t to_size)
 {
     nya_memory::memory_writer writer(to_data,to_size);
+    if(!write(writer))
+        return 0;
 
+    return writer.get_offset();
+}
+
+bool nms_mesh_chunk::write(nya_memory::memory_writer &writer)
+{
     writer.write(aabb_min);
     writer.write(aabb_max);
 
@@ -289,7 +337,7 @@ size_t nms_mesh_chunk::write_to_buf(void *to_data,size_t to_size)
         }
     }
 
-    return writer.get_offset();
+    return !writer.is_failed();
 }
 
 bool nms_material_chunk::read(const void *data,size_t size,int version)
@@ -325,10 +373,7 @@ bool nms_material_chunk::read(const void *data,size_t size,int version)
         for(size_t j=0;j<m.vectors.size();++j)
         {
             m.vectors[j].name=reader.read_string();
-            m.vectors[j].value.x=reader.read<float>();
-            m.vectors[j].value.y=reader.read<float>();
-            m.vectors[j].value.z=reader.read<float>();
-            m.vectors[j].value.w=reader.read<float>();
+            reader.read_array(&m.vectors[j].value.x,4);
         }
 
         m.ints.resize(reader.read<uint16_t>());
@@ -342,9 +387,26 @@ bool nms_material_chunk::read(const void *data,size_t size,int version)
     return true;
 }
 
+size_t nms_material_chunk::get_chunk_size()
+{
+    nya_memory::memory_writer writer(nya_memory::memory_writer::sink_callback(0),0);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
 size_t nms_material_chunk::write_to_buf(void *to_data,size_t to_size)
 {
     nya_memory::memory_writer writer(to_data,to_size);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
+bool nms_material_chunk::write(nya_memory::memory_writer &writer)
+{
     writer.write_ushort((unsigned short)materials.size());
     for(size_t i=0;i<materials.size();++i)
     {
@@ -383,7 +445,7 @@ size_t nms_material_chunk::write_to_buf(void *to_data,size_t to_size)
         }
     }
 
-    return writer.get_offset();
+    return !writer.is_failed();
 }
 
 template<typename t> t& add_param(const char *name,std::vector<t> &array,bool unique)
@@ -484,9 +546,26 @@ bool nms_skeleton_chunk::read(const void *data,size_t size,int version)
     return true;
 }
 
+size_t nms_skeleton_chunk::get_chunk_size()
+{
+    nya_memory::memory_writer writer(nya_memory::memory_writer::sink_callback(0),0);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
 size_t nms_skeleton_chunk::write_to_buf(void *to_data,size_t to_size)
 {
     nya_memory::memory_writer writer(to_data,to_size);
+    if(!write(writer))
+        return 0;
+
+    return writer.get_offset();
+}
+
+bool nms_skeleton_chunk::write(nya_memory::memory_writer &writer)
+{
     writer.write_uint((unsigned int)bones.size());
     for(size_t i=0;i<bones.size();++i)
     {
@@ -497,7 +576,7 @@ size_t nms_skeleton_chunk::write_to_buf(void *to_data,size_t to_size)
         writer.write_int(b.parent);
     }
 
-    return writer.get_offset();
+    return !writer.is_failed();
 }
 
 }
@@ -4,6 +4,7 @@
 
 //write_to_buf return used size or 0 if failed
 //to_data size should be allocated with enough size
+//write streams to a growable or sink memory_writer without a sizing pass
 
 #include <vector>
 #include <string>
@@ -11,6 +12,8 @@
 #include "math/vector.h"
 #include "math/quaternion.h"
 
+namespace nya_memory { class memory_writer; }
+
 namespace nya_formats
 {
 
@@ -52,6 +55,7 @@ public:
 public:
     size_t get_nms_size();
     size_t write_to_buf(void *to_data,size_t to_size); //to_size=get_nms_size()
+    bool write(nya_memory::memory_writer &writer);
 
 public:
     static size_t write_header_to_buf(unsigned int chunks_count,void *to_data,size_t to_size=nms_header_size)
@@ -65,6 +69,10 @@ public:
     static size_t get_chunk_write_size(size_t chunk_data_size);
     static size_t write_chunk_to_buf(const chunk_info &chunk,void *to_data,size_t to_size); //to_size=get_chunk_size()
 
+    static bool write_header(const header &h,nya_memory::memory_writer &writer);
+    static bool write_chunk(const chunk_info &chunk,nya_memory::memory_writer &writer);
+    static bool write_chunk_header(unsigned int type,size_t chunk_data_size,nya_memory::memory_writer &writer); //followed by chunk data
+
 public:
     const static size_t nms_header_size=16;
     const static unsigned int latest_version=2;
@@ -151,8 +159,9 @@ public:
     size_t read_header(const void *data,size_t size,int version); //0 if invalid
 
 public:
-    //size_t get_chunk_size();
+    size_t get_chunk_size();
     size_t write_to_buf(void *to_data,size_t to_size);
+    bool write(nya_memory::memory_writer &writer);
 };
 
 struct nms_material_chunk
@@ -204,8 +213,9 @@ public:
     bool read(const void *data,size_t size,int version);
 
 public:
-    //size_t get_chunk_size();
+    size_t get_chunk_size();
     size_t write_to_buf(void *to_data,size_t to_size);
+    bool write(nya_memory::memory_writer &writer);
 };
 
 struct nms_skeleton_chunk
@@ -230,8 +240,9 @@ public:
     bool read(const void *data,size_t size,int version);
 
 public:
-    //size_t get_chunk_size();
+    size_t get_chunk_size();
     size_t write_to_buf(void *to_data,size_t to_size);
+    bool write(nya_memory::memory_writer &writer);
 };
 
 }
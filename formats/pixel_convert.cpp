@@ -0,0 +1,265 @@
+//https://code.google.com/p/nya-engine/
+
+#include "pixel_convert.h"
+#include <string.h>
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP>=2)
+    #include <emmintrin.h>
+    #define PIXEL_CONVERT_SIMD
+#endif
+
+namespace nya_formats
+{
+
+namespace
+{
+
+typedef unsigned char uchar;
+
+#ifdef PIXEL_CONVERT_SIMD
+inline __m128i load16(const uchar *p) { return _mm_loadu_si128((const __m128i *)p); }
+inline void store16(uchar *p,__m128i v) { _mm_storeu_si128((__m128i *)p,v); }
+
+inline __m128i swap_rb4(__m128i v)
+{
+    const __m128i rb=_mm_and_si128(v,_mm_set1_epi32(0x00ff00ff));
+    const __m128i ga=_mm_andnot_si128(_mm_set1_epi32(0x00ff00ff),v);
+    return _mm_or_si128(ga,_mm_or_si128(_mm_slli_epi32(rb,16),_mm_srli_epi32(rb,16)));
+}
+
+inline __m128i reverse4(__m128i v) { return _mm_shuffle_epi32(v,_MM_SHUFFLE(0,1,2,3)); }
+
+inline __m128i reverse1(__m128i v)
+{
+    v=_mm_or_si128(_mm_slli_epi16(v,8),_mm_srli_epi16(v,8));
+    v=_mm_shufflelo_epi16(v,_MM_SHUFFLE(0,1,2,3));
+    v=_mm_shufflehi_epi16(v,_MM_SHUFFLE(0,1,2,3));
+    return _mm_shuffle_epi32(v,_MM_SHUFFLE(1,0,3,2));
+}
+
+//16 lanes of 0 or 1 bytes to a bit mask
+inline int equal_mask(const uchar *a,const uchar *b) { return _mm_movemask_epi8(_mm_cmpeq_epi8(load16(a),load16(b))); }
+#endif
+
+inline int first_zero_bit(int mask)
+{
+    int i=0;
+    while(mask & (1<<i))
+        ++i;
+
+    return i;
+}
+
+inline void swap_bytes(uchar *a,uchar *b,size_t size)
+{
+    size_t i=0;
+#ifdef PIXEL_CONVERT_SIMD
+    for(;i+16<=size;i+=16)
+    {
+        const __m128i va=load16(a+i), vb=load16(b+i);
+        store16(a+i,vb);
+        store16(b+i,va);
+    }
+#endif
+    for(;i<size;++i)
+    {
+        const uchar t=a[i];
+        a[i]=b[i];
+        b[i]=t;
+    }
+}
+
+inline bool is_pixel_equal(const uchar *a,const uchar *b,int channels)
+{
+    for(int i=0;i<channels;++i)
+    {
+        if(a[i]!=b[i])
+            return false;
+    }
+
+    return true;
+}
+
+}
+
+void swap_red_blue(const void *from,void *to,size_t pixels,int channels)
+{
+    if(!from || !to || (channels!=3 && channels!=4))
+        return;
+
+    const uchar *f=(const uchar *)from;
+    uchar *t=(uchar *)to;
+    size_t i=0;
+
+    if(channels==4)
+    {
+#ifdef PIXEL_CONVERT_SIMD
+        for(;i+4<=pixels;i+=4)
+            store16(t+i*4,swap_rb4(load16(f+i*4)));
+#endif
+        for(;i<pixels;++i)
+        {
+            const uchar r=f[i*4+2], b=f[i*4];
+            t[i*4+1]=f[i*4+1], t[i*4+3]=f[i*4+3];
+            t[i*4]=r, t[i*4+2]=b;
+        }
+
+        return;
+    }
+
+#ifdef PIXEL_CONVERT_SIMD
+    //five pixels per 16 bytes, the last byte is stored unchanged
+    const __m128i keep=_mm_setr_epi8(0,-1,0,0,-1,0,0,-1,0,0,-1,0,0,-1,0,-1);
+    const __m128i first=_mm_setr_epi8(-1,0,0,-1,0,0,-1,0,0,-1,0,0,-1,0,0,0);
+    const __m128i last=_mm_setr_epi8(0,0,-1,0,0,-1,0,0,-1,0,0,-1,0,0,-1,0);
+    for(;(i+5)*3+1<=pixels*3;i+=5,f+=15,t+=15)
+    {
+        const __m128i v=load16(f);
+        store16(t,_mm_or_si128(_mm_and_si128(v,keep),_mm_or_si128(_mm_slli_si128(_mm_and_si128(v,first),2),
+                                                                 _mm_srli_si128(_mm_and_si128(v,last),2))));
+    }
+#endif
+    for(;i<pixels;++i,f+=3,t+=3)
+    {
+        const uchar r=f[2], b=f[0];
+        t[1]=f[1];
+        t[0]=r, t[2]=b;
+    }
+}
+
+void reverse_pixels(const void *from,void *to,size_t pixels,int channels)
+{
+    if(!from || !to || channels<1 || channels>4 || !pixels)
+        return;
+
+    const uchar *f=(const uchar *)from;
+    uchar *t=(uchar *)to;
+
+    if(from!=to)
+    {
+        size_t i=0;
+#ifdef PIXEL_CONVERT_SIMD
+        if(channels==4)
+        {
+            for(;i+4<=pixels;i+=4)
+                store16(t+i*4,reverse4(load16(f+(pixels-i-4)*4)));
+        }
+        else if(channels==1)
+        {
+            for(;i+16<=pixels;i+=16)
+                store16(t+i,reverse1(load16(f+pixels-i-16)));
+        }
+#endif
+        for(;i<pixels;++i)
+            memcpy(t+i*channels,f+(pixels-i-1)*channels,channels);
+
+        return;
+    }
+
+    //in place, blocks from both ends are swapped
+    size_t l=0,r=pixels;
+#ifdef PIXEL_CONVERT_SIMD
+    if(channels==4)
+    {
+        for(;l+8<=r;l+=4,r-=4)
+        {
+            const __m128i a=load16(t+l*4), b=load16(t+(r-4)*4);
+            store16(t+l*4,reverse4(b));
+            store16(t+(r-4)*4,reverse4(a));
+        }
+    }
+    else if(channels==1)
+    {
+        for(;l+32<=r;l+=16,r-=16)
+        {
+            const __m128i a=load16(t+l), b=load16(t+r-16);
+            store16(t+l,reverse1(b));
+            store16(t+r-16,reverse1(a));
+        }
+    }
+#endif
+    for(;l+1<r;++l,--r)
+        swap_bytes(t+l*channels,t+(r-1)*channels,channels);
+}
+
+void flip_rows(const void *from,void *to,size_t row_size,size_t rows)
+{
+    if(!from || !to || !rows)
+        return;
+
+    uchar *t=(uchar *)to;
+    if(from==to)
+    {
+        for(size_t i=0;i<rows/2;++i)
+            swap_bytes(t+i*row_size,t+(rows-i-1)*row_size,row_size);
+        return;
+    }
+
+    const uchar *f=(const uchar *)from;
+    for(size_t i=0;i<rows;++i)
+        memcpy(t+(rows-i-1)*row_size,f+i*row_size,row_size);
+}
+
+size_t get_run_length(const void *data,size_t max_pixels,int channels)
+{
+    if(!data || max_pixels<2 || channels<1)
+        return max_pixels?1:0;
+
+    //pixels are equal to the first one while the data equals itself shifted by one pixel
+    const uchar *d=(const uchar *)data;
+    const size_t size=(max_pixels-1)*channels;
+    size_t i=0;
+#ifdef PIXEL_CONVERT_SIMD
+    for(;i+16<=size;i+=16)
+    {
+        const int mask=equal_mask(d+i,d+i+channels);
+        if(mask!=0xffff)
+            return (i+first_zero_bit(mask))/channels+1;
+    }
+#endif
+    for(;i<size;++i)
+    {
+        if(d[i]!=d[i+channels])
+            break;
+    }
+
+    return i/channels+1;
+}
+
+size_t get_raw_length(const void *data,size_t max_pixels,int channels)
+{
+    if(!data || max_pixels<2 || channels<1)
+        return max_pixels;
+
+    const uchar *d=(const uchar *)data;
+    size_t i=0;
+#ifdef PIXEL_CONVERT_SIMD
+    if(channels==4)
+    {
+        for(;i+5<=max_pixels;i+=4)
+        {
+            const int mask=_mm_movemask_epi8(_mm_cmpeq_epi32(load16(d+i*4),load16(d+i*4+4)));
+            if(mask)
+                return i+first_zero_bit(~mask)/4;
+        }
+    }
+    else if(channels==1)
+    {
+        for(;i+17<=max_pixels;i+=16)
+        {
+            const int mask=equal_mask(d+i,d+i+1);
+            if(mask)
+                return i+first_zero_bit(~mask);
+        }
+    }
+#endif
+    for(;i+1<max_pixels;++i)
+    {
+        if(is_pixel_equal(d+i*channels,d+(i+1)*channels,channels))
+            return i;
+    }
+
+    return max_pixels;
+}
+
+}
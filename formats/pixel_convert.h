@@ -0,0 +1,22 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//8-bit pixel row kernels shared by image loaders and the renderer
+//from and to may point to the same data unless noted otherwise
+
+#include <stddef.h>
+
+namespace nya_formats
+{
+
+void swap_red_blue(const void *from,void *to,size_t pixels,int channels); //bgr to rgb, bgra to rgba and back
+void reverse_pixels(const void *from,void *to,size_t pixels,int channels); //mirrors a row
+void flip_rows(const void *from,void *to,size_t row_size,size_t rows); //vertical flip
+
+//count of pixels equal to the first one, at least one, at most max_pixels
+size_t get_run_length(const void *data,size_t max_pixels,int channels);
+//count of pixels before two equal neighbours, max_pixels if there are none
+size_t get_raw_length(const void *data,size_t max_pixels,int channels);
+
+}
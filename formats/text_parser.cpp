@@ -3,6 +3,7 @@
 #include "text_parser.h"
 #include "log/log.h"
 #include "memory/invalid_object.h"
+#include "memory/mem_accounting.h"
 
 #include <iostream>
 #include <sstream>
@@ -234,9 +235,40 @@ bool text_parser::load_from_data(const char *text,size_t text_size)
     if(subsection_end_idx>subsection_start_idx && !subsection_empty)
         m_sections[sections_count-1].value=std::string(text+subsection_start_idx,subsection_end_idx-subsection_start_idx);
 
+    update_mem_size();
     return true;
 }
 
+static int get_mem_category()
+{
+    static const int category=nya_memory::mem_accounting::get_category("text_parser");
+    return category;
+}
+
+text_parser::~text_parser()
+{
+    if(m_mem_size)
+        nya_memory::mem_accounting::remove(get_mem_category(),m_mem_size);
+}
+
+void text_parser::update_mem_size()
+{
+    if(m_mem_size)
+        nya_memory::mem_accounting::remove(get_mem_category(),m_mem_size);
+
+    m_mem_size=m_sections.capacity()*sizeof(section);
+    for(size_t i=0;i<m_sections.size();++i)
+    {
+        const section &s=m_sections[i];
+        m_mem_size+=s.type.capacity()+s.option.capacity()+s.value.capacity();
+        for(size_t j=0;j<s.names.size();++j)
+            m_mem_size+=s.names[j].capacity();
+    }
+
+    if(m_mem_size)
+        nya_memory::mem_accounting::add(get_mem_category(),m_mem_size);
+}
+
 void text_parser::fill_section(section &s,const line &l)
 {
    std::list<std::string> tokens=tokenize_line(l);
@@ -37,7 +37,8 @@ public:
     void debug_print(nya_log::ostream_base &os) const;
 
 public:
-    text_parser() {}
+    text_parser(): m_mem_size(0) {}
+    ~text_parser();
 
     //non copyable
 private:
@@ -45,7 +46,8 @@ private:
     text_parser &operator=(const text_parser &);
 
 private:
-    void clear() { m_sections.clear(); }
+    void clear() { m_sections.clear(); update_mem_size(); }
+    void update_mem_size(); //approximate, reported to nya_memory::mem_accounting
 
     struct subsection
     {
@@ -92,6 +94,7 @@ private:
     static size_t skip_whitespaces(const char *text,size_t text_size,size_t pos);
 
     std::vector<section> m_sections;
+    size_t m_mem_size;
 };
 
 }
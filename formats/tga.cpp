@@ -1,7 +1,9 @@
 //https://code.google.com/p/nya-engine/
 
 #include "tga.h"
+#include "pixel_convert.h"
 #include "memory/memory_reader.h"
+#include "memory/memory_writer.h"
 #include "memory/tmp_buffer.h"
 #include "resources/resources.h"
 #include <stdio.h>
@@ -135,211 +137,236 @@ size_t tga::encode_header(void *to_data,size_t to_size)
     return tga_minimum_header_size;
 }
 
-bool tga::decode_rle(void *decoded_data)
+namespace
 {
-    if(!decoded_data || !rle)
-        return false;
 
-    typedef unsigned char uchar;
-    const uchar *cur=(uchar*)data;
-    const uchar *const last=(uchar*)data+compressed_size;
-    uchar *out=(uchar*)decoded_data;
-    const uchar *const out_last=out+uncompressed_size;
+typedef unsigned char uchar;
+
+//places decoded pixels to their rows, each row is flipped and swizzled once complete, while in cache
+class row_writer
+{
+public:
+    size_t write(const uchar *pixels,size_t count,bool repeat) //returns written count
+    {
+        const size_t row_pixels=(m_row_size-m_x)/m_channels;
+        const size_t n=count<row_pixels?count:row_pixels;
+        uchar *out=get_row()+m_x;
+        const size_t size=n*m_channels;
+
+        if(!repeat)
+            memcpy(out,pixels,size);
+        else if(m_channels==1)
+            memset(out,pixels[0],size);
+        else
+        {
+            //doubling copies of the first pixel
+            memcpy(out,pixels,m_channels);
+            for(size_t filled=m_channels;filled<size;)
+            {
+                const size_t c=filled<size-filled?filled:size-filled;
+                memcpy(out+filled,out,c);
+                filled+=c;
+            }
+        }
+
+        m_x+=size;
+        if(m_x==m_row_size)
+            finish_row();
+
+        return n;
+    }
+
+    void write_row(const uchar *row)
+    {
+        uchar *out=get_row();
+        if(m_flip_horisontal)
+        {
+            reverse_pixels(row,out,m_width,m_channels);
+            if(m_swizzle)
+                swap_red_blue(out,out,m_width,m_channels);
+        }
+        else if(m_swizzle)
+            swap_red_blue(row,out,m_width,m_channels);
+        else
+            memcpy(out,row,m_row_size);
+
+        ++m_y;
+    }
+
+    bool is_full() const { return m_y>=m_height; }
+
+public:
+    row_writer(uchar *data,int width,int height,int channels,bool flip_horisontal,bool flip_vertical,bool swizzle):
+        m_data(data),m_width(width),m_height(height),m_channels(channels),m_row_size((size_t)width*channels),
+        m_flip_horisontal(flip_horisontal),m_flip_vertical(flip_vertical),m_swizzle(swizzle),m_y(0),m_x(0) {}
+
+private:
+    uchar *get_row() const { return m_data+m_row_size*(m_flip_vertical?m_height-1-m_y:m_y); }
+
+    void finish_row()
+    {
+        uchar *row=get_row();
+        if(m_flip_horisontal)
+            reverse_pixels(row,row,m_width,m_channels);
+        if(m_swizzle)
+            swap_red_blue(row,row,m_width,m_channels);
+
+        ++m_y;
+        m_x=0;
+    }
 
-    while(out<out_last)
+private:
+    uchar *m_data;
+    int m_width;
+    int m_height;
+    int m_channels;
+    size_t m_row_size;
+    bool m_flip_horisontal;
+    bool m_flip_vertical;
+    bool m_swizzle;
+    int m_y;
+    size_t m_x;
+};
+
+bool decode_rle(const uchar *cur,size_t data_size,int channels,row_writer &out)
+{
+    const uchar *const last=cur+data_size;
+    while(!out.is_full())
     {
         if(cur>=last)
             return false;
 
-        if(*cur & 0x80)
-        {
-            const uchar *to=out+(*cur++ -127)*channels;
-            if(cur+channels>last || to>out_last)
-                return false;
+        const bool repeat=(*cur & 0x80)!=0;
+        size_t count=(*cur++ & 0x7f)+1;
+        const size_t size=repeat?channels:count*channels;
+        if(cur+size>last)
+            return false;
 
-            while(out<to) memcpy(out,cur,channels),out+=channels;
-            cur+=channels;
-        }
-        else // raw
+        for(const uchar *pixels=cur;count>0;)
         {
-            const size_t size=(*cur++ +1)*channels;
-            if(cur+size>last || out+size>out_last)
+            if(out.is_full())
                 return false;
 
-            memcpy(out,cur,size);
-            cur+=size,out+=size;
+            const size_t written=out.write(pixels,count,repeat);
+            count-=written;
+            if(!repeat)
+                pixels+=written*channels;
         }
+
+        cur+=size;
     }
 
     return true;
 }
 
-size_t tga::encode_rle(void *to_data,size_t to_size)
+}
+
+bool tga::decode_rle(void *decoded_data)
 {
-    typedef unsigned int uint;
-    typedef unsigned char uchar;
+    if(!decoded_data || !rle || width<=0 || height<=0)
+        return false;
 
-    const uchar *from=(uchar *)data;
-    const uchar *from_last=from+uncompressed_size;
-    uchar *to=(uchar *)to_data;
-    uchar *to_last=to+to_size;
+    row_writer out((uchar *)decoded_data,width,height,channels,false,false,false);
+    return nya_formats::decode_rle((const uchar *)data,compressed_size,channels,out);
+}
 
-    uchar raw[128*4];
-    memset(raw,0,sizeof(raw));
+bool tga::decode(void *decoded_data,bool swizzle)
+{
+    if(!decoded_data || !data || width<=0 || height<=0)
+        return false;
 
-    int curr_line=0;
-    for(int rle=1;from<from_last;from+=channels*rle,curr_line+=rle)
+    const bool swizzle_channels=swizzle && channels!=greyscale;
+    row_writer out((uchar *)decoded_data,width,height,channels,horisontal_flip,vertical_flip,swizzle_channels);
+    if(rle)
     {
-        if(curr_line>=width)
-            curr_line-=width;
-
-        memcpy(raw,from,channels);
-
-        rle=1;
-        bool is_rle=false;
-        int max_rle=128;
-        if(curr_line+max_rle>width)
-            max_rle=width-curr_line;
+        if(!nya_formats::decode_rle((const uchar *)data,compressed_size,channels,out))
+            return false;
+    }
+    else
+    {
+        if(compressed_size<uncompressed_size)
+            return false;
 
-        for(const uchar *check=from+channels;check<from_last;++rle,check+=channels)
+        //plain data is copied at once, rows are only walked when they have to be converted
+        if(!horisontal_flip && !vertical_flip && !swizzle_channels)
+            memcpy(decoded_data,data,uncompressed_size);
+        else
         {
-            if(memcmp(raw,check,channels)!=0 || rle>=max_rle)
-            {
-                is_rle=rle>1;
-                break;
-            }
+            const size_t row_size=(size_t)width*channels;
+            for(int y=0;y<height;++y)
+                out.write_row((const uchar *)data+y*row_size);
         }
+    }
 
-        if(is_rle)
-        {
-            if(to+channels+1>to_last)
-                return 0;
+    rle=horisontal_flip=vertical_flip=false;
+    data=decoded_data;
+    compressed_size=uncompressed_size;
+    return true;
+}
 
-            *to++ =(128 | (rle-1));
-            memcpy(to,raw,channels);
-            to+=channels;
-            continue;
-        }
+size_t tga::encode_rle(void *to_data,size_t to_size)
+{
+    nya_memory::memory_writer writer(to_data,to_size);
+    if(!encode_rle(writer))
+        return 0;
 
-        rle = 1;
-        uchar *raw_it=raw;
-        for(const uchar *check=from+channels;check<from_last;++rle,check+=channels)
+    return writer.get_offset();
+}
+
+bool tga::encode_rle(nya_memory::memory_writer &writer)
+{
+    if(!data || !uncompressed_size || width<=0)
+        return false;
+
+    //packets don't cross rows
+    const uchar *from=(const uchar *)data;
+    const uchar *const from_last=from+uncompressed_size;
+    while(from<from_last)
+    {
+        for(int x=0;x<width && from<from_last;)
         {
-            if((memcmp(raw_it,check,channels)!=0 && rle<max_rle) || rle<3)
+            const size_t left=(size_t)(width-x)<(size_t)(from_last-from)/channels?width-x:(from_last-from)/channels;
+            const size_t max_count=left<128?left:128;
+
+            const size_t run=get_run_length(from,max_count,channels);
+            if(run>1)
             {
-                memcpy(raw_it+=channels,check,channels);
-                if(rle>=max_rle)
-                    break;
+                if(!writer.write_ubyte(uchar(128 | (run-1))) || !writer.write(from,channels))
+                    return false;
 
+                from+=run*channels,x+=(int)run;
                 continue;
             }
 
-            // check if the exit condition was the start of a repeating color
-            if(memcmp(raw_it,check,channels)!=0)
-                rle-=2;
+            const size_t raw=get_raw_length(from,max_count,channels);
+            if(!writer.write_ubyte(uchar(raw-1)) || !writer.write(from,raw*channels))
+                return false;
 
-            break;
+            from+=raw*channels,x+=(int)raw;
         }
-
-        size_t raw_size=channels*rle;
-        if(to+raw_size+1>to_last)
-            return 0;
-
-        *to++ =rle-1;
-        memcpy(to,raw,raw_size);
-        to+=raw_size;
     }
 
-    return to-(uchar*)to_data;
+    return true;
 }
 
 void tga::flip_vertical(const void *from_data,void *to_data)
 {
-    if(!from_data || !to_data || !height)
+    if(!from_data || !to_data || height<=0)
         return;
 
-    const int line_size=width*channels, top=line_size*(height-1);
-
-    typedef unsigned char uchar;
-
-    uchar *to=(uchar*)to_data;
-
-    if(from_data==to_data)
-    {
-        if(!line_size)
-            return;
-
-        const int half=line_size*(height/2);
-        std::vector<uchar> line_data(line_size);
-        uchar *line=&line_data[0];
-        uchar *from=to;
-        to+=top;
-
-        for(int offset=0;offset<half;offset+=line_size)
-        {
-            uchar *f=from+offset, *t=to-offset;
-            memcpy(line,f,line_size);
-            memcpy(f,t,line_size);
-            memcpy(t,line,line_size);
-        }
-    }
-    else
-    {
-        const uchar *from=(const uchar*)from_data;
-        to+=top;
-        for(size_t offset=0;offset<uncompressed_size;offset+=line_size)
-            memcpy(to-offset,from+offset,line_size);
-    }
+    flip_rows(from_data,to_data,(size_t)width*channels,height);
 }
 
 void tga::flip_horisontal(const void *from_data,void *to_data)
 {
-    if(!from_data || !to_data)
+    if(!from_data || !to_data || width<=0)
         return;
 
-    const int line_size=width*channels;
-    const int half=line_size/2;
-
-    typedef unsigned char uchar;
-
-    uchar *to=(uchar*)to_data;
-
-    if(from_data==to_data)
-    {
-        uchar tmp[4];
-
-        for(size_t offset=0;offset<uncompressed_size;offset+=line_size)
-        {
-            uchar *ha=to+offset;
-            uchar *hb=ha+line_size-channels;
-
-            for(int w=0;w<half;w+=channels)
-            {
-                uchar *a=ha+w;
-                uchar *b=hb-w;
-                memcpy(tmp,a,channels);
-                memcpy(a,b,channels);
-                memcpy(b,tmp,channels);
-            }
-        }
-    }
-    else
-    {
-        const uchar *from=(const uchar*)from_data;
-
-        for(size_t offset=0;offset<uncompressed_size;offset+=line_size)
-        {
-            const uchar *ha=from+offset;
-            uchar *hb=to+offset+line_size-channels;
-
-            for(int w=0;w<line_size;w+=channels)
-            {
-                const uchar *a=ha+w;
-                uchar *b=hb-w;
-                memcpy(b,a,channels);
-            }
-        }
-    }
+    const size_t line_size=(size_t)width*channels;
+    const uchar *from=(const uchar *)from_data;
+    uchar *to=(uchar *)to_data;
+    for(size_t offset=0;offset+line_size<=uncompressed_size;offset+=line_size)
+        reverse_pixels(from+offset,to+offset,width,channels);
 }
 
 bool tga_file::load(const char *file_name)
@@ -382,8 +409,9 @@ bool tga_file::create(int width,int height,tga::color_mode channels,const void *
     m_header.width=width;
     m_header.height=height;
     m_header.channels=channels;
+    m_header.uncompressed_size=width*height*channels;
 
-    m_data.resize(width*height*channels,0);
+    m_data.resize(m_header.uncompressed_size,0);
     if(data)
         memcpy(&m_data[0],data,m_data.size());
 
@@ -419,15 +447,18 @@ bool tga_file::encode_rle(size_t max_compressed_size)
         return false;
 
     m_header.data=&m_data[0];
-    nya_memory::tmp_buffer_scoped buf(max_compressed_size);
-    size_t encoded_size=m_header.encode_rle(buf.get_data(),max_compressed_size);
-    if(!encoded_size)
+    nya_memory::memory_writer writer(max_compressed_size?max_compressed_size:m_data.size());
+    if(!m_header.encode_rle(writer))
+        return false;
+
+    const size_t encoded_size=writer.get_size();
+    if(max_compressed_size && encoded_size>max_compressed_size)
         return false;
 
     m_header.rle=true;
     m_header.compressed_size=encoded_size;
     m_data.resize(encoded_size);
-    memcpy(&m_data[0],buf.get_data(),encoded_size);
+    memcpy(&m_data[0],writer.get_data(),encoded_size);
 
     return true;
 }
@@ -453,6 +484,40 @@ bool tga_file::save(const char *file_name)
     return true;
 }
 
+static bool file_sink(const void *data,size_t size,void *file)
+{
+    return fwrite(data,1,size,(FILE *)file)==size;
+}
+
+bool tga_file::save_rle(const char *file_name)
+{
+    if(m_data.empty())
+        return false;
+
+    if(m_header.rle)
+        return save(file_name);
+
+    FILE *out_file=fopen( file_name, "wb" );
+    if(!out_file)
+    {
+        printf( "unable to save texture %s\n", file_name );
+        return false;
+    }
+
+    tga header=m_header;
+    header.rle=true;
+    header.data=&m_data[0];
+
+    char header_buf[tga::tga_minimum_header_size];
+    const size_t header_size=header.encode_header(header_buf,sizeof(header_buf));
+
+    nya_memory::memory_writer writer(file_sink,out_file);
+    const bool result=writer.write(header_buf,header_size) && header.encode_rle(writer) && writer.flush();
+
+    fclose(out_file);
+    return result;
+}
+
 bool tga_file::flip_horisontal()
 {
     if(m_data.empty())
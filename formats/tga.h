@@ -5,6 +5,8 @@
 #include <vector>
 #include <stddef.h>
 
+namespace nya_memory { class memory_writer; }
+
 namespace nya_formats
 {
 
@@ -31,12 +33,16 @@ struct tga
 public:
     size_t decode_header(const void *data,size_t size); //0 if invalid
     bool decode_rle(void *decoded_data); //decoded_data must be allocated with uncompressed_size
+    //decodes rle if any, applies the flips and swaps bgr(a) to rgb(a) if swizzle in a single pass
+    //decoded_data must be allocated with uncompressed_size, the header then describes it unflipped
+    bool decode(void *decoded_data,bool swizzle=false);
     void flip_horisontal(const void *from_data,void *to_data); //to_data must be allocated, to_data could be equal to from_data
     void flip_vertical(const void *from_data,void *to_data);
 
 public:
     size_t encode_header(void *to_data,size_t to_size=tga_minimum_header_size);
     size_t encode_rle(void *to_data,size_t to_size); //to_data size should be allocated with enough size
+    bool encode_rle(nya_memory::memory_writer &writer); //streams to a growable or sink writer
 
 public:
     const static size_t tga_minimum_header_size=18;
@@ -51,8 +57,9 @@ public:
     bool load(const char *file_name);
     bool create(int width,int height,tga::color_mode channels,const void *data);
     bool decode_rle();
-    bool encode_rle(size_t max_compressed_size);
+    bool encode_rle(size_t max_compressed_size=0); //0 for no limit
     bool save(const char *file_name);
+    bool save_rle(const char *file_name); //encodes while writing, data stays uncompressed
     bool flip_horisontal();
     bool flip_vertical();
     void release() { m_header=nya_formats::tga(); m_data.clear(); }
@@ -0,0 +1,65 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+#ifdef _MSC_VER
+    #include <intrin.h>
+#endif
+
+namespace nya_memory
+{
+
+//returns the new value
+
+inline int atomic_inc(volatile int &value)
+{
+#ifdef _MSC_VER
+    return (int)_InterlockedIncrement((volatile long *)&value);
+#else
+    return __sync_add_and_fetch(&value,1);
+#endif
+}
+
+inline int atomic_dec(volatile int &value)
+{
+#ifdef _MSC_VER
+    return (int)_InterlockedDecrement((volatile long *)&value);
+#else
+    return __sync_sub_and_fetch(&value,1);
+#endif
+}
+
+inline int atomic_get(volatile int &value)
+{
+#ifdef _MSC_VER
+    return (int)_InterlockedCompareExchange((volatile long *)&value,0,0);
+#else
+    return __sync_add_and_fetch(&value,0);
+#endif
+}
+
+//writes made before a release store are visible after an acquire load that reads the stored value
+//for word-sized values and pointers; msvc relies on volatile ordering of x86 and x64
+
+template<typename t> inline t atomic_load_acquire(const volatile t &value)
+{
+#ifdef _MSC_VER
+    const t result=value;
+    _ReadWriteBarrier();
+    return result;
+#else
+    return __atomic_load_n(&value,__ATOMIC_ACQUIRE);
+#endif
+}
+
+template<typename t> inline void atomic_store_release(volatile t &value,t new_value)
+{
+#ifdef _MSC_VER
+    _ReadWriteBarrier();
+    value=new_value;
+#else
+    __atomic_store_n(&value,new_value,__ATOMIC_RELEASE);
+#endif
+}
+
+}
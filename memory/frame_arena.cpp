@@ -0,0 +1,133 @@
+//https://code.google.com/p/nya-engine/
+
+#include "frame_arena.h"
+#include "mem_accounting.h"
+
+namespace nya_memory
+{
+
+namespace
+{
+    int get_mem_category()
+    {
+        static const int category=mem_accounting::get_category("frame_arena");
+        return category;
+    }
+}
+
+void *frame_arena::allocate(size_t size,size_t align)
+{
+    if(!align)
+        align=1;
+
+    while(m_curr_page<m_pages.size())
+    {
+        page &p=m_pages[m_curr_page];
+        const size_t pad=(align-(size_t)(p.data+p.offset)%align)%align;
+        if(p.offset+pad+size<=p.size)
+        {
+            void *result=p.data+p.offset+pad;
+            p.offset+=pad+size;
+            m_used+=pad+size;
+            if(m_used>m_frame_used)
+                m_frame_used=m_used;
+
+            return result;
+        }
+
+        if(++m_curr_page<m_pages.size())
+            m_pages[m_curr_page].offset=0;
+    }
+
+    page p;
+    p.size=size+align>m_page_size?size+align:m_page_size;
+    p.data=new char[p.size];
+    mem_accounting::add(get_mem_category(),p.size);
+    p.offset=0;
+    m_pages.push_back(p);
+    m_curr_page=m_pages.size()-1;
+
+    return allocate(size,align);
+}
+
+frame_arena::marker frame_arena::get_marker() const
+{
+    marker m;
+    if(m_curr_page<m_pages.size())
+    {
+        m.page=m_curr_page;
+        m.offset=m_pages[m_curr_page].offset;
+    }
+
+    m.used=m_used;
+    return m;
+}
+
+void frame_arena::rewind(const marker &m)
+{
+    if(m.page>=m_pages.size())
+        return;
+
+    m_curr_page=m.page;
+    m_pages[m_curr_page].offset=m.offset;
+    m_used=m.used;
+}
+
+void frame_arena::reset()
+{
+    m_last_frame_used=m_frame_used;
+    if(m_frame_used>m_peak_frame_used)
+        m_peak_frame_used=m_frame_used;
+
+    //coalesce pages so that the next frame of the same size fits in one page
+    if(m_pages.size()>1)
+    {
+        const size_t capacity=get_capacity();
+        for(size_t i=0;i<m_pages.size();++i)
+        {
+            delete []m_pages[i].data;
+            mem_accounting::remove(get_mem_category(),m_pages[i].size);
+        }
+
+        m_pages.resize(1);
+        m_pages[0].size=capacity;
+        m_pages[0].data=new char[capacity];
+        mem_accounting::add(get_mem_category(),capacity);
+    }
+
+    if(!m_pages.empty())
+        m_pages[0].offset=0;
+
+    m_curr_page=0;
+    m_used=0;
+    m_frame_used=0;
+}
+
+size_t frame_arena::get_capacity() const
+{
+    size_t capacity=0;
+    for(size_t i=0;i<m_pages.size();++i)
+        capacity+=m_pages[i].size;
+
+    return capacity;
+}
+
+frame_arena &frame_arena::get()
+{
+    static frame_arena arena;
+    return arena;
+}
+
+frame_arena::frame_arena(size_t page_size): m_curr_page(0),m_page_size(page_size?page_size:1),m_used(0),
+                                            m_frame_used(0),m_last_frame_used(0),m_peak_frame_used(0) {}
+
+frame_arena::~frame_arena()
+{
+    for(size_t i=0;i<m_pages.size();++i)
+    {
+        delete []m_pages[i].data;
+        mem_accounting::remove(get_mem_category(),m_pages[i].size);
+    }
+}
+
+}
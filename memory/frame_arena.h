@@ -0,0 +1,137 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <string>
+
+//Note: linear allocator for the per-frame scratch data, not thread safe
+//      the default arena is reset in nya_render::statistics::begin_frame
+
+namespace nya_memory
+{
+
+class frame_arena
+{
+public:
+    void *allocate(size_t size,size_t align=16); //align should be a power of two
+
+public:
+    struct marker
+    {
+        size_t page;
+        size_t offset;
+        size_t used;
+
+        marker(): page(0),offset(0),used(0) {}
+    };
+
+    marker get_marker() const;
+    void rewind(const marker &m);
+
+    void reset(); //call once per frame
+
+public:
+    size_t get_used() const { return m_used; }
+    size_t get_capacity() const;
+    size_t get_last_frame_used() const { return m_last_frame_used; }
+    size_t get_peak_frame_used() const { return m_peak_frame_used; }
+
+public:
+    static frame_arena &get();
+
+public:
+    frame_arena(size_t page_size=64*1024);
+    ~frame_arena();
+
+    //non copyable
+private:
+    frame_arena(const frame_arena &);
+    void operator = (const frame_arena &);
+
+private:
+    struct page
+    {
+        char *data;
+        size_t size;
+        size_t offset;
+    };
+
+    std::vector<page> m_pages;
+    size_t m_curr_page;
+    size_t m_page_size;
+    size_t m_used;
+    size_t m_frame_used;
+    size_t m_last_frame_used;
+    size_t m_peak_frame_used;
+};
+
+class frame_arena_scoped_rewind
+{
+public:
+    frame_arena_scoped_rewind(frame_arena &a=frame_arena::get()): m_arena(a),m_marker(a.get_marker()) {}
+    ~frame_arena_scoped_rewind() { m_arena.rewind(m_marker); }
+
+    //non copyable
+private:
+    frame_arena_scoped_rewind(const frame_arena_scoped_rewind &);
+    void operator = (const frame_arena_scoped_rewind &);
+
+private:
+    frame_arena &m_arena;
+    frame_arena::marker m_marker;
+};
+
+template<typename t> class frame_allocator
+{
+    template<typename> friend class frame_allocator;
+
+public:
+    typedef t value_type;
+    typedef t *pointer;
+    typedef const t *const_pointer;
+    typedef t &reference;
+    typedef const t &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename u> struct rebind { typedef frame_allocator<u> other; };
+
+public:
+    pointer address(reference r) const { return &r; }
+    const_pointer address(const_reference r) const { return &r; }
+
+    pointer allocate(size_type n,const void* =0)
+    {
+        const size_t align=sizeof(t)&(~sizeof(t)+1); //largest power of two dividing the size
+        void *p=m_arena->allocate(n*sizeof(t),align<16?align:16);
+        if(!p)
+            throw std::bad_alloc();
+
+        return (pointer)p;
+    }
+
+    void deallocate(pointer,size_type) {} //freed on rewind or reset
+
+    size_type max_size() const { return size_t(-1)/sizeof(t); }
+
+    void construct(pointer p,const t &v) { new (p) t(v); }
+    void destroy(pointer p) { p->~t(); }
+
+    template<typename u> bool operator == (const frame_allocator<u> &other) const { return m_arena==other.m_arena; }
+    template<typename u> bool operator != (const frame_allocator<u> &other) const { return m_arena!=other.m_arena; }
+
+public:
+    frame_allocator(): m_arena(&frame_arena::get()) {}
+    frame_allocator(frame_arena &a): m_arena(&a) {}
+    template<typename u> frame_allocator(const frame_allocator<u> &other): m_arena(other.m_arena) {}
+
+private:
+    frame_arena *m_arena;
+};
+
+typedef std::basic_string<char,std::char_traits<char>,frame_allocator<char> > frame_string;
+
+}
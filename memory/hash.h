@@ -0,0 +1,119 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+#include <cstddef>
+#include <string.h>
+
+namespace nya_memory
+{
+
+//32-bit FNV-1a
+
+inline unsigned int hash_data(const void *data,size_t size,unsigned int hash=2166136261u)
+{
+    const unsigned char *d=(const unsigned char *)data;
+    for(size_t i=0;i<size;++i)
+    {
+        hash^=d[i];
+        hash*=16777619u;
+    }
+
+    return hash;
+}
+
+inline unsigned int hash_string(const char *str,unsigned int hash=2166136261u)
+{
+    if(!str)
+        return hash;
+
+    for(const unsigned char *s=(const unsigned char *)str;*s;++s)
+    {
+        hash^=*s;
+        hash*=16777619u;
+    }
+
+    return hash;
+}
+
+//64-bit hash of large blocks such as resource contents, processes 8 bytes at a time
+
+inline unsigned long long hash_data64(const void *data,size_t size,unsigned long long hash=14695981039346656037ull)
+{
+    const unsigned long long prime=1099511628211ull;
+    const unsigned char *d=(const unsigned char *)data;
+
+    size_t i=0;
+    for(;i+8<=size;i+=8)
+    {
+        unsigned long long v;
+        memcpy(&v,d+i,8);
+        hash=(hash^v)*prime;
+        hash^=hash>>29;
+    }
+
+    for(;i<size;++i)
+        hash=(hash^d[i])*prime;
+
+    return (hash^size)*prime;
+}
+
+//128-bit murmur3 (x64 variant), for keys that identify contents without comparing the data
+
+inline unsigned long long hash_rotl64(unsigned long long x,int r) { return (x<<r)|(x>>(64-r)); }
+
+inline unsigned long long hash_fmix64(unsigned long long k)
+{
+    k^=k>>33;
+    k*=0xff51afd7ed558ccdull;
+    k^=k>>33;
+    k*=0xc4ceb9fe1a85ec53ull;
+    k^=k>>33;
+    return k;
+}
+
+inline void hash_data128(const void *data,size_t size,unsigned long long out[2],unsigned long long seed=0)
+{
+    const unsigned long long c1=0x87c37b91114253d5ull,c2=0x4cf5ad432745937full;
+    const unsigned char *d=(const unsigned char *)data;
+    unsigned long long h1=seed,h2=seed;
+
+    size_t i=0;
+    for(;i+16<=size;i+=16)
+    {
+        unsigned long long k1,k2;
+        memcpy(&k1,d+i,8);
+        memcpy(&k2,d+i+8,8);
+
+        h1^=hash_rotl64(k1*c1,31)*c2;
+        h1=(hash_rotl64(h1,27)+h2)*5+0x52dce729;
+        h2^=hash_rotl64(k2*c2,33)*c1;
+        h2=(hash_rotl64(h2,31)+h1)*5+0x38495ab5;
+    }
+
+    const size_t tail=size-i;
+    unsigned long long k1=0,k2=0;
+    for(size_t j=tail;j>8;--j)
+        k2^=(unsigned long long)d[i+j-1]<<((j-9)*8);
+    for(size_t j=tail<8?tail:8;j>0;--j)
+        k1^=(unsigned long long)d[i+j-1]<<((j-1)*8);
+
+    if(tail>8)
+        h2^=hash_rotl64(k2*c2,33)*c1;
+    if(tail)
+        h1^=hash_rotl64(k1*c1,31)*c2;
+
+    h1^=size;
+    h2^=size;
+    h1+=h2;
+    h2+=h1;
+    h1=hash_fmix64(h1);
+    h2=hash_fmix64(h2);
+    h1+=h2;
+    h2+=h1;
+
+    out[0]=h1;
+    out[1]=h2;
+}
+
+}
@@ -1,66 +1,64 @@
 #pragma once
 
-// 'insert' and 'get_by_key' are O(log(size)) operations
-// 'get_by_idx' is O(1) operation
-// 'erase', 'get_idx_for_key' and 'get_key_for_idx' are O(size) operations
-// copy construction and assigment are O(size^2) operations
+// objects and keys are stored in contiguous arrays, keys are indexed with an open-addressing hash table
+// 'insert', 'get_by_key', 'get_idx_for_key' and 'erase' are O(1) average operations
+// 'get_by_idx' and 'get_key_for_idx' are O(1) operations
+// erase moves the last object to the erased index, use handles to refer objects across erases
+// copy construction and assigment are O(size) operations
 
-#include <map>
 #include <vector>
-#include <list>
-#include <algorithm>
+#include <string>
 #include "invalid_object.h"
+#include "hash.h"
 
 namespace nya_memory
 {
 
-template <class object_t,class key_t=std::string>
+template<typename key_t> struct indexed_map_hash
+{
+    //for plain data keys
+    unsigned int operator () (const key_t &k) const { return hash_data(&k,sizeof(k)); }
+};
+
+template<> struct indexed_map_hash<std::string>
+{
+    unsigned int operator () (const std::string &k) const { return hash_data(k.data(),k.size()); }
+};
+
+template <class object_t,class key_t=std::string,class hash_t=indexed_map_hash<key_t> >
 class indexed_map
 {
 public:
     bool insert(const key_t &k,const object_t &obj)
     {
-        typename keys_map::iterator key_iter=m_keys.find(k);
-        if(key_iter==m_keys.end())
-        {
-            typename objects_list::iterator object_iter = m_objects.insert(m_objects.end(),obj);
-            m_keys.insert(std::make_pair(k,object_iter));
-            m_indices.push_back(object_iter);
-            return true;
-        }
-        else
+        const unsigned int hash=m_hash(k);
+        const int idx=find(k,hash);
+        if(idx>=0)
         {
-            *(key_iter->second)=obj;
+            m_objects[idx]=obj;
             return false;
         }
+
+        push(k,hash,obj);
+        return true;
     }
 
     object_t &add(const key_t &k)
     {
-        typename keys_map::iterator key_iter=m_keys.find(k);
-        if(key_iter==m_keys.end())
-        {
-            typename objects_list::iterator object_iter = m_objects.insert(m_objects.end(),object_t());
-            m_keys.insert(std::make_pair(k,object_iter));
-            m_indices.push_back(object_iter);
-            return *object_iter;
-        }
-        else
-            return *(key_iter->second);
+        const unsigned int hash=m_hash(k);
+        const int idx=find(k,hash);
+        if(idx>=0)
+            return m_objects[idx];
+
+        push(k,hash,object_t());
+        return m_objects.back();
     }
 
-    bool has_key(const key_t &k) const { return m_keys.find(k)!=m_keys.end(); }
+    bool has_key(const key_t &k) const { return find(k,m_hash(k))>=0; }
     bool is_empty() const { return m_objects.empty(); }
     int get_size() const { return (int)m_objects.size(); }
 
-    int get_idx_for_key(const key_t &k) const
-    {
-        typename keys_map::const_iterator key_iter=m_keys.find(k);
-        if(key_iter==m_keys.end())
-            return -1;
-
-        return (int)get_idx_for_iter(key_iter->second);
-    }
+    int get_idx_for_key(const key_t &k) const { return find(k,m_hash(k)); }
 
     // returns invalid key on bad idx
     key_t get_key_for_idx(size_t idx) const
@@ -68,11 +66,7 @@ public:
         if(idx>=m_objects.size())
             return get_invalid_object<key_t>();
 
-        typename objects_list::const_iterator object_iter=m_indices[idx];
-        typename keys_map::const_iterator key_iter=m_keys.begin();
-        while(key_iter->second!=object_iter)
-            ++key_iter;
-        return key_iter->first;
+        return m_keys[idx];
     }
 
     object_t &get_by_idx(size_t idx)
@@ -80,40 +74,66 @@ public:
         if(idx>=m_objects.size())
             return get_invalid_object<object_t>();
 
-        return *(m_indices[idx]);
+        return m_objects[idx];
     }
 
     const object_t &get_by_idx(size_t idx) const
     {
-        if(idx >= m_objects.size())
+        if(idx>=m_objects.size())
             return get_invalid_object<object_t>();
 
-        return *(m_indices[idx]);
+        return m_objects[idx];
     }
 
     object_t &get_by_key(const key_t &k)
     {
-        typename keys_map::iterator iter=m_keys.find(k);
-        if(iter==m_keys.end())
+        const int idx=find(k,m_hash(k));
+        if(idx<0)
             return get_invalid_object<object_t>();
 
-        return *(iter->second);
+        return m_objects[idx];
     }
 
     const object_t &get_by_key(const key_t &k) const
     {
-        typename keys_map::const_iterator iter=m_keys.find(k);
-        if(iter==m_keys.end())
+        const int idx=find(k,m_hash(k));
+        if(idx<0)
             return get_invalid_object<object_t>();
 
-        return *(iter->second);
+        return m_objects[idx];
     }
 
+public:
+    //handles stay valid until the object is erased, returns -1 if not found
+    int get_handle_for_key(const key_t &k) const
+    {
+        const int idx=find(k,m_hash(k));
+        return idx<0?-1:m_handles[idx];
+    }
+
+    int get_handle_for_idx(size_t idx) const { return idx<m_handles.size()?m_handles[idx]:-1; }
+
+    int get_idx_for_handle(int handle) const
+    {
+        if(handle<0 || handle>=(int)m_handle_idx.size())
+            return -1;
+
+        return m_handle_idx[handle];
+    }
+
+    object_t &get_by_handle(int handle) { return get_by_idx((size_t)get_idx_for_handle(handle)); }
+    const object_t &get_by_handle(int handle) const { return get_by_idx((size_t)get_idx_for_handle(handle)); }
+
+public:
     void clear()
     {
         m_objects.clear();
         m_keys.clear();
-        m_indices.clear();
+        m_hashes.clear();
+        m_handles.clear();
+        m_handle_idx.clear();
+        m_free_handles.clear();
+        m_slots.clear();
     }
 
     bool erase_by_idx(size_t idx)
@@ -121,83 +141,157 @@ public:
         if(idx>=m_objects.size())
             return false;
 
-        key_t k=get_key_for_idx(idx);
-        m_objects.erase(m_indices[idx]);
-        m_indices.erase(m_indices.begin()+idx);
-        m_keys.erase(k);
+        erase_slot(idx);
+
+        const int handle=m_handles[idx];
+        m_handle_idx[handle]=-1;
+        m_free_handles.push_back(handle);
+
+        const size_t last=m_objects.size()-1;
+        if(idx!=last)
+        {
+            m_slots[find_slot(last)]=(int)idx;
+            m_objects[idx]=m_objects[last];
+            m_keys[idx]=m_keys[last];
+            m_hashes[idx]=m_hashes[last];
+            m_handles[idx]=m_handles[last];
+            m_handle_idx[m_handles[idx]]=(int)idx;
+        }
+
+        m_objects.pop_back();
+        m_keys.pop_back();
+        m_hashes.pop_back();
+        m_handles.pop_back();
         return true;
     }
 
     bool erase_by_key(const key_t &k)
     {
-        typename keys_map::iterator key_iter=m_keys.find(k);
-        if(key_iter==m_keys.end())
+        const int idx=find(k,m_hash(k));
+        if(idx<0)
             return false;
 
-        size_t idx=get_idx_for_iter(key_iter->second);
-        m_objects.erase(m_indices[idx]);
-        m_indices.erase(m_indices.begin()+idx);
-        m_keys.erase(key_iter);
-        return true;
+        return erase_by_idx(idx);
     }
 
-public:
-    indexed_map() {}
-    indexed_map(const indexed_map &m):
-    m_objects(m.m_objects)
+    void reserve(size_t size)
     {
-        for(typename keys_map::const_iterator it=m.m_keys.begin(); it!=m.m_keys.end(); ++it)
-            m_keys.insert(std::make_pair(it->first,find_corressponding_iterator(m.m_objects,it->second)));
+        m_objects.reserve(size);
+        m_keys.reserve(size);
+        m_hashes.reserve(size);
+        m_handles.reserve(size);
+        m_handle_idx.reserve(size);
+        if(m_slots.size()<size*2)
+            rehash(size*2);
+    }
 
-        for(typename indices_map::const_iterator it=m.m_indices.begin(); it!=m.m_indices.end(); ++it)
-            m_indices.push_back(find_corressponding_iterator(m.m_objects,*it));
+private:
+    int find(const key_t &k,unsigned int hash) const
+    {
+        if(m_slots.empty())
+            return -1;
+
+        const size_t mask=m_slots.size()-1;
+        for(size_t i=hash&mask;;i=(i+1)&mask)
+        {
+            const int idx=m_slots[i];
+            if(idx<0)
+                return -1;
+
+            if(m_hashes[idx]==hash && m_keys[idx]==k)
+                return idx;
+        }
     }
 
-    indexed_map &operator=(const indexed_map &m)
+    size_t find_slot(size_t idx) const
     {
-        m_objects=m.m_objects;
+        const size_t mask=m_slots.size()-1;
+        size_t i=m_hashes[idx]&mask;
+        while(m_slots[i]!=(int)idx)
+            i=(i+1)&mask;
 
-        m_keys.clear();
-        for(typename keys_map::const_iterator it=m.m_keys.begin(); it!=m.m_keys.end(); ++it)
-            m_keys.insert(std::make_pair(it->first,find_corressponding_iterator(m.m_objects,it->second)));
+        return i;
+    }
 
-        m_indices.clear();
-        for(typename indices_map::const_iterator it=m.m_indices.begin();it!=m.m_indices.end(); ++it)
-            m_indices.push_back(find_corressponding_iterator(m.m_objects,*it));
+    void insert_slot(size_t idx)
+    {
+        const size_t mask=m_slots.size()-1;
+        size_t i=m_hashes[idx]&mask;
+        while(m_slots[i]>=0)
+            i=(i+1)&mask;
 
-        return *this;
+        m_slots[i]=(int)idx;
     }
 
-private:
-    typedef std::list<object_t> objects_list;
-    typedef std::map<key_t, typename std::list<object_t>::iterator> keys_map;
-    typedef std::vector<typename std::list<object_t>::iterator> indices_map;
+    void erase_slot(size_t idx)
+    {
+        const size_t mask=m_slots.size()-1;
+        size_t i=find_slot(idx);
+
+        //backward shift deletion, keeps probe sequences without tombstones
+        m_slots[i]=-1;
+        for(size_t j=(i+1)&mask;m_slots[j]>=0;j=(j+1)&mask)
+        {
+            const size_t home=m_hashes[m_slots[j]]&mask;
+            if(((j-home)&mask)<((j-i)&mask))
+                continue;
+
+            m_slots[i]=m_slots[j];
+            m_slots[j]=-1;
+            i=j;
+        }
+    }
 
-    size_t get_idx_for_iter(typename objects_list::const_iterator object_iter) const
+    void rehash(size_t min_size)
     {
-        size_t result=0;
-        while(m_indices[result]!=object_iter)
-            ++result;
+        size_t size=16;
+        while(size<min_size)
+            size*=2;
 
-        return result;
+        m_slots.assign(size,-1);
+        for(size_t i=0;i<m_objects.size();++i)
+            insert_slot(i);
     }
 
-    typename objects_list::iterator find_corressponding_iterator(const objects_list &another_objects,
-                                                                 typename objects_list::const_iterator another_iter)
+    void push(const key_t &k,unsigned int hash,const object_t &obj)
     {
-        typename objects_list::iterator result=m_objects.begin();
-        typename objects_list::const_iterator another_finder=another_objects.begin();
-        while(another_finder!=another_iter)
+        const size_t idx=m_objects.size();
+        m_objects.push_back(obj);
+        m_keys.push_back(k);
+        m_hashes.push_back(hash);
+
+        int handle;
+        if(m_free_handles.empty())
+        {
+            handle=(int)m_handle_idx.size();
+            m_handle_idx.push_back((int)idx);
+        }
+        else
         {
-            ++another_finder;
-            ++result;
+            handle=m_free_handles.back();
+            m_free_handles.pop_back();
+            m_handle_idx[handle]=(int)idx;
         }
-        return result;
+
+        m_handles.push_back(handle);
+
+        if(m_objects.size()*2>m_slots.size())
+            rehash(m_objects.size()*2);
+        else
+            insert_slot(idx);
     }
 
-    objects_list m_objects;
-    keys_map m_keys;
-    indices_map m_indices;
+private:
+    std::vector<object_t> m_objects;
+    std::vector<key_t> m_keys;
+    std::vector<unsigned int> m_hashes;
+    std::vector<int> m_handles;
+
+    std::vector<int> m_handle_idx;
+    std::vector<int> m_free_handles;
+
+    std::vector<int> m_slots;
+    hash_t m_hash;
 };
 
 }
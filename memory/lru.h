@@ -1,8 +1,15 @@
 #pragma once
 
+// entries are stored in a flat array linked into an intrusive list,
+// names are found through an open-addressing hash table with precomputed hashes
+// 'access' and 'free' are O(1) operations on average
+// count is the maximum number of entries, set_size_limit adds an optional byte budget
+
 #include "invalid_object.h"
-#include <list>
-#include <map>
+#include "hash.h"
+#include "mem_accounting.h"
+#include <string>
+#include <vector>
 
 namespace nya_memory
 {
@@ -12,6 +19,7 @@ template<class t,size_t count> class lru
 protected:
     virtual bool on_access(const char *name,t& value) { return false; }
     virtual bool on_free(const char *name,t& value) { return true; }
+    virtual size_t get_size(const char *name,const t& value) { return 0; } //for the byte budget
 
 public:
     t &access(const char *name)
@@ -19,31 +27,56 @@ public:
         if(!name)
             return get_invalid_object<t>();
 
-        typename map::iterator it=m_map.find(name);
-		if(it!=m_map.end())
-        {
-			m_list.splice(m_list.begin(),m_list,it->second);
-			return it->second->second;
-		}
+        return access(name,hash_string(name));
+    }
+
+    t &access(const char *name,unsigned int hash)
+    {
+        if(!name)
+            return get_invalid_object<t>();
 
-		if(m_list.size()>=count)
+        int idx=find(name,hash);
+        if(idx>=0)
         {
-            typename list::iterator last=m_list.end();
-			last--;
-            on_free(last->first.c_str(),last->second);
-			m_map.erase(last->first);
-			m_list.pop_back();
-		}
-
-		m_list.push_front(entry(name,t()));
-        if(!on_access(name,m_list.front().second))
+            ++m_hits;
+            unlink(idx);
+            link_front(idx);
+            return m_entries[idx].value;
+        }
+
+        ++m_misses;
+
+        if(m_free<0)
+            evict(m_tail);
+
+        if(m_free<0)
+            return get_invalid_object<t>();
+
+        idx=m_free;
+        entry &e=m_entries[idx];
+        m_free=e.next;
+
+        e.name.assign(name);
+        e.hash=hash;
+        e.value=t();
+        if(!on_access(name,e.value))
         {
-            m_list.pop_front();
+            e.next=m_free;
+            m_free=idx;
             return get_invalid_object<t>();
         }
 
-        m_map[name]=m_list.begin();
-        return m_list.front().second;
+        insert_slot(idx);
+        link_front(idx);
+
+        e.size=get_size(name,e.value);
+        m_used_size+=e.size;
+        ++m_count;
+
+        while(m_size_limit && m_used_size>m_size_limit && m_tail!=idx)
+            evict(m_tail);
+
+        return e.value;
     }
 
     void free(const char *name)
@@ -51,32 +84,208 @@ public:
         if(!name)
             return;
 
-        typename map::iterator it=m_map.find(name);
-        if(it==m_map.end())
+        free(name,hash_string(name));
+    }
+
+    void free(const char *name,unsigned int hash)
+    {
+        if(!name)
+            return;
+
+        const int idx=find(name,hash);
+        if(idx<0)
             return;
 
-        on_free(it->first.c_str(),it->second->second);
-        m_list.erase(it->second);
-        m_map.erase(it);
+        on_free(m_entries[idx].name.c_str(),m_entries[idx].value);
+        remove(idx);
     }
 
     void clear()
     {
-        for(typename list::iterator it=m_list.begin();it!=m_list.end();++it)
-            on_free(it->first.c_str(),it->second);
-        m_list.clear();
-        m_map.clear();
+        for(int i=m_head;i>=0;i=m_entries[i].next)
+            on_free(m_entries[i].name.c_str(),m_entries[i].value);
+
+        reset();
+    }
+
+public:
+    void set_size_limit(size_t bytes)
+    {
+        m_size_limit=bytes;
+        while(m_size_limit && m_used_size>m_size_limit && m_tail>=0)
+            evict(m_tail);
+    }
+
+    size_t get_size_limit() const { return m_size_limit; }
+    size_t get_used_size() const { return m_used_size; }
+    size_t get_count() const { return m_count; }
+
+    size_t get_hits() const { return m_hits; }
+    size_t get_misses() const { return m_misses; }
+    size_t get_evictions() const { return m_evictions; }
+    void reset_stats() { m_hits=m_misses=m_evictions=0; }
+
+public:
+    lru(): m_entries(count),m_slots(table_size),m_size_limit(0),m_hits(0),m_misses(0),m_evictions(0)
+    {
+        reset();
+        m_mem_poll=mem_accounting::register_poll("lru_caches",poll_mem,this);
     }
 
-public: lru(){}
+    virtual ~lru() { mem_accounting::unregister_poll(m_mem_poll); }
+
 private: lru(const lru &); void operator = (const lru &); //non copyable
 
 private:
-    typedef std::pair<std::string,t> entry;
-    typedef std::list<entry> list;
-    typedef std::map<std::string,typename list::iterator> map;
-    list m_list;
-    map m_map;
+    static void poll_mem(mem_usage &usage,void *user_data)
+    {
+        const lru *l=(const lru *)user_data;
+        usage.current=l->m_used_size;
+        usage.count=l->m_count;
+    }
+
+private:
+    int find(const char *name,unsigned int hash) const
+    {
+        for(size_t i=hash%table_size;;i=(i+1)%table_size)
+        {
+            const int idx=m_slots[i];
+            if(idx<0)
+                return -1;
+
+            const entry &e=m_entries[idx];
+            if(e.hash==hash && e.name==name)
+                return idx;
+        }
+    }
+
+    void insert_slot(int idx)
+    {
+        size_t i=m_entries[idx].hash%table_size;
+        while(m_slots[i]>=0)
+            i=(i+1)%table_size;
+
+        m_slots[i]=idx;
+    }
+
+    void erase_slot(int idx)
+    {
+        size_t i=m_entries[idx].hash%table_size;
+        while(m_slots[i]!=idx)
+            i=(i+1)%table_size;
+
+        //backward shift deletion, keeps probe sequences without tombstones
+        m_slots[i]=-1;
+        for(size_t j=(i+1)%table_size;m_slots[j]>=0;j=(j+1)%table_size)
+        {
+            const size_t home=m_entries[m_slots[j]].hash%table_size;
+            const bool in_place=i<=j?(i<home && home<=j):(i<home || home<=j);
+            if(in_place)
+                continue;
+
+            m_slots[i]=m_slots[j];
+            m_slots[j]=-1;
+            i=j;
+        }
+    }
+
+    void link_front(int idx)
+    {
+        entry &e=m_entries[idx];
+        e.prev=-1;
+        e.next=m_head;
+        if(m_head>=0)
+            m_entries[m_head].prev=idx;
+        else
+            m_tail=idx;
+
+        m_head=idx;
+    }
+
+    void unlink(int idx)
+    {
+        entry &e=m_entries[idx];
+        if(e.prev>=0)
+            m_entries[e.prev].next=e.next;
+        else
+            m_head=e.next;
+
+        if(e.next>=0)
+            m_entries[e.next].prev=e.prev;
+        else
+            m_tail=e.prev;
+    }
+
+    void remove(int idx)
+    {
+        erase_slot(idx);
+        unlink(idx);
+
+        entry &e=m_entries[idx];
+        m_used_size-=e.size;
+        --m_count;
+
+        e.value=t();
+        e.size=0;
+        e.next=m_free;
+        m_free=idx;
+    }
+
+    void evict(int idx)
+    {
+        if(idx<0)
+            return;
+
+        on_free(m_entries[idx].name.c_str(),m_entries[idx].value);
+        remove(idx);
+        ++m_evictions;
+    }
+
+    void reset()
+    {
+        for(size_t i=0;i<table_size;++i)
+            m_slots[i]=-1;
+
+        for(size_t i=0;i<count;++i)
+        {
+            m_entries[i].value=t();
+            m_entries[i].size=0;
+            m_entries[i].next=i+1<count?int(i+1):-1;
+        }
+
+        m_free=count?0:-1;
+        m_head=m_tail=-1;
+        m_used_size=0;
+        m_count=0;
+    }
+
+private:
+    struct entry
+    {
+        std::string name;
+        t value;
+        unsigned int hash;
+        int prev,next;
+        size_t size;
+
+        entry(): value(),hash(0),prev(-1),next(-1),size(0) {}
+    };
+
+    static const size_t table_size=count*2+1;
+
+    std::vector<entry> m_entries;
+    std::vector<int> m_slots;
+    int m_head,m_tail,m_free;
+
+    size_t m_count;
+    size_t m_used_size;
+    size_t m_size_limit;
+
+    size_t m_hits;
+    size_t m_misses;
+    size_t m_evictions;
+
+    int m_mem_poll;
 };
 
 }
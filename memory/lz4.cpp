@@ -0,0 +1,203 @@
+//https://code.google.com/p/nya-engine/
+
+#include "lz4.h"
+#include <string.h>
+
+namespace nya_memory
+{
+
+namespace
+{
+
+const size_t min_match=4;
+const size_t last_literals=5; //last bytes are always literals
+const size_t mflimit=12; //last match starts at least this far from the end
+const size_t max_distance=65535;
+const unsigned int hash_log=12;
+
+inline unsigned int read32(const unsigned char *p) { unsigned int v; memcpy(&v,p,4); return v; }
+
+inline unsigned int hash32(unsigned int v) { return (v*2654435761u)>>(32-hash_log); }
+
+bool write_length(unsigned char *&out,const unsigned char *out_end,size_t len)
+{
+    for(;len>=255;len-=255)
+    {
+        if(out>=out_end)
+            return false;
+
+        *out++=255;
+    }
+
+    if(out>=out_end)
+        return false;
+
+    *out++=(unsigned char)len;
+    return true;
+}
+
+//match_len 0 for the last sequence
+bool write_sequence(unsigned char *&out,const unsigned char *out_end,const unsigned char *literals,size_t literals_len,
+                    size_t offset,size_t match_len)
+{
+    if(out>=out_end)
+        return false;
+
+    unsigned char *token=out++;
+    *token=(unsigned char)((literals_len<15?literals_len:15)<<4);
+    if(literals_len>=15 && !write_length(out,out_end,literals_len-15))
+        return false;
+
+    if(literals_len>(size_t)(out_end-out))
+        return false;
+
+    memcpy(out,literals,literals_len);
+    out+=literals_len;
+
+    if(!match_len)
+        return true;
+
+    if(out_end-out<2)
+        return false;
+
+    *out++=(unsigned char)(offset&0xff);
+    *out++=(unsigned char)(offset>>8);
+
+    const size_t len=match_len-min_match;
+    *token|=(unsigned char)(len<15?len:15);
+    return len<15 || write_length(out,out_end,len-15);
+}
+
+bool read_length(const unsigned char *&in,const unsigned char *in_end,size_t &len)
+{
+    unsigned char b;
+    do
+    {
+        if(in>=in_end)
+            return false;
+
+        b=*in++;
+        len+=b;
+    }
+    while(b==255);
+
+    return true;
+}
+
+}
+
+size_t lz4::get_max_compressed_size(size_t size) { return size+size/255+16; }
+
+size_t lz4::compress(const void *data,size_t size,void *to_data,size_t to_size)
+{
+    if((!data && size) || !to_data)
+        return 0;
+
+    const unsigned char *src=(const unsigned char *)data;
+    unsigned char *out=(unsigned char *)to_data;
+    const unsigned char *out_end=out+to_size;
+
+    size_t anchor=0;
+    if(size>mflimit)
+    {
+        unsigned int table[1<<hash_log];
+        memset(table,0,sizeof(table));
+
+        const size_t match_limit=size-last_literals;
+        for(size_t i=1;i+mflimit<=size;)
+        {
+            const unsigned int seq=read32(src+i);
+            const unsigned int h=hash32(seq);
+            const size_t ref=table[h];
+            table[h]=(unsigned int)i;
+
+            if(ref>=i || i-ref>max_distance || read32(src+ref)!=seq)
+            {
+                ++i;
+                continue;
+            }
+
+            size_t start=i,match=ref;
+            while(start>anchor && match>0 && src[start-1]==src[match-1])
+                --start,--match;
+
+            size_t len=min_match;
+            while(start+len<match_limit && src[match+len]==src[start+len])
+                ++len;
+
+            if(!write_sequence(out,out_end,src+anchor,start-anchor,start-match,len))
+                return 0;
+
+            i=anchor=start+len;
+            if(i+mflimit<=size)
+                table[hash32(read32(src+i-2))]=(unsigned int)(i-2);
+        }
+    }
+
+    if(!write_sequence(out,out_end,src+anchor,size-anchor,0,0))
+        return 0;
+
+    return out-(unsigned char *)to_data;
+}
+
+bool lz4::decompress(const void *data,size_t size,void *to_data,size_t to_size)
+{
+    if(!data || (!to_data && to_size))
+        return false;
+
+    const unsigned char *in=(const unsigned char *)data;
+    const unsigned char *in_end=in+size;
+    unsigned char *out=(unsigned char *)to_data;
+    unsigned char *out_end=out+to_size;
+
+    for(;;)
+    {
+        if(in>=in_end)
+            return false;
+
+        const unsigned char token=*in++;
+
+        size_t literals_len=token>>4;
+        if(literals_len==15 && !read_length(in,in_end,literals_len))
+            return false;
+
+        if(literals_len>(size_t)(in_end-in) || literals_len>(size_t)(out_end-out))
+            return false;
+
+        memcpy(out,in,literals_len);
+        out+=literals_len;
+        in+=literals_len;
+
+        if(in==in_end)
+            return out==out_end;
+
+        if(in_end-in<2)
+            return false;
+
+        const size_t offset=in[0]|(in[1]<<8);
+        in+=2;
+        if(!offset || offset>(size_t)(out-(unsigned char *)to_data))
+            return false;
+
+        size_t len=token&15;
+        if(len==15 && !read_length(in,in_end,len))
+            return false;
+
+        len+=min_match;
+        if(len>(size_t)(out_end-out))
+            return false;
+
+        const unsigned char *match=out-offset;
+        if(offset>=len)
+            memcpy(out,match,len);
+        else
+        {
+            for(size_t i=0;i<len;++i)
+                out[i]=match[i];
+        }
+
+        out+=len;
+    }
+}
+
+}
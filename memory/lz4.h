@@ -0,0 +1,25 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//lz4 block format, compatible with the reference LZ4_compress_default/LZ4_decompress_safe
+//no frame headers, the caller stores the sizes
+
+#include <cstddef>
+
+namespace nya_memory
+{
+
+class lz4
+{
+public:
+    static size_t get_max_compressed_size(size_t size);
+
+    //returns compressed size or 0 if it doesn't fit to to_size
+    static size_t compress(const void *data,size_t size,void *to_data,size_t to_size);
+
+    //to_size must be exactly the uncompressed size, false on malformed data
+    static bool decompress(const void *data,size_t size,void *to_data,size_t to_size);
+};
+
+}
@@ -0,0 +1,296 @@
+//https://code.google.com/p/nya-engine/
+
+#include "mem_accounting.h"
+#include "memory.h"
+#include "mutex.h"
+#include "invalid_object.h"
+#include <string.h>
+
+namespace nya_memory
+{
+
+namespace
+{
+
+struct poll
+{
+    int category;
+    mem_accounting::poll_callback callback;
+    void *user_data;
+};
+
+struct registry
+{
+    std::vector<std::string> names;
+    std::vector<mem_usage> usages;
+    std::vector<poll> polls;
+    std::vector<int> free_polls;
+    mutex m;
+
+    unsigned int log_interval;
+    unsigned int log_time;
+    mem_accounting::snapshot last_logged;
+
+    int get_category(const char *name)
+    {
+        for(size_t i=0;i<names.size();++i)
+        {
+            if(names[i]==name)
+                return (int)i;
+        }
+
+        names.push_back(name);
+        usages.resize(names.size());
+        return (int)names.size()-1;
+    }
+
+    registry(): log_interval(0),log_time(0) {}
+};
+
+//never destroyed, subsystems may report from static destructors
+registry &get_registry()
+{
+    static registry *r=new registry();
+    return *r;
+}
+
+void log_snapshot(const mem_accounting::snapshot &s)
+{
+    log()<<"memory usage: "<<(unsigned long)s.get_total()<<" bytes total\n";
+    for(size_t i=0;i<s.entries.size();++i)
+    {
+        const mem_usage &u=s.entries[i].usage;
+        log()<<"  "<<s.entries[i].name.c_str()<<": "<<(unsigned long)u.current<<" bytes, peak "<<(unsigned long)u.peak
+             <<", "<<(unsigned long)u.count<<" allocations ("<<(unsigned long)u.total_count<<" total)\n";
+    }
+}
+
+}
+
+int mem_accounting::get_category(const char *name)
+{
+    if(!name)
+        return -1;
+
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    return r.get_category(name);
+}
+
+void mem_accounting::add(int category,size_t size)
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    if(category<0 || category>=(int)r.usages.size())
+        return;
+
+    mem_usage &u=r.usages[category];
+    u.current+=size;
+    ++u.count;
+    ++u.total_count;
+    if(u.current>u.peak)
+        u.peak=u.current;
+}
+
+void mem_accounting::remove(int category,size_t size)
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    if(category<0 || category>=(int)r.usages.size())
+        return;
+
+    mem_usage &u=r.usages[category];
+    if(size>u.current || !u.count)
+    {
+        log()<<"mem_accounting: unbalanced remove in category "<<r.names[category].c_str()<<"\n";
+        u.current=u.count=0;
+        return;
+    }
+
+    u.current-=size;
+    --u.count;
+}
+
+int mem_accounting::register_poll(const char *category_name,poll_callback callback,void *user_data)
+{
+    if(!category_name || !callback)
+        return -1;
+
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+
+    poll p;
+    p.category=r.get_category(category_name);
+    p.callback=callback;
+    p.user_data=user_data;
+
+    if(!r.free_polls.empty())
+    {
+        const int id=r.free_polls.back();
+        r.free_polls.pop_back();
+        r.polls[id]=p;
+        return id;
+    }
+
+    r.polls.push_back(p);
+    return (int)r.polls.size()-1;
+}
+
+void mem_accounting::unregister_poll(int poll_id)
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    if(poll_id<0 || poll_id>=(int)r.polls.size() || !r.polls[poll_id].callback)
+        return;
+
+    r.polls[poll_id].callback=0;
+    r.free_polls.push_back(poll_id);
+}
+
+void mem_accounting::get_snapshot(snapshot &out_snapshot)
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+
+    out_snapshot.entries.resize(r.names.size());
+    for(size_t i=0;i<r.names.size();++i)
+    {
+        out_snapshot.entries[i].name=r.names[i];
+        out_snapshot.entries[i].usage=r.usages[i];
+    }
+
+    for(size_t i=0;i<r.polls.size();++i)
+    {
+        const poll &p=r.polls[i];
+        if(!p.callback)
+            continue;
+
+        mem_usage u;
+        p.callback(u,p.user_data);
+
+        mem_usage &e=out_snapshot.entries[p.category].usage;
+        e.current+=u.current;
+        e.count+=u.count;
+        e.total_count+=u.total_count;
+    }
+
+    //polled categories have their peak tracked at snapshot time
+    for(size_t i=0;i<r.names.size();++i)
+    {
+        mem_usage &e=out_snapshot.entries[i].usage;
+        mem_usage &u=r.usages[i];
+        if(e.current>u.peak)
+            u.peak=e.current;
+
+        e.peak=u.peak;
+    }
+}
+
+void mem_accounting::reset_peaks()
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    for(size_t i=0;i<r.usages.size();++i)
+        r.usages[i].peak=r.usages[i].current;
+}
+
+size_t mem_accounting::snapshot::get_total() const
+{
+    size_t total=0;
+    for(size_t i=0;i<entries.size();++i)
+        total+=entries[i].usage.current;
+
+    return total;
+}
+
+const mem_usage &mem_accounting::snapshot::get(const char *name) const
+{
+    if(name)
+    {
+        for(size_t i=0;i<entries.size();++i)
+        {
+            if(entries[i].name==name)
+                return entries[i].usage;
+        }
+    }
+
+    return get_invalid_object<mem_usage>();
+}
+
+void mem_accounting::diff(const snapshot &from,const snapshot &to,std::vector<diff_entry> &out_diff)
+{
+    out_diff.resize(to.entries.size());
+    for(size_t i=0;i<to.entries.size();++i)
+    {
+        const snapshot::entry &e=to.entries[i];
+        const mem_usage &f=from.get(e.name.c_str());
+
+        diff_entry &d=out_diff[i];
+        d.name=e.name;
+        d.current=(ptrdiff_t)e.usage.current-(ptrdiff_t)f.current;
+        d.count=(ptrdiff_t)e.usage.count-(ptrdiff_t)f.count;
+        d.total_count=e.usage.total_count>=f.total_count?e.usage.total_count-f.total_count:0;
+    }
+}
+
+void mem_accounting::log_dump()
+{
+    snapshot s;
+    get_snapshot(s);
+    log_snapshot(s);
+}
+
+void mem_accounting::log_diff(const snapshot &from,const snapshot &to)
+{
+    std::vector<diff_entry> d;
+    diff(from,to,d);
+
+    log()<<"memory usage change: "<<(long)((ptrdiff_t)to.get_total()-(ptrdiff_t)from.get_total())<<" bytes\n";
+    for(size_t i=0;i<d.size();++i)
+    {
+        if(!d[i].current && !d[i].count && !d[i].total_count)
+            continue;
+
+        log()<<"  "<<d[i].name.c_str()<<": "<<(long)d[i].current<<" bytes, "<<(long)d[i].count
+             <<" allocations ("<<(unsigned long)d[i].total_count<<" made)\n";
+    }
+}
+
+void mem_accounting::set_log_interval(unsigned int ms)
+{
+    registry &r=get_registry();
+    mutex_scoped_lock lock(r.m);
+    r.log_interval=ms;
+    r.log_time=0;
+}
+
+void mem_accounting::update(unsigned int dt)
+{
+    registry &r=get_registry();
+    {
+        mutex_scoped_lock lock(r.m);
+        if(!r.log_interval)
+            return;
+
+        r.log_time+=dt;
+        if(r.log_time<r.log_interval)
+            return;
+
+        r.log_time=0;
+    }
+
+    snapshot s,prev;
+    get_snapshot(s);
+    {
+        mutex_scoped_lock lock(r.m);
+        prev.entries.swap(r.last_logged.entries);
+        r.last_logged=s;
+    }
+
+    log_snapshot(s);
+
+    if(!prev.entries.empty())
+        log_diff(prev,s);
+}
+
+}
@@ -0,0 +1,81 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//central registry of memory usage grouped by named categories
+//subsystems either report allocations as they happen with add/remove
+//or register a poll callback which is called when a snapshot is taken
+//poll callbacks are called under the registry lock and must not call mem_accounting
+//all functions are thread safe, but polled subsystems such as render objects are not synchronized:
+//take snapshots (get_snapshot, log_dump, update) on the main thread
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace nya_memory
+{
+
+struct mem_usage
+{
+    size_t current;
+    size_t peak;
+    size_t count; //live allocations
+    size_t total_count; //allocations made
+
+    mem_usage(): current(0),peak(0),count(0),total_count(0) {}
+};
+
+class mem_accounting
+{
+public:
+    static int get_category(const char *name); //adds category if not present, -1 if name is null
+
+    static void add(int category,size_t size);
+    static void remove(int category,size_t size);
+
+public:
+    typedef void (*poll_callback)(mem_usage &usage,void *user_data); //fill current, count and total_count
+
+    //several polls may report into the same category, returns poll id or -1
+    static int register_poll(const char *category_name,poll_callback callback,void *user_data=0);
+    static void unregister_poll(int poll_id);
+
+public:
+    struct snapshot
+    {
+        struct entry
+        {
+            std::string name;
+            mem_usage usage;
+        };
+
+        std::vector<entry> entries;
+
+        size_t get_total() const;
+        const mem_usage &get(const char *name) const; //empty usage if not found
+    };
+
+    struct diff_entry
+    {
+        std::string name;
+        ptrdiff_t current;
+        ptrdiff_t count;
+        size_t total_count; //allocations made between snapshots
+    };
+
+    static void get_snapshot(snapshot &out_snapshot);
+    static void diff(const snapshot &from,const snapshot &to,std::vector<diff_entry> &out_diff);
+
+    static void reset_peaks();
+
+public:
+    static void log_dump();
+    static void log_diff(const snapshot &from,const snapshot &to);
+
+    //dumps usage and changes since the previous dump to the log every interval ms, 0 disables
+    static void set_log_interval(unsigned int ms);
+    static void update(unsigned int dt);
+};
+
+}
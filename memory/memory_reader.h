@@ -9,6 +9,22 @@
 namespace nya_memory
 {
 
+//non-owning string reference into the reader's data, not null-terminated
+
+struct string_view
+{
+    const char *data;
+    size_t size;
+
+    std::string to_string() const { return data?std::string(data,size):std::string(); }
+    bool empty() const { return !size; }
+    bool operator == (const char *str) const { return str && strlen(str)==size && (!size || memcmp(data,str,size)==0); }
+    bool operator != (const char *str) const { return !(*this==str); }
+
+    string_view(): data(0),size(0) {}
+    string_view(const char *d,size_t s): data(d),size(s) {}
+};
+
 class memory_reader
 {
 public:
@@ -29,6 +45,60 @@ public:
         return a;
     }
 
+    //endian-aware variants, swap bytes if the host byte order differs
+    template <typename t> t read_le()
+    {
+        t a=read<t>();
+        if(!is_host_little_endian())
+            swap_bytes(a);
+
+        return a;
+    }
+
+    template <typename t> t read_be()
+    {
+        t a=read<t>();
+        if(is_host_little_endian())
+            swap_bytes(a);
+
+        return a;
+    }
+
+    //returns a pointer into the data if it is aligned for t, 0 otherwise
+    //offset is advanced only on success
+    template <typename t> const t *read_array(size_t count)
+    {
+        if(!count || count>get_remained()/sizeof(t))
+            return 0;
+
+        const size_t align=sizeof(t)&(~sizeof(t)+1);
+        const char *data=m_data+m_offset;
+        if(((size_t)data)%(align<sizeof(void*)?align:sizeof(void*)))
+            return 0;
+
+        m_offset+=count*sizeof(t);
+        return (const t *)data;
+    }
+
+    //bulk copy, fills with zeros if not enough data remains
+    template <typename t> bool read_array(t *to,size_t count)
+    {
+        if(!to)
+            return false;
+
+        const size_t size=count*sizeof(t);
+        if(count>get_remained()/sizeof(t))
+        {
+            m_offset=m_size;
+            memset(to,0,size);
+            return false;
+        }
+
+        memcpy(to,m_data+m_offset,size);
+        m_offset+=size;
+        return true;
+    }
+
     std::string read_string() { return read_string<unsigned short>(); }
     template <typename t> std::string read_string()
     {
@@ -40,6 +110,34 @@ public:
         return std::string(str,size);
     }
 
+    string_view read_string_view() { return read_string_view<unsigned short>(); }
+    template <typename t> string_view read_string_view()
+    {
+        const t size=read<t>();
+        const char *str=(const char *)get_data();
+        if(!size || !str || (size_t)size>get_remained())
+        {
+            skip(size);
+            return string_view();
+        }
+
+        skip(size);
+        return string_view(str,size);
+    }
+
+    string_view read_string_view(size_t size)
+    {
+        const char *str=(const char *)get_data();
+        if(!size || !str || size>get_remained())
+        {
+            skip(size);
+            return string_view();
+        }
+
+        skip(size);
+        return string_view(str,size);
+    }
+
     bool test(const void*data,size_t size)
     {
         if(size>m_size-m_offset)
@@ -127,6 +225,24 @@ public:
         m_offset=0;
     }
 
+public:
+    static bool is_host_little_endian()
+    {
+        const unsigned short test=1;
+        return *(const unsigned char *)&test==1;
+    }
+
+    template <typename t> static void swap_bytes(t &v)
+    {
+        unsigned char *b=(unsigned char *)&v;
+        for(size_t i=0;i<sizeof(t)/2;++i)
+        {
+            const unsigned char tmp=b[i];
+            b[i]=b[sizeof(t)-1-i];
+            b[sizeof(t)-1-i]=tmp;
+        }
+    }
+
 private:
     const char *m_data;
     size_t m_size;
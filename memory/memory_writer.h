@@ -2,15 +2,24 @@
 
 #pragma once
 
+//memory_writer(data,size) writes into a fixed buffer
+//memory_writer() grows its own storage, see get_data
+//memory_writer(sink,user_data) buffers small writes and passes them to the sink in chunks,
+//large writes go directly to the sink; call flush when done, sink 0 only counts bytes
+
 #include <cstddef>
 #include <string.h>
 #include <string>
+#include <vector>
 
 namespace nya_memory
 {
 
 class memory_writer
 {
+public:
+    typedef bool (*sink_callback)(const void *data,size_t size,void *user_data); //false on failure
+
 public:
     template<typename t> bool write(const t&v) { return write(&v,sizeof(t)); }
     bool write_short(short v) { return write(&v,sizeof(v)); }
@@ -29,16 +38,91 @@ public:
 
     bool write(const void *data,size_t size)
     {
-        if(!data || !size || size>m_size-m_offset)
+        if(!data || !size)
             return false;
 
+        switch(m_mode)
+        {
+            case mode_fixed:
+                if(size>m_size-m_offset)
+                    return fail();
+                break;
+
+            case mode_growable:
+                if(size>m_size-m_offset)
+                    grow(m_offset+size);
+                break;
+
+            case mode_sink:
+                if(m_failed)
+                    return false;
+
+                if(size>m_size-m_offset)
+                {
+                    if(!flush())
+                        return false;
+
+                    if(size>=m_size)
+                    {
+                        if(m_sink && !m_sink(data,size,m_user_data))
+                            return fail();
+
+                        m_flushed+=size;
+                        return true;
+                    }
+                }
+                break;
+        }
+
         memcpy(m_data+m_offset,data,size);
         m_offset+=size;
+        if(m_offset>m_used)
+            m_used=m_offset;
+
         return true;
     }
 
+    //passes buffered data to the sink, does nothing for other modes
+    bool flush()
+    {
+        if(m_mode!=mode_sink || !m_used)
+            return !m_failed;
+
+        if(m_failed)
+            return false;
+
+        if(m_sink && !m_sink(m_data,m_used,m_user_data))
+            return fail();
+
+        m_flushed+=m_used;
+        m_offset=m_used=0;
+        return true;
+    }
+
+    //sink mode can seek only within not yet flushed data
     bool seek(size_t offset)
     {
+        if(m_mode==mode_sink)
+        {
+            if(offset<m_flushed || offset>m_flushed+m_used)
+                return false;
+
+            m_offset=offset-m_flushed;
+            return true;
+        }
+
+        if(m_mode==mode_growable)
+        {
+            if(offset>m_size)
+                grow(offset);
+
+            m_offset=offset;
+            if(m_offset>m_used)
+                m_used=m_offset;
+
+            return true;
+        }
+
         if(offset>=m_size)
         {
             m_offset=m_size;
@@ -49,10 +133,17 @@ public:
         return true;
     }
 
-    size_t get_offset() { return m_offset; }
+    size_t get_offset() { return m_flushed+m_offset; }
+    size_t get_size() const { return m_flushed+m_used; } //total bytes written
+    bool is_failed() const { return m_failed; } //a write didn't fit or the sink failed
+
+    //growable mode storage, valid until the next write
+    const void *get_data() const { return m_mode==mode_growable?m_data:0; }
+    void *get_data() { return m_mode==mode_growable?m_data:0; }
 
 public:
-    memory_writer(void *data,size_t size)
+    memory_writer(void *data,size_t size): m_mode(mode_fixed),m_sink(0),m_user_data(0),
+                                           m_offset(0),m_used(0),m_flushed(0),m_failed(false)
     {
         if(data)
         {
@@ -64,14 +155,59 @@ public:
             m_data=0;
             m_size=0;
         }
+    }
+
+    explicit memory_writer(size_t reserve_size=0): m_mode(mode_growable),m_data(0),m_size(0),m_sink(0),m_user_data(0),
+                                                   m_offset(0),m_used(0),m_flushed(0),m_failed(false)
+    {
+        if(reserve_size)
+            grow(reserve_size);
+    }
 
-        m_offset=0;
+    memory_writer(sink_callback sink,void *user_data,size_t buffer_size=64*1024): m_mode(mode_sink),m_sink(sink),
+                  m_user_data(user_data),m_offset(0),m_used(0),m_flushed(0),m_failed(false)
+    {
+        m_buf.resize(sink && buffer_size?buffer_size:1);
+        m_data=&m_buf[0];
+        m_size=m_buf.size();
     }
 
 private:
+    memory_writer(const memory_writer &);
+    void operator = (const memory_writer &);
+
+private:
+    bool fail() { m_failed=true; return false; }
+
+    void grow(size_t min_size)
+    {
+        size_t size=m_buf.size()>64?m_buf.size():64;
+        while(size<min_size)
+            size*=2;
+
+        m_buf.resize(size);
+        m_data=&m_buf[0];
+        m_size=size;
+    }
+
+private:
+    enum mode
+    {
+        mode_fixed,
+        mode_growable,
+        mode_sink
+    };
+
+    mode m_mode;
     char *m_data;
     size_t m_size;
+    std::vector<char> m_buf;
+    sink_callback m_sink;
+    void *m_user_data;
     size_t m_offset;
+    size_t m_used;
+    size_t m_flushed;
+    bool m_failed;
 };
 
 }
@@ -0,0 +1,56 @@
+//https://code.google.com/p/nya-engine/
+
+#include "mutex.h"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+#endif
+
+namespace nya_memory
+{
+
+#ifdef _WIN32
+
+mutex::mutex()
+{
+    CRITICAL_SECTION *cs=new CRITICAL_SECTION;
+  #ifdef WINDOWS_METRO
+    InitializeCriticalSectionEx(cs,0,0);
+  #else
+    InitializeCriticalSection(cs);
+  #endif
+    m_mutex=cs;
+}
+
+mutex::~mutex()
+{
+    DeleteCriticalSection((CRITICAL_SECTION*)m_mutex);
+    delete (CRITICAL_SECTION*)m_mutex;
+}
+
+void mutex::lock() { EnterCriticalSection((CRITICAL_SECTION*)m_mutex); }
+void mutex::unlock() { LeaveCriticalSection((CRITICAL_SECTION*)m_mutex); }
+
+#else
+
+mutex::mutex()
+{
+    pthread_mutex_t *m=new pthread_mutex_t;
+    pthread_mutex_init(m,0);
+    m_mutex=m;
+}
+
+mutex::~mutex()
+{
+    pthread_mutex_destroy((pthread_mutex_t*)m_mutex);
+    delete (pthread_mutex_t*)m_mutex;
+}
+
+void mutex::lock() { pthread_mutex_lock((pthread_mutex_t*)m_mutex); }
+void mutex::unlock() { pthread_mutex_unlock((pthread_mutex_t*)m_mutex); }
+
+#endif
+
+}
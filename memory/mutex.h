@@ -0,0 +1,42 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+namespace nya_memory
+{
+
+class mutex
+{
+public:
+    void lock();
+    void unlock();
+
+public:
+    mutex();
+    ~mutex();
+
+    //non copyable
+private:
+    mutex(const mutex &);
+    void operator = (const mutex &);
+
+private:
+    void *m_mutex;
+};
+
+class mutex_scoped_lock
+{
+public:
+    mutex_scoped_lock(mutex &m): m_mutex(m) { m_mutex.lock(); }
+    ~mutex_scoped_lock() { m_mutex.unlock(); }
+
+    //non copyable
+private:
+    mutex_scoped_lock(const mutex_scoped_lock &);
+    void operator = (const mutex_scoped_lock &);
+
+private:
+    mutex &m_mutex;
+};
+
+}
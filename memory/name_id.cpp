@@ -0,0 +1,190 @@
+//https://code.google.com/p/nya-engine/
+
+#include "name_id.h"
+#include "hash.h"
+#include "mutex.h"
+#include "atomic.h"
+#include "mem_accounting.h"
+#include <vector>
+#include <string.h>
+
+namespace nya_memory
+{
+
+namespace
+{
+
+//lookups don't lock: the table and its entries are never changed in place once published,
+//it is copied to a larger one which is published with a release store, replaced tables are kept until exit
+class names_table
+{
+public:
+    unsigned int find(const char *name,unsigned int hash) const
+    {
+        const table *t=atomic_load_acquire(m_table);
+        for(size_t i=hash&t->mask;;i=(i+1)&t->mask)
+        {
+            const unsigned int id=atomic_load_acquire(t->slots[i]);
+            if(!id)
+                return 0;
+
+            const entry &e=t->entries[id-1];
+            if(e.hash==hash && strcmp(e.name,name)==0)
+                return id;
+        }
+    }
+
+    //under the mutex
+    unsigned int add(const char *name,unsigned int hash)
+    {
+        const size_t len=strlen(name)+1;
+        if(m_page_used+len>m_page_size)
+        {
+            const size_t page_size=len>m_page_size?len:m_page_size;
+            m_pages.push_back(new char[page_size]);
+            m_page_used=0;
+            mem_accounting::add(m_mem_category,page_size);
+        }
+
+        entry e;
+        e.name=m_pages.back()+m_page_used;
+        e.hash=hash;
+        memcpy(m_pages.back()+m_page_used,name,len);
+        m_page_used+=len;
+
+        const unsigned int id=m_count+1;
+        table *t=m_table;
+        if(id*2>t->mask+1)
+        {
+            table *grown=new table(t->mask+1);
+            for(unsigned int i=0;i<m_count;++i)
+            {
+                grown->entries[i]=t->entries[i];
+                grown->insert_slot(i+1,grown->entries[i].hash);
+            }
+
+            m_old_tables.push_back(t);
+            atomic_store_release(m_table,grown);
+            t=grown;
+        }
+
+        t->entries[id-1]=e;
+        t->insert_slot(id,hash);
+        atomic_store_release(m_count,id);
+        return id;
+    }
+
+    const char *get_name(unsigned int id) const
+    {
+        //count first, the table it was stored with or a newer one has the entry
+        if(!id || id>atomic_load_acquire(m_count))
+            return 0;
+
+        return atomic_load_acquire(m_table)->entries[id-1].name;
+    }
+
+    mutex &get_mutex() { return m_mutex; }
+
+    names_table(): m_table(new table(512)),m_count(0),m_page_size(64*1024),m_page_used(64*1024),
+                   m_mem_category(mem_accounting::get_category("name_id")) {}
+
+    ~names_table()
+    {
+        for(size_t i=0;i<m_pages.size();++i)
+            delete []m_pages[i];
+
+        for(size_t i=0;i<m_old_tables.size();++i)
+            delete m_old_tables[i];
+
+        delete m_table;
+    }
+
+private:
+    struct entry
+    {
+        const char *name;
+        unsigned int hash;
+    };
+
+    //slots are twice the entries so that probing always meets an empty slot
+    struct table
+    {
+        size_t mask;
+        volatile unsigned int *slots;
+        entry *entries;
+
+        void insert_slot(unsigned int id,unsigned int hash)
+        {
+            size_t i=hash&mask;
+            while(slots[i])
+                i=(i+1)&mask;
+
+            atomic_store_release(slots[i],id);
+        }
+
+        table(size_t entries_count): mask(entries_count*2-1)
+        {
+            slots=new unsigned int[entries_count*2];
+            memset((void *)slots,0,entries_count*2*sizeof(unsigned int));
+            entries=new entry[entries_count];
+        }
+
+        ~table() { delete [](unsigned int *)slots; delete []entries; }
+
+    private:
+        table(const table &);
+        void operator = (const table &);
+    };
+
+private:
+    table *volatile m_table;
+    volatile unsigned int m_count;
+    std::vector<table *> m_old_tables;
+    std::vector<char *> m_pages;
+    size_t m_page_size;
+    size_t m_page_used;
+    int m_mem_category;
+    mutex m_mutex;
+};
+
+names_table &get_table()
+{
+    static names_table table;
+    return table;
+}
+
+}
+
+unsigned int name_id::intern(const char *name)
+{
+    if(!name)
+        return 0;
+
+    const unsigned int hash=hash_string(name);
+
+    names_table &table=get_table();
+    const unsigned int id=table.find(name,hash);
+    if(id)
+        return id;
+
+    mutex_scoped_lock lock(table.get_mutex());
+    const unsigned int added=table.find(name,hash);
+    return added?added:table.add(name,hash);
+}
+
+unsigned int name_id::find(const char *name)
+{
+    if(!name)
+        return 0;
+
+    const unsigned int hash=hash_string(name);
+
+    return get_table().find(name,hash);
+}
+
+const char *name_id::get_name(unsigned int id)
+{
+    return get_table().get_name(id);
+}
+
+}
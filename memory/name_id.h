@@ -0,0 +1,39 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//Note: interned names are never freed, ids are unique for the application lifetime
+//      interning is thread safe, find and get_name don't lock
+
+namespace nya_memory
+{
+
+class name_id
+{
+public:
+    unsigned int get_id() const { return m_id; }
+    const char *get_name() const { return get_name(m_id); }
+    bool is_valid() const { return m_id!=0; }
+
+    bool operator == (const name_id &other) const { return m_id==other.m_id; }
+    bool operator != (const name_id &other) const { return m_id!=other.m_id; }
+    bool operator < (const name_id &other) const { return m_id<other.m_id; }
+
+public:
+    static unsigned int intern(const char *name); //adds name if not present, 0 if name is null
+    static unsigned int find(const char *name); //0 if name was never interned
+    static const char *get_name(unsigned int id); //0 if invalid id
+    static name_id lookup(const char *name) { return name_id(find(name)); } //invalid if name was never interned
+
+public:
+    name_id(): m_id(0) {}
+    explicit name_id(const char *name): m_id(intern(name)) {}
+
+private:
+    explicit name_id(unsigned int id): m_id(id) {}
+
+private:
+    unsigned int m_id;
+};
+
+}
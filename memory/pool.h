@@ -2,11 +2,28 @@
 
 #pragma once
 
+#include "mem_accounting.h"
 #include <vector>
+#include <algorithm>
+#include <new>
+#include <cstddef>
 
 namespace nya_memory
 {
 
+inline int get_pools_mem_category()
+{
+    static const int category=mem_accounting::get_category("pools");
+    return category;
+}
+
+//natural alignment of t, alignof without c++11
+template<typename t> struct pool_alignment
+{
+    struct holder { char c; t data; };
+    static const size_t value=sizeof(holder)-sizeof(t);
+};
+
 template<typename t_data,size_t block_elements_count> class pool
 {
 public:
@@ -17,6 +34,7 @@ public:
         if(m_free_node_idx==no_idx)
         {
             block *b=new block();
+            mem_accounting::add(get_pools_mem_category(),sizeof(block));
 
             m_free_node_idx=block_elements_count*m_blocks.size();
             size_t next_idx=m_free_node_idx+1;
@@ -104,11 +122,18 @@ public:
 
 public:
     size_t get_count() const { return m_used_count; }
-    size_t get_mem_size() const { return m_blocks.size()*sizeof(t_data)*block_elements_count; }
+    size_t get_mem_size() const { return m_blocks.size()*sizeof(block)+m_blocks.capacity()*sizeof(block*); }
 
 public:
     pool(): m_free_node_idx(no_idx),m_used_count(0) {}
-    ~pool() { for(size_t i=0;i<m_blocks.size();++i) delete m_blocks[i]; }
+    ~pool()
+    {
+        for(size_t i=0;i<m_blocks.size();++i)
+        {
+            delete m_blocks[i];
+            mem_accounting::remove(get_pools_mem_category(),sizeof(block));
+        }
+    }
 
     //non copyable
 private:
@@ -133,4 +158,202 @@ private:
     static const size_t no_idx=(size_t)-1;
 };
 
+//elements are densely packed and naturally aligned, including simd types such as __m128;
+//free list and liveness bits are stored out of band
+//for_each_live takes the functor by value, like stl algorithms
+//free is O(log(blocks count)), for_each_live walks blocks linearly
+
+template<typename t_data,size_t block_elements_count> class dense_pool
+{
+public:
+    t_data *allocate()
+    {
+        if(m_free_indices.empty())
+            add_block();
+
+        const size_t idx=m_free_indices.back();
+        m_free_indices.pop_back();
+
+        block &b=*m_blocks[idx/block_elements_count];
+        const size_t offset=idx%block_elements_count;
+        b.live[offset/32]|=1u<<(offset%32);
+        ++b.live_count;
+        ++m_used_count;
+
+        return new (b.get(offset)) t_data;
+    }
+
+    bool free(const t_data *data)
+    {
+        if(!data)
+            return false;
+
+        const char *ptr=(const char *)data;
+        typename sorted_blocks::const_iterator it=std::upper_bound(m_sorted_blocks.begin(),
+                                                                   m_sorted_blocks.end(),
+                                                                   sorted_block(ptr,(size_t)-1));
+        if(it==m_sorted_blocks.begin())
+            return false;
+
+        --it;
+        const size_t byte_offset=(size_t)(ptr-it->first);
+        if(byte_offset>=sizeof(t_data)*block_elements_count || byte_offset%sizeof(t_data))
+            return false;
+
+        block &b=*m_blocks[it->second];
+        const size_t offset=byte_offset/sizeof(t_data);
+        const unsigned int bit=1u<<(offset%32);
+        if(!(b.live[offset/32]&bit))
+            return false;
+
+        data->~t_data();
+
+        b.live[offset/32]&=~bit;
+        --b.live_count;
+        --m_used_count;
+
+        m_free_indices.push_back(it->second*block_elements_count+offset);
+        return true;
+    }
+
+    void clear()
+    {
+        for_each_live(destroy);
+
+        m_free_indices.clear();
+        for(size_t i=m_blocks.size();i>0;--i)
+        {
+            block &b=*m_blocks[i-1];
+            for(size_t j=0;j<live_words_count;++j)
+                b.live[j]=0;
+
+            b.live_count=0;
+
+            for(size_t j=block_elements_count;j>0;--j)
+                m_free_indices.push_back((i-1)*block_elements_count+j-1);
+        }
+
+        m_used_count=0;
+    }
+
+public:
+    template<typename t_func> void for_each_live(t_func f)
+    {
+        for(size_t i=0;i<m_blocks.size();++i)
+        {
+            block &b=*m_blocks[i];
+            if(!b.live_count)
+                continue;
+
+            for(size_t j=0;j<live_words_count;++j)
+            {
+                unsigned int word=b.live[j];
+                for(size_t k=j*32;word;++k,word>>=1)
+                {
+                    if(word&1)
+                        f(*(t_data*)b.get(k));
+                }
+            }
+        }
+    }
+
+    template<typename t_func> void for_each_live(t_func f) const
+    {
+        for(size_t i=0;i<m_blocks.size();++i)
+        {
+            const block &b=*m_blocks[i];
+            if(!b.live_count)
+                continue;
+
+            for(size_t j=0;j<live_words_count;++j)
+            {
+                unsigned int word=b.live[j];
+                for(size_t k=j*32;word;++k,word>>=1)
+                {
+                    if(word&1)
+                        f(*(const t_data*)b.get(k));
+                }
+            }
+        }
+    }
+
+public:
+    size_t get_count() const { return m_used_count; }
+    size_t get_mem_size() const
+    {
+        return m_blocks.size()*sizeof(block)+m_blocks.capacity()*sizeof(block*)
+              +m_sorted_blocks.capacity()*sizeof(sorted_block)+m_free_indices.capacity()*sizeof(size_t);
+    }
+
+public:
+    dense_pool(): m_used_count(0) {}
+    ~dense_pool()
+    {
+        for_each_live(destroy);
+        for(size_t i=0;i<m_blocks.size();++i)
+        {
+            delete m_blocks[i];
+            mem_accounting::remove(get_pools_mem_category(),sizeof(block));
+        }
+    }
+
+    //non copyable
+private:
+    dense_pool(const dense_pool &);
+    void operator = (const dense_pool &);
+
+private:
+    static void destroy(t_data &data) { data.~t_data(); }
+
+    void add_block()
+    {
+        block *b=new block();
+        mem_accounting::add(get_pools_mem_category(),sizeof(block));
+        const size_t block_idx=m_blocks.size();
+        m_blocks.push_back(b);
+
+        const sorted_block sb((const char *)b->get(0),block_idx);
+        m_sorted_blocks.insert(std::upper_bound(m_sorted_blocks.begin(),m_sorted_blocks.end(),sb),sb);
+
+        for(size_t i=block_elements_count;i>0;--i)
+            m_free_indices.push_back(block_idx*block_elements_count+i-1);
+    }
+
+private:
+    static const size_t live_words_count=(block_elements_count+31)/32;
+
+    static const size_t alignment=pool_alignment<t_data>::value;
+
+    //operator new only guarantees the alignment of fundamental types, storage is aligned within the block
+    struct block
+    {
+        char storage[sizeof(t_data)*block_elements_count+alignment-1];
+        char *data;
+
+        unsigned int live[live_words_count];
+        size_t live_count;
+
+        void *get(size_t idx) { return data+idx*sizeof(t_data); }
+        const void *get(size_t idx) const { return data+idx*sizeof(t_data); }
+
+        block(): data(storage+(alignment-(size_t)storage%alignment)%alignment),live_count(0)
+        {
+            for(size_t i=0;i<live_words_count;++i)
+                live[i]=0;
+        }
+
+    private:
+        block(const block &);
+        void operator = (const block &);
+    };
+
+    typedef std::pair<const char *,size_t> sorted_block;
+    typedef std::vector<sorted_block> sorted_blocks;
+
+    std::vector<block*> m_blocks;
+    sorted_blocks m_sorted_blocks;
+    std::vector<size_t> m_free_indices;
+    size_t m_used_count;
+};
+
 }
@@ -2,14 +2,41 @@
 
 #pragma once
 
+#include "atomic.h"
+
+#if __cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1600)
+    #define NYA_RVALUE_REFS
+#endif
+
 namespace nya_memory
 {
 
+//object is allocated together with its reference counter in a single block
+
+struct shared_ptr_block
+{
+    volatile int ref_count;
+
+    shared_ptr_block(): ref_count(1) {}
+    virtual ~shared_ptr_block() {}
+};
+
 template<typename t>
+struct shared_ptr_holder: public shared_ptr_block
+{
+    t obj;
+
+    shared_ptr_holder() {}
+    shared_ptr_holder(const t &o): obj(o) {}
+};
+
+//thread_safe enables atomic reference counting for the pointers shared between threads
+
+template<typename t,bool thread_safe=false>
 class shared_ptr
 {
-    template<typename tt,typename tf> friend shared_ptr<tt> shared_ptr_cast(shared_ptr<tf>& f);
-    template<typename tt,typename tf> friend const shared_ptr<tt> shared_ptr_cast(const shared_ptr<tf>& f);
+    template<typename tt,typename tf,bool ts> friend shared_ptr<tt,ts> shared_ptr_cast(shared_ptr<tf,ts>& f);
+    template<typename tt,typename tf,bool ts> friend const shared_ptr<tt,ts> shared_ptr_cast(const shared_ptr<tf,ts>& f);
 
 public:
     bool is_valid() const { return m_ref!=0; }
@@ -17,39 +44,49 @@ public:
     const t *operator -> () const { return m_ref; };
     t *operator -> () { return m_ref; };
 
-    bool operator == (const shared_ptr &other) { return other.m_ref==m_ref; }
-    bool operator != (const shared_ptr &other) { return other.m_ref!=m_ref; }
+    bool operator == (const shared_ptr &other) const { return other.m_ref==m_ref; }
+    bool operator != (const shared_ptr &other) const { return other.m_ref!=m_ref; }
 
-    int get_ref_count() { return m_ref?*m_ref_count:0; }
+    int get_ref_count() const
+    {
+        if(!m_ref)
+            return 0;
+
+        return thread_safe?atomic_get(m_block->ref_count):m_block->ref_count;
+    }
 
     void free()
     {
         if(!m_ref)
             return;
 
-        if(--(*m_ref_count)<=0)
-        {
-            delete m_ref;
-            delete m_ref_count;
-        }
+        if(ref_dec()<=0)
+            delete m_block;
 
         m_ref=0;
+        m_block=0;
     }
 
-    shared_ptr(): m_ref(0) {}
-
-    explicit shared_ptr(const t &obj)
+    void swap(shared_ptr &p)
     {
-        m_ref=new t(obj);
-        m_ref_count=new int(1);
+        t *ref=m_ref;
+        shared_ptr_block *block=m_block;
+        m_ref=p.m_ref;
+        m_block=p.m_block;
+        p.m_ref=ref;
+        p.m_block=block;
     }
 
+    shared_ptr(): m_ref(0),m_block(0) {}
+
+    explicit shared_ptr(const t &obj) { create_as<t>(obj); }
+
     shared_ptr(const shared_ptr &p)
     {
         m_ref=p.m_ref;
-        m_ref_count=p.m_ref_count;
+        m_block=p.m_block;
         if(m_ref)
-            ++(*m_ref_count);
+            ref_inc();
     }
 
     shared_ptr &operator=(const shared_ptr &p)
@@ -61,33 +98,74 @@ public:
         m_ref=p.m_ref;
         if(m_ref)
         {
-            m_ref_count=p.m_ref_count;
-            ++(*m_ref_count);
+            m_block=p.m_block;
+            ref_inc();
         }
 
         return *this;
     }
 
+#ifdef NYA_RVALUE_REFS
+    shared_ptr(shared_ptr &&p): m_ref(p.m_ref),m_block(p.m_block) { p.m_ref=0; p.m_block=0; }
+
+    shared_ptr &operator=(shared_ptr &&p)
+    {
+        if(this==&p)
+            return *this;
+
+        free();
+        swap(p);
+        return *this;
+    }
+#endif
+
     ~shared_ptr() { free(); }
 
+protected:
+    //allocates object of the derived type t_obj in a single block with the counter
+    template<typename t_obj> void create_as()
+    {
+        shared_ptr_holder<t_obj> *holder=new shared_ptr_holder<t_obj>();
+        m_ref=&holder->obj;
+        m_block=holder;
+    }
+
+    template<typename t_obj> void create_as(const t_obj &obj)
+    {
+        shared_ptr_holder<t_obj> *holder=new shared_ptr_holder<t_obj>(obj);
+        m_ref=&holder->obj;
+        m_block=holder;
+    }
+
+private:
+    void ref_inc()
+    {
+        if(thread_safe)
+            atomic_inc(m_block->ref_count);
+        else
+            ++m_block->ref_count;
+    }
+
+    int ref_dec() { return thread_safe?atomic_dec(m_block->ref_count):--m_block->ref_count; }
+
 protected:
     t *m_ref;
-    int *m_ref_count;
+    shared_ptr_block *m_block;
 };
 
-template<typename to,typename from> shared_ptr<to> shared_ptr_cast(shared_ptr<from>& f)
+template<typename to,typename from,bool thread_safe> shared_ptr<to,thread_safe> shared_ptr_cast(shared_ptr<from,thread_safe>& f)
 {
-    shared_ptr<to> t;
+    shared_ptr<to,thread_safe> t;
     t.m_ref=static_cast<to*>(f.m_ref);
-    if(f.m_ref) t.m_ref_count=f.m_ref_count, ++(*t.m_ref_count);
+    if(f.m_ref) t.m_block=f.m_block, t.ref_inc();
     return t;
 }
 
-template<typename to,typename from> const shared_ptr<to> shared_ptr_cast(const shared_ptr<from>& f)
+template<typename to,typename from,bool thread_safe> const shared_ptr<to,thread_safe> shared_ptr_cast(const shared_ptr<from,thread_safe>& f)
 {
-    shared_ptr<to> t;
+    shared_ptr<to,thread_safe> t;
     t.m_ref=static_cast<to*>(f.m_ref);
-    if(f.m_ref) t.m_ref_count=f.m_ref_count, ++(*t.m_ref_count);
+    if(f.m_ref) t.m_block=f.m_block, t.ref_inc();
     return t;
 }
 
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "invalid_object.h"
+#include "name_id.h"
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <cstddef>
 
 namespace nya_memory
 {
@@ -10,7 +13,7 @@ namespace nya_memory
 template<class t> class tag_list
 {
 public:
-    t &add() { return add(0,0); }
+    t &add() { return add((const char **)0,0); }
 
     t &add(const char **tags,size_t tags_count)
     {
@@ -18,7 +21,7 @@ public:
         if(tags)
         {
             for(size_t i=0;i<tags_count;++i)
-                m_tags[tags[i]].push_back(idx);
+                m_tags[name_id::intern(tags[i])].push_back(idx);
         }
 
         m_elements.resize(idx+1);
@@ -26,7 +29,33 @@ public:
     }
 
 public:
-    int get_count(const char *tag) const
+    t &add(const name_id *tags,size_t tags_count)
+    {
+        const int idx=(int)m_elements.size();
+        if(tags)
+        {
+            for(size_t i=0;i<tags_count;++i)
+                m_tags[tags[i].get_id()].push_back(idx);
+        }
+
+        m_elements.resize(idx+1);
+        return m_elements.back();
+    }
+
+public:
+    int get_count(const char *tag) const { return get_count(name_id::find(tag)); }
+    int get_count(const name_id &tag) const { return get_count(tag.get_id()); }
+
+    int get_idx(const char *tag,int idx) const { return get_idx(name_id::find(tag),idx); }
+    int get_idx(const name_id &tag,int idx) const { return get_idx(tag.get_id(),idx); }
+
+    const t &get(const char *tag,int idx) const { return get(get_idx(tag,idx)); }
+    t &get(const char *tag,int idx) { return get(get_idx(tag,idx)); }
+    const t &get(const name_id &tag,int idx) const { return get(get_idx(tag,idx)); }
+    t &get(const name_id &tag,int idx) { return get(get_idx(tag,idx)); }
+
+private:
+    int get_count(unsigned int tag) const
     {
         if(!tag)
             return 0;
@@ -38,7 +67,7 @@ public:
         return (int)it->second.size();
     }
 
-    int get_idx(const char *tag,int idx) const
+    int get_idx(unsigned int tag,int idx) const
     {
         if(!tag || idx<0)
             return -1;
@@ -53,9 +82,6 @@ public:
         return it->second[idx];
     }
 
-    const t &get(const char *tag,int idx) const { return get(get_idx(tag,idx)); }
-    t &get(const char *tag,int idx) { return get(get_idx(tag,idx)); }
-
 public:
     int get_count() const { return (int)m_elements.size(); }
 
@@ -97,7 +123,7 @@ public:
 
 private:
     std::vector<t> m_elements;
-    typedef std::map<std::string,std::vector<int> > map;
+    typedef std::map<unsigned int,std::vector<int> > map; //name_id to elements
     map m_tags;
 };
 
@@ -0,0 +1,309 @@
+//https://code.google.com/p/nya-engine/
+
+#include "thread_pool.h"
+#include "tmp_buffer.h"
+#include "memory.h"
+#include <deque>
+#include <vector>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
+namespace nya_memory
+{
+
+namespace
+{
+
+struct task
+{
+    thread_pool::task_function function;
+    void *data;
+};
+
+#ifdef _WIN32
+
+//signal and broadcast are called under the lock, waits re-check their condition
+
+#if defined WINDOWS_METRO || (defined _WIN32_WINNT && _WIN32_WINNT>=0x0600)
+
+class condition
+{
+public:
+    void lock() { EnterCriticalSection(&m_cs); }
+    void unlock() { LeaveCriticalSection(&m_cs); }
+    void wait(CONDITION_VARIABLE &cv) { SleepConditionVariableCS(&cv,&m_cs,INFINITE); }
+    static void signal(CONDITION_VARIABLE &cv) { WakeConditionVariable(&cv); }
+    static void broadcast(CONDITION_VARIABLE &cv) { WakeAllConditionVariable(&cv); }
+
+    typedef CONDITION_VARIABLE cv_type;
+    static void init(cv_type &cv) { InitializeConditionVariable(&cv); }
+    static void release(cv_type &cv) {}
+
+  #ifdef WINDOWS_METRO
+    condition() { InitializeCriticalSectionEx(&m_cs,0,0); }
+  #else
+    condition() { InitializeCriticalSection(&m_cs); }
+  #endif
+    ~condition() { DeleteCriticalSection(&m_cs); }
+
+private:
+    CRITICAL_SECTION m_cs;
+};
+
+#else
+
+//condition variables need vista, older targets wake waiters with a semaphore
+class condition
+{
+public:
+    struct cv_type
+    {
+        HANDLE semaphore;
+        int waiters;
+        int released; //wakes not yet taken by waiters
+    };
+
+    void lock() { EnterCriticalSection(&m_cs); }
+    void unlock() { LeaveCriticalSection(&m_cs); }
+
+    void wait(cv_type &cv)
+    {
+        ++cv.waiters;
+        unlock();
+        WaitForSingleObject(cv.semaphore,INFINITE);
+        lock();
+        --cv.waiters;
+        --cv.released;
+    }
+
+    static void signal(cv_type &cv)
+    {
+        if(cv.waiters<=cv.released)
+            return;
+
+        ++cv.released;
+        ReleaseSemaphore(cv.semaphore,1,0);
+    }
+
+    static void broadcast(cv_type &cv)
+    {
+        const int count=cv.waiters-cv.released;
+        if(count<=0)
+            return;
+
+        cv.released+=count;
+        ReleaseSemaphore(cv.semaphore,count,0);
+    }
+
+    static void init(cv_type &cv) { cv.semaphore=CreateSemaphoreA(0,0,0x7fffffff,0); cv.waiters=cv.released=0; }
+    static void release(cv_type &cv) { CloseHandle(cv.semaphore); }
+
+    condition() { InitializeCriticalSection(&m_cs); }
+    ~condition() { DeleteCriticalSection(&m_cs); }
+
+private:
+    CRITICAL_SECTION m_cs;
+};
+
+#endif
+
+typedef HANDLE thread_handle;
+
+#else
+
+class condition
+{
+public:
+    void lock() { pthread_mutex_lock(&m_mutex); }
+    void unlock() { pthread_mutex_unlock(&m_mutex); }
+    void wait(pthread_cond_t &cv) { pthread_cond_wait(&cv,&m_mutex); }
+    static void signal(pthread_cond_t &cv) { pthread_cond_signal(&cv); }
+    static void broadcast(pthread_cond_t &cv) { pthread_cond_broadcast(&cv); }
+
+    typedef pthread_cond_t cv_type;
+    static void init(cv_type &cv) { pthread_cond_init(&cv,0); }
+    static void release(cv_type &cv) { pthread_cond_destroy(&cv); }
+
+    condition() { pthread_mutex_init(&m_mutex,0); }
+    ~condition() { pthread_mutex_destroy(&m_mutex); }
+
+private:
+    pthread_mutex_t m_mutex;
+};
+
+typedef pthread_t thread_handle;
+
+#endif
+
+}
+
+struct thread_pool::state
+{
+    condition c;
+    condition::cv_type task_added;
+    condition::cv_type idle;
+
+    std::deque<task> tasks;
+    std::vector<thread_handle> threads;
+    unsigned int running_count;
+    bool stopping;
+
+    void run()
+    {
+        c.lock();
+        for(;;)
+        {
+            while(tasks.empty() && !stopping)
+                c.wait(task_added);
+
+            if(tasks.empty())
+                break;
+
+            const task t=tasks.front();
+            tasks.pop_front();
+            ++running_count;
+            c.unlock();
+
+            t.function(t.data);
+
+            c.lock();
+            if(!--running_count && tasks.empty())
+                condition::broadcast(idle);
+        }
+        c.unlock();
+
+        //the cache is bounded by its budget while the worker runs, hand it back once on exit
+        tmp_buffers::flush_thread_cache();
+    }
+
+#ifdef _WIN32
+    static DWORD WINAPI worker(LPVOID data) { ((state *)data)->run(); return 0; }
+#else
+    static void *worker(void *data) { ((state *)data)->run(); return 0; }
+#endif
+
+    state(): running_count(0),stopping(false) { condition::init(task_added); condition::init(idle); }
+    ~state() { condition::release(task_added); condition::release(idle); }
+};
+
+bool thread_pool::start(unsigned int threads_count)
+{
+    if(m_state)
+        return false;
+
+    if(!threads_count)
+    {
+        threads_count=get_hardware_threads_count();
+        threads_count=threads_count>1?threads_count-1:1;
+    }
+
+    m_state=new state();
+    for(unsigned int i=0;i<threads_count;++i)
+    {
+        thread_handle h;
+#ifdef _WIN32
+        h=CreateThread(0,0,state::worker,m_state,0,0);
+        if(!h)
+#else
+        if(pthread_create(&h,0,state::worker,m_state)!=0)
+#endif
+        {
+            log()<<"thread_pool: unable to create thread\n";
+            break;
+        }
+
+        m_state->threads.push_back(h);
+    }
+
+    if(m_state->threads.empty())
+    {
+        delete m_state;
+        m_state=0;
+        return false;
+    }
+
+    return true;
+}
+
+void thread_pool::stop()
+{
+    if(!m_state)
+        return;
+
+    m_state->c.lock();
+    m_state->stopping=true;
+    condition::broadcast(m_state->task_added);
+    m_state->c.unlock();
+
+    for(size_t i=0;i<m_state->threads.size();++i)
+    {
+#ifdef _WIN32
+        WaitForSingleObject(m_state->threads[i],INFINITE);
+        CloseHandle(m_state->threads[i]);
+#else
+        pthread_join(m_state->threads[i],0);
+#endif
+    }
+
+    delete m_state;
+    m_state=0;
+}
+
+bool thread_pool::add_task(task_function function,void *data)
+{
+    if(!m_state || !function)
+        return false;
+
+    task t;
+    t.function=function;
+    t.data=data;
+
+    m_state->c.lock();
+    m_state->tasks.push_back(t);
+    condition::signal(m_state->task_added);
+    m_state->c.unlock();
+    return true;
+}
+
+void thread_pool::wait_idle()
+{
+    if(!m_state)
+        return;
+
+    m_state->c.lock();
+    while(!m_state->tasks.empty() || m_state->running_count)
+        m_state->c.wait(m_state->idle);
+    m_state->c.unlock();
+}
+
+size_t thread_pool::get_queued_count() const
+{
+    if(!m_state)
+        return 0;
+
+    m_state->c.lock();
+    const size_t count=m_state->tasks.size();
+    m_state->c.unlock();
+    return count;
+}
+
+unsigned int thread_pool::get_threads_count() const { return m_state?(unsigned int)m_state->threads.size():0; }
+
+unsigned int thread_pool::get_hardware_threads_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors>0?(unsigned int)info.dwNumberOfProcessors:1;
+#else
+    const long count=sysconf(_SC_NPROCESSORS_ONLN);
+    return count>0?(unsigned int)count:1;
+#endif
+}
+
+}
@@ -0,0 +1,45 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//fixed set of worker threads executing queued tasks in fifo order
+//tasks may be added from any thread, workers keep their tmp_buffers cache across tasks and flush it on exit
+//stop waits for all queued tasks
+
+#include <cstddef>
+
+namespace nya_memory
+{
+
+class thread_pool
+{
+public:
+    typedef void (*task_function)(void *data);
+
+public:
+    bool start(unsigned int threads_count=0); //0 for hardware threads count minus one, at least one
+    void stop();
+    bool is_started() const { return m_state!=0; }
+
+    bool add_task(task_function function,void *data);
+    void wait_idle(); //returns when queue is empty and no task is running
+    size_t get_queued_count() const;
+    unsigned int get_threads_count() const;
+
+public:
+    static unsigned int get_hardware_threads_count();
+
+public:
+    thread_pool(): m_state(0) {}
+    ~thread_pool() { stop(); }
+
+private:
+    thread_pool(const thread_pool &);
+    void operator = (const thread_pool &);
+
+private:
+    struct state;
+    state *m_state;
+};
+
+}
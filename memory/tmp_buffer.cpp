@@ -2,43 +2,50 @@
 
 #include "tmp_buffer.h"
 #include "memory.h"
+#include "mutex.h"
+#include "mem_accounting.h"
 #include <memory.h>
 #include <string.h>
 #include <vector>
-#include <list>
+
+#if defined(_MSC_VER)
+    #define nya_thread_local __declspec(thread)
+#else
+    #define nya_thread_local __thread
+#endif
 
 namespace nya_memory
 {
 
-class tmp_buffer
+namespace
 {
-private:
-    void allocate(size_t size)
+    //buffers are rounded up to the power of two, smallest class is 2^min_class_shift bytes
+    const unsigned int min_class_shift=6;
+    const unsigned int classes_count=sizeof(size_t)*8;
+    const unsigned int thread_cache_depth=4;
+    const size_t thread_cache_max_size=1024*1024; //per thread, larger buffers go to the shared lists
+
+    unsigned int get_size_class(size_t size)
     {
-        if(size>m_data.size())
-        {
-            if(m_allocate_log_enabled) log()<<"tmp buf resized from "<<m_data.size()<<" to "<<size<<", ";
-            m_data.resize(size);
-            if(m_allocate_log_enabled) log()<<get_total_size()<<" in "<<m_buffers.size()<<" buffers total)\n";
-        }
+        unsigned int c=min_class_shift;
+        while(c<classes_count-1 && ((size_t)1<<c)<size)
+            ++c;
 
-        m_size = size;
-        m_used=true;
+        return c;
     }
+}
 
-    bool is_used() const { return m_used; }
-    size_t get_actual_size() const { return m_data.size(); }
-
+class tmp_buffer
+{
 public:
     size_t get_size() const { return m_size; }
-    void free() { m_size=0; m_used=false; }
 
     void *get_data(size_t offset)
     {
         if(offset>=m_size)
             return 0;
 
-        return &m_data[offset];
+        return m_data+offset;
     }
 
     const void *get_data(size_t offset) const
@@ -46,7 +53,7 @@ public:
         if(offset>=m_size)
             return 0;
 
-        return &m_data[offset];
+        return m_data+offset;
     }
 
     bool copy_to(void *data,size_t size,size_t offset) const
@@ -54,7 +61,7 @@ public:
         if(size+offset>m_size)
             return false;
 
-        memcpy(data,&m_data[offset],size);
+        memcpy(data,m_data+offset,size);
         return true;
     }
 
@@ -63,93 +70,168 @@ public:
         if(size+offset>m_size)
             return false;
 
-        memcpy(&m_data[offset],data,size);
+        memcpy(m_data+offset,data,size);
         return true;
     }
 
+public:
     static tmp_buffer *allocate_new(size_t size)
     {
-        tmp_buffer* min_suit_buf=0;
-        tmp_buffer* max_buf=0;
+        const unsigned int c=get_size_class(size);
 
-        for(buffers_list::iterator it=m_buffers.begin();it!=m_buffers.end();++it)
+        thread_cache &cache=m_thread_cache;
+        if(cache.count[c]>0)
         {
-            tmp_buffer &buffer = *it;
-            if(buffer.is_used())
-                continue;
+            tmp_buffer *buf=cache.buffers[c][--cache.count[c]];
+            cache.size-=(size_t)1<<c;
+            buf->m_size=size;
+            return buf;
+        }
 
-            if(buffer.get_actual_size()>=size && (!min_suit_buf  || buffer.get_actual_size()< min_suit_buf->get_actual_size()))
-                min_suit_buf=&buffer;
+        {
+            mutex_scoped_lock lock(get_mutex());
 
-            if(max_buf)
+            shared_state &s=get_shared();
+            std::vector<tmp_buffer*> &free_list=s.free_lists[c];
+            if(!free_list.empty())
             {
-                if(buffer.get_actual_size() > max_buf->get_actual_size())
-                    max_buf=&buffer;
+                tmp_buffer *buf=free_list.back();
+                free_list.pop_back();
+                buf->m_size=size;
+                return buf;
             }
-            else
-                max_buf=&buffer;
-        }
 
-        if(min_suit_buf)
-        {
-            min_suit_buf->allocate(size);
-            return min_suit_buf;
+            s.total_size+=(size_t)1<<c;
+            ++s.total_count;
+            mem_accounting::add(s.mem_category,(size_t)1<<c);
+
+            if(m_allocate_log_enabled)
+            {
+                log()<<"new tmp buf allocated with size "<<((size_t)1<<c)<<" ("<<s.total_size
+                     <<" in "<<s.total_count<<" buffers total)\n";
+            }
         }
 
-        if(max_buf)
+        tmp_buffer *buf=new tmp_buffer(c);
+        buf->m_size=size;
+        return buf;
+    }
+
+    //buffer may be released from any thread, not only from the one that allocated it
+    void free()
+    {
+        m_size=0;
+
+        thread_cache &cache=m_thread_cache;
+        const size_t class_size=(size_t)1<<m_class;
+        if(cache.count[m_class]<thread_cache_depth && cache.size+class_size<=thread_cache_max_size)
         {
-            max_buf->allocate(size);
-            return max_buf;
+            cache.buffers[m_class][cache.count[m_class]++]=this;
+            cache.size+=class_size;
+            return;
         }
 
-        m_buffers.push_back(tmp_buffer());
-        m_buffers.back().allocate(size);
+        mutex_scoped_lock lock(get_mutex());
+        get_shared().free_lists[m_class].push_back(this);
+    }
 
-        if(m_allocate_log_enabled) log()<<"new tmp buf allocated ("<<m_buffers.size()<<" total)\n";
+    static void flush_thread_cache()
+    {
+        thread_cache &cache=m_thread_cache;
+        if(!cache.size)
+            return;
 
-        return &m_buffers.back();
+        mutex_scoped_lock lock(get_mutex());
+        shared_state &s=get_shared();
+        for(unsigned int i=0;i<classes_count;++i)
+        {
+            for(unsigned int j=0;j<cache.count[i];++j)
+                s.free_lists[i].push_back(cache.buffers[i][j]);
+
+            cache.count[i]=0;
+        }
+
+        cache.size=0;
     }
 
+    //frees unused buffers from the shared lists and calling thread's cache
     static void force_free()
     {
-        for(buffers_list::iterator it=m_buffers.begin();it!=m_buffers.end();++it)
+        flush_thread_cache();
+
+        mutex_scoped_lock lock(get_mutex());
+        shared_state &s=get_shared();
+        for(unsigned int i=0;i<classes_count;++i)
         {
-            tmp_buffer &buffer = *it;
-            if(buffer.is_used())
-                continue;
+            std::vector<tmp_buffer*> &free_list=s.free_lists[i];
+            for(size_t j=0;j<free_list.size();++j)
+            {
+                s.total_size-=(size_t)1<<i;
+                --s.total_count;
+                mem_accounting::remove(s.mem_category,(size_t)1<<i);
+                delete free_list[j];
+            }
 
-            std::vector<char>().swap(buffer.m_data);
+            std::vector<tmp_buffer*>().swap(free_list);
         }
     }
 
     static size_t get_total_size()
     {
-        size_t size=0;
-        for(buffers_list::iterator it=m_buffers.begin();it!=m_buffers.end();++it)
-        {
-            tmp_buffer &buffer = *it;
-            size+=buffer.m_data.size();
-        }
-
-        return size;
+        mutex_scoped_lock lock(get_mutex());
+        return get_shared().total_size;
     }
 
     static void enable_alloc_log(bool enable) { m_allocate_log_enabled=enable; }
 
-    tmp_buffer(): m_used(false), m_size(0) {}
+private:
+    tmp_buffer(unsigned int size_class): m_size(0),m_class(size_class)
+    {
+        m_data=new char[(size_t)1<<size_class];
+    }
+
+    ~tmp_buffer() { delete []m_data; }
 
 private:
-    std::vector<char> m_data;
-    bool m_used;
+    char *m_data;
     size_t m_size;
+    unsigned int m_class;
 
 private:
-    typedef std::list<tmp_buffer> buffers_list;
-    static buffers_list m_buffers;
+    struct shared_state
+    {
+        std::vector<tmp_buffer*> free_lists[classes_count];
+        size_t total_size;
+        size_t total_count;
+        int mem_category;
+
+        shared_state(): total_size(0),total_count(0),mem_category(mem_accounting::get_category("tmp_buffers")) {}
+    };
+
+    struct thread_cache
+    {
+        tmp_buffer *buffers[classes_count][thread_cache_depth];
+        unsigned int count[classes_count];
+        size_t size; //bytes held
+    };
+
+    static shared_state &get_shared()
+    {
+        static shared_state state;
+        return state;
+    }
+
+    static mutex &get_mutex()
+    {
+        static mutex m;
+        return m;
+    }
+
+    static nya_thread_local thread_cache m_thread_cache;
     static bool m_allocate_log_enabled;
 };
 
-tmp_buffer::buffers_list tmp_buffer::m_buffers;
+nya_thread_local tmp_buffer::thread_cache tmp_buffer::m_thread_cache;
 bool tmp_buffer::m_allocate_log_enabled=false;
 
 void *tmp_buffer_ref::get_data(size_t offset) const
@@ -212,5 +294,6 @@ tmp_buffer_scoped::~tmp_buffer_scoped() { if(m_buf) m_buf->free(); }
 void tmp_buffers::force_free() { tmp_buffer::force_free(); }
 size_t tmp_buffers::get_total_size() { return tmp_buffer::get_total_size(); }
 void tmp_buffers::enable_alloc_log(bool enable) { tmp_buffer::enable_alloc_log(enable); }
+void tmp_buffers::flush_thread_cache() { tmp_buffer::flush_thread_cache(); }
 
 }
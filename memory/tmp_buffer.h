@@ -4,7 +4,9 @@
 
 #include <cstddef>
 
-//Note: many buffers are not supposed to be opened at the same time
+//Note: buffers are pooled in power-of-two size classes,
+//      may be allocated and released from any thread,
+//      each thread keeps up to 1 mb of released buffers for reuse without locking
 
 namespace nya_memory
 {
@@ -68,6 +70,9 @@ namespace tmp_buffers
     void force_free();
     size_t get_total_size();
     void enable_alloc_log(bool enable);
+
+    //returns calling thread's cached buffers to the shared pool, call before worker thread exits
+    void flush_thread_cache();
 }
 
 }
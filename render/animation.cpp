@@ -13,12 +13,11 @@ template<typename t_map,typename t_data,typename t_names_data> int add_bone_curv
 
     const int idx=(int)data.size();
     std::pair<typename t_map::iterator,bool> ret=
-    map.insert(std::pair<std::string,int>(name,idx));
+    map.insert(std::pair<unsigned int,unsigned int>(nya_memory::name_id::intern(name),idx));
 
     if(ret.second==false)
         return ret.first->second;
 
-    map[name]=idx;
     data.resize(idx+1);
     names.resize(idx+1);
     names.back().assign(name);
@@ -44,12 +43,12 @@ template<typename t_list,typename t_frame> void add_frame(t_list &seq,const t_fr
     seq.push_back(f);
 }
 
-template<typename t_map> int get_idx(const char *name,t_map &map)
+template<typename t_map> int get_idx(unsigned int id,t_map &map)
 {
-    if(!name)
+    if(!id)
         return -1;
 
-    typename t_map::const_iterator it=map.find(name);
+    typename t_map::const_iterator it=map.find(id);
     if(it==map.end())
         return -1;
 
@@ -111,7 +110,8 @@ template<typename t_value,typename t_data,typename t_frame> t_value get_value(in
 namespace nya_render
 {
 
-int animation::get_bone_idx(const char *name) const { return get_idx(name,m_bones_map); }
+int animation::get_bone_idx(const char *name) const { return get_idx(nya_memory::name_id::find(name),m_bones_map); }
+int animation::get_bone_idx(const nya_memory::name_id &name) const { return get_idx(name.get_id(),m_bones_map); }
 
 nya_math::vec3 animation::get_bone_pos(int idx,unsigned int time,bool looped) const
 {
@@ -153,7 +153,8 @@ const char *animation::get_bone_name(int idx) const
     return m_bone_names[idx].c_str();
 }
 
-int animation::get_curve_idx(const char *name) const { return get_idx(name,m_curves_map); }
+int animation::get_curve_idx(const char *name) const { return get_idx(nya_memory::name_id::find(name),m_curves_map); }
+int animation::get_curve_idx(const nya_memory::name_id &name) const { return get_idx(name.get_id(),m_curves_map); }
 
 float animation::get_curve(int idx,unsigned int time,bool looped) const
 {
@@ -5,6 +5,7 @@
 #include "math/vector.h"
 #include "math/quaternion.h"
 #include "math/bezier.h"
+#include "memory/name_id.h"
 #include <vector>
 #include <map>
 #include <string>
@@ -17,12 +18,14 @@ class animation
 public:
     unsigned int get_duration() const { return m_duration; }
     int get_bone_idx(const char *name) const; //< 0 if invalid
+    int get_bone_idx(const nya_memory::name_id &name) const;
     nya_math::vec3 get_bone_pos(int idx,unsigned int time,bool looped=true) const;
     nya_math::quat get_bone_rot(int idx,unsigned int time,bool looped=true) const;
     int get_bones_count() const { return (int)m_bone_names.size(); }
     const char *get_bone_name(int idx) const;
 
     int get_curve_idx(const char *name) const; //< 0 if invalid
+    int get_curve_idx(const nya_memory::name_id &name) const;
     float get_curve(int idx,unsigned int time,bool looped=true) const;
     int get_cuves_count() const { return (int)m_curves.size(); }
     const char *get_curve_name(int idx) const;
@@ -69,7 +72,7 @@ private:
     typedef std::vector<rot_frame> rot_sequence;
 
 
-    typedef std::map<std::string,unsigned int> index_map;
+    typedef std::map<unsigned int,unsigned int> index_map; //name_id to index
     index_map m_bones_map;
     std::vector<std::string> m_bone_names;
     std::vector<pos_sequence> m_pos_sequences;
@@ -4,6 +4,7 @@
 #include "shader_code_parser.h"
 #include "platform_specific_gl.h"
 #include "render.h"
+#include "memory/mem_accounting.h"
 
 //#define CACHE_UNIFORM_CHANGES
 //#define CACHE_MATRIX_CHANGES
@@ -181,6 +182,8 @@ namespace
     public:
         void release();
 
+        template<typename t> static int apply_to_all(t &applier) { return get_shader_objs().apply_to_all(applier); }
+
     private:
         typedef render_objects<shader_obj> shader_objs;
         static shader_objs &get_shader_objs()
@@ -190,6 +193,32 @@ namespace
         }
     };
 
+    struct shader_mem_counter
+    {
+        size_t size;
+
+        void apply(const shader_obj &obj)
+        {
+            size+=sizeof(shader_obj)+obj.uniforms.capacity()*sizeof(shader_obj::uniform);
+            for(size_t i=0;i<obj.uniforms.size();++i)
+                size+=obj.uniforms[i].name.capacity();
+#ifdef CACHE_UNIFORM_CHANGES
+            size+=obj.uniforms_cache.capacity()*sizeof(nya_math::vec4);
+#endif
+        }
+
+        shader_mem_counter(): size(0) {}
+    };
+
+    void poll_shaders_mem(nya_memory::mem_usage &usage,void *)
+    {
+        shader_mem_counter counter;
+        usage.count=shader_obj::apply_to_all(counter);
+        usage.current=counter.size;
+    }
+
+    const int shaders_mem_poll=nya_memory::mem_accounting::register_poll("shaders",poll_shaders_mem);
+
     shader::uniform_type convert_uniform_type(shader_code_parser::variable_type type)
     {
         switch(type)
@@ -15,7 +15,7 @@ int skeleton::add_bone(const char *name,const nya_math::vec3 &pos,const nya_math
 
     int bone_idx=(int)m_bones.size();
     std::pair<index_map::iterator,bool> ret=
-            m_bones_map.insert (std::pair<std::string,int>(name,bone_idx));
+            m_bones_map.insert (std::pair<unsigned int,unsigned int>(nya_memory::name_id::intern(name),bone_idx));
 
     if(!allow_doublicate && ret.second==false)
         return ret.first->second;
@@ -86,7 +86,20 @@ int skeleton::get_bone_idx(const char *name) const
     if(!name)
         return -1;
 
-    index_map::const_iterator it=m_bones_map.find(name);
+    const unsigned int id=nya_memory::name_id::find(name);
+    if(!id)
+        return -1;
+
+    index_map::const_iterator it=m_bones_map.find(id);
+    if(it==m_bones_map.end())
+        return -1;
+
+    return (int)it->second;
+}
+
+int skeleton::get_bone_idx(const nya_memory::name_id &name) const
+{
+    index_map::const_iterator it=m_bones_map.find(name.get_id());
     if(it==m_bones_map.end())
         return -1;
 
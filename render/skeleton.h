@@ -4,6 +4,7 @@
 
 #include "math/vector.h"
 #include "math/quaternion.h"
+#include "memory/name_id.h"
 
 #include <string>
 #include <map>
@@ -16,6 +17,7 @@ class skeleton
 {
 public:
     int get_bone_idx(const char *name) const; //< 0 if invalid
+    int get_bone_idx(const nya_memory::name_id &name) const;
     const char *get_bone_name(int idx) const;
     int get_bone_parent_idx(int idx) const;
     nya_math::vec3 transform(int bone_idx,const nya_math::vec3 &point) const;
@@ -55,7 +57,7 @@ private:
     void update_ik(int idx);
 
 private:
-    typedef std::map<std::string,unsigned int> index_map;
+    typedef std::map<unsigned int,unsigned int> index_map; //name_id to index
 
     struct bone
     {
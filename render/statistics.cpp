@@ -2,13 +2,19 @@
 
 #include "statistics.h"
 #include "platform_specific_gl.h"
+#include "memory/frame_arena.h"
 
 namespace nya_render
 {
 
 namespace { statistics stats; bool stats_enabled=false; }
 
-void statistics::begin_frame() { stats=statistics(); stats_enabled=true; }
+void statistics::begin_frame()
+{
+    stats=statistics();
+    stats_enabled=true;
+    nya_memory::frame_arena::get().reset();
+}
 statistics &statistics::get() { return stats; }
 bool statistics::enabled() { return stats_enabled; }
 
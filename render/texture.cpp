@@ -5,6 +5,10 @@
 #include "platform_specific_gl.h"
 
 #include "memory/tmp_buffer.h"
+#include "memory/mem_accounting.h"
+#include "formats/mip_chain.h"
+#include "formats/pixel_convert.h"
+#include <string.h>
 
 namespace nya_render
 {
@@ -126,29 +130,6 @@ unsigned int get_tex_memory_size(unsigned int width,unsigned int height,texture:
     return full_size;
 }
 
-void downsample(const void *from,void *to,unsigned int width,unsigned int height,unsigned int channels)
-{
-    const unsigned char *f=(unsigned char *)from;
-    unsigned char *t=(unsigned char *)to;
-
-    const unsigned int new_width=width/2;
-    const unsigned int new_height=height/2;
-
-    for(unsigned int h=0;h<new_height*channels;h+=channels)
-    {
-        for(unsigned int w=0;w<new_width*channels;w+=channels)
-        {
-            for(unsigned int c=0;c<channels;++c)
-            {
-                t[h*new_width+w+c]=(f[(h*width+w)*2+c]+
-                                    f[((h*2+channels)*width+w*2)+c]+
-                                    f[(h*2*width+(w*2+channels))+c]+
-                                    f[((h*2+channels)*width+(w*2+channels))+c])/4;
-            }
-        }
-    }
-}
-
 #ifdef DIRECTX11
 void dx_convert_to_format(const unsigned char *from,unsigned char *to,size_t size,texture::color_format format)
 {
@@ -307,13 +288,7 @@ void bgra_to_rgba(const unsigned char *from,unsigned char *to,size_t data_size)
     if(!from || !to || from==to)
         return;
 
-    for(size_t i=0;i<data_size;i+=4)
-    {
-        to[i]=from[i+2];
-        to[i+1]=from[i+1];
-        to[i+2]=from[i+0];
-        to[i+3]=from[i+3];
-    }
+    nya_formats::swap_red_blue(from,to,data_size/4,4);
 }
 
 }
@@ -501,7 +476,7 @@ bool texture::build_texture(const void *data_a[6],bool is_cubemap,unsigned int w
         char *mem_data=(char *)buf_mip.get_data();
         for(int i=0,w=width,h=height;i<(int)srdata.size()-1;++i)
         {
-            downsample(prev_data,mem_data,w,h,4);
+            nya_formats::mip_chain().downsample(nya_formats::mip_chain::rgba,prev_data,w,h,mem_data);
             prev_data=srdata[i+1].pSysMem=mem_data;
             w=w>1?w/2:1,h=h>1?h/2:1;
             srdata[i+1].SysMemPitch=w*4;
@@ -1059,6 +1034,44 @@ bool texture::is_dxt_supported()
 */
 }
 
+bool texture::is_etc1_supported()
+{
+#if defined DIRECTX11 || !defined OPENGL_ES
+    return false;
+#else
+    static bool checked=false,supported=false;
+    if(!checked && glGetString(GL_EXTENSIONS))
+        checked=true,supported=is_etc2_supported() || has_extension("GL_OES_compressed_ETC1_RGB8_texture");
+    return supported;
+#endif
+}
+
+bool texture::is_etc2_supported()
+{
+#if defined DIRECTX11 || !defined OPENGL_ES
+    return false;
+#else
+    //core since es 3.0
+    static bool checked=false,supported=false;
+    const char *version=checked?0:(const char *)glGetString(GL_VERSION);
+    if(version)
+        checked=true,supported=strncmp(version,"OpenGL ES ",10)==0 && version[10]>='3';
+    return supported;
+#endif
+}
+
+bool texture::is_pvr_supported()
+{
+#if defined DIRECTX11 || !defined OPENGL_ES
+    return false;
+#else
+    static bool checked=false,supported=false;
+    if(!checked && glGetString(GL_EXTENSIONS))
+        checked=true,supported=has_extension("GL_IMG_texture_compression_pvrtc");
+    return supported;
+#endif
+}
+
 namespace
 {
 
@@ -1070,8 +1083,25 @@ struct size_counter
     size_counter(): size(0) {}
 };
 
+void poll_vmem(nya_memory::mem_usage &usage,void *)
+{
+    size_counter counter;
+    usage.count=texture_obj::get_texture_objs().apply_to_all(counter);
+    usage.current=counter.size;
+}
+
+const int vmem_poll=nya_memory::mem_accounting::register_poll("texture",poll_vmem);
+
 };
 
+unsigned int texture::get_vmem_size() const
+{
+    if(m_tex<0)
+        return 0;
+
+    return texture_obj::get(m_tex).size;
+}
+
 unsigned int texture::get_used_vmem_size()
 {
     size_counter counter;
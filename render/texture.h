@@ -46,6 +46,9 @@ public:
     };
 
     static bool is_dxt_supported();
+    static bool is_etc1_supported();
+    static bool is_etc2_supported(); //etc2, etc2_eac and etc2_a1
+    static bool is_pvr_supported();
 
 public:
     //mip_count= -1 means "generate mipmaps". You have to provide a single mip or a complete mipmap pyramid instead
@@ -89,6 +92,7 @@ public:
     unsigned int get_height() const;
     color_format get_color_format() const;
     bool is_cubemap() const;
+    unsigned int get_vmem_size() const;
 
     static void get_default_filter(filter &minification,filter &magnification,filter &mipmap);
     static unsigned int get_default_aniso();
@@ -14,6 +14,7 @@
 #include "statistics.h"
 
 #include "memory/tmp_buffer.h"
+#include "memory/mem_accounting.h"
 
 #ifdef DIRECTX11
     #include "shader.h"
@@ -1203,8 +1204,28 @@ struct size_counter
     size_counter(): size(0) {}
 };
 
+void poll_vmem(nya_memory::mem_usage &usage,void *)
+{
+    size_counter counter;
+    usage.count=vbo_obj::get_vbo_objs().apply_to_all(counter);
+    usage.current=counter.size;
+}
+
+const int vmem_poll=nya_memory::mem_accounting::register_poll("vbo",poll_vmem);
+
 };
 
+unsigned int vbo::get_vmem_size() const
+{
+    size_counter counter;
+    if(m_verts>=0)
+        counter.apply(vbo_obj::get(m_verts));
+    if(m_indices>=0)
+        counter.apply(vbo_obj::get(m_indices));
+
+    return counter.size;
+}
+
 unsigned int vbo::get_used_vmem_size()
 {
     size_counter counter;
@@ -84,6 +84,7 @@ public:
     void release();
 
 public:
+    unsigned int get_vmem_size() const;
     static unsigned int get_used_vmem_size();
 
 public:
@@ -1,12 +1,117 @@
 //https://code.google.com/p/nya-engine/
 
 #include "composite_resources_provider.h"
-#include "memory/pool.h"
 #include <algorithm>
+#include <string.h>
 
 namespace nya_resources
 {
 
+//open addressing hash table of normalized names, lookups don't allocate
+class composite_resources_provider::name_index
+{
+public:
+    int find(const char *name) const
+    {
+        if(m_slots.empty())
+            return -1;
+
+        const unsigned int hash=get_name_hash(name,m_ignore_case);
+        const size_t mask=m_slots.size()-1;
+        for(size_t i=hash&mask;;i=(i+1)&mask)
+        {
+            const int idx=m_slots[i];
+            if(idx<0)
+                return -1;
+
+            const entry &e=m_entries[idx];
+            if(e.hash==hash && is_name_equal(name,&m_names[e.key],m_ignore_case))
+                return idx;
+        }
+    }
+
+    void add(const char *name,int value)
+    {
+        const int found=find(name);
+        if(found>=0)
+        {
+            m_entries[found].value=value;
+            return;
+        }
+
+        if((m_entries.size()+1)*2>m_slots.size())
+            rehash(m_slots.empty()?64:m_slots.size()*2);
+
+        entry e;
+        e.hash=get_name_hash(name,m_ignore_case);
+        e.value=value;
+        e.key=add_name(normalize_name(name,m_ignore_case).c_str());
+        e.original=add_name(name);
+
+        const size_t mask=m_slots.size()-1;
+        size_t i=e.hash&mask;
+        while(m_slots[i]>=0)
+            i=(i+1)&mask;
+
+        m_slots[i]=(int)m_entries.size();
+        m_entries.push_back(e);
+    }
+
+    int get_value(int idx) const { return m_entries[idx].value; }
+    const char *get_key(int idx) const { return &m_names[m_entries[idx].key]; }
+    const char *get_original_name(int idx) const { return &m_names[m_entries[idx].original]; }
+    int get_count() const { return (int)m_entries.size(); }
+
+    void clear() { m_entries.clear(); m_slots.clear(); m_names.clear(); }
+
+public:
+    name_index(bool ignore_case): m_ignore_case(ignore_case) {}
+
+private:
+    void rehash(size_t slots_count)
+    {
+        m_slots.assign(slots_count,-1);
+        const size_t mask=slots_count-1;
+        for(size_t i=0;i<m_entries.size();++i)
+        {
+            size_t s=m_entries[i].hash&mask;
+            while(m_slots[s]>=0)
+                s=(s+1)&mask;
+
+            m_slots[s]=(int)i;
+        }
+    }
+
+    unsigned int add_name(const char *name)
+    {
+        const unsigned int offset=(unsigned int)m_names.size();
+        m_names.insert(m_names.end(),name,name+strlen(name)+1);
+        return offset;
+    }
+
+private:
+    struct entry
+    {
+        unsigned int hash;
+        unsigned int key;
+        unsigned int original;
+        int value;
+    };
+
+    std::vector<entry> m_entries;
+    std::vector<int> m_slots; //-1 if empty
+    std::vector<char> m_names;
+    bool m_ignore_case;
+};
+
+composite_resources_provider::~composite_resources_provider()
+{
+    for(size_t i=0;i<m_indices.size();++i)
+        delete m_indices[i];
+
+    delete m_lookups;
+}
+
 void composite_resources_provider::add_provider(resources_provider *provider)
 {
     if(!provider)
@@ -15,36 +120,16 @@ void composite_resources_provider::add_provider(resources_provider *provider)
         return;
     }
 
+    nya_memory::mutex_scoped_lock lock(m_mutex);
     m_resource_names.clear();
     m_providers.push_back(provider);
+    m_indices.push_back(0);
     if(m_cache_entries)
         cache_provider((int)m_providers.size()-1);
-}
-
-inline std::string fix_name(const char *name)
-{
-    if(!name)
-        return std::string();
 
-    std::string name_str(name);
-    for(size_t i=0;i<name_str.size();++i)
-    {
-        if(name_str[i]=='\\')
-            name_str[i]='/';
-    }
-
-    std::string out;
-    char prev=0;
-    for(size_t i=0;i<name_str.size();++i)
-    {
-        if(prev=='/' && name_str[i]=='/')
-            continue;
-
-        prev=name_str[i];
-        out.push_back(prev);
-    }
-    
-    return out;
+    //a new provider may have names that were not found before
+    if(m_lookups)
+        m_lookups->clear();
 }
 
 void composite_resources_provider::cache_provider(int idx)
@@ -52,63 +137,82 @@ void composite_resources_provider::cache_provider(int idx)
     if(idx<0 || idx>=(int)m_providers.size())
         return;
 
+    delete m_indices[idx];
+    m_indices[idx]=new name_index(m_ignore_case);
+
     resources_provider *provider=m_providers[idx];
     for(int i=0;i<provider->get_resources_count();++i)
     {
         const char *name=provider->get_resource_name(i);
-        if(!name)
-            continue;
-
-        std::string name_str=fix_name(name);
-
-        if(m_ignore_case)
-            std::transform(name_str.begin(),name_str.end(),name_str.begin(),::tolower);
-
-        entry &e=m_cached_entries[name_str];
-        e.original_name.assign(name);
-        e.prov_idx=idx;
+        if(name)
+            m_indices[idx]->add(name,idx);
     }
 }
 
-resource_data *composite_resources_provider::access(const char *resource_name)
+//provider_name is copied, the index it is stored in may be rebuilt by another thread
+resources_provider *composite_resources_provider::find(const char *resource_name,std::string &provider_name)
 {
-    if(!resource_name)
-    {
-        log()<<"unable to access composite entry: invalid name\n";
-        return 0;
-    }
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    provider_name.assign(resource_name);
 
-    if(!m_cache_entries)
+    if(m_cache_entries)
     {
-        for(size_t i=0;i<m_providers.size();++i)
+        for(int i=(int)m_indices.size()-1;i>=0;--i)
         {
-            if(m_providers[i]->has(resource_name))
-                return m_providers[i]->access(resource_name);
+            const int idx=m_indices[i]?m_indices[i]->find(resource_name):-1;
+            if(idx>=0)
+            {
+                provider_name.assign(m_indices[i]->get_original_name(idx));
+                return m_providers[i];
+            }
         }
 
         return 0;
     }
 
-    entries_map::iterator it;
+    if(!m_lookups)
+        m_lookups=new name_index(false);
 
-    if(m_ignore_case)
+    //hits and misses are remembered until invalidate or add_provider, -1 for a miss
+    const int idx=m_lookups->find(resource_name);
+    if(idx>=0)
     {
-        std::string res_str=fix_name(resource_name);
-        std::transform(res_str.begin(),res_str.end(),res_str.begin(),::tolower);
+        const int provider_idx=m_lookups->get_value(idx);
+        return provider_idx<0?0:m_providers[provider_idx];
+    }
 
-        it=m_cached_entries.find(res_str);
+    for(size_t i=0;i<m_providers.size();++i)
+    {
+        if(m_providers[i]->has(resource_name))
+        {
+            m_lookups->add(resource_name,(int)i);
+            return m_providers[i];
+        }
     }
-    else
-        it=m_cached_entries.find(fix_name(resource_name));
 
-    if(it==m_cached_entries.end())
+    m_lookups->add(resource_name,-1);
+    return 0;
+}
+
+resource_data *composite_resources_provider::access(const char *resource_name)
+{
+    if(!resource_name)
     {
-        log()<<"unable to access composite entry "<<resource_name
-                <<": not found\n";
+        log()<<"unable to access composite entry: invalid name\n";
         return 0;
     }
 
-    return m_providers[it->second.prov_idx]->access(it->second.original_name.c_str());
+    std::string provider_name;
+    resources_provider *provider=find(resource_name,provider_name);
+    if(!provider)
+    {
+        if(m_cache_entries)
+            log()<<"unable to access composite entry "<<resource_name<<": not found\n";
+
+        return 0;
+    }
+
+    return provider->access(provider_name.c_str());
 }
 
 bool composite_resources_provider::has(const char *resource_name)
@@ -116,77 +220,114 @@ bool composite_resources_provider::has(const char *resource_name)
     if(!resource_name)
         return false;
 
-    if(!m_cache_entries)
-    {
-        for(size_t i=0;i<m_providers.size();++i)
-        {
-            if(m_providers[i]->has(resource_name))
-                return true;
-        }
+    std::string provider_name;
+    return find(resource_name,provider_name)!=0;
+}
 
+bool composite_resources_provider::prefetch(const char *resource_name)
+{
+    if(!resource_name)
         return false;
-    }
 
-    if(m_ignore_case)
-    {
-        std::string res_str=fix_name(resource_name);
-        std::transform(res_str.begin(),res_str.end(),res_str.begin(),::tolower);
-
-        return m_cached_entries.find(res_str)!=m_cached_entries.end();
-    }
-
-    return m_cached_entries.find(fix_name(resource_name))!=m_cached_entries.end();
+    std::string provider_name;
+    resources_provider *provider=find(resource_name,provider_name);
+    return provider?provider->prefetch(provider_name.c_str()):false;
 }
 
 void composite_resources_provider::enable_cache()
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    cache_all();
+}
+
+void composite_resources_provider::cache_all()
 {
     if(m_cache_entries)
         return;
 
-    m_cached_entries.clear();
     for(int i=0;i<(int)m_providers.size();++i)
         cache_provider(i);
 
+    delete m_lookups;
+    m_lookups=0;
+    m_resource_names.clear();
     m_cache_entries=true;
 }
 
+void composite_resources_provider::invalidate(resources_provider *provider)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    m_resource_names.clear();
+
+    if(m_lookups)
+        m_lookups->clear();
+
+    if(!m_cache_entries)
+        return;
+
+    for(int i=0;i<(int)m_providers.size();++i)
+    {
+        if(!provider || m_providers[i]==provider)
+            cache_provider(i);
+    }
+}
+
 int composite_resources_provider::get_resources_count()
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    update_resource_names();
+    return (int)m_resource_names.size();
+}
+
+void composite_resources_provider::update_resource_names()
 {
     if(m_resource_names.empty())
     {
         if(m_cache_entries)
         {
-            for(entries_map::const_iterator it=m_cached_entries.begin();
-                it!=m_cached_entries.end();++it)
-                m_resource_names.push_back(it->first);
+            name_index unique(m_ignore_case);
+            for(size_t i=0;i<m_indices.size();++i)
+            {
+                if(!m_indices[i])
+                    continue;
+
+                for(int j=0;j<m_indices[i]->get_count();++j)
+                {
+                    const char *key=m_indices[i]->get_key(j);
+                    if(unique.find(key)>=0)
+                        continue;
+
+                    unique.add(key,0);
+                    m_resource_names.push_back(key);
+                }
+            }
+
+            std::sort(m_resource_names.begin(),m_resource_names.end());
         }
         else
         {
-            std::map<std::string,bool> already_has;
+            name_index unique(false);
             for(size_t i=0;i<m_providers.size();++i)
             {
                 for(int j=0;j<m_providers[i]->get_resources_count();++j)
                 {
                     const char *name=m_providers[i]->get_resource_name(j);
-                    if(!name)
-                        continue;
-
-                    if(already_has.find(name)!=already_has.end())
+                    if(!name || unique.find(name)>=0)
                         continue;
 
+                    unique.add(name,0);
                     m_resource_names.push_back(name);
-                    already_has[name]=true;
                 }
             }
         }
     }
-
-    return (int)m_resource_names.size();
 }
 
 const char *composite_resources_provider::get_resource_name(int idx)
 {
-    if(idx<0 || idx>=get_resources_count())
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    update_resource_names();
+    if(idx<0 || idx>=(int)m_resource_names.size())
         return 0;
 
     return m_resource_names[idx].c_str();
@@ -194,13 +335,13 @@ const char *composite_resources_provider::get_resource_name(int idx)
 
 void composite_resources_provider::set_ignore_case(bool ignore)
 {
+    nya_memory::mutex_scoped_lock lock(m_mutex);
     if(ignore==m_ignore_case)
         return;
 
     m_ignore_case=ignore;
     m_resource_names.clear();
 
-    m_cached_entries.clear();
     if(m_cache_entries)
     {
         for(int i=0;i<(int)m_providers.size();++i)
@@ -208,7 +349,7 @@ void composite_resources_provider::set_ignore_case(bool ignore)
     }
 
     if(ignore)
-        enable_cache();
+        cache_all();
 }
 
 }
@@ -3,49 +3,60 @@
 #pragma once
 
 #include "resources.h"
-#include <map>
+#include "memory/mutex.h"
 #include <string>
 #include <vector>
 
 namespace nya_resources
 {
 
+//thread safe, names returned by get_resource_name stay valid until contents change
 class composite_resources_provider: public resources_provider
 {
 public:
     void add_provider(resources_provider *provider);
-    void enable_cache();
+    void enable_cache(); //indexes names of each provider, later added providers take precedence
     void set_ignore_case(bool ignore); //enables cache if true
 
+    //call when provider's contents change, 0 for all providers
+    //without cache the provider a name was found in, or that it wasn't found, is remembered until invalidated
+    void invalidate(resources_provider *provider=0);
+
 public:
     resource_data *access(const char *resource_name);
     bool has(const char *resource_name);
+    bool prefetch(const char *resource_name);
 
 public:
     int get_resources_count();
     const char *get_resource_name(int idx);
 
 public:
-    composite_resources_provider(): m_ignore_case(false),m_cache_entries(false) {}
+    composite_resources_provider(): m_lookups(0),m_ignore_case(false),m_cache_entries(false) {}
+    ~composite_resources_provider();
+
+private:
+    composite_resources_provider(const composite_resources_provider &);
+    void operator = (const composite_resources_provider &);
 
 private:
+    class name_index;
+
     void cache_provider(int idx);
+    void cache_all();
+    void update_resource_names();
+    resources_provider *find(const char *resource_name,std::string &provider_name);
 
 private:
     std::vector<resources_provider*> m_providers;
     std::vector<std::string> m_resource_names;
 
-    struct entry
-    {
-        std::string original_name;
-        int prov_idx;
-    };
-
-    typedef std::map<std::string,entry> entries_map;
-    entries_map m_cached_entries;
+    std::vector<name_index*> m_indices; //per provider, if cache enabled
+    name_index *m_lookups; //provider index of found names, if cache disabled
 
     bool m_ignore_case;
     bool m_cache_entries;
+    nya_memory::mutex m_mutex;
 };
 
 }
@@ -3,13 +3,27 @@
 #include "file_resources_provider.h"
 #include "memory/pool.h"
 #include "memory/lru.h"
+#include "memory/mutex.h"
+#include "memory/thread_pool.h"
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <set>
 
 #ifdef _WIN32
 	#include <io.h>
+	#include <windows.h>
 #else
 	#include <dirent.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+#endif
+
+#ifdef __linux__
+	#include <sys/inotify.h>
+	#include <errno.h>
 #endif
 
 #include <sys/stat.h>
@@ -24,11 +38,11 @@ namespace nya_resources
 class file_ref
 {
 public:
-    void init(const char *name) { m_name.assign(name?name:""); }
+    void init(const char *name) { m_name.assign(name?name:""); m_hash=nya_memory::hash_string(m_name.c_str()); }
 
-    FILE *access() { return get_lru().access(m_name.c_str()); }
+    FILE *access() { return get_lru().access(m_name.c_str(),m_hash); } //under get_mutex
 
-    void free() { get_lru().free(m_name.c_str()); }
+    void free() { nya_memory::mutex_scoped_lock lock(get_mutex()); get_lru().free(m_name.c_str(),m_hash); }
 
     class lru: public nya_memory::lru<FILE *,64>
     {
@@ -42,8 +56,20 @@ public:
         return cache;
     }
 
+    //the cache and file positions are shared between threads, held around access and the following seek and read
+    static nya_memory::mutex &get_mutex()
+    {
+        //never destroyed, resources may be released from static destructors
+        static nya_memory::mutex *m=new nya_memory::mutex();
+        return *m;
+    }
+
+public:
+    file_ref(): m_hash(0) {}
+
 private:
     std::string m_name;
+    unsigned int m_hash;
 };
 
 class file_resource: public resource_data
@@ -66,12 +92,58 @@ private:
     size_t m_size;
 };
 
+//the view is read-only, writes to the mapped data fault
+class mapped_file_resource: public resource_data
+{
+public:
+    size_t get_size() { return m_size; }
+
+    bool read_all(void*data);
+    bool read_chunk(void *data,size_t size,size_t offset);
+    const void *get_mapped_data() { return m_data; }
+
+public:
+    bool open(const char*filename);
+    void release();
+
+    mapped_file_resource(): m_data(0),m_size(0) {}
+
+private:
+    void unmap();
+
+private:
+    void *m_data;
+    size_t m_size;
+};
+
 }
 
 namespace nya_resources
 {
 
-namespace { nya_memory::pool<nya_resources::file_resource,8> file_resources; }
+namespace
+{
+    nya_memory::dense_pool<nya_resources::file_resource,8> file_resources;
+    nya_memory::dense_pool<nya_resources::mapped_file_resource,8> mapped_file_resources;
+
+    //resources are accessed and released from any thread
+    nya_memory::mutex &get_pools_mutex()
+    {
+        static nya_memory::mutex *m=new nya_memory::mutex();
+        return *m;
+    }
+
+    unsigned long long get_mtime(const struct stat &sb)
+    {
+#if defined __APPLE__
+        return (unsigned long long)sb.st_mtimespec.tv_sec*1000000000ull+sb.st_mtimespec.tv_nsec;
+#elif defined __linux__
+        return (unsigned long long)sb.st_mtim.tv_sec*1000000000ull+sb.st_mtim.tv_nsec;
+#else
+        return (unsigned long long)sb.st_mtime*1000000000ull;
+#endif
+    }
+}
 
 resource_data *file_resources_provider::access(const char *resource_name)
 {
@@ -81,8 +153,6 @@ resource_data *file_resources_provider::access(const char *resource_name)
         return 0;
     }
 
-    file_resource *file = file_resources.allocate();
-
     std::string file_name=m_path+resource_name;
     for(size_t i=m_path.size();i<file_name.size();++i)
     {
@@ -90,10 +160,32 @@ resource_data *file_resources_provider::access(const char *resource_name)
             file_name[i]='/';
     }
 
+    if(m_mmap)
+    {
+        mapped_file_resource *mapped;
+        {
+            nya_memory::mutex_scoped_lock lock(get_pools_mutex());
+            mapped=mapped_file_resources.allocate();
+        }
+
+        if(mapped->open(file_name.c_str()))
+            return mapped;
+
+        nya_memory::mutex_scoped_lock lock(get_pools_mutex());
+        mapped_file_resources.free(mapped);
+    }
+
+    file_resource *file;
+    {
+        nya_memory::mutex_scoped_lock lock(get_pools_mutex());
+        file=file_resources.allocate();
+    }
+
     if(!file->open(file_name.c_str()))
     {
         log()<<"unable to access file: "<<file_name.c_str()+m_path.size()
                         <<" at path "<<m_path.c_str()<<"\n";
+        nya_memory::mutex_scoped_lock lock(get_pools_mutex());
         file_resources.free(file);
         return 0;
     }
@@ -103,9 +195,76 @@ resource_data *file_resources_provider::access(const char *resource_name)
 
 bool file_resources_provider::has(const char *name)
 {
-    if(!name)
+    file_info info;
+    return get_info(name,info);
+}
+
+bool file_resources_provider::prefetch(const char *resource_name)
+{
+#if defined __linux__ || defined __APPLE__
+    if(!resource_name)
+        return false;
+
+    std::string file_name=m_path+resource_name;
+    for(size_t i=m_path.size();i<file_name.size();++i)
+    {
+        if(file_name[i]=='\\')
+            file_name[i]='/';
+    }
+
+    const int fd=::open(file_name.c_str(),O_RDONLY);
+    if(fd<0)
         return false;
 
+  #ifdef __APPLE__
+    struct stat sb;
+    bool result=false;
+    if(fstat(fd,&sb)==0)
+    {
+        radvisory ra;
+        ra.ra_offset=0;
+        ra.ra_count=sb.st_size<0x7fffffff?(int)sb.st_size:0x7fffffff;
+        result=fcntl(fd,F_RDADVISE,&ra)!=-1;
+    }
+  #else
+    const bool result=posix_fadvise(fd,0,0,POSIX_FADV_WILLNEED)==0;
+  #endif
+    close(fd);
+    return result;
+#else
+    return false;
+#endif
+}
+
+bool file_resources_provider::get_info(const char *resource_name,file_info &info)
+{
+    if(!resource_name)
+        return false;
+
+    {
+        nya_memory::mutex_scoped_lock lock(m_mutex);
+        if(m_indexed)
+        {
+            const int idx=find_entry(resource_name);
+            if(idx<0)
+                return false;
+
+            info=m_files[idx];
+            return true;
+        }
+    }
+
+    return stat_file(resource_name,info);
+}
+
+size_t file_resources_provider::get_size(const char *resource_name)
+{
+    file_info info;
+    return get_info(resource_name,info)?info.size:0;
+}
+
+bool file_resources_provider::stat_file(const char *name,file_info &info) const
+{
     std::string file_name=m_path+name;
     for(size_t i=m_path.size();i<file_name.size();++i)
     {
@@ -114,13 +273,31 @@ bool file_resources_provider::has(const char *name)
     }
 
     struct stat sb;
-    return stat(file_name.c_str(),&sb)==0;
+    if(stat(file_name.c_str(),&sb)!=0 || S_ISDIR(sb.st_mode))
+        return false;
+
+    info.size=(size_t)sb.st_size;
+    info.mtime=get_mtime(sb);
+    return true;
 }
 
 bool file_resources_provider::set_folder(const char*name,bool recursive,bool ignore_nonexistent)
 {
-    m_resource_names.clear();
-    m_recursive=recursive;
+    {
+        nya_memory::mutex_scoped_lock lock(m_mutex);
+        m_indexed=false;
+        m_files.clear();
+        m_folders.clear();
+        m_recursive=recursive;
+    }
+
+    if(is_watching())
+    {
+        enable_watch(false);
+        const bool result=set_folder(name,recursive,ignore_nonexistent);
+        enable_watch(true);
+        return result;
+    }
 
     if(!name)
     {
@@ -162,99 +339,547 @@ bool file_resources_provider::set_folder(const char*name,bool recursive,bool ign
     return true;
 }
 
-void file_resources_provider::enumerate_folder(const char*folder_name)
+//reads folders in parallel, subfolders found in known aren't entered unless added explicitly
+class file_resources_provider::index_builder
 {
-    if(!folder_name)
-        return;
+public:
+    void add_folder(const std::string &folder) { m_queue.push_back(folder); }
+
+    void run(unsigned int threads_count)
+    {
+        //small trees don't need threads
+        while(m_queue.size()==1)
+        {
+            const std::string folder=m_queue.back();
+            m_queue.pop_back();
+            process(folder);
+        }
 
-    std::string folder_name_str(folder_name);
+        if(m_queue.empty())
+            return;
 
-    while(!folder_name_str.empty() && folder_name_str[folder_name_str.length()-1]=='/')
-        folder_name_str.resize(folder_name_str.length()-1);
+        if(threads_count!=1 && m_pool.start(threads_count))
+        {
+            for(size_t i=0;i<m_queue.size();++i)
+                add_task(m_queue[i]);
 
-    std::string first_dir=(m_path+folder_name_str);
-    if(first_dir.empty())
-        return;
+            m_queue.clear();
+            m_pool.wait_idle();
+            m_pool.stop();
+            return;
+        }
 
-    if(first_dir[0]=='.')
-        return;
+        while(!m_queue.empty())
+        {
+            const std::string folder=m_queue.back();
+            m_queue.pop_back();
+            process(folder);
+        }
+    }
+
+public:
+    std::vector<index_entry> files;
+    std::vector<std::pair<std::string,unsigned long long> > folders; //read folders with modification time
+    std::vector<std::string> failed;
+
+public:
+    index_builder(const std::string &path,bool recursive,const std::map<std::string,unsigned long long> *known):
+                  m_path(path),m_recursive(recursive),m_known(known) {}
+
+private:
+    struct task
+    {
+        index_builder *builder;
+        std::string folder;
+    };
+
+    void add_task(const std::string &folder)
+    {
+        task *t=new task();
+        t->builder=this;
+        t->folder=folder;
+        if(!m_pool.add_task(read_task,t))
+            delete t;
+    }
+
+    static void read_task(void *data)
+    {
+        task *t=(task *)data;
+        t->builder->process(t->folder);
+        delete t;
+    }
+
+    void process(const std::string &folder)
+    {
+        std::vector<index_entry> folder_files;
+        std::vector<std::string> subfolders;
+        unsigned long long mtime=0;
+        const bool result=read_folder(folder,folder_files,subfolders,mtime);
+
+        nya_memory::mutex_scoped_lock lock(m_mutex);
+        if(!result)
+        {
+            failed.push_back(folder);
+            return;
+        }
+
+        files.insert(files.end(),folder_files.begin(),folder_files.end());
+        folders.push_back(std::make_pair(folder,mtime));
+
+        for(size_t i=0;i<subfolders.size();++i)
+        {
+            if(m_known && m_known->find(subfolders[i])!=m_known->end())
+                continue;
+
+            if(m_pool.is_started())
+                add_task(subfolders[i]);
+            else
+                m_queue.push_back(subfolders[i]);
+        }
+    }
 
-    while(!first_dir.empty() && first_dir[first_dir.length()-1]=='/')
-        first_dir.resize(first_dir.length()-1);
+    bool read_folder(const std::string &folder,std::vector<index_entry> &folder_files,
+                     std::vector<std::string> &subfolders,unsigned long long &mtime) const
+    {
+        const std::string path=m_path+(folder.empty()?".":folder);
+        struct stat sb;
 
 #ifdef _WIN32
-	_finddata_t data;
-	intptr_t hdl=_findfirst((first_dir + "/*").c_str(),&data);
-    if(!hdl)
+        _finddata_t data;
+        intptr_t hdl=_findfirst((path+"/*").c_str(),&data);
+        if(hdl==-1)
+            return false;
+
+        mtime=stat(path.c_str(),&sb)==0?get_mtime(sb):0;
+
+        do
+        {
+            const char *name=data.name;
+            const bool is_dir=(data.attrib&_A_SUBDIR)!=0;
 #else
-    DIR *dirp=opendir(first_dir.c_str());
-    if(!dirp)
+        DIR *dirp=opendir(path.c_str());
+        if(!dirp)
+            return false;
+
+        mtime=fstat(dirfd(dirp),&sb)==0?get_mtime(sb):0;
+
+        while(dirent *dp=readdir(dirp))
+        {
+            const char *name=dp->d_name;
+            if(fstatat(dirfd(dirp),name,&sb,0)!=0)
+                continue;
+
+            const bool is_dir=S_ISDIR(sb.st_mode);
 #endif
+            if(name[0]=='.' && (!name[1] || (name[1]=='.' && !name[2])))
+                continue;
+
+            const std::string entry_name=folder.empty()?std::string(name):folder+"/"+name;
+            if(is_dir)
+            {
+                if(m_recursive)
+                    subfolders.push_back(entry_name);
+
+                continue;
+            }
+
+            folder_files.resize(folder_files.size()+1);
+            index_entry &e=folder_files.back();
+            e.name=entry_name;
+            e.hash=get_name_hash(entry_name.c_str());
+#ifdef _WIN32
+            e.size=(size_t)data.size;
+            e.mtime=(unsigned long long)data.time_write*1000000000ull;
+        }
+        while(_findnext(hdl,&data)==0);
+
+        _findclose(hdl);
+#else
+            e.size=(size_t)sb.st_size;
+            e.mtime=get_mtime(sb);
+        }
+
+        closedir(dirp);
+#endif
+        return true;
+    }
+
+private:
+    const std::string &m_path;
+    const bool m_recursive;
+    const std::map<std::string,unsigned long long> *m_known;
+    std::vector<std::string> m_queue;
+    nya_memory::mutex m_mutex;
+    nya_memory::thread_pool m_pool; //last, stopped first
+};
+
+//re-stats a range of indexed files, entries that no longer exist are marked removed
+struct file_resources_provider::stat_task
+{
+    const file_resources_provider *provider;
+    index_entry *from;
+    index_entry *to;
+    char *removed;
+
+    static void run(void *data)
     {
-        nya_log::log()<<"unable to enumerate folder "<<(m_path+folder_name_str).c_str()<<"\n";
+        const stat_task &t=*(stat_task *)data;
+        for(index_entry *e=t.from;e!=t.to;++e)
+            t.removed[e-t.from]=t.provider->stat_file(e->name.c_str(),*e)?0:1;
+    }
+};
+
+bool file_resources_provider::build_index(unsigned int threads_count)
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    return do_build_index(threads_count);
+}
+
+void file_resources_provider::refresh_index()
+{
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    do_refresh_index();
+}
+
+bool file_resources_provider::do_build_index(unsigned int threads_count)
+{
+    m_indexed=false;
+    m_files.clear();
+    m_folders.clear();
+
+    index_builder builder(m_path,m_recursive,0);
+    builder.add_folder("");
+    builder.run(threads_count);
+
+    if(builder.folders.empty())
+    {
+        log()<<"unable to enumerate folder "<<m_path.c_str()<<"\n";
+        return false;
+    }
+
+    for(size_t i=0;i<builder.failed.size();++i)
+        log()<<"unable to enumerate folder "<<(m_path+builder.failed[i]).c_str()<<"\n";
+
+    m_files.swap(builder.files);
+    std::sort(m_files.begin(),m_files.end());
+    m_folders.insert(builder.folders.begin(),builder.folders.end());
+    m_indexed=true;
+    return true;
+}
+
+void file_resources_provider::do_refresh_index()
+{
+    if(!m_indexed)
+    {
+        do_build_index(0);
         return;
     }
 
-#ifdef _WIN32
-	for(intptr_t it=hdl;it>=0;it=_findnext(hdl,&data))
-	{
-		const char *name=data.name;
-#else
-    while(dirent *dp=readdir(dirp))
+    //folder modification time changes when entries are added, removed or renamed
+    index_builder builder(m_path,m_recursive,&m_folders);
+    std::set<std::string> changed;
+    for(std::map<std::string,unsigned long long>::const_iterator it=m_folders.begin();it!=m_folders.end();++it)
     {
-		const char *name=dp->d_name;
-#endif
-        if((name[0]=='.'&&name[1]=='\0')||(name[0]=='.'&&name[1]=='.'&&name[2]=='\0'))
+        struct stat sb;
+        const std::string path=m_path+(it->first.empty()?".":it->first);
+        if(stat(path.c_str(),&sb)==0 && S_ISDIR(sb.st_mode) && get_mtime(sb)==it->second)
             continue;
 
-#ifdef _WIN32
-        std::string name_str=folder_name_str+"/"+name;
-        std::string full_path_str=m_path+name_str;
+        changed.insert(it->first);
+        builder.add_folder(it->first);
+    }
 
-        struct stat stat_buf;
-        if(stat(full_path_str.c_str(),&stat_buf)<0)
-        {
-            nya_log::log()<<"unable to read "<<full_path_str.c_str()<<"\n";
+    if(!changed.empty())
+        builder.run(0);
+
+    size_t count=0;
+    for(size_t i=0;i<m_files.size();++i)
+    {
+        const size_t slash=m_files[i].name.rfind('/');
+        if(!changed.empty() && changed.find(slash==std::string::npos?std::string():m_files[i].name.substr(0,slash))!=changed.end())
             continue;
+
+        if(count!=i)
+            m_files[count]=m_files[i];
+
+        ++count;
+    }
+
+    m_files.resize(count);
+
+    //files rewritten in place keep their folder modification time
+    if(count)
+    {
+        std::vector<char> removed(count);
+        const size_t chunk_size=256;
+        std::vector<stat_task> tasks((count+chunk_size-1)/chunk_size);
+        for(size_t i=0;i<tasks.size();++i)
+        {
+            const size_t from=i*chunk_size,to=from+chunk_size<count?from+chunk_size:count;
+            tasks[i].provider=this;
+            tasks[i].from=&m_files[0]+from;
+            tasks[i].to=&m_files[0]+to;
+            tasks[i].removed=&removed[from];
         }
 
-        if((stat_buf.st_mode&S_IFDIR)==S_IFDIR && m_recursive)
-#else
-        if(dp->d_type==DT_DIR && m_recursive)
-#endif
+        nya_memory::thread_pool pool;
+        if(tasks.size()>1 && pool.start())
         {
-            enumerate_folder((folder_name_str+"/"+name).c_str());
-            continue;
+            for(size_t i=0;i<tasks.size();++i)
+            {
+                if(!pool.add_task(stat_task::run,&tasks[i]))
+                    stat_task::run(&tasks[i]);
+            }
+
+            pool.wait_idle();
+            pool.stop();
+        }
+        else
+        {
+            for(size_t i=0;i<tasks.size();++i)
+                stat_task::run(&tasks[i]);
+        }
+
+        size_t existing=0;
+        for(size_t i=0;i<count;++i)
+        {
+            if(removed[i])
+                continue;
+
+            if(existing!=i)
+                m_files[existing]=m_files[i];
+
+            ++existing;
         }
 
-        std::string entry_name;
-        if(!folder_name_str.empty() && folder_name_str != ".")
-            entry_name=folder_name_str+'/';
+        m_files.resize(existing);
+    }
+
+    m_files.insert(m_files.end(),builder.files.begin(),builder.files.end());
+    std::sort(m_files.begin(),m_files.end());
+
+    for(std::set<std::string>::const_iterator it=changed.begin();it!=changed.end();++it)
+        m_folders.erase(*it);
 
-        entry_name.append(name);
-        m_resource_names.push_back(entry_name);
+    m_folders.insert(builder.folders.begin(),builder.folders.end());
+}
+
+int file_resources_provider::find_entry(const char *name) const
+{
+    const unsigned int hash=get_name_hash(name);
+
+    size_t from=0,to=m_files.size();
+    while(from<to)
+    {
+        const size_t mid=(from+to)/2;
+        if(m_files[mid].hash<hash)
+            from=mid+1;
+        else
+            to=mid;
     }
-#ifdef _WIN32
-    _findclose(hdl);
+
+    for(size_t i=from;i<m_files.size() && m_files[i].hash==hash;++i)
+    {
+        if(is_name_equal(name,m_files[i].name.c_str()))
+            return (int)i;
+    }
+
+    return -1;
+}
+
+void file_resources_provider::update_entry(const std::string &name)
+{
+    const int idx=find_entry(name.c_str());
+
+    file_info info;
+    if(!stat_file(name.c_str(),info))
+    {
+        if(idx>=0)
+            m_files.erase(m_files.begin()+idx);
+
+        return;
+    }
+
+    if(idx>=0)
+    {
+        m_files[idx].size=info.size;
+        m_files[idx].mtime=info.mtime;
+        return;
+    }
+
+    index_entry e;
+    e.name=name;
+    e.hash=get_name_hash(name.c_str());
+    e.size=info.size;
+    e.mtime=info.mtime;
+    m_files.insert(std::lower_bound(m_files.begin(),m_files.end(),e),e);
+}
+
+bool file_resources_provider::enable_watch(bool enable)
+{
+    if(enable==is_watching())
+        return true;
+
+#ifdef __linux__
+    if(!enable)
+    {
+        close(m_watch_fd);
+        m_watch_fd=-1;
+        m_watch_folders.clear();
+        return true;
+    }
+
+    m_watch_fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+    if(m_watch_fd<0)
+    {
+        log()<<"unable to watch folder "<<m_path.c_str()<<": inotify init failed\n";
+        return false;
+    }
+
+    watch_folder("");
+    if(m_watch_folders.empty())
+    {
+        enable_watch(false);
+        return false;
+    }
+
+    return true;
 #else
+    if(enable)
+        log()<<"unable to watch folder "<<m_path.c_str()<<": not supported on this platform\n";
+
+    return !enable;
+#endif
+}
+
+void file_resources_provider::watch_folder(const std::string &folder_name)
+{
+#ifdef __linux__
+    const std::string path=m_path.empty()?(folder_name.empty()?".":folder_name):m_path+folder_name;
+    const int wd=inotify_add_watch(m_watch_fd,path.c_str(),IN_CLOSE_WRITE|IN_MOVED_TO|IN_MOVED_FROM|IN_CREATE|IN_DELETE|IN_ONLYDIR);
+    if(wd<0)
+    {
+        log()<<"unable to watch folder "<<path.c_str()<<"\n";
+        return;
+    }
+
+    m_watch_folders[wd]=folder_name;
+
+    if(!m_recursive)
+        return;
+
+    DIR *dirp=opendir(path.c_str());
+    if(!dirp)
+        return;
+
+    while(dirent *dp=readdir(dirp))
+    {
+        const char *name=dp->d_name;
+        if(dp->d_type!=DT_DIR || (name[0]=='.' && (!name[1] || (name[1]=='.' && !name[2]))))
+            continue;
+
+        watch_folder(folder_name.empty()?std::string(name):folder_name+"/"+name);
+    }
+
     closedir(dirp);
 #endif
 }
 
+bool file_resources_provider::get_changes(std::vector<std::string> &names)
+{
+    if(!is_watching())
+        return false;
+
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    const size_t prev_count=names.size();
+
+#ifdef __linux__
+    //events are aligned to the inotify_event size
+    union { inotify_event e; char data[4096]; } buf;
+    bool folders_changed=false;
+    for(;;)
+    {
+        const ssize_t size=read(m_watch_fd,buf.data,sizeof(buf));
+        if(size<=0)
+        {
+            if(size<0 && errno==EINTR)
+                continue;
+
+            break;
+        }
+
+        for(ssize_t offset=0;offset<size;)
+        {
+            const inotify_event *e=(const inotify_event *)(buf.data+offset);
+            offset+=sizeof(inotify_event)+e->len;
+
+            if(e->mask&IN_Q_OVERFLOW)
+            {
+                log()<<"file watch queue overflow at path "<<m_path.c_str()<<", some changes were lost\n";
+                continue;
+            }
+
+            std::map<int,std::string>::iterator it=m_watch_folders.find(e->wd);
+            if(it==m_watch_folders.end())
+                continue;
+
+            if(e->mask&IN_IGNORED)
+            {
+                m_watch_folders.erase(it);
+                continue;
+            }
+
+            if(!e->len || !e->name[0])
+                continue;
+
+            const std::string name=it->second.empty()?std::string(e->name):it->second+"/"+e->name;
+
+            if(e->mask&IN_ISDIR)
+            {
+                if(m_recursive && e->mask&(IN_CREATE|IN_MOVED_TO))
+                    watch_folder(name);
+
+                folders_changed=true;
+                continue;
+            }
+
+            if(!(e->mask&(IN_CLOSE_WRITE|IN_MOVED_TO|IN_DELETE|IN_MOVED_FROM)))
+                continue;
+
+            if(m_indexed)
+                update_entry(name);
+
+            if(std::find(names.begin()+prev_count,names.end(),name)==names.end())
+                names.push_back(name);
+        }
+    }
+
+    if(folders_changed && m_indexed)
+        do_refresh_index();
+#endif
+
+    return names.size()>prev_count;
+}
+
 int file_resources_provider::get_resources_count()
 {
-    if(m_resource_names.empty())
-        enumerate_folder(m_path.empty()?".":"");
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    if(!m_indexed)
+        do_build_index(0);
 
-    return (int)m_resource_names.size();
+    return (int)m_files.size();
 }
 
 const char *file_resources_provider::get_resource_name(int idx)
 {
-    if(idx<0 || idx>=get_resources_count())
+    nya_memory::mutex_scoped_lock lock(m_mutex);
+    if(!m_indexed)
+        do_build_index(0);
+
+    if(idx<0 || idx>=(int)m_files.size())
         return 0;
 
-    return m_resource_names[idx].c_str();
+    return m_files[idx].name.c_str();
 }
 
 bool file_resource::read_all(void*data)
@@ -265,6 +890,7 @@ bool file_resource::read_all(void*data)
         return false;
     }
 
+    nya_memory::mutex_scoped_lock lock(file_ref::get_mutex());
     FILE *file=m_file.access();
     if(!file)
     {
@@ -295,6 +921,7 @@ bool file_resource::read_chunk(void *data,size_t size,size_t offset)
         return false;
     }
 
+    nya_memory::mutex_scoped_lock lock(file_ref::get_mutex());
     FILE *file=m_file.access();
     if(!file)
     {
@@ -333,6 +960,7 @@ bool file_resource::open(const char*filename)
         return false;
 
     m_file.init(filename);
+    nya_memory::mutex_scoped_lock lock(file_ref::get_mutex());
     FILE *file=m_file.access();
     if(!file)
         return false;
@@ -349,7 +977,136 @@ void file_resource::release()
 {
     m_file.free();
 
+    nya_memory::mutex_scoped_lock lock(get_pools_mutex());
     file_resources.free(this);
 }
 
+bool mapped_file_resource::read_all(void*data)
+{
+    if(!data)
+    {
+        log()<<"unable to read file data: invalid data pointer\n";
+        return false;
+    }
+
+    if(m_size)
+        memcpy(data,m_data,m_size);
+
+    return true;
+}
+
+bool mapped_file_resource::read_chunk(void *data,size_t size,size_t offset)
+{
+    if(!data)
+    {
+        log()<<"unable to read file data chunk: invalid data pointer\n";
+        return false;
+    }
+
+    if(offset+size>m_size||!size)
+    {
+        log()<<"unable to read file data chunk: invalid size\n";
+        return false;
+    }
+
+    memcpy(data,(const char *)m_data+offset,size);
+    return true;
+}
+
+bool mapped_file_resource::open(const char*filename)
+{
+    unmap();
+
+    if(!filename)
+        return false;
+
+#ifdef _WIN32
+  #ifdef WINDOWS_METRO
+    return false;
+  #else
+    HANDLE file=CreateFileA(filename,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+    if(file==INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file,&size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    m_size=(size_t)size.QuadPart;
+    if(!m_size)
+    {
+        CloseHandle(file);
+        return true;
+    }
+
+    HANDLE mapping=CreateFileMappingA(file,0,PAGE_READONLY,0,0,0);
+    CloseHandle(file);
+    if(!mapping)
+    {
+        m_size=0;
+        return false;
+    }
+
+    m_data=MapViewOfFile(mapping,FILE_MAP_READ,0,0,m_size);
+    CloseHandle(mapping);
+  #endif
+#else
+    const int fd=::open(filename,O_RDONLY);
+    if(fd<0)
+        return false;
+
+    struct stat sb;
+    if(fstat(fd,&sb)!=0 || !S_ISREG(sb.st_mode))
+    {
+        close(fd);
+        return false;
+    }
+
+    m_size=(size_t)sb.st_size;
+    if(!m_size)
+    {
+        close(fd);
+        return true;
+    }
+
+    void *data=mmap(0,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    m_data=data==MAP_FAILED?0:data;
+#endif
+
+    if(!m_data)
+    {
+        m_size=0;
+        return false;
+    }
+
+    return true;
+}
+
+void mapped_file_resource::unmap()
+{
+    if(m_data)
+    {
+#ifdef _WIN32
+        UnmapViewOfFile(m_data);
+#else
+        munmap(m_data,m_size);
+#endif
+    }
+
+    m_data=0;
+    m_size=0;
+}
+
+void mapped_file_resource::release()
+{
+    unmap();
+
+    nya_memory::mutex_scoped_lock lock(get_pools_mutex());
+    mapped_file_resources.free(this);
+}
+
 }
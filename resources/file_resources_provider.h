@@ -3,35 +3,99 @@
 #pragma once
 
 #include "resources.h"
+#include "memory/mutex.h"
 #include <string>
 #include <vector>
+#include <map>
 
 namespace nya_resources
 {
 
+//thread safe, except that set_folder, enable_mmap and enable_watch are expected before loading starts
 class file_resources_provider: public resources_provider
 {
 public:
     resource_data *access(const char *resource_name);
     bool has(const char *resource_name);
+    bool prefetch(const char *resource_name); //posix_fadvise on linux and android, F_RDADVISE on apple
 
 public:
     bool set_folder(const char*,bool recursive=true,bool ignore_nonexistent=false);
 
+    //access memory-maps files, resource_data::get_mapped_data returns the mapped view
+    void enable_mmap(bool enable) { m_mmap=enable; }
+
+public:
+    //enumeration builds an index of files with their size and modification time,
+    //folders are read in parallel, threads_count 0 for hardware threads count minus one
+    //has, get_size and get_info answer from the index once it is built without accessing the file system,
+    //so they return a snapshot that is current only as of the last build_index, refresh_index or watched change,
+    //names returned by get_resource_name stay valid until the index changes
+    //refresh_index re-reads folders whose modification time changed and re-stats the other indexed files in parallel
+    bool build_index(unsigned int threads_count=0);
+    void refresh_index();
+    bool is_indexed() const { return m_indexed; }
+
+    struct file_info
+    {
+        size_t size;
+        unsigned long long mtime; //nanoseconds since epoch, precision depends on the platform
+
+        file_info(): size(0),mtime(0) {}
+    };
+
+    bool get_info(const char *resource_name,file_info &info);
+    size_t get_size(const char *resource_name); //0 if not found
+
+public:
+    //watches the folder for changed files, inotify-based, supported on linux and android only
+    bool enable_watch(bool enable);
+    bool is_watching() const { return m_watch_fd>=0; }
+
+    //appends names of files written, moved or removed since the last call, returns false if nothing changed
+    bool get_changes(std::vector<std::string> &names);
+
 public:
     int get_resources_count();
     const char *get_resource_name(int idx);
 
 public:
-    file_resources_provider(): m_recursive(true) {}
+    file_resources_provider(): m_recursive(true),m_mmap(false),m_indexed(false),m_watch_fd(-1) {}
+    ~file_resources_provider() { enable_watch(false); }
+
+private:
+    file_resources_provider(const file_resources_provider &);
+    void operator = (const file_resources_provider &);
 
 private:
-    void enumerate_folder(const char*folder_name);
+    struct index_entry: public file_info
+    {
+        std::string name;
+        unsigned int hash; //get_name_hash
+
+        bool operator < (const index_entry &other) const { return hash<other.hash || (hash==other.hash && name<other.name); }
+    };
+
+    class index_builder;
+    struct stat_task;
+
+    bool do_build_index(unsigned int threads_count); //under m_mutex
+    void do_refresh_index();
+    int find_entry(const char *name) const;
+    void update_entry(const std::string &name);
+    bool stat_file(const char *name,file_info &info) const;
+    void watch_folder(const std::string &folder_name);
 
 private:
     std::string m_path;
     bool m_recursive;
-    std::vector<std::string> m_resource_names;
+    bool m_mmap;
+    bool m_indexed;
+    std::vector<index_entry> m_files; //sorted
+    std::map<std::string,unsigned long long> m_folders; //indexed folders with modification time
+    int m_watch_fd;
+    std::map<int,std::string> m_watch_folders; //watch descriptor to folder name
+    nya_memory::mutex m_mutex; //index
 };
 
 }
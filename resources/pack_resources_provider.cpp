@@ -0,0 +1,254 @@
+//https://code.google.com/p/nya-engine/
+
+#include "pack_resources_provider.h"
+#include "memory/tmp_buffer.h"
+#include "memory/lz4.h"
+#include <string.h>
+
+namespace nya_resources
+{
+
+class pack_resources_provider::pack_resource: public resource_data
+{
+public:
+    size_t get_size() { return m_entry.unpacked_size; }
+
+    bool read_all(void *data)
+    {
+        if(!data)
+            return false;
+
+        if(!m_entry.unpacked_size)
+            return true;
+
+        if(m_entry.compression==compression_none)
+            return m_provider.read(data,m_entry.unpacked_size,get_offset());
+
+        if(m_unpacked.get_size())
+            return m_unpacked.copy_to(data,m_entry.unpacked_size);
+
+        return unpack(data);
+    }
+
+    bool read_chunk(void *data,size_t size,size_t offset)
+    {
+        if(!data || !size || offset+size>m_entry.unpacked_size)
+            return false;
+
+        if(m_entry.compression==compression_none)
+            return m_provider.read(data,size,get_offset()+offset);
+
+        //lz4 blocks can't be decoded from the middle, the entry is unpacked once and kept until release
+        if(!m_unpacked.get_size())
+        {
+            m_unpacked.allocate(m_entry.unpacked_size);
+            if(!unpack(m_unpacked.get_data()))
+            {
+                m_unpacked.free();
+                return false;
+            }
+        }
+
+        return m_unpacked.copy_to(data,size,offset);
+    }
+
+    const void *get_mapped_data()
+    {
+        if(m_entry.compression!=compression_none || !m_provider.m_mapped)
+            return 0;
+
+        return m_provider.m_mapped+get_offset();
+    }
+
+    void release() { m_unpacked.free(); delete this; }
+
+public:
+    pack_resource(pack_resources_provider &provider,const entry &e): m_provider(provider),m_entry(e) {}
+
+private:
+    size_t get_offset() const { return (size_t)m_entry.page*page_size; }
+
+    bool unpack(void *data)
+    {
+        if(m_provider.m_mapped)
+            return nya_memory::lz4::decompress(m_provider.m_mapped+get_offset(),m_entry.packed_size,data,m_entry.unpacked_size);
+
+        nya_memory::tmp_buffer_scoped buf(m_entry.packed_size);
+        if(!m_provider.read(buf.get_data(),m_entry.packed_size,get_offset()))
+            return false;
+
+        return nya_memory::lz4::decompress(buf.get_data(),m_entry.packed_size,data,m_entry.unpacked_size);
+    }
+
+private:
+    pack_resources_provider &m_provider;
+    entry m_entry;
+    nya_memory::tmp_buffer_ref m_unpacked;
+};
+
+unsigned int pack_resources_provider::get_name_hash(const char *name) { return nya_resources::get_name_hash(name); }
+
+bool pack_resources_provider::is_name_less(const entry &a,const char *a_name,const entry &b,const char *b_name)
+{
+    if(a.hash!=b.hash)
+        return a.hash<b.hash;
+
+    return strcmp(a_name,b_name)<0;
+}
+
+bool pack_resources_provider::open_archive(const char *archive_name)
+{
+    if(!archive_name)
+        return false;
+
+    resource_data *data=get_resources_provider().access(archive_name);
+    if(!data)
+    {
+        log()<<"unable to open pack "<<archive_name<<": unable to access resource\n";
+        return false;
+    }
+
+    return open_archive(data);
+}
+
+bool pack_resources_provider::open_archive(resource_data *data)
+{
+    close_archive();
+
+    if(!data)
+        return false;
+
+    m_res=data;
+    m_mapped=(const char *)data->get_mapped_data();
+
+    const size_t size=data->get_size();
+
+    header h;
+    if(!read(&h,sizeof(h),0) || memcmp(h.sign,"nyap",4)!=0)
+    {
+        log()<<"unable to open pack: invalid header\n";
+        close_archive();
+        return false;
+    }
+
+    if(h.version!=version)
+    {
+        log()<<"unable to open pack: unsupported version "<<h.version<<"\n";
+        close_archive();
+        return false;
+    }
+
+    const size_t toc_size=(size_t)h.entries_count*sizeof(entry);
+    if(toc_size/sizeof(entry)!=h.entries_count || sizeof(h)+toc_size+h.names_size>size
+       || (h.entries_count && (!h.names_size)))
+    {
+        log()<<"unable to open pack: invalid size\n";
+        close_archive();
+        return false;
+    }
+
+    m_entries.resize(h.entries_count);
+    m_names.resize(h.names_size);
+    if((toc_size && !read(&m_entries[0],toc_size,sizeof(h)))
+       || (h.names_size && !read(&m_names[0],h.names_size,sizeof(h)+toc_size)))
+    {
+        log()<<"unable to open pack: unable to read entries\n";
+        close_archive();
+        return false;
+    }
+
+    for(size_t i=0;i<m_entries.size();++i)
+    {
+        const entry &e=m_entries[i];
+        const bool valid_data=(e.compression==compression_none && e.packed_size==e.unpacked_size)
+                              || e.compression==compression_lz4;
+
+        if(!valid_data || e.name_offset>=h.names_size || m_names.back()!=0
+           || (size_t)e.page*page_size>size || e.packed_size>size-(size_t)e.page*page_size)
+        {
+            log()<<"unable to open pack: invalid entry "<<(unsigned int)i<<"\n";
+            close_archive();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void pack_resources_provider::close_archive()
+{
+    if(m_res)
+        m_res->release();
+
+    m_res=0;
+    m_mapped=0;
+    m_entries.clear();
+    m_names.clear();
+}
+
+bool pack_resources_provider::read(void *data,size_t size,size_t offset)
+{
+    if(!m_res)
+        return false;
+
+    if(!m_mapped)
+    {
+        nya_memory::mutex_scoped_lock lock(m_mutex);
+        return m_res->read_chunk(data,size,offset);
+    }
+
+    if(offset+size>m_res->get_size())
+        return false;
+
+    memcpy(data,m_mapped+offset,size);
+    return true;
+}
+
+int pack_resources_provider::find_entry(const char *name) const
+{
+    if(!name || m_entries.empty())
+        return -1;
+
+    const unsigned int hash=get_name_hash(name);
+
+    size_t from=0,to=m_entries.size();
+    while(from<to)
+    {
+        const size_t mid=(from+to)/2;
+        if(m_entries[mid].hash<hash)
+            from=mid+1;
+        else
+            to=mid;
+    }
+
+    for(size_t i=from;i<m_entries.size() && m_entries[i].hash==hash;++i)
+    {
+        if(is_name_equal(name,&m_names[m_entries[i].name_offset]))
+            return (int)i;
+    }
+
+    return -1;
+}
+
+resource_data *pack_resources_provider::access(const char *resource_name)
+{
+    const int idx=find_entry(resource_name);
+    if(idx<0)
+        return 0;
+
+    return new pack_resource(*this,m_entries[idx]);
+}
+
+bool pack_resources_provider::has(const char *resource_name) { return find_entry(resource_name)>=0; }
+
+int pack_resources_provider::get_resources_count() { return (int)m_entries.size(); }
+
+const char *pack_resources_provider::get_resource_name(int idx)
+{
+    if(idx<0 || idx>=(int)m_entries.size())
+        return 0;
+
+    return &m_names[m_entries[idx].name_offset];
+}
+
+}
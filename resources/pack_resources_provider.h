@@ -0,0 +1,86 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//nya pack archive, see tools/pack_builder.cpp
+//layout: header, entries sorted by name hash then name, names, entries data aligned to 4K pages
+//raw entries of a mapped archive are returned as mapped views without copying
+//thread safe while the archive is open, reads of an archive that isn't mapped are serialized
+//all values are little-endian
+
+#include "resources.h"
+#include "memory/mutex.h"
+#include <vector>
+
+namespace nya_resources
+{
+
+class pack_resources_provider: public resources_provider
+{
+public:
+    bool open_archive(const char *archive_name); //accessed through the current resources provider
+    bool open_archive(resource_data *data); //takes ownership
+    void close_archive();
+
+public:
+    resource_data *access(const char *resource_name);
+    bool has(const char *resource_name);
+
+public:
+    int get_resources_count();
+    const char *get_resource_name(int idx);
+
+public:
+    enum compression
+    {
+        compression_none=0,
+        compression_lz4=1
+    };
+
+    struct header
+    {
+        char sign[4]; //"nyap"
+        unsigned int version;
+        unsigned int entries_count;
+        unsigned int names_size;
+    };
+
+    struct entry
+    {
+        unsigned int hash; //get_name_hash
+        unsigned int name_offset; //in names, null-terminated
+        unsigned int page; //data offset in page_size units
+        unsigned int compression;
+        unsigned int packed_size;
+        unsigned int unpacked_size;
+    };
+
+    static const unsigned int version=1;
+    static const unsigned int page_size=4096;
+
+    static unsigned int get_name_hash(const char *name); //see nya_resources::get_name_hash
+    static bool is_name_less(const entry &a,const char *a_name,const entry &b,const char *b_name); //toc order
+
+public:
+    pack_resources_provider(): m_res(0),m_mapped(0) {}
+    ~pack_resources_provider() { close_archive(); }
+
+private:
+    pack_resources_provider(const pack_resources_provider &);
+    void operator = (const pack_resources_provider &);
+
+private:
+    class pack_resource;
+
+    int find_entry(const char *name) const;
+    bool read(void *data,size_t size,size_t offset);
+
+private:
+    resource_data *m_res;
+    const char *m_mapped;
+    std::vector<entry> m_entries;
+    std::vector<char> m_names;
+    nya_memory::mutex m_mutex; //m_res reads
+};
+
+}
@@ -4,6 +4,7 @@
 #include "file_resources_provider.h"
 //#include "system/system.h"
 #include <string.h>
+#include <ctype.h>
 
 #if defined(_WIN32)
     #define strcasecmp _stricmp
@@ -13,6 +14,39 @@ namespace
 {
     nya_resources::resources_provider *res_provider=0;
     nya_log::log_base *resources_log=0;
+
+    class name_iterator
+    {
+    public:
+        char next()
+        {
+            for(;;)
+            {
+                char c=*m_str;
+                if(!c)
+                    return 0;
+
+                ++m_str;
+                if(c=='\\')
+                    c='/';
+                else if(m_ignore_case)
+                    c=(char)tolower((unsigned char)c);
+
+                if(c=='/' && (m_prev=='/' || !m_prev))
+                    continue;
+
+                m_prev=c;
+                return c;
+            }
+        }
+
+        name_iterator(const char *str,bool ignore_case): m_str(str?str:""),m_prev(0),m_ignore_case(ignore_case) {}
+
+    private:
+        const char *m_str;
+        char m_prev;
+        bool m_ignore_case;
+    };
 }
 
 namespace nya_resources
@@ -64,4 +98,44 @@ bool check_extension(const char *name,const char *ext)
     return strcasecmp(name+name_len-ext_len,ext)==0;
 }
 
+std::string normalize_name(const char *name,bool ignore_case)
+{
+    std::string out;
+    name_iterator it(name,ignore_case);
+    for(char c=it.next();c;c=it.next())
+        out.push_back(c);
+
+    return out;
+}
+
+unsigned int get_name_hash(const char *name,bool ignore_case)
+{
+    unsigned int hash=2166136261u;
+    name_iterator it(name,ignore_case);
+    for(char c=it.next();c;c=it.next())
+    {
+        hash^=(unsigned char)c;
+        hash*=16777619u;
+    }
+
+    return hash;
+}
+
+bool is_name_equal(const char *name,const char *normalized_name,bool ignore_case)
+{
+    if(!normalized_name)
+        return false;
+
+    name_iterator it(name,ignore_case);
+    for(const char *n=normalized_name;;++n)
+    {
+        const char c=it.next();
+        if(c!=*n)
+            return false;
+
+        if(!c)
+            return true;
+    }
+}
+
 }
@@ -4,6 +4,7 @@
 
 #include "log/log.h"
 #include <cstddef>
+#include <string>
 
 namespace nya_resources
 {
@@ -17,16 +18,26 @@ public:
     virtual bool read_all(void*data) { return false; }
     virtual bool read_chunk(void *data,size_t size,size_t offset=0) { return false; }
 
+    //read-only pointer to the whole resource valid until release, 0 if the provider can't map it
+    virtual const void *get_mapped_data() { return 0; }
+
 public:
     virtual void release() {}
+    virtual ~resource_data() {}
 };
 
+//providers are called from async loader workers and must be thread safe,
+//each resource_data is used by one thread at a time
 class resources_provider
 {
 public:
     virtual resource_data *access(const char *resource_name) { return 0; }
     virtual bool has(const char *resource_name) { return false; }
 
+    //asks the os to read the resource into its page cache ahead of access, the provider keeps no copy
+    //false if the provider can't, callers don't read the resource themselves as a fallback
+    virtual bool prefetch(const char *resource_name) { return false; }
+
 public:
     virtual int get_resources_count() { return 0; }
     virtual const char *get_resource_name(int idx) { return 0; }
@@ -40,4 +51,9 @@ nya_log::log_base &log();
 
 bool check_extension(const char *name,const char *ext);
 
+//resource names are compared with '\\' treated as '/', leading slashes skipped and repeated ones collapsed
+std::string normalize_name(const char *name,bool ignore_case=false);
+unsigned int get_name_hash(const char *name,bool ignore_case=false); //hash of the normalized name, doesn't allocate
+bool is_name_equal(const char *name,const char *normalized_name,bool ignore_case=false); //doesn't allocate
+
 }
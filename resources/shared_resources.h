@@ -4,8 +4,10 @@
 
 #include "resources.h"
 #include "memory/pool.h"
+#include "memory/name_id.h"
 #include <map>
 #include <string>
+#include <vector>
 #include <algorithm>
 
 namespace nya_resources
@@ -13,9 +15,22 @@ namespace nya_resources
 
 template<typename t_res,int block_count> class shared_resources
 {
+public:
+    struct unused_cache_stats
+    {
+        unsigned int hits; //unused resources accessed again before eviction
+        unsigned int misses; //resources loaded with fill_resource
+        unsigned int evictions;
+        unsigned int count; //currently cached
+        size_t size; //currently cached, in bytes
+
+        unused_cache_stats(): hits(0),misses(0),evictions(0),count(0),size(0) {}
+    };
+
 private:
     virtual bool fill_resource(const char *name,t_res &res) { return false; }
     virtual bool release_resource(t_res &res) { return false; }
+    virtual size_t get_resource_size(const t_res &res) { return sizeof(t_res); } //for the unused cache budget
 
 private:
     class shared_resources_creator
@@ -149,6 +164,7 @@ private:
                 holder->map_it=ir.first;
 
                 ++m_ref_count;
+                ++m_unused_stats.misses;
 
                 return shared_resource_ref(&(holder->res),holder,this);
             }
@@ -157,8 +173,10 @@ private:
                 res_holder *holder=ir.first->second;
                 if(holder)
                 {
-                    ++holder->ref_count;
+                    if(holder->unused)
+                        ++m_unused_stats.hits;
 
+                    ref_holder(holder);
                     return shared_resource_ref(&(holder->res),holder,this);
                 }
             }
@@ -166,6 +184,31 @@ private:
             return shared_resource_ref();
         }
 
+        shared_resource_ref access(const nya_memory::name_id &name)
+        {
+            if(!name.is_valid() || !m_base)
+                return shared_resource_ref();
+
+            typename ids_map::iterator it=m_ids_map.find(name.get_id());
+            if(it!=m_ids_map.end())
+            {
+                if(it->second->unused)
+                    ++m_unused_stats.hits;
+
+                ref_holder(it->second);
+                return shared_resource_ref(&(it->second->res),it->second,this);
+            }
+
+            shared_resource_ref ref=access(name.get_name());
+            if(ref.m_res_holder && ref.m_res_holder->map_it!=m_res_map.end())
+            {
+                m_ids_map[name.get_id()]=ref.m_res_holder;
+                ref.m_res_holder->ids.push_back(name.get_id());
+            }
+
+            return ref;
+        }
+
         shared_resource_mutable_ref create()
         {
             res_holder *holder=m_res_pool.allocate();
@@ -202,6 +245,8 @@ private:
             if(!m_base)
                 return 0;
 
+            clear_unused_cache();
+
             int count=0;
 
             for(resources_map_iterator it=m_res_map.begin();
@@ -218,15 +263,40 @@ private:
             return count;
         }
 
+        bool has(const char *name) const
+        {
+            if(!name)
+                return false;
+
+            std::string name_str(name);
+            if(m_force_lowercase)
+                std::transform(name_str.begin(),name_str.end(),name_str.begin(),::tolower);
+
+            const_resources_map_iterator it=m_res_map.find(name_str);
+            return it!=m_res_map.end() && it->second;
+        }
+
         bool reload_resource(const char *name)
         {
             if(!name || !m_base)
                 return false;
 
-            resources_map_iterator it=m_res_map.find(name);
+            std::string name_str(name);
+            if(m_force_lowercase)
+                std::transform(name_str.begin(),name_str.end(),name_str.begin(),::tolower);
+
+            resources_map_iterator it=m_res_map.find(name_str);
             if(it==m_res_map.end() || !it->second)
                 return false;
 
+            //not used at the moment, will be loaded again on access
+            if(it->second->unused)
+            {
+                unlink_unused(it->second);
+                release_holder(it->second);
+                return true;
+            }
+
             m_base->release_resource(it->second->res);
             return m_base->fill_resource(it->first.c_str(),it->second->res);
         }
@@ -263,23 +333,37 @@ private:
             if(!m_should_unload_unused)
                 return;
 
+            if(m_unused_cache_size && m_base && ref.m_res_holder->map_it!=m_res_map.end())
+            {
+                cache_unused(ref.m_res_holder);
+                return;
+            }
+
+            release_holder(ref.m_res_holder);
+        }
+
+        //may delete the creator if the base was released
+        void release_holder(res_holder *holder)
+        {
             if(m_ref_count>0)
                 --m_ref_count;
             else
                 nya_log::log()<<"resource system failure\n";
 
-            if(ref.m_res && m_base)
-                m_base->release_resource(*ref.m_res);
+            if(m_base)
+                m_base->release_resource(holder->res);
+
+            forget_ids(holder);
 
-            if(ref.m_res_holder->map_it!=m_res_map.end())
+            if(holder->map_it!=m_res_map.end())
             {
                 if(!m_base)
-                    nya_log::log()<<"warning: unreleased resource "<<ref.m_res_holder->map_it->first.c_str()<<"\n";
+                    nya_log::log()<<"warning: unreleased resource "<<holder->map_it->first.c_str()<<"\n";
 
-                m_res_map.erase(ref.m_res_holder->map_it);
+                m_res_map.erase(holder->map_it);
             }
 
-            m_res_pool.free(ref.m_res_holder);
+            m_res_pool.free(holder);
 
             if(!m_ref_count)
             {
@@ -298,6 +382,78 @@ private:
             ++ref.m_res_holder->ref_count;
         }
 
+        void ref_holder(res_holder *holder)
+        {
+            if(holder->unused)
+                unlink_unused(holder);
+
+            ++holder->ref_count;
+        }
+
+        //unused named resources are kept in lru order until they don't fit the budget
+        void cache_unused(res_holder *holder)
+        {
+            holder->unused=true;
+            holder->unused_size=m_base->get_resource_size(holder->res);
+            holder->unused_prev=m_unused_last;
+            holder->unused_next=0;
+            if(m_unused_last)
+                m_unused_last->unused_next=holder;
+            else
+                m_unused_first=holder;
+
+            m_unused_last=holder;
+            ++m_unused_stats.count;
+            m_unused_stats.size+=holder->unused_size;
+
+            evict_unused(m_unused_cache_size);
+        }
+
+        void unlink_unused(res_holder *holder)
+        {
+            if(holder->unused_prev)
+                holder->unused_prev->unused_next=holder->unused_next;
+            else
+                m_unused_first=holder->unused_next;
+
+            if(holder->unused_next)
+                holder->unused_next->unused_prev=holder->unused_prev;
+            else
+                m_unused_last=holder->unused_prev;
+
+            holder->unused=false;
+            holder->unused_prev=holder->unused_next=0;
+            --m_unused_stats.count;
+            m_unused_stats.size-=holder->unused_size;
+        }
+
+        void evict_unused(size_t budget)
+        {
+            while(m_unused_first && m_unused_stats.size>budget)
+            {
+                res_holder *holder=m_unused_first;
+                unlink_unused(holder);
+                ++m_unused_stats.evictions;
+                release_holder(holder);
+            }
+        }
+
+        void set_unused_cache_size(size_t size)
+        {
+            m_unused_cache_size=size;
+            evict_unused(size);
+        }
+
+        void clear_unused_cache()
+        {
+            while(m_unused_first)
+            {
+                res_holder *holder=m_unused_first;
+                unlink_unused(holder);
+                release_holder(holder);
+            }
+        }
+
         void should_unload_unused(bool unload)
         {
             if(unload && unload!=m_should_unload_unused)
@@ -319,10 +475,14 @@ private:
                         continue;
                     }
 
-                    if(m_base)
-                        m_base->release_resource(it->second->res);
+                    res_holder *holder=it->second;
+                    ++it;
 
-                    m_res_pool.free(it->second);
+                    if(holder->unused)
+                        unlink_unused(holder);
+
+                    release_holder(holder);
+                    continue;
                 }
 
                 resources_map_iterator er = it;
@@ -347,7 +507,12 @@ private:
             }
 
             m_res_map.clear();
+            m_ids_map.clear();
             m_res_pool.clear();
+
+            m_unused_first=m_unused_last=0;
+            m_unused_stats.count=0;
+            m_unused_stats.size=0;
         }
 
         void base_released()
@@ -363,12 +528,22 @@ private:
 
         bool has_refs() { return m_ref_count>0; }
 
+        void forget_ids(res_holder *holder)
+        {
+            for(size_t i=0;i<holder->ids.size();++i)
+                m_ids_map.erase(holder->ids[i]);
+
+            holder->ids.clear();
+        }
+
     public:
         shared_resources_creator(shared_resources *base): m_base(base),m_should_unload_unused(true),
-                                                          m_force_lowercase(true), m_ref_count(1) {}
+                                                          m_force_lowercase(true), m_ref_count(1),
+                                                          m_unused_first(0),m_unused_last(0),m_unused_cache_size(0) {}
     private:
         typedef std::map<std::string,res_holder*> resources_map;
         typedef typename resources_map::iterator resources_map_iterator;
+        typedef typename resources_map::const_iterator const_resources_map_iterator;
 
     private:
         struct res_holder
@@ -376,18 +551,32 @@ private:
             t_res res;
             int ref_count;
             resources_map_iterator map_it;
+            std::vector<unsigned int> ids;
 
-            res_holder(): ref_count(0) {}
+            bool unused; //in the unused cache
+            size_t unused_size;
+            res_holder *unused_prev;
+            res_holder *unused_next;
+
+            res_holder(): ref_count(0),unused(false),unused_size(0),unused_prev(0),unused_next(0) {}
         };
 
         resources_map m_res_map;
-        nya_memory::pool<res_holder,block_count> m_res_pool;
+
+        typedef std::map<unsigned int,res_holder*> ids_map; //name_id to holder
+        ids_map m_ids_map;
+        nya_memory::dense_pool<res_holder,block_count> m_res_pool;
 
     private:
         shared_resources *m_base;
         bool m_should_unload_unused;
         bool m_force_lowercase;
         size_t m_ref_count;
+
+        res_holder *m_unused_first; //least recently used
+        res_holder *m_unused_last;
+        size_t m_unused_cache_size;
+        unused_cache_stats m_unused_stats;
     };
 
 public:
@@ -396,6 +585,7 @@ public:
 
 public:
     shared_resource_ref access(const char*name) { return m_creator->access(name); }
+    shared_resource_ref access(const nya_memory::name_id &name) { return m_creator->access(name); }
     shared_resource_mutable_ref create() { return m_creator->create(); }
     static shared_resource_mutable_ref modify(shared_resource_ref &res) { return shared_resources_creator::modify(res); }
 
@@ -407,8 +597,19 @@ public:
     void force_lowercase(bool force) { m_creator->m_force_lowercase=force; }
     void should_unload_unused(bool unload) { m_creator->should_unload_unused(unload); }
     bool reload_resource(const char *name) { return m_creator->reload_resource(name); }
+    bool has(const char *name) const { return m_creator->has(name); } //true if loaded
     int reload_resources() { return m_creator->reload_resources(); }
 
+public:
+    //keep up to size bytes of unused resources loaded, least recently used are released first
+    //0 to release unused resources immediately, has no effect if should_unload_unused is false
+    //cached resources can't be released from the base destructor, call clear_unused_cache before
+    void set_unused_cache_size(size_t size) { m_creator->set_unused_cache_size(size); }
+    size_t get_unused_cache_size() const { return m_creator->m_unused_cache_size; }
+    void clear_unused_cache() { m_creator->clear_unused_cache(); }
+    const unused_cache_stats &get_unused_cache_stats() const { return m_creator->m_unused_stats; }
+    void reset_unused_cache_stats() { m_creator->m_unused_stats.hits=m_creator->m_unused_stats.misses=m_creator->m_unused_stats.evictions=0; }
+
 public:
     shared_resource_ref get_first_resource()
     {
@@ -419,7 +620,7 @@ public:
         if(!holder)
             return shared_resource_ref();
 
-        ++holder->ref_count;
+        m_creator->ref_holder(holder);
         return shared_resource_ref(&(holder->res),holder,m_creator);
     }
 
@@ -436,7 +637,7 @@ public:
         if(!holder)
             return shared_resource_ref();
 
-        ++holder->ref_count;
+        m_creator->ref_holder(holder);
         return shared_resource_ref(&(holder->res),holder,m_creator);
     }
 
@@ -0,0 +1,429 @@
+//https://code.google.com/p/nya-engine/
+
+#include "async_loader.h"
+#include "shared_resources.h"
+#include "scene.h"
+#include "memory/thread_pool.h"
+#include "memory/mutex.h"
+#include "memory/tmp_buffer.h"
+#include <deque>
+#include <vector>
+#include <set>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/time.h>
+#endif
+
+namespace nya_scene
+{
+
+namespace
+{
+
+//scene doesn't depend on system, microseconds
+unsigned long long get_time_us()
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    static bool initialised=false;
+    if(!initialised)
+    {
+        QueryPerformanceFrequency(&freq);
+        initialised=true;
+    }
+
+    LARGE_INTEGER time;
+    QueryPerformanceCounter(&time);
+    return (unsigned long long)(time.QuadPart*1000000/freq.QuadPart);
+#else
+    timeval tim;
+    gettimeofday(&tim,0);
+    return (unsigned long long)tim.tv_sec*1000000+tim.tv_usec;
+#endif
+}
+
+//touches every page so that the main thread doesn't stall on page faults while parsing
+void prefault(const void *data,size_t size)
+{
+    const size_t page_size=4096;
+    const volatile char *c=(const volatile char *)data;
+    for(size_t i=0;i<size;i+=page_size)
+        (void)c[i];
+}
+
+struct loader_state
+{
+    nya_memory::mutex done_mutex;
+    std::deque<async_request *> done;
+    size_t pending; //main thread only
+
+    struct record
+    {
+        unsigned int time;
+        std::string name;
+    };
+
+    nya_memory::mutex record_mutex;
+    std::vector<record> records;
+    unsigned long long record_start;
+    bool recording;
+
+    nya_memory::mutex prefetch_mutex;
+    std::vector<std::string> prefetch_names;
+    size_t prefetch_next;
+    bool prefetch_stop;
+
+    //declared last to stop workers first
+    nya_memory::thread_pool pool;
+    nya_memory::thread_pool prefetch_pool;
+
+    loader_state(): pending(0),record_start(0),recording(false),prefetch_next(0),prefetch_stop(false) {}
+};
+
+loader_state &get_state()
+{
+    static loader_state state;
+    return state;
+}
+
+const size_t io_chunk_size=256*1024;
+
+//providers that serialize reads lock per chunk, so loads on other threads don't wait for the whole resource
+bool read_chunked(nya_resources::resource_data *res,void *data,size_t size)
+{
+    for(size_t offset=0;offset<size;offset+=io_chunk_size)
+    {
+        if(res->read_chunk((char *)data+offset,size-offset<io_chunk_size?size-offset:io_chunk_size,offset))
+            continue;
+
+        //providers without read_chunk
+        return !offset && res->read_all(data);
+    }
+
+    return true;
+}
+
+}
+
+bool async_loader::start(unsigned int threads_count)
+{
+    loader_state &s=get_state();
+    if(s.pool.is_started())
+        return true;
+
+    return s.pool.start(threads_count);
+}
+
+void async_loader::stop()
+{
+    stop_prefetch();
+    finish_all();
+    get_state().pool.stop();
+}
+
+bool async_loader::is_started() { return get_state().pool.is_started(); }
+
+void async_loader::read(void *data)
+{
+    async_request *r=(async_request *)data;
+    r->m_opened=r->m_data->open(r->get_name());
+    if(r->m_opened && r->m_data->is_mapped())
+        prefault(r->m_data->get_data(),r->m_data->get_size());
+
+    r->decode();
+
+    loader_state &s=get_state();
+    nya_memory::mutex_scoped_lock lock(s.done_mutex);
+    s.done.push_back(r);
+}
+
+bool async_loader::add(async_request *request)
+{
+    if(!request)
+        return false;
+
+    loader_state &s=get_state();
+    if(!s.pool.is_started())
+    {
+        log()<<"unable to add async request "<<request->get_name()<<": async loader is not started\n";
+        delete request;
+        return false;
+    }
+
+    request->m_data=new resource_data();
+    ++s.pending;
+    s.pool.add_task(read,request);
+    return true;
+}
+
+void async_loader::update(unsigned int budget_ms)
+{
+    loader_state &s=get_state();
+    const unsigned long long start=get_time_us();
+
+    for(;;)
+    {
+        async_request *r;
+        {
+            nya_memory::mutex_scoped_lock lock(s.done_mutex);
+            if(s.done.empty())
+                break;
+
+            r=s.done.front();
+            s.done.pop_front();
+        }
+
+        --s.pending;
+        if(!r->is_canceled())
+            r->finish();
+
+        delete r->m_data;
+        delete r;
+
+        if(budget_ms && get_time_us()-start>=budget_ms*1000ull)
+            break;
+    }
+}
+
+void async_loader::finish_all()
+{
+    loader_state &s=get_state();
+
+    //finish may add new requests
+    while(s.pending)
+    {
+        s.pool.wait_idle();
+        update(0);
+    }
+}
+
+size_t async_loader::get_pending_count() { return get_state().pending; }
+
+void async_loader::start_recording()
+{
+    loader_state &s=get_state();
+    nya_memory::mutex_scoped_lock lock(s.record_mutex);
+    s.records.clear();
+    s.record_start=get_time_us();
+    s.recording=true;
+}
+
+bool async_loader::stop_recording(const char *manifest_file_name)
+{
+    loader_state &s=get_state();
+    std::vector<loader_state::record> records;
+    {
+        nya_memory::mutex_scoped_lock lock(s.record_mutex);
+        if(!s.recording)
+            return false;
+
+        s.recording=false;
+        records.swap(s.records);
+    }
+
+    if(!manifest_file_name)
+        return true;
+
+    FILE *f=fopen(manifest_file_name,"wb");
+    if(!f)
+    {
+        log()<<"unable to write manifest "<<manifest_file_name<<"\n";
+        return false;
+    }
+
+    bool result=true;
+    for(size_t i=0;i<records.size() && result;++i)
+        result=fprintf(f,"%u %s\n",records[i].time,records[i].name.c_str())>0;
+
+    fclose(f);
+    if(!result)
+        log()<<"unable to write manifest "<<manifest_file_name<<"\n";
+
+    return result;
+}
+
+bool async_loader::is_recording()
+{
+    loader_state &s=get_state();
+    nya_memory::mutex_scoped_lock lock(s.record_mutex);
+    return s.recording;
+}
+
+void async_loader::record_access(const char *name)
+{
+    if(!name || !name[0])
+        return;
+
+    loader_state &s=get_state();
+    nya_memory::mutex_scoped_lock lock(s.record_mutex);
+    if(!s.recording)
+        return;
+
+    s.records.resize(s.records.size()+1);
+    s.records.back().time=(unsigned int)((get_time_us()-s.record_start)/1000);
+    s.records.back().name.assign(name);
+}
+
+bool async_loader::prefetch(const char *manifest_file_name)
+{
+    stop_prefetch();
+
+    if(!manifest_file_name)
+        return false;
+
+    FILE *f=fopen(manifest_file_name,"rb");
+    if(!f)
+    {
+        log()<<"unable to prefetch: unable to open manifest "<<manifest_file_name<<"\n";
+        return false;
+    }
+
+    std::vector<std::string> names;
+    std::set<std::string> unique_names;
+    std::string line;
+    for(int c=fgetc(f);;c=fgetc(f))
+    {
+        if(c!='\n' && c!='\r' && c!=EOF)
+        {
+            line.push_back((char)c);
+            continue;
+        }
+
+        const size_t name_from=line.find(' ');
+        if(name_from!=std::string::npos && name_from+1<line.size())
+        {
+            const std::string name=line.substr(name_from+1);
+            if(unique_names.insert(name).second)
+                names.push_back(name);
+        }
+
+        line.clear();
+        if(c==EOF)
+            break;
+    }
+
+    fclose(f);
+
+    if(names.empty())
+        return true;
+
+    loader_state &s=get_state();
+    {
+        nya_memory::mutex_scoped_lock lock(s.prefetch_mutex);
+        s.prefetch_names.swap(names);
+        s.prefetch_next=0;
+        s.prefetch_stop=false;
+    }
+
+    if(!s.prefetch_pool.start(1))
+        return false;
+
+    return s.prefetch_pool.add_task(prefetch_task,0);
+}
+
+void async_loader::prefetch_task(void *data)
+{
+    loader_state &s=get_state();
+    for(;;)
+    {
+        std::string name;
+        {
+            nya_memory::mutex_scoped_lock lock(s.prefetch_mutex);
+            if(s.prefetch_stop || s.prefetch_next>=s.prefetch_names.size())
+                return;
+
+            name=s.prefetch_names[s.prefetch_next++];
+        }
+
+        //reading resources that aren't mapped would throw the data away, e.g. unpacked pack entries,
+        //so they are left to providers that can warm the page cache without keeping a copy
+        nya_resources::resources_provider &provider=nya_resources::get_resources_provider();
+        if(provider.prefetch(name.c_str()))
+            continue;
+
+        nya_resources::resource_data *res=provider.access(name.c_str());
+        if(!res)
+            continue;
+
+        const void *mapped=res->get_mapped_data();
+        if(mapped)
+            prefault(mapped,res->get_size());
+
+        res->release();
+    }
+}
+
+void async_loader::stop_prefetch()
+{
+    loader_state &s=get_state();
+    {
+        nya_memory::mutex_scoped_lock lock(s.prefetch_mutex);
+        s.prefetch_stop=true;
+    }
+
+    s.prefetch_pool.stop();
+}
+
+bool async_loader::is_prefetching()
+{
+    loader_state &s=get_state();
+    nya_memory::mutex_scoped_lock lock(s.prefetch_mutex);
+    return !s.prefetch_stop && s.prefetch_next<s.prefetch_names.size();
+}
+
+bool resource_data::open(const char *name,bool deferred)
+{
+    free();
+    if(!name)
+        return false;
+
+    m_res=nya_resources::get_resources_provider().access(name);
+    if(!m_res)
+        return false;
+
+    m_mapped=m_res->get_mapped_data();
+    m_size=m_res->get_size();
+
+    if(!m_mapped && !deferred && !read_deferred())
+        return false;
+
+    async_loader::record_access(name);
+    return true;
+}
+
+bool resource_data::read_deferred() const
+{
+    m_buf.allocate(m_size);
+    const bool result=read_chunked(m_res,m_buf.get_data(),m_size);
+    if(!result)
+    {
+        nya_resources::log()<<"unable to read resource data\n";
+        m_buf.free();
+    }
+
+    m_res->release();
+    m_res=0;
+    m_size=0;
+    return result;
+}
+
+bool resource_data::read_chunk(void *data,size_t size,size_t offset) const
+{
+    if(!data || offset>get_size() || size>get_size()-offset)
+        return false;
+
+    if(!size)
+        return true;
+
+    if(is_deferred())
+        return m_res->read_chunk(data,size,offset);
+
+    memcpy(data,get_data(offset),size);
+    return true;
+}
+
+}
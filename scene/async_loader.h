@@ -0,0 +1,86 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//background loading of scene resources, see scene_shared::load_async
+//worker threads access the resources provider, read resource data and run decode functions,
+//load functions parse it and create render objects in update on the main thread
+//resources providers are thread safe, see nya_resources::resources_provider
+//
+//a session may be recorded into a manifest of accessed resources, prefetch replays it on
+//a background thread in recorded order, warming the os page cache ahead of the actual loads:
+//through resources_provider::prefetch where supported, otherwise by touching mapped resources,
+//nothing is kept in provider caches; manifest is a text file of "time_ms name" lines
+
+#include <string>
+
+namespace nya_scene
+{
+
+class resource_data;
+
+class async_request
+{
+public:
+    const char *get_name() const { return m_name.c_str(); }
+    resource_data *get_data() const { return m_opened?m_data:0; } //0 if resource wasn't accessed
+
+    void cancel() { m_canceled=true; } //main thread only, finish will not be called
+    bool is_canceled() const { return m_canceled; }
+
+public:
+    virtual void decode() {} //called on the worker thread after the data is read
+    virtual void finish()=0; //called from async_loader::update on the main thread
+
+public:
+    async_request(const char *name): m_name(name?name:""),m_data(0),m_opened(false),m_canceled(false) {}
+    virtual ~async_request() {}
+
+private:
+    async_request(const async_request &);
+    void operator = (const async_request &);
+
+private:
+    friend class async_loader;
+
+    std::string m_name;
+    resource_data *m_data;
+    bool m_opened;
+    bool m_canceled;
+};
+
+class async_loader
+{
+public:
+    static bool start(unsigned int threads_count=0); //0 for hardware threads count minus one
+    static void stop(); //waits for workers, pending requests are finished
+    static bool is_started();
+
+    //takes ownership, returns false and deletes the request if the loader isn't started
+    static bool add(async_request *request);
+
+    //finishes read requests until budget_ms is spent, at least one per call; 0 for no limit
+    //call once per frame from the main thread
+    static void update(unsigned int budget_ms);
+    static void finish_all(); //waits for workers and finishes all requests
+
+    static size_t get_pending_count(); //requests added and not yet finished
+
+public:
+    static void start_recording(); //records resources opened with resource_data::open(name)
+    static bool stop_recording(const char *manifest_file_name); //writes the manifest, 0 to discard
+    static bool is_recording();
+
+    static bool prefetch(const char *manifest_file_name); //stops the previous prefetch
+    static void stop_prefetch(); //waits for the resource being read
+    static bool is_prefetching();
+
+public:
+    static void record_access(const char *name);
+
+private:
+    static void read(void *request);
+    static void prefetch_task(void *data);
+};
+
+}
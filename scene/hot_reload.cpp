@@ -0,0 +1,157 @@
+//https://code.google.com/p/nya-engine/
+
+#include "hot_reload.h"
+#include "resources/file_resources_provider.h"
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+namespace nya_scene
+{
+
+namespace
+{
+
+typedef std::pair<hot_reload::reload_function,std::string> resource_key;
+typedef std::vector<resource_key> resources_list;
+
+struct hot_reload_state
+{
+    std::vector<nya_resources::file_resources_provider *> providers;
+    std::vector<hot_reload::reload_function> types;
+    std::map<std::string,resources_list> dependents; //normalized file name to resources loaded from it
+    resources_list loading; //nested loads
+    std::deque<resource_key> pending;
+};
+
+hot_reload_state &get_state()
+{
+    static hot_reload_state state;
+    return state;
+}
+
+void add_pending(hot_reload_state &s,const resource_key &key)
+{
+    if(std::find(s.pending.begin(),s.pending.end(),key)==s.pending.end())
+        s.pending.push_back(key);
+}
+
+}
+
+bool hot_reload::watch(nya_resources::file_resources_provider &provider)
+{
+    hot_reload_state &s=get_state();
+    if(std::find(s.providers.begin(),s.providers.end(),&provider)!=s.providers.end())
+        return true;
+
+    if(!provider.enable_watch(true))
+        return false;
+
+    s.providers.push_back(&provider);
+    return true;
+}
+
+void hot_reload::unwatch(nya_resources::file_resources_provider &provider)
+{
+    hot_reload_state &s=get_state();
+    std::vector<nya_resources::file_resources_provider *>::iterator it=std::find(s.providers.begin(),s.providers.end(),&provider);
+    if(it==s.providers.end())
+        return;
+
+    provider.enable_watch(false);
+    s.providers.erase(it);
+}
+
+void hot_reload::unwatch_all()
+{
+    hot_reload_state &s=get_state();
+    for(size_t i=0;i<s.providers.size();++i)
+        s.providers[i]->enable_watch(false);
+
+    s.providers.clear();
+    s.pending.clear();
+}
+
+int hot_reload::update(int max_count)
+{
+    hot_reload_state &s=get_state();
+
+    std::vector<std::string> changed;
+    for(size_t i=0;i<s.providers.size();++i)
+    {
+        const size_t from=changed.size();
+        s.providers[i]->get_changes(changed);
+
+        //removed files would reload resources blank, they are reloaded when written again
+        size_t count=from;
+        for(size_t j=from;j<changed.size();++j)
+        {
+            if(!s.providers[i]->has(changed[j].c_str()))
+                continue;
+
+            if(count!=j)
+                changed[count]=changed[j];
+
+            ++count;
+        }
+
+        changed.resize(count);
+    }
+
+    for(size_t i=0;i<changed.size();++i)
+    {
+        //resources loaded from the file itself, unloaded ones are skipped on reload
+        for(size_t j=0;j<s.types.size();++j)
+            add_pending(s,resource_key(s.types[j],changed[i]));
+
+        std::map<std::string,resources_list>::const_iterator it=s.dependents.find(nya_resources::normalize_name(changed[i].c_str()));
+        if(it==s.dependents.end())
+            continue;
+
+        for(size_t j=0;j<it->second.size();++j)
+            add_pending(s,it->second[j]);
+    }
+
+    int count=0;
+    while(!s.pending.empty() && (max_count<=0 || count<max_count))
+    {
+        const resource_key key=s.pending.front();
+        s.pending.pop_front();
+        if(key.first(key.second.c_str()))
+            ++count;
+    }
+
+    return count;
+}
+
+size_t hot_reload::get_pending_count() { return get_state().pending.size(); }
+
+void hot_reload::begin_load(reload_function reload,const char *name)
+{
+    hot_reload_state &s=get_state();
+    if(reload && std::find(s.types.begin(),s.types.end(),reload)==s.types.end())
+        s.types.push_back(reload);
+
+    s.loading.push_back(resource_key(reload,name?name:""));
+}
+
+void hot_reload::end_load()
+{
+    hot_reload_state &s=get_state();
+    if(!s.loading.empty())
+        s.loading.pop_back();
+}
+
+void hot_reload::add_dependency(const char *file_name)
+{
+    hot_reload_state &s=get_state();
+    if(!file_name || s.loading.empty() || !s.loading.back().first)
+        return;
+
+    resources_list &list=s.dependents[nya_resources::normalize_name(file_name)];
+    if(std::find(list.begin(),list.end(),s.loading.back())==list.end())
+        list.push_back(s.loading.back());
+}
+
+}
@@ -0,0 +1,42 @@
+//https://code.google.com/p/nya-engine/
+
+#pragma once
+
+//reloads scene resources whose files were changed, see file_resources_provider::enable_watch
+//resources are reloaded in place, so everything referencing a texture, mesh, shader or material
+//picks up the new data; a shader is also reloaded when one of its @include files changes
+//and materials rebuild their parameter maps after a shader reload; material copies, such as the ones
+//meshes hold, are copied again from a reloaded material file; removed files are skipped
+//names reported by watched providers are expected to match the names resources were loaded with
+
+#include <string>
+
+namespace nya_resources { class file_resources_provider; }
+
+namespace nya_scene
+{
+
+class hot_reload
+{
+public:
+    static bool watch(nya_resources::file_resources_provider &provider); //enables the provider's watch
+    static void unwatch(nya_resources::file_resources_provider &provider);
+    static void unwatch_all();
+
+    //collects changes and reloads up to max_count changed resources, 0 for no limit
+    //call once per frame from the main thread, returns the number of reloaded resources
+    static int update(int max_count=1);
+    static size_t get_pending_count();
+
+public:
+    typedef bool (*reload_function)(const char *name); //returns false if the resource isn't loaded
+
+    //called from scene_shared, dependencies added between begin and end belong to the resource
+    static void begin_load(reload_function reload,const char *name);
+    static void end_load();
+
+    //reloads the resource being loaded when the file changes
+    static void add_dependency(const char *file_name);
+};
+
+}
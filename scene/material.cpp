@@ -216,10 +216,22 @@ void material_internal::set(const char *pass_name) const
     if(!pass_name)
         return;
 
+    update_shared();
+    set_pass(get_pass_idx(pass_name));
+}
+
+void material_internal::set(const nya_memory::name_id &pass_name) const
+{
+    update_shared();
+    set_pass(get_pass_idx(pass_name));
+}
+
+void material_internal::set_pass(int idx) const
+{
     if(m_last_set_pass_idx>=0)
         unset();
 
-    m_last_set_pass_idx=get_pass_idx(pass_name);
+    m_last_set_pass_idx=idx;
     if(m_last_set_pass_idx<0)
         return;
 
@@ -319,6 +331,7 @@ int material_internal::get_texture_idx(const char *semantics) const
 material_internal::pass &material_internal::pass::operator=(const pass &p)
 {
     m_name=p.m_name;
+    m_name_id=p.m_name_id;
     m_render_state=p.m_render_state;
     m_shader=p.m_shader;
     m_pass_params=p.m_pass_params;
@@ -359,7 +372,7 @@ void material_internal::pass::set_pass_param(const char *name,const param &value
     update_pass_params();
 }
 
-void material_internal::pass::update_pass_params()
+void material_internal::pass::update_pass_params() const
 {
     for(int i=0;i<(int)m_pass_params.size();++i)
     {
@@ -420,14 +433,14 @@ int material_internal::add_pass(const char *pass_name)
     if(!pass_name)
         return -1;
 
-    for(std::vector<pass>::iterator iter=m_passes.begin();iter!=m_passes.end();++iter)
-    {
-        if(iter->m_name==pass_name)
-            return (int)(iter - m_passes.begin());
-    }
+    const nya_memory::name_id id(pass_name);
+    const int idx=get_pass_idx(id);
+    if(idx>=0)
+        return idx;
 
     m_passes.push_back(pass());
     m_passes.back().m_name.assign(pass_name);
+    m_passes.back().m_name_id=id;
     return (int)m_passes.size()-1;
 }
 
@@ -437,7 +450,19 @@ int material_internal::get_pass_idx(const char *pass_name) const
         return -1;
 
     for(int i=0;i<(int)m_passes.size();++i)
-        if(m_passes[i].m_name == pass_name)
+        if(m_passes[i].m_name==pass_name)
+            return i;
+
+    return -1;
+}
+
+int material_internal::get_pass_idx(const nya_memory::name_id &pass_name) const
+{
+    if(!pass_name.is_valid())
+        return -1;
+
+    for(int i=0;i<(int)m_passes.size();++i)
+        if(m_passes[i].m_name_id==pass_name)
             return i;
 
     return -1;
@@ -461,6 +486,16 @@ const material_internal::pass &material_internal::get_pass(int idx) const
 
 void material_internal::update_passes_maps() const
 {
+    if(m_shader_reloads!=shader_internal::get_reloads_count())
+    {
+        m_shader_reloads=shader_internal::get_reloads_count();
+        for(std::vector<pass>::const_iterator it=m_passes.begin();it!=m_passes.end();++it)
+        {
+            it->m_shader_changed=true;
+            it->update_pass_params();
+        }
+    }
+
     if(!m_should_rebuild_passes_maps)
     {
         for(std::vector<pass>::const_iterator it=m_passes.begin();it!=m_passes.end();++it)
@@ -579,10 +614,42 @@ bool material_internal::release()
     m_name.clear();
     m_should_rebuild_passes_maps = false;
     m_last_set_pass_idx = -1;
+    ++m_releases;
 
     return true;
 }
 
+void material_internal::copy_shared() const
+{
+    m_last_set_pass_idx= -1;
+    m_should_rebuild_passes_maps=true;
+
+    m_name=m_shared->m_name;
+    m_passes=m_shared->m_passes;
+    m_params=m_shared->m_params;
+    m_textures=m_shared->m_textures;
+
+    m_shared_releases=m_shared->m_releases;
+    m_reloads=get_reloads_count();
+}
+
+//materials, including ones held by meshes, are copies of the shared one,
+//they are copied again when the material file is reloaded and changes made to them are lost
+void material_internal::update_shared() const
+{
+    if(m_reloads==get_reloads_count())
+        return;
+
+    m_reloads=get_reloads_count();
+    if(!m_shared.is_valid() || m_shared->m_releases==m_shared_releases)
+        return;
+
+    if(m_last_set_pass_idx>=0)
+        unset();
+
+    copy_shared();
+}
+
 bool material::load(const char *name)
 {
     if(!m_internal.load(name))
@@ -591,14 +658,7 @@ bool material::load(const char *name)
     if(!internal().m_shared.is_valid())
         return false;
 
-    m_internal.m_last_set_pass_idx= -1;
-    m_internal.m_should_rebuild_passes_maps=true;
-
-    m_internal.m_name=m_internal.m_shared->m_name;
-    m_internal.m_passes=m_internal.m_shared->m_passes;
-    m_internal.m_params=m_internal.m_shared->m_params;
-    m_internal.m_textures=m_internal.m_shared->m_textures;
-
+    m_internal.copy_shared();
     return true;
 }
 
@@ -6,6 +6,7 @@
 #include "scene.h"
 #include "shader.h"
 #include "texture.h"
+#include "memory/name_id.h"
 
 namespace nya_scene
 {
@@ -20,13 +21,15 @@ public:
 
 public:
     void set(const char *pass_name=default_pass) const;
+    void set(const nya_memory::name_id &pass_name) const;
     void unset() const;
     void skeleton_changed(const nya_render::skeleton *skeleton) const;
     int get_param_idx(const char *name) const;
     int get_texture_idx(const char *semantics) const;
     bool release();
 
-    material_internal(): m_last_set_pass_idx(-1),m_should_rebuild_passes_maps(false) {}
+    material_internal(): m_last_set_pass_idx(-1),m_should_rebuild_passes_maps(false),m_shader_reloads(0),
+                         m_releases(0),m_shared_releases(0),m_reloads(0) {}
 
 private:
     friend class material;
@@ -101,9 +104,10 @@ private:
         friend class material_internal;
         friend class material;
         void update_maps(const material_internal &m) const;
-        void update_pass_params();
+        void update_pass_params() const;
 
         std::string m_name;
+        nya_memory::name_id m_name_id;
         nya_render::state m_render_state;
         shader m_shader;
         mutable bool m_shader_changed;
@@ -119,22 +123,30 @@ private:
             pass_param(): uniform_idx(-1) {}
         };
 
-        std::vector<pass_param> m_pass_params;
+        mutable std::vector<pass_param> m_pass_params;
     };
 
     int add_pass(const char *pass_name);
     int get_pass_idx(const char *pass_name) const;
+    int get_pass_idx(const nya_memory::name_id &pass_name) const;
     pass &get_pass(int idx);
     const pass &get_pass(int idx) const;
     void update_passes_maps() const;
+    void set_pass(int idx) const;
+    void copy_shared() const;
+    void update_shared() const;
 
 private:
-    std::string m_name;
-    std::vector<pass> m_passes;
+    mutable std::string m_name;
+    mutable std::vector<pass> m_passes;
     mutable int m_last_set_pass_idx;
     mutable bool m_should_rebuild_passes_maps;
+    mutable unsigned int m_shader_reloads; //shaders are reloaded in place, uniforms may change
     mutable std::vector<param_holder> m_params;
     mutable std::vector<material_texture> m_textures;
+    unsigned int m_releases; //shared materials are released before reload
+    mutable unsigned int m_shared_releases; //copied from the shared material, it is copied again if reloaded
+    mutable unsigned int m_reloads;
 };
 
 class material
@@ -154,13 +166,17 @@ public:
 
     const char *get_name() const { return internal().m_name.c_str(); }
     void set_name(const char*name) { m_internal.m_name.assign(name?name:""); }
+    void set_name(const char*name,size_t size) { m_internal.m_name.assign(name?name:"",name?size:0); }
 
     int add_pass(const char *pass_name) { return m_internal.add_pass(pass_name); } //returns existing if already present
     int get_passes_count() const {return (int)m_internal.m_passes.size();}
     int get_pass_idx(const char *pass_name) const { return m_internal.get_pass_idx(pass_name); }
+    int get_pass_idx(const nya_memory::name_id &pass_name) const { return m_internal.get_pass_idx(pass_name); }
     const char *get_pass_name(int idx) const { return m_internal.m_passes[idx].m_name.c_str(); }
     pass &get_pass(const char *pass_name) { return m_internal.get_pass(m_internal.get_pass_idx(pass_name)); }
     const pass &get_pass(const char *pass_name) const { return m_internal.get_pass(m_internal.get_pass_idx(pass_name)); }
+    pass &get_pass(const nya_memory::name_id &pass_name) { return m_internal.get_pass(m_internal.get_pass_idx(pass_name)); }
+    const pass &get_pass(const nya_memory::name_id &pass_name) const { return m_internal.get_pass(m_internal.get_pass_idx(pass_name)); }
     pass &get_pass(int idx) { return m_internal.get_pass(idx); }
     const pass &get_pass(int idx) const { return m_internal.get_pass(idx); }
     pass &get_default_pass() { return get_pass(add_pass(default_pass)); } //adds the default pass if it is not present
@@ -299,7 +299,7 @@ int mesh_internal::get_mat_idx(int group_idx) const
     return (int)g.material_idx;
 }
 
-void mesh_internal::draw_group(int idx, const char *pass_name) const
+void mesh_internal::draw_group(int idx,const nya_memory::name_id &pass_name) const
 {
     if(!m_shared.is_valid())
         return;
@@ -329,6 +329,14 @@ void mesh::draw(const char *pass_name) const
     if(!pass_name)
         return;
 
+    draw(nya_memory::name_id::lookup(pass_name));
+}
+
+void mesh::draw(const nya_memory::name_id &pass_name) const
+{
+    if(!pass_name.is_valid())
+        return;
+
     if(internal().m_has_aabb && frustum_cull_enabled && !get_camera().get_frustum().test_intersect(get_aabb()))
         return;
 
@@ -341,6 +349,14 @@ void mesh::draw_group(int idx,const char *pass_name) const
     if(!pass_name)
         return;
 
+    draw_group(idx,nya_memory::name_id::lookup(pass_name));
+}
+
+void mesh::draw_group(int idx,const nya_memory::name_id &pass_name) const
+{
+    if(!pass_name.is_valid())
+        return;
+
     int mat_idx=internal().get_mat_idx(idx);
     if(mat_idx<0)
         return;
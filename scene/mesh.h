@@ -66,6 +66,8 @@ struct shared_mesh
 
 typedef proxy<animation> animation_proxy;
 
+inline size_t get_shared_resource_size(const shared_mesh &res) { return sizeof(res)+res.vbo.get_vmem_size(); }
+
 class mesh_internal: public scene_shared<shared_mesh>
 {
     friend class mesh;
@@ -77,7 +79,7 @@ public:
 private:
     mesh_internal(): m_recalc_aabb(true), m_has_aabb(false) {}
 
-    void draw_group(int idx, const char *pass_name) const;
+    void draw_group(int idx,const nya_memory::name_id &pass_name) const;
     bool init_from_shared();
 
     int get_materials_count() const;
@@ -160,6 +162,8 @@ public:
     void update(unsigned int dt);
     void draw(const char *pass_name=material::default_pass) const;
     void draw_group(int group_idx,const char *pass_name=material::default_pass) const;
+    void draw(const nya_memory::name_id &pass_name) const;
+    void draw_group(int group_idx,const nya_memory::name_id &pass_name) const;
 
     const nya_math::aabb &get_aabb() const;
 
@@ -211,6 +215,7 @@ public:
 public:
     static void set_resources_prefix(const char *prefix) { mesh_internal::set_resources_prefix(prefix); }
     static void register_load_function(mesh_internal::load_function function,bool clear_default=true) { mesh_internal::register_load_function(function,clear_default); }
+    static void set_unused_cache_size(size_t size) { mesh_internal::set_unused_cache_size(size); }
 public:
     static void set_frustum_cull(bool enable);
 
@@ -5,6 +5,7 @@
 #include "formats/string_convert.h"
 #include "formats/math_expr_parser.h"
 #include "memory/invalid_object.h"
+#include "memory/frame_arena.h"
 #include "scene.h"
 #include <string.h>
 
@@ -39,7 +40,8 @@ void postprocess::draw(int dt)
     nya_render::rect prev_rect=nya_render::get_viewport();
 
     nya_render::state state;
-    std::vector<size_t> textures_set;
+    nya_memory::frame_arena_scoped_rewind arena_rewind;
+    std::vector<size_t,nya_memory::frame_allocator<size_t> > textures_set;
     for(size_t i=0;i<m_op.size();++i)
     {
         const size_t idx=m_op[i].idx;
@@ -120,7 +122,7 @@ void postprocess::draw(int dt)
 bool postprocess::load_text(shared_postprocess &res,resource_data &data,const char* name)
 {
     nya_formats::text_parser parser;
-    if(!parser.load_from_data((char *)data.get_data()))
+    if(!parser.load_from_data((const char *)data.get_data(),data.get_size()))
         return false;
 
     res.lines.resize(parser.get_sections_count());
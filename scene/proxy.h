@@ -28,6 +28,12 @@ public:
     explicit proxy(const t &obj): nya_memory::shared_ptr<t>(obj) {}
 
     proxy(const proxy &p): nya_memory::shared_ptr<t>(p) {}
+    proxy &operator=(const proxy &p) { nya_memory::shared_ptr<t>::operator=(p); return *this; }
+
+#ifdef NYA_RVALUE_REFS
+    proxy(proxy &&p): nya_memory::shared_ptr<t>(static_cast<nya_memory::shared_ptr<t>&&>(p)) {}
+    proxy &operator=(proxy &&p) { nya_memory::shared_ptr<t>::operator=(static_cast<nya_memory::shared_ptr<t>&&>(p)); return *this; }
+#endif
 };
 
 }
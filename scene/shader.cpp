@@ -78,18 +78,15 @@ bool load_nya_shader_internal(shared_shader &res,shader_description &desc,resour
 
             path.append(file);
 
-            nya_resources::resource_data *file_data=nya_resources::get_resources_provider().access(path.c_str());
-            if(!file_data)
+            hot_reload::add_dependency(path.c_str());
+
+            resource_data include_data;
+            if(!include_data.open(path.c_str()))
             {
                 log()<<"unable to load shader include resource in shader "<<name<<": unable to access resource "<<path.c_str()<<"\n";
                 return false;
             }
 
-            const size_t data_size=file_data->get_size();
-            nya_memory::tmp_buffer_ref include_data(data_size);
-            file_data->read_all(include_data.get_data());
-            file_data->release();
-
             if(!load_nya_shader_internal(res,desc,include_data,path.c_str(),true))
             {
                 log()<<"unable to load shader include in shader "<<name<<": unknown format in "<<path.c_str()<<"\n";
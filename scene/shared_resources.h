@@ -4,11 +4,110 @@
 
 #include "resources/shared_resources.h"
 #include "memory/tmp_buffer.h"
+#include "memory/frame_arena.h"
+#include "memory/hash.h"
+#include "async_loader.h"
+#include "hot_reload.h"
+#include <string.h>
 
 namespace nya_scene
 {
 
-typedef nya_memory::tmp_buffer_ref resource_data;
+//resource bytes passed to load functions, treat as read-only
+//points into the provider's mapped view if available, otherwise into a temporary copy
+//deferred data is read on the first get_data call, read_chunk reads parts of it without the copy
+
+class resource_data
+{
+public:
+    const void *get_data(size_t offset=0) const
+    {
+        if(!m_mapped)
+        {
+            if(m_res)
+                read_deferred();
+
+            return m_buf.get_data(offset);
+        }
+
+        return offset<m_size?(const char *)m_mapped+offset:0;
+    }
+
+    size_t get_size() const { return m_res?m_size:m_buf.get_size(); }
+    bool is_mapped() const { return m_mapped!=0; }
+    bool is_deferred() const { return m_res && !m_mapped; }
+
+    bool read_chunk(void *data,size_t size,size_t offset) const;
+
+public:
+    //accesses the resources provider, may be called from worker threads
+    bool open(const char *name,bool deferred=false);
+
+    bool open(nya_resources::resource_data *data,bool deferred=false)
+    {
+        free();
+        if(!data)
+            return false;
+
+        m_mapped=data->get_mapped_data();
+        if(m_mapped || deferred)
+        {
+            m_size=data->get_size();
+            m_res=data;
+            return true;
+        }
+
+        m_buf.allocate(data->get_size());
+        const bool result=data->read_all(m_buf.get_data());
+        data->release();
+        return result;
+    }
+
+    void take(nya_memory::tmp_buffer_ref &buf) //replaces the data with buf, buf is left empty
+    {
+        free();
+        m_buf=buf;
+        buf=nya_memory::tmp_buffer_ref();
+    }
+
+    void take(resource_data &from) //moves opened data, from is left closed
+    {
+        free();
+        m_buf=from.m_buf,m_res=from.m_res,m_mapped=from.m_mapped,m_size=from.m_size;
+        from.m_buf=nya_memory::tmp_buffer_ref();
+        from.m_res=0,from.m_mapped=0,from.m_size=0;
+    }
+
+    void free()
+    {
+        if(m_res)
+            m_res->release();
+
+        m_res=0;
+        m_mapped=0;
+        m_size=0;
+        m_buf.free();
+    }
+
+public:
+    resource_data(): m_res(0),m_mapped(0),m_size(0) {}
+    ~resource_data() { free(); }
+
+private:
+    resource_data(const resource_data &);
+    void operator = (const resource_data &);
+
+    bool read_deferred() const;
+
+private:
+    mutable nya_memory::tmp_buffer_ref m_buf;
+    mutable nya_resources::resource_data *m_res;
+    const void *m_mapped;
+    mutable size_t m_size;
+};
+
+//approximate memory held by a loaded resource, overload for resource types holding gpu data
+template<typename t> size_t get_shared_resource_size(const t &res) { return sizeof(t); }
 
 template<typename t>
 class scene_shared
@@ -22,7 +121,9 @@ public:
             return false;
         }
 
-        const std::string final_name=get_resources_prefix_str()+name;
+        nya_memory::frame_arena_scoped_rewind arena_rewind;
+        nya_memory::frame_string final_name(get_resources_prefix_str().c_str());
+        final_name.append(name);
         if(m_shared.is_valid())
         {
             const char *res_name=m_shared.get_name();
@@ -32,13 +133,18 @@ public:
 
         unload();
 
-        m_shared=get_shared_resources().access(final_name.c_str());
+        if(get_content_dedup().enabled && !get_shared_resources().has(final_name.c_str()))
+            m_shared=access_content(final_name.c_str(),0);
+        else
+            m_shared=get_shared_resources().access(final_name.c_str());
 
         return m_shared.is_valid();
     }
 
     void create(const t &res)
     {
+        cancel_async();
+
         typename shared_resources::shared_resource_mutable_ref ref=get_shared_resources().create();
         if(!ref.is_valid())
         {
@@ -52,18 +158,65 @@ public:
 
     void unload()
     {
+        cancel_async();
+
         if(m_shared.is_valid())
             m_shared.free();
     }
 
     const char *get_name() const { return m_shared.get_name(); }
 
+public:
+    typedef void (*load_callback)(const char *name,bool success,void *user_data);
+
+    //reads the resource on async_loader threads and loads it in async_loader::update
+    //loads synchronously if the loader isn't started or the resource is already loaded
+    //callback isn't called if the request is canceled by load, unload, create or destruction
+    bool load_async(const char *name,load_callback callback=0,void *user_data=0)
+    {
+        if(!name || !name[0])
+        {
+            unload();
+            return false;
+        }
+
+        const std::string final_name=get_resources_prefix_str()+name;
+        if(m_request && final_name==m_request->get_name())
+        {
+            m_request->set_callback(callback,user_data);
+            return true;
+        }
+
+        if(!async_loader::is_started() || get_shared_resources().has(final_name.c_str()))
+        {
+            const bool result=load(name);
+            if(callback)
+                callback(final_name.c_str(),result,user_data);
+
+            return result;
+        }
+
+        unload();
+
+        m_request=new load_request(final_name.c_str(),this);
+        m_request->set_callback(callback,user_data);
+        if(!async_loader::add(m_request))
+        {
+            m_request=0;
+            return false;
+        }
+
+        return true;
+    }
+
+    bool is_loading() const { return m_request!=0; }
+
 public:
     static void set_resources_prefix(const char *prefix) { get_resources_prefix_str().assign(prefix?prefix:""); }
     static const char *get_resources_prefix() { return get_resources_prefix_str().c_str(); }
 
 public:
-    static int reload_all_resources() { return get_shared_resources().reload_resources(); }
+    static int reload_all_resources() { ++get_reloads_count_ref(); return get_shared_resources().reload_resources(); }
 
     static bool reload_resource(const char *name)
     {
@@ -71,13 +224,37 @@ public:
             return false;
 
         if(get_resources_prefix_str().empty())
-            return get_shared_resources().reload_resource(name);
+            return reload_shared_resource(name);
 
-        return get_shared_resources().reload_resource((get_resources_prefix_str()+name).c_str());
+        return reload_shared_resource((get_resources_prefix_str()+name).c_str());
     }
 
+    //incremented on reload, lets dependent resources refresh cached data
+    static unsigned int get_reloads_count() { return get_reloads_count_ref(); }
+
+public:
+    struct content_dedup_stats
+    {
+        unsigned int shared_count; //loads given an already loaded resource with identical data
+        size_t saved_data_size; //resource data bytes that were not loaded
+        size_t saved_resource_size; //see get_shared_resource_size, includes vram for textures and meshes
+
+        content_dedup_stats(): shared_count(0),saved_data_size(0),saved_resource_size(0) {}
+    };
+
+    //resources with identical data share one loaded resource even if names differ
+    //data is matched by size and a 128-bit hash without comparing the bytes
+    //get_name returns the name the shared resource was loaded with
+    static void set_content_dedup(bool enable) { get_content_dedup().enabled=enable; if(!enable) get_content_dedup().clear(); }
+    static const content_dedup_stats &get_content_dedup_stats() { return get_content_dedup().stats; }
+
+    //synchronous loads open resources without reading them, load functions read parts with
+    //resource_data::read_chunk or the whole resource with get_data; async and dedup loads read it as usual
+    static void set_deferred_read(bool enable) { get_deferred_read_ref()=enable; }
+
 public:
     typedef bool (*load_function)(t &sh,resource_data &data,const char *name);
+    typedef bool (*decode_function)(resource_data &data,const char *name);
 
     static void register_load_function(load_function function,bool clear_default)
     {
@@ -99,7 +276,7 @@ public:
         get_load_functions().add(function,false);
     }
 
-    static void default_load_function(load_function function)
+    static void default_load_function(load_function function,decode_function decode=0)
     {
         if(!function)
             return;
@@ -108,10 +285,46 @@ public:
             return;
 
         get_load_functions().add(function,true);
+        register_decode_function(function,decode);
+    }
+
+    //decode prepares data for the load function on async_loader threads, so that only the upload is left for update
+    //it returns false if the data isn't in its format and must not touch render or shared resources
+    //it replaces the data with resource_data::take, the load function then gets only such data from async loads
+    static void register_decode_function(load_function function,decode_function decode)
+    {
+        if(!function || !decode)
+            return;
+
+        std::vector<decoder> &d=get_load_functions().decoders;
+        for(size_t i=0;i<d.size();++i)
+        {
+            if(d[i].first==function)
+            {
+                d[i].second=decode;
+                return;
+            }
+        }
+
+        d.push_back(decoder(function,decode));
     }
 
 public:
-    virtual ~scene_shared<t>() {}
+    scene_shared(): m_request(0) {}
+    scene_shared(const scene_shared &from): m_shared(from.m_shared),m_request(0) {}
+
+    //pending async load isn't copied
+    scene_shared &operator = (const scene_shared &from)
+    {
+        if(this==&from)
+            return *this;
+
+        cancel_async();
+        m_shared=from.m_shared;
+        return *this;
+    }
+
+    virtual ~scene_shared<t>() { cancel_async(); }
 
 protected:
     typedef nya_resources::shared_resources<t,8> shared_resources;
@@ -119,6 +332,8 @@ protected:
 
     class shared_resources_manager: public shared_resources
     {
+        friend class scene_shared;
+
         bool fill_resource(const char *name,t &res)
         {
             if(!name)
@@ -127,21 +342,37 @@ protected:
                 return false;
             }
 
-            nya_resources::resource_data *file_data=nya_resources::get_resources_provider().access(name);
-            if(!file_data)
+            hot_reload::begin_load(reload_shared_resource,name);
+
+            bool result;
+            if(m_prefetched && strcmp(name,m_prefetched_name)==0)
+                result=load(res,*m_prefetched,name,m_prefetched_load);
+            else
             {
-                nya_resources::log()<<"unable to load scene resource: unable to access resource "<<name<<"\n";
-                return false;
+                resource_data res_data;
+                if(res_data.open(name,get_deferred_read_ref()))
+                    result=load(res,res_data,name);
+                else
+                {
+                    nya_resources::log()<<"unable to load scene resource: unable to access resource "<<name<<"\n";
+                    result=false;
+                }
             }
 
-            const size_t data_size=file_data->get_size();
-            nya_memory::tmp_buffer_ref res_data(data_size);
-            file_data->read_all(res_data.get_data());
-            file_data->release();
+            hot_reload::end_load();
+            return result;
+        }
 
+        //only_function is set for data prepared by its decode function
+        static bool load(t &res,resource_data &res_data,const char *name,load_function only_function=0)
+        {
             for(size_t i=0;i<scene_shared::get_load_functions().f.size();++i)
             {
-                if(scene_shared::get_load_functions().f[i].first(res,res_data,name))
+                const load_function f=scene_shared::get_load_functions().f[i].first;
+                if(only_function && f!=only_function)
+                    continue;
+
+                if(f(res,res_data,name))
                 {
                     res_data.free();
                     return true;
@@ -155,10 +386,25 @@ protected:
             return false;
         }
 
+        //data read by an async request, used instead of accessing the provider
+        const char *m_prefetched_name;
+        resource_data *m_prefetched;
+        load_function m_prefetched_load;
+
+    public:
+        //dedup is constructed first so that it outlives the manager
+        shared_resources_manager(): m_prefetched_name(0),m_prefetched(0),m_prefetched_load(0) { get_content_dedup(); }
+
         bool release_resource(t &res)
         {
+            get_content_dedup().forget(&res);
             return res.release();
         }
+
+        size_t get_resource_size(const t &res)
+        {
+            return get_shared_resource_size(res);
+        }
     };
 
 public:
@@ -168,15 +414,40 @@ public:
         return manager;
     }
 
+public:
+    //keeps released resources of this type loaded within the budget, see nya_resources::shared_resources
+    static void set_unused_cache_size(size_t size) { get_shared_resources().set_unused_cache_size(size); }
+    static void clear_unused_cache() { get_shared_resources().clear_unused_cache(); }
+
+    typedef typename shared_resources::unused_cache_stats unused_cache_stats;
+    static const unused_cache_stats &get_unused_cache_stats() { return get_shared_resources().get_unused_cache_stats(); }
+
 public:
     const shared_resource_ref &get_shared_data() const { return m_shared; }
 
 private:
+    typedef std::pair<load_function,decode_function> decoder;
+
     struct load_functions
     {
         std::vector<std::pair<load_function,bool> > f;
+        std::vector<decoder> decoders;
         bool clear_default;
 
+        //decoders of registered load functions in their order
+        void get_decoders(std::vector<decoder> &out) const
+        {
+            out.clear();
+            for(size_t i=0;i<f.size();++i)
+            {
+                for(size_t j=0;j<decoders.size();++j)
+                {
+                    if(decoders[j].first==f[i].first)
+                        out.push_back(decoders[j]);
+                }
+            }
+        }
+
         void add(load_function function,bool is_default)
         {
             if(!function)
@@ -201,14 +472,240 @@ private:
     }
 
 private:
+    struct content_key
+    {
+        unsigned long long hash[2];
+        size_t size;
+
+        bool operator < (const content_key &other) const
+        {
+            if(hash[0]!=other.hash[0])
+                return hash[0]<other.hash[0];
+
+            if(hash[1]!=other.hash[1])
+                return hash[1]<other.hash[1];
+
+            return size<other.size;
+        }
+    };
+
+    struct content_entry
+    {
+        std::string name;
+        const t *res;
+
+        content_entry(): res(0) {}
+    };
+
+    struct content_dedup
+    {
+        bool enabled;
+        std::map<content_key,content_entry> contents; //to the resource loaded from it
+        std::map<const t*,content_key> keys;
+        content_dedup_stats stats;
+
+        void add(const content_key &key,const char *name,const t *res)
+        {
+            forget(res);
+            content_entry &e=contents[key];
+            if(e.res)
+                keys.erase(e.res);
+
+            e.name.assign(name);
+            e.res=res;
+            keys[res]=key;
+        }
+
+        void forget(const t *res)
+        {
+            typename std::map<const t*,content_key>::iterator it=keys.find(res);
+            if(it==keys.end())
+                return;
+
+            contents.erase(it->second);
+            keys.erase(it);
+        }
+
+        void clear() { contents.clear(); keys.clear(); }
+
+        content_dedup(): enabled(false) {}
+    };
+
+    static content_dedup &get_content_dedup()
+    {
+        static content_dedup dedup;
+        return dedup;
+    }
+
+    static content_key get_content_key(const resource_data &data)
+    {
+        content_key key;
+        key.size=data.get_size();
+        nya_memory::hash_data128(data.get_data(),key.size,key.hash);
+        return key;
+    }
+
+    //name with prefix, data is opened if not provided
+    //key is computed from data if not provided, data prepared by decode must come with the key of the original data
+    static shared_resource_ref access_content(const char *name,resource_data *data,const content_key *key=0,
+                                              load_function decoded_load=0)
+    {
+        shared_resources_manager &manager=get_shared_resources();
+
+        resource_data res_data;
+        if(!data)
+        {
+            if(!res_data.open(name))
+            {
+                nya_resources::log()<<"unable to load scene resource: unable to access resource "<<name<<"\n";
+                return shared_resource_ref();
+            }
+
+            data=&res_data;
+        }
+
+        //entries are removed when their resource is released or reloaded, so a match is loaded with the same data
+        const content_key data_key=key?*key:get_content_key(*data);
+
+        content_dedup &dedup=get_content_dedup();
+        typename std::map<content_key,content_entry>::const_iterator it=dedup.contents.find(data_key);
+        if(it!=dedup.contents.end() && it->second.name!=name)
+        {
+            shared_resource_ref ref=manager.access(it->second.name.c_str());
+            if(ref.is_valid())
+            {
+                data->free();
+                ++dedup.stats.shared_count;
+                dedup.stats.saved_data_size+=data_key.size;
+                dedup.stats.saved_resource_size+=get_shared_resource_size(*ref.const_get());
+                return ref;
+            }
+        }
+
+        manager.m_prefetched_name=name;
+        manager.m_prefetched=data;
+        manager.m_prefetched_load=decoded_load;
+        shared_resource_ref ref=manager.access(name);
+        manager.m_prefetched_load=0;
+        manager.m_prefetched=0;
+        manager.m_prefetched_name=0;
+
+        if(ref.is_valid())
+            dedup.add(data_key,name,ref.const_get());
+
+        return ref;
+    }
+
+    //name with prefix
+    static bool reload_shared_resource(const char *name)
+    {
+        if(!get_shared_resources().reload_resource(name))
+            return false;
+
+        ++get_reloads_count_ref();
+        return true;
+    }
+
+    static unsigned int &get_reloads_count_ref()
+    {
+        static unsigned int count=0;
+        return count;
+    }
+
+    static bool &get_deferred_read_ref()
+    {
+        static bool deferred=false;
+        return deferred;
+    }
+
     static std::string &get_resources_prefix_str()
     {
         static std::string prefix;
         return prefix;
     }
 
+private:
+    class load_request: public async_request
+    {
+    public:
+        void set_callback(load_callback callback,void *user_data) { m_callback=callback; m_user_data=user_data; }
+
+        void decode()
+        {
+            resource_data *data=get_data();
+            if(!data)
+                return;
+
+            if(m_dedup)
+                m_key=get_content_key(*data);
+
+            for(size_t i=0;i<m_decoders.size();++i)
+            {
+                if(m_decoders[i].second(*data,get_name()))
+                {
+                    m_decoded_load=m_decoders[i].first;
+                    break;
+                }
+            }
+        }
+
+        void finish()
+        {
+            m_owner->m_request=0;
+
+            shared_resources_manager &manager=get_shared_resources();
+            if(get_data() && get_content_dedup().enabled && (m_dedup || !m_decoded_load))
+                m_owner->m_shared=access_content(get_name(),get_data(),m_dedup?&m_key:0,m_decoded_load);
+            else if(get_data())
+            {
+                manager.m_prefetched_name=get_name();
+                manager.m_prefetched=get_data();
+                manager.m_prefetched_load=m_decoded_load;
+                m_owner->m_shared=manager.access(get_name());
+                manager.m_prefetched_load=0;
+                manager.m_prefetched=0;
+                manager.m_prefetched_name=0;
+            }
+            else if(manager.has(get_name()))
+                m_owner->m_shared=manager.access(get_name());
+            else
+                nya_resources::log()<<"unable to load scene resource: unable to access resource "<<get_name()<<"\n";
+
+            if(m_callback)
+                m_callback(get_name(),m_owner->m_shared.is_valid(),m_user_data);
+        }
+
+        //decoders and dedup state are taken on the main thread, decode runs on a worker
+        load_request(const char *name,scene_shared *owner): async_request(name),m_owner(owner),m_callback(0),m_user_data(0),
+                                                             m_decoded_load(0),m_dedup(get_content_dedup().enabled)
+        {
+            get_load_functions().get_decoders(m_decoders);
+        }
+
+    private:
+        scene_shared *m_owner;
+        load_callback m_callback;
+        void *m_user_data;
+        std::vector<decoder> m_decoders;
+        load_function m_decoded_load;
+        bool m_dedup;
+        content_key m_key;
+    };
+
+    void cancel_async()
+    {
+        if(!m_request)
+            return;
+
+        m_request->cancel();
+        m_request=0;
+    }
+
 protected:
     shared_resource_ref m_shared;
+
+private:
+    load_request *m_request;
 };
 
 }
@@ -3,49 +3,461 @@
 #include "texture.h"
 #include "memory/memory_reader.h"
 #include "memory/tmp_buffer.h"
+#include "memory/thread_pool.h"
 #include "formats/tga.h"
 #include "formats/dds.h"
 #include "formats/ktx.h"
+#include "formats/pixel_convert.h"
+#include <stdio.h>
+#include <vector>
 
 namespace nya_scene
 {
 
 void bgr_to_rgb(unsigned char *data,size_t data_size)
 {
-    if(!data)
+    nya_formats::swap_red_blue(data,data,data_size/3,3);
+}
+
+namespace
+{
+
+typedef nya_render::texture::color_format color_format;
+
+//queried once on the main thread, decode functions run on loader threads without the render context
+struct format_support
+{
+    bool cached;
+    bool dxt;
+    bool etc1;
+    bool etc2;
+    bool pvr;
+};
+
+format_support &get_format_support()
+{
+    static format_support support={false,false,false,false,false};
+    return support;
+}
+
+void cache_format_support()
+{
+    format_support &s=get_format_support();
+    if(s.cached)
         return;
 
-    unsigned char *data2=data+2;
-    for(size_t i=0;i<data_size;i+=3)
+    s.dxt=nya_render::texture::is_dxt_supported();
+    s.etc1=nya_render::texture::is_etc1_supported();
+    s.etc2=nya_render::texture::is_etc2_supported();
+    s.pvr=nya_render::texture::is_pvr_supported();
+    s.cached=true;
+}
+
+bool is_format_supported(color_format cf)
+{
+    const format_support &s=get_format_support();
+    switch(cf)
     {
-        unsigned char tmp=data[i];
-        data[i]=data2[i];
-        data2[i]=tmp;
+        case nya_render::texture::dxt1:
+        case nya_render::texture::dxt3:
+        case nya_render::texture::dxt5: return s.dxt;
+
+        case nya_render::texture::etc1: return s.etc1;
+
+        case nya_render::texture::etc2:
+        case nya_render::texture::etc2_eac:
+        case nya_render::texture::etc2_a1: return s.etc2;
+
+        case nya_render::texture::pvr_rgb2b:
+        case nya_render::texture::pvr_rgb4b:
+        case nya_render::texture::pvr_rgba2b:
+        case nya_render::texture::pvr_rgba4b: return s.pvr;
+
+        default: return true;
     }
 }
 
-bool texture::load_ktx(shared_texture &res,resource_data &data,const char* name)
+//etc is re-encoded to dxt if possible, anything else is decoded
+color_format get_transcode_format(color_format cf)
 {
-    if(!data.get_size())
+    if(!get_format_support().dxt)
+        return nya_render::texture::color_rgba;
+
+    switch(cf)
+    {
+        case nya_render::texture::etc1:
+        case nya_render::texture::etc2: return nya_render::texture::dxt1;
+
+        case nya_render::texture::etc2_eac:
+        case nya_render::texture::etc2_a1: return nya_render::texture::dxt5;
+
+        default: return nya_render::texture::color_rgba;
+    }
+}
+
+struct transcode_cache_header
+{
+    char sign[4]; //"nyat"
+    unsigned int version;
+    unsigned long long source_hash;
+    unsigned int source_size;
+    unsigned int format;
+    unsigned int data_size;
+};
+
+const unsigned int transcode_cache_version=1;
+
+std::string get_transcode_cache_name(const std::string &folder,unsigned long long hash,color_format cf)
+{
+    char name[64];
+    sprintf(name,"%08x%08x_%d.ntc",(unsigned int)(hash>>32),(unsigned int)hash,(int)cf);
+    return folder+name;
+}
+
+bool read_transcode_cache(const std::string &name,const transcode_cache_header &expected,size_t reserve,nya_memory::tmp_buffer_ref &result)
+{
+    FILE *f=fopen(name.c_str(),"rb");
+    if(!f)
         return false;
 
-    if(data.get_size()<12)
+    transcode_cache_header h;
+    bool ok=fread(&h,sizeof(h),1,f)==1 && memcmp(h.sign,expected.sign,4)==0 && h.version==expected.version
+            && h.source_hash==expected.source_hash && h.source_size==expected.source_size
+            && h.format==expected.format && h.data_size==expected.data_size;
+    if(ok)
+    {
+        result.allocate(reserve+h.data_size);
+        ok=fread(result.get_data(reserve),h.data_size,1,f)==1;
+        if(!ok)
+            result.free();
+    }
+
+    fclose(f);
+    return ok;
+}
+
+void write_transcode_cache(const std::string &name,const transcode_cache_header &header,const void *data)
+{
+    //written under a temporary name so that an interrupted write is never read
+    const std::string tmp_name=name+".tmp";
+    FILE *f=fopen(tmp_name.c_str(),"wb");
+    if(!f)
+    {
+        nya_log::log()<<"unable to write transcoded texture cache "<<name.c_str()<<"\n";
+        return;
+    }
+
+    const bool ok=fwrite(&header,sizeof(header),1,f)==1 && fwrite(data,header.data_size,1,f)==1;
+    fclose(f);
+    if(!ok || rename(tmp_name.c_str(),name.c_str())!=0)
+        remove(tmp_name.c_str());
+}
+
+//loads on the main thread transcode on a pool kept between textures,
+//loader threads decode textures in parallel and transcode each on its own thread
+nya_memory::thread_pool *get_transcode_pool(unsigned int threads)
+{
+    if(!threads)
+        threads=nya_memory::thread_pool::get_hardware_threads_count();
+    if(threads<2)
+        return 0;
+
+    //never destroyed, its threads flush tmp_buffers on exit
+    static nya_memory::thread_pool *pool=new nya_memory::thread_pool();
+    if(pool->is_started() && pool->get_threads_count()!=threads)
+        pool->stop();
+    if(!pool->is_started() && !pool->start(threads))
+        return 0;
+
+    return pool;
+}
+
+void decode(const nya_formats::ktx &ktx,void *rgba,nya_memory::thread_pool *pool)
+{
+    if(pool)
+        ktx.decode_etc(rgba,*pool);
+    else
+        ktx.decode_etc(rgba,1);
+}
+
+void decode(const nya_formats::dds &dds,void *rgba,nya_memory::thread_pool *pool)
+{
+    if(pool)
+        dds.decode_dxt(rgba,*pool);
+    else
+        dds.decode_dxt(rgba,1);
+}
+
+void encode(nya_formats::dds::pixel_format pf,const void *rgba,unsigned int w,unsigned int h,void *to,nya_memory::thread_pool *pool)
+{
+    if(pool)
+        nya_formats::dds::encode_dxt(pf,rgba,w,h,to,*pool);
+    else
+        nya_formats::dds::encode_dxt(pf,rgba,w,h,to,1);
+}
+
+//result is reserve bytes followed by a packed mipmap chain of each face; pool is 0 to transcode on the calling thread
+template<typename t> bool transcode(const t &source,const resource_data &data,unsigned int faces,color_format to,
+                                    const std::string &cache_folder,nya_memory::thread_pool *pool,size_t reserve,
+                                    nya_memory::tmp_buffer_ref &result)
+{
+    const size_t decoded_size=source.get_decoded_size();
+    if(!decoded_size)
         return false;
 
-    if(memcmp((const char *)data.get_data()+1,"KTX ",4)!=0)
+    nya_formats::dds::pixel_format pf=nya_formats::dds::dxt1;
+    switch(to)
+    {
+        case nya_render::texture::color_rgba:
+        case nya_render::texture::dxt1: break;
+        case nya_render::texture::dxt5: pf=nya_formats::dds::dxt5; break;
+        default: return false;
+    }
+
+    size_t size=decoded_size;
+    if(to!=nya_render::texture::color_rgba)
+    {
+        size=0;
+        for(unsigned int i=0,w=source.width,h=source.height;i<source.mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+            size+=nya_formats::dds::get_dxt_size(pf,w,h);
+        size*=faces;
+    }
+
+    transcode_cache_header header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.sign,"nyat",4);
+    header.version=transcode_cache_version;
+    header.source_size=(unsigned int)data.get_size();
+    header.format=to;
+    header.data_size=(unsigned int)size;
+
+    std::string cache_name;
+    if(!cache_folder.empty())
+    {
+        header.source_hash=nya_memory::hash_data64(data.get_data(),data.get_size());
+        cache_name=get_transcode_cache_name(cache_folder,header.source_hash,to);
+        if(read_transcode_cache(cache_name,header,reserve,result))
+            return true;
+    }
+
+    if(to==nya_render::texture::color_rgba)
+    {
+        result.allocate(reserve+decoded_size);
+        decode(source,result.get_data(reserve),pool);
+    }
+    else
+    {
+        nya_memory::tmp_buffer_scoped rgba(decoded_size);
+        decode(source,rgba.get_data(),pool);
+
+        result.allocate(reserve+size);
+        const unsigned char *src=(const unsigned char *)rgba.get_data();
+        unsigned char *dst=(unsigned char *)result.get_data(reserve);
+        for(unsigned int f=0;f<faces;++f)
+        {
+            for(unsigned int i=0,w=source.width,h=source.height;i<source.mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+            {
+                encode(pf,src,w,h,dst,pool);
+                src+=(size_t)w*h*4;
+                dst+=nya_formats::dds::get_dxt_size(pf,w,h);
+            }
+        }
+    }
+
+    if(!cache_name.empty())
+        write_transcode_cache(cache_name,header,result.get_data(reserve));
+
+    return true;
+}
+
+const size_t stream_chunk_size=256*1024;
+const size_t stream_min_chunk_size=16*1024;
+
+//buf holds the level being read followed by the uploaded levels, so the texture
+//is rebuilt from one buffer and only the level being read is kept besides them
+struct texture_stream
+{
+    shared_texture *res;
+    resource_data data;
+    std::string name;
+    color_format cf;
+    unsigned int width;
+    unsigned int height;
+    std::vector<size_t> offsets; //of each level in the resource
+    std::vector<size_t> sizes;
+    unsigned int level; //levels from it to the last one are uploaded
+    size_t read_size; //of level-1
+    nya_memory::tmp_buffer_ref buf;
+    nya_formats::dds::pixel_format dds_pf; //rows layout for flip and swizzle
+    bool flip;
+    bool swizzle;
+
+    texture_stream(): res(0),cf(nya_render::texture::color_rgba),width(0),height(0),level(0),read_size(0),
+                      dds_pf(nya_formats::dds::bgra),flip(false),swizzle(false) {}
+};
+
+std::vector<texture_stream *> &get_streams()
+{
+    static std::vector<texture_stream *> streams;
+    return streams;
+}
+
+texture_stream *find_stream(const shared_texture *res)
+{
+    std::vector<texture_stream *> &streams=get_streams();
+    for(size_t i=0;i<streams.size();++i)
+    {
+        if(streams[i]->res==res)
+            return streams[i];
+    }
+
+    return 0;
+}
+
+void delete_stream(texture_stream *s)
+{
+    s->buf.free();
+    delete s;
+}
+
+void remove_stream(const shared_texture *res)
+{
+    std::vector<texture_stream *> &streams=get_streams();
+    for(size_t i=0;i<streams.size();++i)
+    {
+        if(streams[i]->res!=res)
+            continue;
+
+        delete_stream(streams[i]);
+        streams.erase(streams.begin()+i);
+        return;
+    }
+}
+
+unsigned int get_level_size(unsigned int size,unsigned int level) { return size>>level?size>>level:1; }
+
+//reads up to max_size of the level above the uploaded ones, at least one row
+//level is decremented when it is read completely
+bool read_stream_chunk(texture_stream &s,const resource_data &data,size_t max_size,size_t &read)
+{
+    const unsigned int level=s.level-1;
+    const size_t level_size=s.sizes[level];
+    if(!s.read_size)
+    {
+        size_t tail_size=0;
+        for(size_t i=s.level;i<s.sizes.size();++i)
+            tail_size+=s.sizes[i];
+
+        nya_memory::tmp_buffer_ref buf(level_size+tail_size);
+        if(tail_size)
+            buf.copy_from(s.buf.get_data(),tail_size,level_size);
+        s.buf.free();
+        s.buf=buf;
+    }
+
+    size_t size=level_size-s.read_size;
+    if(size>max_size)
+        size=max_size;
+
+    //whole rows, flipped rows are read to their mirrored place
+    size_t row_size=0;
+    if(s.flip || s.swizzle)
+    {
+        row_size=nya_formats::dds::get_row_size(s.dds_pf,get_level_size(s.width,level));
+        size=size>row_size?size/row_size*row_size:row_size;
+    }
+
+    const size_t offset=s.flip?level_size-s.read_size-size:s.read_size;
+    unsigned char *to=(unsigned char *)s.buf.get_data(offset);
+    if(!data.read_chunk(to,size,s.offsets[level]+s.read_size))
         return false;
 
-    nya_formats::ktx ktx;
-    const size_t header_size=ktx.decode_header(data.get_data(),data.get_size());
-    if(!header_size)
+    if(s.swizzle)
+        bgr_to_rgb(to,size);
+    if(s.flip)
+        nya_formats::dds::flip_rows(s.dds_pf,get_level_size(s.height,level),to,row_size,(unsigned int)(size/row_size));
+
+    read+=size;
+    s.read_size+=size;
+    if(s.read_size==level_size)
+        s.level=level,s.read_size=0;
+
+    return true;
+}
+
+bool upload_stream_levels(texture_stream &s)
+{
+    return s.res->tex.build_texture(s.buf.get_data(),get_level_size(s.width,s.level),get_level_size(s.height,s.level),
+                                    s.cf,int(s.sizes.size()-s.level));
+}
+
+//uploads levels up to first_size and at least the last one, the rest is read by texture::update_streaming
+bool start_stream(texture_stream *s,shared_texture &res,resource_data &data,const char *name,unsigned int first_size)
+{
+    s->res=&res;
+    s->name.assign(name?name:"");
+    s->level=(unsigned int)s->sizes.size();
+
+    for(size_t i=0;i<s->sizes.size();++i)
     {
-        nya_log::log()<<"unable to load ktx: invalid or unsupported ktx header in file "<<name<<"\n";
+        if(!s->sizes[i] || s->offsets[i]>data.get_size() || s->sizes[i]>data.get_size()-s->offsets[i])
+        {
+            nya_log::log()<<"unable to stream texture: lack of data, probably corrupted file "<<name<<"\n";
+            delete_stream(s);
+            return false;
+        }
+    }
+
+    size_t read=0;
+    while(s->level>0)
+    {
+        const unsigned int next=s->level-1;
+        if(s->level<s->sizes.size() && (get_level_size(s->width,next)>first_size || get_level_size(s->height,next)>first_size))
+            break;
+
+        if(!read_stream_chunk(*s,data,stream_chunk_size,read))
+        {
+            nya_log::log()<<"unable to stream texture: unable to read file "<<name<<"\n";
+            delete_stream(s);
+            return false;
+        }
+    }
+
+    if(!upload_stream_levels(*s))
+    {
+        delete_stream(s);
         return false;
     }
 
-    nya_render::texture::color_format cf;
+    if(!s->level)
+    {
+        delete_stream(s);
+        return true;
+    }
+
+    //buffered data is dropped, the rest is read from the provider
+    if(data.is_deferred() || data.is_mapped())
+        s->data.take(data);
+    else if(!s->data.open(name,true))
+    {
+        nya_log::log()<<"unable to stream texture: unable to access resource "<<name<<"\n";
+        delete_stream(s);
+        return true;
+    }
 
-    switch(ktx.pf)
+    get_streams().push_back(s);
+    return true;
+}
+
+bool is_streamable(unsigned int width,unsigned int height,unsigned int mipmap_count,color_format cf)
+{
+    const bool pot=((width&(width-1))==0 && (height&(height-1))==0);
+    return pot && mipmap_count>1 && mipmap_count<=32 && is_format_supported(cf);
+}
+
+bool get_color_format(nya_formats::ktx::pixel_format pf,color_format &cf)
+{
+    switch(pf)
     {
         case nya_formats::ktx::rgb: cf=nya_render::texture::color_rgb; break;
         case nya_formats::ktx::rgba: cf=nya_render::texture::color_rgba; break;
@@ -61,35 +473,479 @@ bool texture::load_ktx(shared_texture &res,resource_data &data,const char* name)
         case nya_formats::ktx::pvr_rgba2b: cf=nya_render::texture::pvr_rgba2b; break;
         case nya_formats::ktx::pvr_rgba4b: cf=nya_render::texture::pvr_rgba4b; break;
 
-        default: nya_log::log()<<"unable to load ktx: unsupported color format in file "<<name<<"\n"; return false;
+        default: return false;
+    }
+
+    return true;
+}
+
+//only the header is read, data sizes are checked against the resource size; 0 if loaded as a whole
+texture_stream *create_ktx_stream(const resource_data &data)
+{
+    unsigned char header[64];
+    if(data.get_size()<sizeof(header) || !data.read_chunk(header,sizeof(header),0))
+        return 0;
+
+    unsigned int key_value_size;
+    memcpy(&key_value_size,header+60,4);
+    if(key_value_size>data.get_size()-sizeof(header))
+        return 0;
+
+    const size_t header_size=sizeof(header)+key_value_size;
+    nya_memory::tmp_buffer_scoped buf(header_size);
+    if(!data.read_chunk(buf.get_data(),header_size,0))
+        return 0;
+
+    nya_formats::ktx ktx;
+    color_format cf;
+    if(ktx.decode_header(buf.get_data(),data.get_size())!=header_size || !get_color_format(ktx.pf,cf)
+       || !is_streamable(ktx.width,ktx.height,ktx.mipmap_count,cf))
+        return 0;
+
+    texture_stream *s=new texture_stream();
+    s->cf=cf;
+    s->width=ktx.width;
+    s->height=ktx.height;
+
+    //each level is prefixed with its size
+    for(size_t i=0,offset=header_size;i<ktx.mipmap_count;++i)
+    {
+        unsigned int size=0;
+        if(offset>data.get_size() || !data.read_chunk(&size,4,offset))
+            size=0;
+
+        s->offsets.push_back(offset+4);
+        s->sizes.push_back(size);
+        offset+=4+size;
+    }
+
+    return s;
+}
+
+//see create_ktx_stream
+texture_stream *create_dds_stream(const resource_data &data,bool flip)
+{
+    unsigned char header[128];
+    if(data.get_size()<sizeof(header) || !data.read_chunk(header,sizeof(header),0))
+        return 0;
+
+    nya_formats::dds dds;
+    const size_t header_size=dds.decode_header(header,data.get_size());
+    if(!header_size || dds.type!=nya_formats::dds::texture_2d || dds.need_generate_mipmaps)
+        return 0;
+
+    color_format cf;
+    switch(dds.pf)
+    {
+        case nya_formats::dds::dxt1: cf=nya_render::texture::dxt1; break;
+        case nya_formats::dds::dxt2:
+        case nya_formats::dds::dxt3: cf=nya_render::texture::dxt3; break;
+        case nya_formats::dds::dxt4:
+        case nya_formats::dds::dxt5: cf=nya_render::texture::dxt5; break;
+        case nya_formats::dds::bgra: cf=nya_render::texture::color_bgra; break;
+        case nya_formats::dds::bgr: cf=nya_render::texture::color_rgb; break;
+        case nya_formats::dds::greyscale: cf=nya_render::texture::greyscale; break;
+        default: return 0;
+    }
+
+    if(!is_streamable(dds.width,dds.height,dds.mipmap_count,cf))
+        return 0;
+
+    texture_stream *s=new texture_stream();
+    s->cf=cf;
+    s->width=dds.width;
+    s->height=dds.height;
+    s->dds_pf=dds.pf;
+    s->flip=flip;
+    s->swizzle=dds.pf==nya_formats::dds::bgr;
+
+    size_t offset=header_size;
+    for(unsigned int i=0;i<dds.mipmap_count;++i)
+    {
+        const size_t size=nya_formats::dds::get_row_size(dds.pf,get_level_size(dds.width,i))
+                          *nya_formats::dds::get_rows_count(dds.pf,get_level_size(dds.height,i));
+        s->offsets.push_back(offset);
+        s->sizes.push_back(size);
+        offset+=size;
     }
 
-    char *d=(char *)ktx.data;
+    return s;
+}
+
+}
+
+bool shared_texture::release()
+{
+    remove_stream(this);
+    tex.release();
+    return true;
+}
+
+std::string texture::m_transcode_cache_folder;
+unsigned int texture::m_transcode_threads=0;
+bool texture::m_streaming=false;
+unsigned int texture::m_stream_first_size=64;
+
+bool texture::load_async(const char *name,texture_internal::load_callback callback,void *user_data)
+{
+    cache_format_support();
+    return m_internal.load_async(name,callback,user_data);
+}
+
+void texture::set_transcode_cache_folder(const char *folder)
+{
+    m_transcode_cache_folder=folder?folder:"";
+    if(!m_transcode_cache_folder.empty() && m_transcode_cache_folder[m_transcode_cache_folder.size()-1]!='/')
+        m_transcode_cache_folder.push_back('/');
+}
+
+void texture::set_streaming(bool enable,unsigned int first_size)
+{
+    m_streaming=enable;
+    m_stream_first_size=first_size;
+    texture_internal::set_deferred_read(enable);
+}
+
+void texture::update_streaming(size_t budget)
+{
+    //one texture at a time, so that only one of them holds a large level
+    std::vector<texture_stream *> &streams=get_streams();
+    size_t read=0;
+    while(!streams.empty() && (!budget || read<budget))
+    {
+        texture_stream &s=*streams.front();
+        const unsigned int level=s.level;
+        size_t max_size=budget && budget-read<stream_chunk_size?budget-read:stream_chunk_size;
+        if(max_size<stream_min_chunk_size)
+            max_size=stream_min_chunk_size;
+        if(!read_stream_chunk(s,s.data,max_size,read))
+        {
+            nya_log::log()<<"unable to stream texture: unable to read file "<<s.name.c_str()<<"\n";
+            remove_stream(s.res);
+            continue;
+        }
+
+        if(s.level==level)
+            continue;
+
+        if(!upload_stream_levels(s) || !s.level)
+            remove_stream(s.res);
+    }
+}
+
+size_t texture::get_streaming_count() { return get_streams().size(); }
+
+namespace
+{
+
+//pixels prepared by a decode function on async_loader threads, followed by the pixels to upload
+//dds and ktx files start with their signatures, a tga file's second byte is the color map type
+const char decoded_sign[8]={0,'n','y','a','t','e','x',0};
+
+struct decoded_header
+{
+    char sign[8];
+    unsigned int width;
+    unsigned int height;
+    int format;
+    int mipmap_count;
+    int cube;
+};
+
+bool is_decoded(const resource_data &data)
+{
+    char sign[sizeof(decoded_sign)];
+    return data.get_size()>=sizeof(decoded_header) && data.read_chunk(sign,sizeof(sign),0)
+           && memcmp(sign,decoded_sign,sizeof(sign))==0;
+}
+
+//buf has the header space reserved before the pixels, it is left empty
+void set_decoded(resource_data &data,nya_memory::tmp_buffer_ref &buf,unsigned int width,unsigned int height,
+                 color_format cf,int mipmap_count,bool cube)
+{
+    decoded_header h;
+    memcpy(h.sign,decoded_sign,sizeof(h.sign));
+    h.width=width;
+    h.height=height;
+    h.format=cf;
+    h.mipmap_count=mipmap_count;
+    h.cube=cube?1:0;
+    memcpy(buf.get_data(),&h,sizeof(h));
+    data.take(buf);
+}
+
+bool build_decoded(shared_texture &res,resource_data &data)
+{
+    decoded_header h;
+    memcpy(&h,data.get_data(),sizeof(h));
+    const char *pixels=(const char *)data.get_data(sizeof(h));
+    if(!h.cube)
+        return res.tex.build_texture(pixels,h.width,h.height,color_format(h.format),h.mipmap_count);
+
+    const size_t face_size=(data.get_size()-sizeof(h))/6;
+    const void *faces[6];
+    for(int i=0;i<6;++i)
+        faces[i]=pixels+i*face_size;
+    return res.tex.build_cubemap(faces,h.width,h.height,color_format(h.format),h.mipmap_count);
+}
+
+//levels without their size prefixes, resource data may be a read-only view
+void copy_ktx_levels(const nya_formats::ktx &ktx,void *to)
+{
+    char *d=(char *)to;
     nya_memory::memory_reader r(ktx.data,ktx.data_size);
     for(unsigned int i=0;i<ktx.mipmap_count;++i)
     {
         const unsigned int size=r.read<unsigned int>();
-        memmove(d,r.get_data(),size);
+        memcpy(d,r.get_data(),size);
         r.skip(size);
         d+=size;
     }
+}
+
+bool get_color_format(nya_formats::dds::pixel_format pf,color_format &cf)
+{
+    switch(pf)
+    {
+        case nya_formats::dds::dxt1: cf=nya_render::texture::dxt1; break;
+        case nya_formats::dds::dxt2:
+        case nya_formats::dds::dxt3: cf=nya_render::texture::dxt3; break;
+        case nya_formats::dds::dxt4:
+        case nya_formats::dds::dxt5: cf=nya_render::texture::dxt5; break;
+
+        case nya_formats::dds::bgra: cf=nya_render::texture::color_bgra; break;
+        case nya_formats::dds::greyscale: cf=nya_render::texture::greyscale; break;
+        case nya_formats::dds::bgr: cf=nya_render::texture::color_rgb; break;
+        case nya_formats::dds::palette8_rgba: cf=nya_render::texture::color_rgba; break;
+
+        default: return false;
+    }
+
+    return true;
+}
+
+//bgr swizzle, palette and flip into buf after reserve bytes, dds.data is set to the converted pixels
+//false if the pixels are uploaded as they are
+bool convert_dds(nya_formats::dds &dds,bool flip,size_t reserve,nya_memory::tmp_buffer_ref &buf)
+{
+    //resource data may be a read-only view
+    if(dds.pf==nya_formats::dds::bgr)
+    {
+        buf.allocate(reserve+dds.data_size);
+        nya_formats::swap_red_blue(dds.data,buf.get_data(reserve),dds.data_size/3,3);
+        dds.data=buf.get_data(reserve);
+    }
+    else if(dds.pf==nya_formats::dds::palette8_rgba)
+    {
+        dds.data_size=dds.width*dds.height*4;
+        buf.allocate(reserve+dds.data_size);
+        dds.decode_palette8_rgba(buf.get_data(reserve));
+        dds.data=buf.get_data(reserve);
+        dds.pf=nya_formats::dds::bgra;
+    }
 
-    return res.tex.build_texture(ktx.data,ktx.width,ktx.height,cf,ktx.mipmap_count);
+    if(flip && dds.type==nya_formats::dds::texture_2d)
+    {
+        nya_memory::tmp_buffer_ref flipped(reserve+dds.data_size);
+        dds.flip_vertical(dds.data,flipped.get_data(reserve));
+        buf.free();
+        buf=flipped;
+        dds.data=buf.get_data(reserve);
+    }
+
+    return buf.get_size()>0;
+}
+
+//dxt the device doesn't support to rgba into buf after reserve bytes, dds is set to the transcoded pixels
+bool transcode_dds(nya_formats::dds &dds,const resource_data &data,const std::string &cache_folder,nya_memory::thread_pool *pool,
+                   size_t reserve,nya_memory::tmp_buffer_ref &buf,color_format &cf,int &mipmap_count)
+{
+    const int faces=dds.type==nya_formats::dds::texture_cube?6:1;
+    if(!transcode(dds,data,faces,nya_render::texture::color_rgba,cache_folder,pool,reserve,buf))
+        return false;
+
+    dds.data_size=buf.get_size()-reserve;
+    dds.data=buf.get_data(reserve);
+    dds.pf=nya_formats::dds::bgra;
+    cf=nya_render::texture::color_rgba;
+    if(mipmap_count>1)
+        mipmap_count= -1;
+
+    return true;
+}
+
+bool get_tga_color_format(int channels,color_format &out)
+{
+    switch(channels)
+    {
+        case 4: out=nya_render::texture::color_bgra; return true;
+        case 3: out=nya_render::texture::color_rgb; return true;
+        case 1: out=nya_render::texture::greyscale; return true;
+    }
+
+    return false;
+}
+
+}
+
+bool texture::decode_ktx(resource_data &data,const char* name)
+{
+    //streamed textures are read by update_streaming
+    if(m_streaming || !get_format_support().cached || data.get_size()<12 || memcmp((const char *)data.get_data()+1,"KTX ",4)!=0)
+        return false;
+
+    //errors are left to load_ktx
+    nya_formats::ktx ktx;
+    color_format cf;
+    if(!ktx.decode_header(data.get_data(),data.get_size()) || !get_color_format(ktx.pf,cf))
+        return false;
+
+    nya_memory::tmp_buffer_ref buf;
+    if(is_format_supported(cf))
+    {
+        buf.allocate(sizeof(decoded_header)+ktx.data_size);
+        copy_ktx_levels(ktx,buf.get_data(sizeof(decoded_header)));
+    }
+    else
+    {
+        if(cf>=nya_render::texture::pvr_rgb2b)
+            return false;
+
+        cf=get_transcode_format(cf);
+        if(!transcode(ktx,data,1,cf,m_transcode_cache_folder,0,sizeof(decoded_header),buf))
+            return false;
+    }
+
+    set_decoded(data,buf,ktx.width,ktx.height,cf,ktx.mipmap_count,false);
+    return true;
+}
+
+bool texture::load_ktx(shared_texture &res,resource_data &data,const char* name)
+{
+    if(!data.get_size())
+        return false;
+
+    if(is_decoded(data))
+        return build_decoded(res,data);
+
+    cache_format_support();
+    if(data.get_size()<12)
+        return false;
+
+    char sign[5];
+    if(!data.read_chunk(sign,sizeof(sign),0) || memcmp(sign+1,"KTX ",4)!=0)
+        return false;
+
+    if(m_streaming)
+    {
+        texture_stream *s=create_ktx_stream(data);
+        if(s)
+            return start_stream(s,res,data,name,m_stream_first_size);
+    }
+
+    nya_formats::ktx ktx;
+    const size_t header_size=ktx.decode_header(data.get_data(),data.get_size());
+    if(!header_size)
+    {
+        nya_log::log()<<"unable to load ktx: invalid or unsupported ktx header in file "<<name<<"\n";
+        return false;
+    }
+
+    nya_render::texture::color_format cf;
+    if(!get_color_format(ktx.pf,cf))
+    {
+        nya_log::log()<<"unable to load ktx: unsupported color format in file "<<name<<"\n";
+        return false;
+    }
+
+    nya_memory::tmp_buffer_ref tmp_buf;
+    if(!is_format_supported(cf))
+    {
+        if(cf>=nya_render::texture::pvr_rgb2b)
+        {
+            nya_log::log()<<"unable to load ktx: pvr compression is not supported by device, file "<<name<<"\n";
+            return false;
+        }
+
+        const color_format to=get_transcode_format(cf);
+        if(!transcode(ktx,data,1,to,m_transcode_cache_folder,get_transcode_pool(m_transcode_threads),0,tmp_buf))
+        {
+            nya_log::log()<<"unable to load ktx: unable to transcode file "<<name<<"\n";
+            return false;
+        }
+
+        const bool result=res.tex.build_texture(tmp_buf.get_data(),ktx.width,ktx.height,to,ktx.mipmap_count);
+        tmp_buf.free();
+        return result;
+    }
+
+    tmp_buf.allocate(ktx.data_size);
+    copy_ktx_levels(ktx,tmp_buf.get_data());
+    const bool result=res.tex.build_texture(tmp_buf.get_data(),ktx.width,ktx.height,cf,ktx.mipmap_count);
+    tmp_buf.free();
+    return result;
 }
 
 bool texture::m_load_dds_flip=false;
 
+bool texture::decode_dds(resource_data &data,const char* name)
+{
+    //streamed textures are read by update_streaming
+    if(m_streaming || !get_format_support().cached || data.get_size()<4 || memcmp(data.get_data(),"DDS ",4)!=0)
+        return false;
+
+    //errors are left to load_dds
+    nya_formats::dds dds;
+    color_format cf;
+    if(!dds.decode_header(data.get_data(),data.get_size()) || !get_color_format(dds.pf,cf))
+        return false;
+
+    if(dds.pf==nya_formats::dds::palette8_rgba && (dds.mipmap_count!=1 || dds.type!=nya_formats::dds::texture_2d))
+        return false;
+
+    int mipmap_count=dds.need_generate_mipmaps?-1:dds.mipmap_count;
+    nya_memory::tmp_buffer_ref buf;
+    if(!is_format_supported(cf) && !transcode_dds(dds,data,m_transcode_cache_folder,0,sizeof(decoded_header),buf,cf,mipmap_count))
+        return false;
+
+    nya_memory::tmp_buffer_ref converted;
+    if(convert_dds(dds,m_load_dds_flip,sizeof(decoded_header),converted))
+    {
+        buf.free();
+        buf=converted;
+    }
+
+    //supported formats without conversions are uploaded from the resource data as is
+    if(!buf.get_size())
+        return false;
+
+    set_decoded(data,buf,dds.width,dds.height,cf,mipmap_count,dds.type==nya_formats::dds::texture_cube);
+    return true;
+}
+
 bool texture::load_dds(shared_texture &res,resource_data &data,const char* name)
 {
     if(!data.get_size())
         return false;
 
+    if(is_decoded(data))
+        return build_decoded(res,data);
+
+    cache_format_support();
     if(data.get_size()<4)
         return false;
 
-    if(memcmp(data.get_data(),"DDS ",4)!=0)
+    char sign[4];
+    if(!data.read_chunk(sign,sizeof(sign),0) || memcmp(sign,"DDS ",4)!=0)
         return false;
 
+    if(m_streaming)
+    {
+        texture_stream *s=create_dds_stream(data,m_load_dds_flip);
+        if(s)
+            return start_stream(s,res,data,name,m_stream_first_size);
+    }
+
     nya_formats::dds dds;
     const size_t header_size=dds.decode_header(data.get_data(),data.get_size());
     if(!header_size)
@@ -98,91 +954,40 @@ bool texture::load_dds(shared_texture &res,resource_data &data,const char* name)
         return false;
     }
 
-    nya_memory::tmp_buffer_ref tmp_buf;
-
-    int mipmap_count=dds.need_generate_mipmaps?-1:dds.mipmap_count;
     nya_render::texture::color_format cf;
-    switch(dds.pf)
+    if(!get_color_format(dds.pf,cf))
     {
-        case nya_formats::dds::dxt1: cf=nya_render::texture::dxt1; break;
-        case nya_formats::dds::dxt2:
-        case nya_formats::dds::dxt3: cf=nya_render::texture::dxt3; break;
-        case nya_formats::dds::dxt4:
-        case nya_formats::dds::dxt5: cf=nya_render::texture::dxt5; break;
-
-        case nya_formats::dds::bgra: cf=nya_render::texture::color_bgra; break;
-        case nya_formats::dds::greyscale: cf=nya_render::texture::greyscale; break;
-
-        case nya_formats::dds::bgr:
-        {
-            bgr_to_rgb((unsigned char*)dds.data,dds.data_size);
-            cf=nya_render::texture::color_rgb;
-        }
-        break;
-
-        case nya_formats::dds::palette8_rgba:
-        {
-            if(dds.mipmap_count!=1 || dds.type!=nya_formats::dds::texture_2d) //ToDo
-            {
-                nya_log::log()<<"unable to load dds: uncomplete palette8_rgba support, unable to load file "<<name<<"\n";
-                return false;
-            }
+        nya_log::log()<<"unable to load dds: unsupported color format in file "<<name<<"\n";
+        return false;
+    }
 
-            cf=nya_render::texture::color_rgba;
-            dds.data_size=dds.width*dds.height*4;
-            tmp_buf.allocate(dds.data_size);
-            dds.decode_palette8_rgba(tmp_buf.get_data());
-            dds.data=tmp_buf.get_data();
-            dds.pf=nya_formats::dds::bgra;
-        }
-        break;
+    if(dds.pf==nya_formats::dds::palette8_rgba && (dds.mipmap_count!=1 || dds.type!=nya_formats::dds::texture_2d)) //ToDo
+    {
+        nya_log::log()<<"unable to load dds: uncomplete palette8_rgba support, unable to load file "<<name<<"\n";
+        return false;
+    }
 
-        default: nya_log::log()<<"unable to load dds: unsupported color format in file "<<name<<"\n"; return false;
+    int mipmap_count=dds.need_generate_mipmaps?-1:dds.mipmap_count;
+    nya_memory::tmp_buffer_ref tmp_buf;
+    if(!is_format_supported(cf) && !transcode_dds(dds,data,m_transcode_cache_folder,get_transcode_pool(m_transcode_threads),0,
+                                                  tmp_buf,cf,mipmap_count))
+    {
+        nya_log::log()<<"unable to load dds: unable to transcode file "<<name<<"\n";
+        return false;
     }
 
-    bool result=false;
+    nya_memory::tmp_buffer_ref converted;
+    convert_dds(dds,m_load_dds_flip,0,converted);
 
+    bool result=false;
     switch(dds.type)
     {
         case nya_formats::dds::texture_2d:
-        {
-            if(!nya_render::texture::is_dxt_supported())
-            {
-                tmp_buf.allocate(dds.get_decoded_size());
-                dds.decode_dxt(tmp_buf.get_data());
-                dds.data_size=tmp_buf.get_size();
-                dds.data=tmp_buf.get_data();
-                cf=nya_render::texture::color_rgba;
-                dds.pf=nya_formats::dds::bgra;
-                if(mipmap_count>1)
-                    mipmap_count= -1;
-            }
-
-            if(m_load_dds_flip)
-            {
-                nya_memory::tmp_buffer_scoped tmp_data(dds.data_size);
-                dds.flip_vertical(dds.data,tmp_data.get_data());
-                result=res.tex.build_texture(tmp_data.get_data(),dds.width,dds.height,cf,mipmap_count);
-            }
-            else
-                result=res.tex.build_texture(dds.data,dds.width,dds.height,cf,mipmap_count);
-        }
-        break;
+            result=res.tex.build_texture(dds.data,dds.width,dds.height,cf,mipmap_count);
+            break;
 
         case nya_formats::dds::texture_cube:
         {
-            if(!nya_render::texture::is_dxt_supported())
-            {
-                tmp_buf.allocate(dds.get_decoded_size());
-                dds.decode_dxt(tmp_buf.get_data());
-                dds.data_size=tmp_buf.get_size();
-                dds.data=tmp_buf.get_data();
-                cf=nya_render::texture::color_rgba;
-                dds.pf=nya_formats::dds::bgra;
-                if(mipmap_count>1)
-                    mipmap_count= -1;
-            }
-
             const void *data[6];
             for(int i=0;i<6;++i)
                 data[i]=(const char *)dds.data+i*dds.data_size/6;
@@ -190,92 +995,87 @@ bool texture::load_dds(shared_texture &res,resource_data &data,const char* name)
         }
         break;
 
-        default:
-        {
-            nya_log::log()<<"unable to load dds: unsupported texture type in file "<<name<<"\n";
-            tmp_buf.free();
-            return false;
-        }
+        default: nya_log::log()<<"unable to load dds: unsupported texture type in file "<<name<<"\n"; break;
     }
 
+    converted.free();
     tmp_buf.free();
     return result;
 }
 
+bool texture::decode_tga(resource_data &data,const char* name)
+{
+    //tga has no signature, other formats are only told apart by trying their load functions first
+    if(!data.get_size() || !nya_resources::check_extension(name,".tga"))
+        return false;
+
+    nya_formats::tga tga;
+    const size_t header_size=tga.decode_header(data.get_data(),data.get_size());
+    color_format cf;
+    if(!header_size || !get_tga_color_format(tga.channels,cf))
+        return false;
+
+    //plain data is uploaded from the resource data as is, errors are reported by load_tga
+    if(!tga.rle && tga.channels!=3 && !tga.horisontal_flip && !tga.vertical_flip)
+        return false;
+
+    if(!tga.rle && header_size+tga.uncompressed_size>data.get_size())
+        return false;
+
+    nya_memory::tmp_buffer_ref buf(sizeof(decoded_header)+tga.uncompressed_size);
+    if(!tga.decode(buf.get_data(sizeof(decoded_header)),tga.channels==3))
+    {
+        buf.free();
+        return false;
+    }
+
+    set_decoded(data,buf,tga.width,tga.height,cf,-1,false);
+    return true;
+}
+
 bool texture::load_tga(shared_texture &res,resource_data &data,const char* name)
 {
     if(!data.get_size())
         return false;
 
+    if(is_decoded(data))
+        return build_decoded(res,data);
+
     nya_formats::tga tga;
     const size_t header_size=tga.decode_header(data.get_data(),data.get_size());
     if(!header_size)
         return false;
 
-    nya_render::texture::color_format color_format;
-    switch(tga.channels)
+    color_format cf;
+    if(!get_tga_color_format(tga.channels,cf))
     {
-        case 4: color_format=nya_render::texture::color_bgra; break;
-        case 3: color_format=nya_render::texture::color_rgb; break;
-        case 1: color_format=nya_render::texture::greyscale; break;
-        default: nya_log::log()<<"unable to load tga: unsupported color format in file "<<name<<"\n"; return false;
+        nya_log::log()<<"unable to load tga: unsupported color format in file "<<name<<"\n";
+        return false;
     }
 
-    typedef unsigned char uchar;
+    if(!tga.rle && header_size+tga.uncompressed_size>data.get_size())
+    {
+        nya_log::log()<<"unable to load tga: lack of data, probably corrupted file "<<name<<"\n";
+        return false;
+    }
 
     nya_memory::tmp_buffer_ref tmp_data;
     const void *color_data=tga.data;
-    if(tga.rle)
+    if(tga.rle || tga.channels==3 || tga.horisontal_flip || tga.vertical_flip)
     {
+        //rle, flips and bgr swizzle in one pass, resource data may be a read-only view
         tmp_data.allocate(tga.uncompressed_size);
-        if(!tga.decode_rle(tmp_data.get_data()))
+        if(!tga.decode(tmp_data.get_data(),tga.channels==3))
         {
             tmp_data.free();
-            nya_log::log()<<"unable to load tga: unable to decode rle in file "<<name<<"\n";
+            nya_log::log()<<"unable to load tga: unable to decode file "<<name<<"\n";
             return false;
         }
 
         color_data=tmp_data.get_data();
     }
-    else if(header_size+tga.uncompressed_size>data.get_size())
-    {
-        nya_log::log()<<"unable to load tga: lack of data, probably corrupted file "<<name<<"\n";
-        return false;
-    }
-
-    if(tga.channels==3 || tga.horisontal_flip || tga.vertical_flip)
-    {
-        if(!tmp_data.get_data())
-        {
-            tmp_data.allocate(tga.uncompressed_size);
-
-            if(tga.horisontal_flip || tga.vertical_flip)
-            {
-                if(tga.horisontal_flip)
-                    tga.flip_horisontal(color_data,tmp_data.get_data());
-
-                if(tga.vertical_flip)
-                    tga.flip_vertical(color_data,tmp_data.get_data());
-            }
-            else
-                tmp_data.copy_from(color_data,tga.uncompressed_size);
-
-            color_data=tmp_data.get_data();
-        }
-        else
-        {
-            if(tga.horisontal_flip)
-                tga.flip_horisontal(tmp_data.get_data(),tmp_data.get_data());
-
-            if(tga.vertical_flip)
-                tga.flip_vertical(tmp_data.get_data(),tmp_data.get_data());
-        }
-
-        if(tga.channels==3)
-            bgr_to_rgb((uchar*)color_data,tga.uncompressed_size);
-    }
 
-    const bool result=res.tex.build_texture(color_data,tga.width,tga.height,color_format);
+    const bool result=res.tex.build_texture(color_data,tga.width,tga.height,cf);
     tmp_data.free();
 
     return result;
@@ -308,6 +1108,10 @@ unsigned int texture::get_width() const
     if( !internal().get_shared_data().is_valid() )
         return 0;
 
+    const texture_stream *s=find_stream(internal().get_shared_data().const_get());
+    if(s)
+        return s->width;
+
     return internal().get_shared_data()->tex.get_width();
 }
 
@@ -316,6 +1120,10 @@ unsigned int texture::get_height() const
     if(!internal().get_shared_data().is_valid())
         return 0;
 
+    const texture_stream *s=find_stream(internal().get_shared_data().const_get());
+    if(s)
+        return s->height;
+
     return internal().get_shared_data()->tex.get_height();
 }
 
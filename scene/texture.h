@@ -13,13 +13,11 @@ struct shared_texture
 {
     nya_render::texture tex;
 
-    bool release()
-    {
-        tex.release();
-        return true;
-    }
+    bool release(); //also stops streaming
 };
 
+inline size_t get_shared_resource_size(const shared_texture &res) { return sizeof(res)+res.tex.get_vmem_size(); }
+
 class texture_internal: public scene_shared<shared_texture>
 {
     friend class texture;
@@ -41,18 +39,27 @@ public:
     bool load(const char *name) { return m_internal.load(name); }
     void unload() { return m_internal.unload(); }
 
+    //see scene_shared::load_async; main thread only, device formats support is queried here for the decode functions
+    bool load_async(const char *name,texture_internal::load_callback callback=0,void *user_data=0);
+    bool is_loading() const { return m_internal.is_loading(); }
+
 public:
     void create(const shared_texture &res) { m_internal.create(res); }
 
 public:
     static void set_resources_prefix(const char *prefix) { texture_internal::set_resources_prefix(prefix); }
     static void register_load_function(texture_internal::load_function function,bool clear_default=true) { texture_internal::register_load_function(function,clear_default); }
+    static void set_unused_cache_size(size_t size) { texture_internal::set_unused_cache_size(size); }
+
+    //textures with identical file data share one gpu texture, see scene_shared::set_content_dedup
+    static void set_content_dedup(bool enable) { texture_internal::set_content_dedup(enable); }
+    static const texture_internal::content_dedup_stats &get_content_dedup_stats() { return texture_internal::get_content_dedup_stats(); }
 
 public:
     typedef nya_render::texture::color_format color_format;
 
     const char *get_name() const { return internal().get_name(); }
-    unsigned int get_width() const;
+    unsigned int get_width() const; //of the full texture while its mips are streamed
     unsigned int get_height() const;
     color_format get_format() const;
     bool is_cubemap() const;
@@ -61,9 +68,9 @@ public:
     bool build(const void *data,unsigned int width,unsigned int height,color_format format);
 
 public:
-    texture() { texture_internal::default_load_function(load_tga);
-                texture_internal::default_load_function(load_dds);
-                texture_internal::default_load_function(load_ktx); }
+    texture() { texture_internal::default_load_function(load_dds,decode_dds);
+                texture_internal::default_load_function(load_ktx,decode_ktx);
+                texture_internal::default_load_function(load_tga,decode_tga); }
 
     texture(const char *name) { *this=texture(); load(name); }
 
@@ -72,14 +79,42 @@ public:
     static bool load_dds(shared_texture &res,resource_data &data,const char* name);
     static bool load_ktx(shared_texture &res,resource_data &data,const char* name);
 
+    //rle, flips, swizzle, mip repacking and transcoding on async_loader threads, see scene_shared::register_decode_function
+    static bool decode_tga(resource_data &data,const char* name);
+    static bool decode_dds(resource_data &data,const char* name);
+    static bool decode_ktx(resource_data &data,const char* name);
+
     static void set_load_dds_flip(bool flip) { m_load_dds_flip=flip; }
 
+    //etc and dxt textures the device doesn't support are transcoded on load,
+    //etc to dxt if it is supported, otherwise to rgba; pvr textures are not transcoded
+    //transcoded data is kept in the folder by source file hash, 0 to disable; set it before loading
+    static void set_transcode_cache_folder(const char *folder);
+    //threads of the pool kept for textures transcoded by load, 0 for hardware threads count;
+    //async loads transcode each texture on its loader thread
+    static void set_transcode_threads_count(unsigned int count) { m_transcode_threads=count; }
+
+    //2d dds and ktx textures with mipmaps are loaded starting from the smallest mips,
+    //levels up to first_size are uploaded on load and larger ones by update_streaming,
+    //the texture is rebuilt at the size of the largest level uploaded so far
+    //resources are opened without reading, see scene_shared::set_deferred_read
+    static void set_streaming(bool enable,unsigned int first_size=64);
+    //reads and uploads mips until budget bytes are read, at least one chunk per call; 0 for no limit
+    //call once per frame from the main thread
+    static void update_streaming(size_t budget);
+    static void finish_streaming() { update_streaming(0); }
+    static size_t get_streaming_count(); //textures with mips not yet uploaded
+
 public:
     const texture_internal &internal() const { return m_internal; }
 
 private:
     texture_internal m_internal;
     static bool m_load_dds_flip;
+    static bool m_streaming;
+    static unsigned int m_stream_first_size;
+    static std::string m_transcode_cache_folder;
+    static unsigned int m_transcode_threads;
 };
 
 typedef proxy<texture> texture_proxy;
@@ -0,0 +1,13 @@
+#include "resources/file_resources_provider.h"
+#include <stdio.h>
+#include <unistd.h>
+int main(){
+ nya_resources::file_resources_provider p; p.set_folder("/tmp/t20/d"); p.build_index();
+ printf("%d %d %d\n",(int)p.get_size("sub/a.txt"),(int)p.get_size("b.txt"),(int)p.has("sub/f5"));
+ FILE*f=fopen("/tmp/t20/d/sub/a.txt","r+b"); fwrite("0123456789",1,10,f); fclose(f);
+ f=fopen("/tmp/t20/d/sub/f699","r+b"); fwrite("0123456789",1,10,f); fclose(f);
+ p.refresh_index();
+ printf("%d %d %d %d\n",(int)p.get_size("sub/a.txt"),(int)p.get_size("b.txt"),(int)p.get_size("sub/f699"),p.get_resources_count());
+ unlink("/tmp/t20/d/sub/f5"); p.refresh_index();
+ printf("%d %d\n",(int)p.has("sub/f5"),p.get_resources_count());
+}
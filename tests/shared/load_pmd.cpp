@@ -48,26 +48,27 @@ bool pmd_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
     std::vector<vert> vertices(vert_count);
     for(size_t i=0;i<vertices.size();++i)
     {
-        read_vector(vertices[i].pos,reader);
-        read_vector(vertices[i].normal,reader);
-
-        vertices[i].tc.x=reader.read<float>();
-        vertices[i].tc.y=1.0f-reader.read<float>();
-
-        vertices[i].bone_idx[0]=reader.read<ushort>();
-        vertices[i].bone_idx[1]=reader.read<ushort>();
-        vertices[i].bone_weight=reader.read<uchar>()/100.0f;
+        vert &v=vertices[i];
+        float f[8];
+        reader.read_array(f,8);
+        v.pos.x=f[0],v.pos.y=f[1],v.pos.z=-f[2];
+        v.normal.x=f[3],v.normal.y=f[4],v.normal.z=-f[5];
+        v.tc.x=f[6],v.tc.y=1.0f-f[7];
+
+        ushort bone_idx[2];
+        reader.read_array(bone_idx,2);
+        v.bone_idx[0]=bone_idx[0],v.bone_idx[1]=bone_idx[1];
+        v.bone_weight=reader.read<uchar>()/100.0f;
 
         reader.skip(1);
     }
     
     const uint ind_count=reader.read<uint>();
-    const size_t inds_size=sizeof(ushort)*ind_count;
-    if(!reader.check_remained(inds_size))
+    const char *indices=reader.read_array<char>(sizeof(ushort)*ind_count);
+    if(!indices && ind_count)
         return false;
 
-    res.vbo.set_index_data(data.get_data(reader.get_offset()),nya_render::vbo::index2b,ind_count);
-    reader.skip(inds_size);
+    res.vbo.set_index_data(indices,nya_render::vbo::index2b,ind_count);
 
     const uint mat_count=reader.read<uint>();
     if(!reader.check_remained(mat_count*(sizeof(pmd_material_params)+2+sizeof(uint)+20)))
@@ -104,8 +105,10 @@ bool pmd_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
         g.material_idx=i;
         ind_offset+=g.count;
 
-        const std::string tex_name((const char*)data.get_data(reader.get_offset()));
-        reader.skip(20);
+        //fixed size field, null-terminated only if shorter
+        const nya_memory::string_view tex_field=reader.read_string_view(20);
+        const char *tex_end=tex_field.data?(const char *)memchr(tex_field.data,0,tex_field.size):0;
+        const std::string tex_name(tex_field.data?tex_field.data:"",tex_end?tex_end-tex_field.data:tex_field.size);
 
         std::string base_tex=tex_name;
         size_t pos=base_tex.find('*');
@@ -331,7 +334,9 @@ bool pmd_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
 
             const uint idx=reader.read<uint>();
             v.idx=type?base_morph.verts[idx].idx:idx;
-            read_vector(v.pos,reader);
+            float f[3];
+            reader.read_array(f,3);
+            v.pos.x=f[0],v.pos.y=f[1],v.pos.z=-f[2];
         }
     }
 
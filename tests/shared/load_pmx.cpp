@@ -84,17 +84,14 @@ bool pmx_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
     for(int i=0;i<vert_count;++i)
     {
         vert &v=verts[i];
-        
-        v.pos.x=reader.read<float>();
-        v.pos.y=reader.read<float>();
-        v.pos.z=-reader.read<float>();
 
-        v.normal.x=reader.read<float>();
-        v.normal.y=reader.read<float>();
-        v.normal.z=-reader.read<float>();
-        
-        v.tc.x=reader.read<float>();
-        v.tc.y=1.0f-reader.read<float>();
+        float f[8]; //pos, normal, tc
+        reader.read_array(f,8);
+
+        v.pos=nya_math::vec3(f[0],f[1],-f[2]);
+        v.normal=nya_math::vec3(f[3],f[4],-f[5]);
+        v.tc.x=f[6];
+        v.tc.y=1.0f-f[7];
         reader.skip(header.extended_uv*sizeof(float)*4);
 
         switch(reader.read<char>())
@@ -147,17 +144,20 @@ bool pmx_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
     }
 
     const int indices_count=reader.read<int>();
-    if(header.index_size==2)
-        res.vbo.set_index_data(reader.get_data(),nya_render::vbo::index2b,indices_count);
-    else if(header.index_size==4)
-        res.vbo.set_index_data(reader.get_data(),nya_render::vbo::index4b,indices_count);
-    else
+    if(header.index_size!=2 && header.index_size!=4)
     {
         nya_log::log()<<"pmx load error: invalid index size\n";
         return false;
     }
 
-    reader.skip(indices_count*header.index_size);
+    const char *indices=reader.read_array<char>((size_t)indices_count*header.index_size);
+    if(!indices && indices_count)
+    {
+        nya_log::log()<<"pmx load error: invalid indices\n";
+        return false;
+    }
+
+    res.vbo.set_index_data(indices,header.index_size==2?nya_render::vbo::index2b:nya_render::vbo::index4b,indices_count);
 
     const int textures_count=reader.read<int>();
     std::vector<std::string> tex_names(textures_count);
@@ -220,13 +220,9 @@ bool pmx_loader::load(nya_scene::shared_mesh &res,nya_scene::resource_data &data
 
         for(int j=0;j<2;++j)
         {
-            const int name_len=reader.read<int>();
+            const nya_memory::string_view name=reader.read_string_view<int>();
             if(j==1)
-            {
-                std::string name((const char*)reader.get_data(),name_len);
-                m.set_name(name.c_str());
-            }
-            reader.skip(name_len);
+                m.set_name(name.data,name.size);
         }
 
         pmx_material_params params=reader.read<pmx_material_params>();
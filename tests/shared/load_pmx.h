@@ -4,8 +4,8 @@
 
 #include "load_pmd.h"
 
-namespace nya_memory { class memory_reader; class tmp_buffer_ref; }
-namespace nya_scene { class mesh; class shared_mesh; typedef nya_memory::tmp_buffer_ref resource_data; }
+namespace nya_memory { class memory_reader; }
+namespace nya_scene { class mesh; class shared_mesh; class resource_data; }
 
 struct pmx_loader
 {
@@ -9,17 +9,15 @@ inline unsigned int swap_byte_order(unsigned int ui) { return (ui >> 24) | ((ui<
 
 std::string read_string(nya_memory::memory_reader &reader)
 {
-    std::string out;
-    while(reader.get_remained())
-    {
-        const char c=reader.read<char>();
-        if(!c)
-            break;
+    const char *str=(const char *)reader.get_data();
+    const size_t remained=reader.get_remained();
+    const char *end=str?(const char *)memchr(str,0,remained):0;
 
-        out.push_back(c);
-    }
+    const nya_memory::string_view s=reader.read_string_view(end?end-str:remained);
+    if(end)
+        reader.skip(1);
 
-    return out;
+    return s.to_string();
 }
 
 struct shader_params
@@ -207,17 +205,18 @@ bool tdcg_loader::load_hardsave(nya_scene::shared_mesh &res,nya_scene::resource_
 
                         const uint shader_params_idx=reader.read<uint>();
                         const uint bone_indices_count=reader.read<uint>();
-                        for(uint k=0;k<bone_indices_count;++k)
-                            reader.read<uint>();
+                        reader.skip(bone_indices_count*sizeof(uint));
 
                         g.count=reader.read<uint>();
                         verts.resize(g.offset+g.count);
                         for(uint k=0;k<g.count;++k)
                         {
                             vert &v=verts[g.offset+k];
-                            v.pos=mat*reader.read<nya_math::vec3>();
-                            v.normal=(mat*nya_math::vec4(reader.read<nya_math::vec3>(),0.0f)).xyz().normalize();
-                            v.tc=reader.read<nya_math::vec2>();
+                            float f[8];
+                            reader.read_array(f,8);
+                            v.pos=mat*nya_math::vec3(f[0],f[1],f[2]);
+                            v.normal=(mat*nya_math::vec4(f[3],f[4],f[5],0.0f)).xyz().normalize();
+                            v.tc=nya_math::vec2(f[6],f[7]);
                             const uint skin_count=reader.read<uint>();
                             if(skin_count>4)
                             {
@@ -6,8 +6,7 @@
 #include <vector>
 #include <string>
 
-namespace nya_memory { class tmp_buffer_ref; }
-namespace nya_scene { class mesh; class shared_mesh; typedef nya_memory::tmp_buffer_ref resource_data; }
+namespace nya_scene { class mesh; class shared_mesh; class resource_data; }
 
 struct tdcg_loader
 {
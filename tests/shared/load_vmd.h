@@ -1,7 +1,6 @@
 //https://code.google.com/p/nya-engine/
 
-namespace nya_memory { class tmp_buffer_ref; }
-namespace nya_scene { class shared_animation; typedef nya_memory::tmp_buffer_ref resource_data; }
+namespace nya_scene { class shared_animation; class resource_data; }
 
 class vmd_loader
 {
@@ -149,9 +149,7 @@ public:
         if(len>get_remained())
             return "";
 
-        std::string ret((const char *)get_data(),len);
-        skip(len);
-        return ret;
+        return read_string_view(len).to_string();
     }
 
     nya_math::vec2 read_tc() { nya_math::vec2 v; v.x=read<float>(); v.y=1.0f-read<float>(); return v; }
@@ -162,13 +160,8 @@ public:
     skining read_skining()
     {
         skining s;
-
-        for(int i=0;i<4;++i)
-            s.inds[i]=read<unsigned short>();
-
-        for(int i=0;i<4;++i)
-            s.weights[i]=read<float>();
-
+        read_array(s.inds,4);
+        read_array(s.weights,4);
         return s;
     }
 
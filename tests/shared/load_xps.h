@@ -4,8 +4,8 @@
 
 #include "math/vector.h"
 
-namespace nya_memory { class memory_reader; class tmp_buffer_ref; }
-namespace nya_scene { class mesh; class shared_mesh; class shared_animation; typedef nya_memory::tmp_buffer_ref resource_data; }
+namespace nya_memory { class memory_reader; }
+namespace nya_scene { class mesh; class shared_mesh; class shared_animation; class resource_data; }
 
 struct xps_loader
 {
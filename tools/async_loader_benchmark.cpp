@@ -0,0 +1,222 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "scene/texture.h"
+#include "scene/async_loader.h"
+#include "resources/file_resources_provider.h"
+#include "memory/tmp_buffer.h"
+#include "system/app.h"
+#include "system/system.h"
+
+const char *help="Usage: async_loader_benchmark [-threads %%count%%] [-mmap] [-flip] [-cancel %%n%%] folder\n"
+                 "loads every dds, ktx and tga texture in the folder with texture::load and then with load_async,\n"
+                 "async loads are read and decoded on the loader threads and only uploaded by async_loader::update\n"
+                 "checks that the async textures match the sync ones, the first level is compared where it can be read back,\n"
+                 "prints both times and the longest main thread stall: a sync load or an update call\n"
+                 "every n-th async request is canceled by unloading it right after load_async, 0 for none\n"
+                 "-flip loads dds textures with texture::set_load_dds_flip\n"
+                 "the second pass reads from the os file cache, drop it to measure cold reads\n"
+                 "needs a window for the gl context\n"
+                 "\n";
+
+struct reference
+{
+    unsigned int width;
+    unsigned int height;
+    int format;
+    bool cube;
+    std::vector<char> data; //first level, empty if it can't be read back
+};
+
+static void get_reference(const nya_scene::texture &t,reference &r)
+{
+    r.width=t.get_width();
+    r.height=t.get_height();
+    r.format=t.get_format();
+    r.cube=t.is_cubemap();
+    r.data.clear();
+
+    const nya_scene::shared_texture *res=t.internal().get_shared_data().const_get();
+    nya_memory::tmp_buffer_ref buf;
+    if(res && res->tex.get_data(buf) && buf.get_size())
+    {
+        r.data.resize(buf.get_size());
+        buf.copy_to(&r.data[0],buf.get_size());
+    }
+
+    buf.free();
+}
+
+static bool is_equal(const reference &a,const reference &b)
+{
+    return a.width==b.width && a.height==b.height && a.format==b.format && a.cube==b.cube && a.data==b.data;
+}
+
+static int loaded_count=0,failed_count=0;
+
+static void on_load(const char *name,bool success,void *user_data)
+{
+    if(success)
+        ++loaded_count;
+    else
+        ++failed_count;
+}
+
+class benchmark: public nya_system::app
+{
+public:
+    unsigned int threads,cancel_step;
+    bool mmap,flip;
+    const char *folder;
+    int result;
+
+    //the whole benchmark runs in on_init with the gl context current
+    void on_init() { result=run(); finish(); exit(result); }
+
+    int run()
+    {
+        nya_resources::file_resources_provider provider;
+        if(!provider.set_folder(folder))
+        {
+            printf("unable to open folder %s\n",folder);
+            return -1;
+        }
+
+        provider.enable_mmap(mmap);
+        nya_resources::set_resources_provider(&provider);
+        nya_scene::texture::set_load_dds_flip(flip);
+        nya_scene::texture_internal::set_unused_cache_size(0);
+
+        std::vector<std::string> names;
+        size_t total_size=0;
+        for(int i=0;i<provider.get_resources_count();++i)
+        {
+            const char *name=provider.get_resource_name(i);
+            if(!nya_resources::check_extension(name,".dds") && !nya_resources::check_extension(name,".ktx")
+               && !nya_resources::check_extension(name,".tga"))
+                continue;
+
+            names.push_back(name);
+            nya_resources::resource_data *res=provider.access(name);
+            if(res)
+                total_size+=res->get_size(),res->release();
+        }
+
+        //unloaded right away so that async loads don't get them from the shared resources
+        std::vector<reference> references(names.size());
+        unsigned long sync_time=0,sync_stall=0;
+        for(size_t i=0;i<names.size();++i)
+        {
+            nya_scene::texture t;
+            const unsigned long start=nya_system::get_time();
+            if(!t.load(names[i].c_str()))
+            {
+                printf("unable to load %s\n",names[i].c_str());
+                return -1;
+            }
+
+            const unsigned long time=nya_system::get_time()-start;
+            sync_time+=time;
+            if(time>sync_stall)
+                sync_stall=time;
+
+            get_reference(t,references[i]);
+            t.unload();
+        }
+
+        if(!nya_scene::async_loader::start(threads))
+        {
+            printf("unable to start async loader\n");
+            return -1;
+        }
+
+        std::vector<nya_scene::texture> textures(names.size());
+        int canceled_count=0;
+        unsigned long async_stall=0;
+        unsigned long async_time=nya_system::get_time();
+        for(size_t i=0;i<names.size();++i)
+        {
+            textures[i].load_async(names[i].c_str(),on_load,0);
+            if(cancel_step && i%cancel_step==cancel_step-1)
+                textures[i].unload(),++canceled_count;
+        }
+
+        while(nya_scene::async_loader::get_pending_count())
+        {
+            const unsigned long start=nya_system::get_time();
+            nya_scene::async_loader::update(1);
+            const unsigned long time=nya_system::get_time()-start;
+            if(time>async_stall)
+                async_stall=time;
+        }
+        async_time=nya_system::get_time()-async_time;
+
+        int mismatch_count=0;
+        for(size_t i=0;i<names.size();++i)
+        {
+            if(cancel_step && i%cancel_step==cancel_step-1)
+            {
+                if(textures[i].is_loading() || textures[i].get_width())
+                    ++mismatch_count;
+                continue;
+            }
+
+            reference r;
+            get_reference(textures[i],r);
+            if(!is_equal(r,references[i]))
+            {
+                printf("async texture mismatch in %s\n",names[i].c_str());
+                ++mismatch_count;
+            }
+        }
+
+        textures.clear();
+        nya_scene::async_loader::stop();
+
+        const double mb=total_size/(1024.0*1024.0);
+        printf("%d textures, %.1f MB, %s: sync %lu ms, longest load %lu ms; async %lu ms, longest update %lu ms; "
+               "%d loaded, %d failed, %d canceled, %s\n",(int)names.size(),mb,mmap?"mmap":"read",sync_time,sync_stall,
+               async_time,async_stall,loaded_count,failed_count,canceled_count,mismatch_count?"MISMATCH":"match");
+
+        return mismatch_count || failed_count?-1:0;
+    }
+
+    benchmark(): threads(0),cancel_step(7),mmap(false),flip(false),folder(0),result(0) {}
+};
+
+int main(int argc,char **argv)
+{
+    benchmark b;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-threads")==0 && i+1<argc)
+            b.threads=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-cancel")==0 && i+1<argc)
+            b.cancel_step=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-mmap")==0)
+            b.mmap=true;
+        else if(strcmp(argv[i],"-flip")==0)
+            b.flip=true;
+        else if(argv[i][0]!='-' && !b.folder)
+            b.folder=argv[i];
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(!b.folder)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    b.start_windowed(0,0,64,64,0);
+    printf("unable to create window\n");
+    return -1;
+}
@@ -0,0 +1,260 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include "formats/dds.h"
+#include "system/system.h"
+
+const char *help="Usage: dxt_benchmark [-threads %%count%%] [-min_time %%ms%%]\n"
+                 "decodes random dxt1/dxt3/dxt5 textures of several sizes with nya_formats::dds::decode_dxt\n"
+                 "reports decoded MB/s and checks the output bit-exact against the reference scalar decoder\n"
+                 "threads count 0 for hardware threads count, 1 by default\n"
+                 "\n";
+
+using nya_formats::dds;
+
+//block at a time decoder as it was before the simd one, kept for comparison
+
+static int unpack565(const unsigned char* src,unsigned char* dst)
+{
+    typedef unsigned char uchar;
+
+    int value=(int)src[0] | ((int)src[1]<<8);
+
+    const uchar r=(uchar)((value >> 11) & 0x1f);
+    const uchar g=(uchar)((value >> 5) & 0x3f);
+    const uchar b=(uchar)(value & 0x1f);
+
+    dst[0]=(r << 3) | (r >> 2);
+    dst[1]=(g << 2) | (g >> 4);
+    dst[2]=(b << 3) | (b >> 2);
+    dst[3]=255;
+
+    return value;
+}
+
+static void decompress_color(const void *src,void *dst,bool is_dxt1)
+{
+    typedef unsigned char uchar;
+
+    const uchar* src_buf=(uchar *)src;
+    if(!is_dxt1)
+        src_buf+=8;
+
+    uchar codes[16];
+    const int a=unpack565(src_buf,codes), b=unpack565(src_buf+2,codes+4);
+
+    for(int i=0;i<3;++i)
+    {
+        const int c=codes[i], d=codes[i+4];
+
+        if(is_dxt1 && a<=b)
+        {
+            codes[i+8]=(uchar)((c+d)/2);
+            codes[i+12]=0;
+        }
+        else
+        {
+            codes[i+8]=(uchar)((c*2+d)/3);
+            codes[i+12]=(uchar)((c+d*2)/3);
+        }
+    }
+
+    codes[8+3]=255;
+    codes[12+3]=(is_dxt1 && a<=b)?0:255;
+
+    uchar indices[16];
+    for(int i=0;i<4;++i)
+    {
+        const uchar packed=src_buf[i+4];
+        uchar* ind=indices + i*4;
+
+        ind[0]=packed & 0x3;
+        ind[1]=(packed >> 2) & 0x3;
+        ind[2]=(packed >> 4) & 0x3;
+        ind[3]=(packed >> 6) & 0x3;
+    }
+
+    for(int i=0;i<16;++i)
+    {
+        const uchar offset=indices[i]*4;
+        for(int j=0;j<4;++j)
+            ((uchar *)dst)[i*4 + j]=codes[offset+j];
+    }
+}
+
+static void decompress_dxt3_alpha(const void *src,void *dst)
+{
+    typedef unsigned char uchar;
+
+    const uchar *src_buf=(uchar *)src;
+    uchar *dst_buf=(uchar *)dst;
+
+    for(int i=0;i<8*8;i+=8,++src_buf)
+    {
+        const uchar lo= *src_buf & 0x0f, hi= *src_buf & 0xf0;
+        dst_buf[i+3] = lo | (lo<<4);
+        dst_buf[i+7] = hi | (hi>>4);
+    }
+}
+
+static void decompress_dxt5_alpha(const void *src,void *dst)
+{
+    typedef unsigned char uchar;
+
+    const uchar *src_buf=(uchar *)src;
+    uchar *dst_buf=(uchar *)dst;
+
+    const int alpha0=src_buf[0], alpha1=src_buf[1];
+
+    uchar codes[8];
+    codes[0]=src_buf[0], codes[1]=src_buf[1];
+    if(alpha0<=alpha1)
+    {
+        for(int i=1;i<5;++i)
+            codes[i+1]=(uchar)(((5-i)*alpha0 + i*alpha1 )/5);
+
+        codes[6]=0, codes[7]=255;
+    }
+    else
+    {
+        for(int i=1;i<7;++i)
+            codes[i+1]=(uchar)(((7-i)*alpha0 + i*alpha1 )/7);
+    }
+
+    src_buf+=2;
+    uchar indices[16];
+    uchar* dest=indices;
+    for(int i=0;i<2;++i)
+    {
+        unsigned int value=0;
+        for(int j=0;j<3;++j)
+            value|=((*src_buf++) << 8*j);
+
+        for(int j=0;j<8;++j)
+            *dest++ = (uchar)(value >> 3*j) & 0x7;
+    }
+
+    for(int i=0;i<16;++i)
+        dst_buf[4*i+3]=codes[indices[i]];
+}
+
+void reference_decode_dxt(const dds &d,void *decoded_data)
+{
+    typedef unsigned int uint;
+    const char* src_buf=(char *)d.data;
+    const uint bpb=d.pf==dds::dxt1?8:16;
+
+    for(int f=0;f<(d.type==dds::texture_cube?6:1);++f)
+    {
+        for(uint i=0,w=d.width,h=d.height;i<d.mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+        {
+            for(uint y=0;y<h;y+=4) for(uint x=0;x<w;x+=4)
+            {
+                uint rgba[16];
+
+                switch(d.pf)
+                {
+                    case dds::dxt1: decompress_color(src_buf,rgba,true); break;
+
+                    case dds::dxt2:
+                    case dds::dxt3:
+                        decompress_color(src_buf,rgba,false);
+                        decompress_dxt3_alpha(src_buf,rgba);
+                        break;
+
+                    case dds::dxt4:
+                    case dds::dxt5:
+                        decompress_color(src_buf,rgba,false);
+                        decompress_dxt5_alpha(src_buf,rgba);
+                        break;
+
+                    default: return;
+                }
+
+                for(uint py=0,sy=y; py<16 && sy<h; py+=4,++sy)
+                    memcpy((uint *)decoded_data+w*sy+x,&rgba[py],((x+4<w)?4:(w-x))*sizeof(uint));
+
+                src_buf+=bpb;
+            }
+
+            decoded_data=(char *)decoded_data+(w*h)*4;
+        }
+    }
+}
+
+
+size_t get_blocks_size(const dds &d)
+{
+    size_t size=0;
+    for(unsigned int i=0,w=d.width,h=d.height;i<d.mipmap_count;++i,w>1?w/=2:w=1,h>1?h/=2:h=1)
+        size+=((w+3)/4)*((h+3)/4)*(d.pf==dds::dxt1?8:16);
+
+    return d.type==dds::texture_cube?size*6:size;
+}
+
+int main(int argc,char **argv)
+{
+    unsigned int threads=1;
+    unsigned long min_time=300;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-threads")==0 && i+1<argc)
+            threads=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    const dds::pixel_format formats[]={dds::dxt1,dds::dxt3,dds::dxt5};
+    const char *format_names[]={"dxt1","dxt3","dxt5"};
+    const unsigned int sizes[][3]={{64,64,1},{256,256,1},{1024,1024,1},{2048,2048,1},{1000,600,1},{1024,1024,11},{257,131,9}};
+
+    srand(0);
+    bool failed=false;
+    for(size_t f=0;f<sizeof(formats)/sizeof(formats[0]);++f)
+    {
+        for(size_t s=0;s<sizeof(sizes)/sizeof(sizes[0]);++s)
+        {
+            dds d;
+            d.pf=formats[f];
+            d.width=sizes[s][0];
+            d.height=sizes[s][1];
+            d.mipmap_count=sizes[s][2];
+            d.type=dds::texture_2d;
+
+            std::vector<unsigned char> blocks(get_blocks_size(d));
+            for(size_t i=0;i<blocks.size();++i)
+                blocks[i]=(unsigned char)rand();
+
+            d.data=&blocks[0];
+            d.data_size=blocks.size();
+
+            std::vector<unsigned char> reference(d.get_decoded_size()), decoded(d.get_decoded_size());
+            reference_decode_dxt(d,&reference[0]);
+
+            unsigned long ref_time=0, time=0;
+            unsigned int ref_count=0, count=0;
+            for(unsigned long start=nya_system::get_time();(ref_time=nya_system::get_time()-start)<min_time;++ref_count)
+                reference_decode_dxt(d,&reference[0]);
+
+            for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++count)
+                d.decode_dxt(&decoded[0],threads);
+
+            const bool same=memcmp(&reference[0],&decoded[0],decoded.size())==0;
+            failed=failed || !same;
+
+            const double mb=decoded.size()/(1024.0*1024.0);
+            printf("%s %4ux%-4u mips %2u: reference %8.1f MB/s, decode_dxt %8.1f MB/s, %s\n",format_names[f],d.width,d.height,
+                   d.mipmap_count,mb*ref_count*1000.0/ref_time,mb*count*1000.0/time,same?"bit-exact":"MISMATCH");
+        }
+    }
+
+    return failed?-1:0;
+}
@@ -0,0 +1,335 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <list>
+#include "memory/indexed_map.h"
+#include "system/system.h"
+
+const char *help="Usage: indexed_map_benchmark [-sizes %%count%%,%%count%%,...] [-sample %%count%%] [-copy_limit %%count%%]\n"
+                 "fills indexed_map with string keys and times insert, get_by_key, get_idx_for_key,\n"
+                 "get_key_for_idx, erase_by_key and copy against the reference std::map and std::list one\n"
+                 "operations that are O(size) in the reference are timed on sample keys,\n"
+                 "the O(size^2) reference copy is skipped above copy_limit entries\n"
+                 "\n";
+
+//indexed_map as it was before the dense arrays, kept for comparison
+
+template <class object_t,class key_t=std::string>
+class reference_indexed_map
+{
+public:
+    bool insert(const key_t &k,const object_t &obj)
+    {
+        typename keys_map::iterator key_iter=m_keys.find(k);
+        if(key_iter!=m_keys.end())
+        {
+            *(key_iter->second)=obj;
+            return false;
+        }
+
+        typename objects_list::iterator object_iter=m_objects.insert(m_objects.end(),obj);
+        m_keys.insert(std::make_pair(k,object_iter));
+        m_indices.push_back(object_iter);
+        return true;
+    }
+
+    int get_size() const { return (int)m_objects.size(); }
+
+    void clear()
+    {
+        m_objects.clear();
+        m_keys.clear();
+        m_indices.clear();
+    }
+
+    int get_idx_for_key(const key_t &k) const
+    {
+        typename keys_map::const_iterator key_iter=m_keys.find(k);
+        if(key_iter==m_keys.end())
+            return -1;
+
+        return (int)get_idx_for_iter(key_iter->second);
+    }
+
+    key_t get_key_for_idx(size_t idx) const
+    {
+        if(idx>=m_objects.size())
+            return key_t();
+
+        typename objects_list::const_iterator object_iter=m_indices[idx];
+        typename keys_map::const_iterator key_iter=m_keys.begin();
+        while(key_iter->second!=object_iter)
+            ++key_iter;
+        return key_iter->first;
+    }
+
+    const object_t *get_by_key(const key_t &k) const
+    {
+        typename keys_map::const_iterator iter=m_keys.find(k);
+        return iter==m_keys.end()?0:&*(iter->second);
+    }
+
+    bool erase_by_key(const key_t &k)
+    {
+        typename keys_map::iterator key_iter=m_keys.find(k);
+        if(key_iter==m_keys.end())
+            return false;
+
+        size_t idx=get_idx_for_iter(key_iter->second);
+        m_objects.erase(m_indices[idx]);
+        m_indices.erase(m_indices.begin()+idx);
+        m_keys.erase(key_iter);
+        return true;
+    }
+
+public:
+    reference_indexed_map() {}
+    reference_indexed_map(const reference_indexed_map &m): m_objects(m.m_objects)
+    {
+        for(typename keys_map::const_iterator it=m.m_keys.begin();it!=m.m_keys.end();++it)
+            m_keys.insert(std::make_pair(it->first,find_corressponding_iterator(m.m_objects,it->second)));
+
+        for(typename indices_map::const_iterator it=m.m_indices.begin();it!=m.m_indices.end();++it)
+            m_indices.push_back(find_corressponding_iterator(m.m_objects,*it));
+    }
+
+private:
+    typedef std::list<object_t> objects_list;
+    typedef std::map<key_t,typename std::list<object_t>::iterator> keys_map;
+    typedef std::vector<typename std::list<object_t>::iterator> indices_map;
+
+    size_t get_idx_for_iter(typename objects_list::const_iterator object_iter) const
+    {
+        size_t result=0;
+        while(m_indices[result]!=object_iter)
+            ++result;
+
+        return result;
+    }
+
+    typename objects_list::iterator find_corressponding_iterator(const objects_list &another_objects,
+                                                                 typename objects_list::const_iterator another_iter)
+    {
+        typename objects_list::iterator result=m_objects.begin();
+        typename objects_list::const_iterator another_finder=another_objects.begin();
+        while(another_finder!=another_iter)
+        {
+            ++another_finder;
+            ++result;
+        }
+        return result;
+    }
+
+    objects_list m_objects;
+    keys_map m_keys;
+    indices_map m_indices;
+};
+
+struct object
+{
+    int value;
+    float data[3];
+};
+
+struct result
+{
+    double time[6]; //ns per operation, negative if skipped
+    long long check[5];
+};
+
+static const char *op_names[]={"insert","get_by_key","get_idx_for_key","get_key_for_idx","erase_by_key","copy"};
+
+static const unsigned long min_time=20; //sample operations are repeated for at least min_time ms
+
+static double ns(unsigned long start,size_t count) { return (nya_system::get_time()-start)*1000000.0/(count?count:1); }
+
+//reference and new maps differ in the const get_by_key return, the rest is timed by the same code
+
+static const object *get(const reference_indexed_map<object> &m,const std::string &k) { return m.get_by_key(k); }
+static const object *get(const nya_memory::indexed_map<object> &m,const std::string &k) { return &m.get_by_key(k); }
+
+template<typename map_t> static void measure(const std::vector<std::string> &keys,const std::vector<int> &order,
+                                             size_t sample,size_t copy_limit,result &r)
+{
+    map_t m;
+    size_t repeats=0;
+    unsigned long start=nya_system::get_time();
+    do
+    {
+        m.clear();
+        for(size_t i=0;i<keys.size();++i)
+        {
+            object o;
+            o.value=(int)i;
+            o.data[0]=o.data[1]=o.data[2]=0.0f;
+            m.insert(keys[i],o);
+        }
+        ++repeats;
+    }
+    while(nya_system::get_time()-start<min_time);
+    r.time[0]=ns(start,keys.size()*repeats);
+    r.check[0]=m.get_size();
+
+    repeats=0;
+    start=nya_system::get_time();
+    do
+    {
+        r.check[1]=0;
+        for(size_t i=0;i<order.size();++i)
+        {
+            const object *o=get(m,keys[order[i]]);
+            if(o)
+                r.check[1]+=o->value;
+        }
+        ++repeats;
+    }
+    while(nya_system::get_time()-start<min_time);
+    r.time[1]=ns(start,order.size()*repeats);
+
+    repeats=0;
+    start=nya_system::get_time();
+    do
+    {
+        r.check[2]=0;
+        for(size_t i=0;i<sample;++i)
+            r.check[2]+=m.get_idx_for_key(keys[order[i]]);
+        ++repeats;
+    }
+    while(nya_system::get_time()-start<min_time);
+    r.time[2]=ns(start,sample*repeats);
+
+    repeats=0;
+    start=nya_system::get_time();
+    do
+    {
+        r.check[3]=0;
+        for(size_t i=0;i<sample;++i)
+            r.check[3]+=m.get_key_for_idx(order[i]).size();
+        ++repeats;
+    }
+    while(nya_system::get_time()-start<min_time);
+    r.time[3]=ns(start,sample*repeats);
+
+    r.time[5]=-1.0;
+    if(keys.size()<=copy_limit)
+    {
+        repeats=0;
+        start=nya_system::get_time();
+        do
+        {
+            map_t copy(m);
+            ++repeats;
+        }
+        while(nya_system::get_time()-start<min_time);
+        r.time[5]=ns(start,keys.size()*repeats);
+    }
+
+    //erased keys are inserted back to repeat, only the erase is timed
+    unsigned long time=0;
+    repeats=0;
+    do
+    {
+        r.check[4]=0;
+        start=nya_system::get_time();
+        for(size_t i=0;i<sample;++i)
+            r.check[4]+=m.erase_by_key(keys[order[i]]);
+        time+=nya_system::get_time()-start;
+        r.check[4]+=m.get_size();
+        ++repeats;
+
+        if(time>=min_time)
+            break;
+
+        for(size_t i=0;i<sample;++i)
+        {
+            object o;
+            o.value=order[i];
+            o.data[0]=o.data[1]=o.data[2]=0.0f;
+            m.insert(keys[order[i]],o);
+        }
+    }
+    while(true);
+    r.time[4]=time*1000000.0/(sample*repeats);
+}
+
+int main(int argc,char **argv)
+{
+    std::vector<size_t> sizes;
+    size_t sample=100,copy_limit=20000;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-sizes")==0 && i+1<argc)
+        {
+            for(const char *s=argv[++i];s;s=strchr(s,','))
+            {
+                if(*s==',')
+                    ++s;
+                sizes.push_back(atoi(s));
+            }
+        }
+        else if(strcmp(argv[i],"-sample")==0 && i+1<argc)
+            sample=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-copy_limit")==0 && i+1<argc)
+            copy_limit=atoi(argv[++i]);
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(sizes.empty())
+    {
+        sizes.push_back(10000);
+        sizes.push_back(100000);
+        sizes.push_back(1000000);
+    }
+
+    bool match=true;
+    for(size_t s=0;s<sizes.size();++s)
+    {
+        const size_t count=sizes[s];
+        if(!count)
+            continue;
+
+        std::vector<std::string> keys(count);
+        std::vector<int> order(count);
+        for(size_t i=0;i<count;++i)
+        {
+            char buf[64];
+            sprintf(buf,"resource/name_%08d.tex",(int)i);
+            keys[i]=buf;
+            order[i]=(int)i;
+        }
+
+        srand(0);
+        for(size_t i=count-1;i>0;--i)
+            std::swap(order[i],order[rand()%(i+1)]);
+
+        const size_t count_sample=sample<count?sample:count;
+        result ref,res;
+        measure<reference_indexed_map<object> >(keys,order,count_sample,copy_limit,ref);
+        measure<nya_memory::indexed_map<object> >(keys,order,count_sample,count,res);
+
+        printf("%d entries, ns per operation, reference / indexed_map:\n",(int)count);
+        for(int i=0;i<6;++i)
+        {
+            if(ref.time[i]<0.0)
+                printf("  %-16s %12s / %10.1f\n",op_names[i],"skipped",res.time[i]);
+            else
+                printf("  %-16s %12.1f / %10.1f %10.1fx\n",op_names[i],ref.time[i],res.time[i],
+                       ref.time[i]/(res.time[i]>0.0?res.time[i]:0.001));
+        }
+
+        if(memcmp(ref.check,res.check,sizeof(ref.check))!=0)
+            match=false;
+    }
+
+    printf("%s\n",match?"match":"MISMATCH");
+    return match?0:-1;
+}
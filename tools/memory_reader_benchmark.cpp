@@ -0,0 +1,174 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "memory/memory_reader.h"
+#include "memory/memory_writer.h"
+#include "system/system.h"
+
+const char *help="Usage: memory_reader_benchmark [-verts %%count%%] [-materials %%count%%] [-min_time %%ms%%]\n"
+                 "parses generated pmx vertex and material name sections the way tests/shared/load_pmx does\n"
+                 "compares the bulk read_array and read_string_view path against the reference per-field reads\n"
+                 "and per-name string copies, checks that the parsed data matches\n"
+                 "the vbo upload is not measured, it needs a render context\n"
+                 "\n";
+
+struct vert
+{
+    float pos[3];
+    float normal[3];
+    float tc[2];
+    int bone_idx;
+};
+
+struct parsed
+{
+    std::vector<vert> verts;
+    std::vector<std::string> names;
+};
+
+//per-field reads and name copies as load_pmx did before the memory_reader additions
+
+static void reference_parse(const std::vector<char> &data,int verts_count,int materials_count,parsed &out)
+{
+    nya_memory::memory_reader reader(&data[0],data.size());
+    for(int i=0;i<verts_count;++i)
+    {
+        vert &v=out.verts[i];
+        v.pos[0]=reader.read<float>();
+        v.pos[1]=reader.read<float>();
+        v.pos[2]=-reader.read<float>();
+        v.normal[0]=reader.read<float>();
+        v.normal[1]=reader.read<float>();
+        v.normal[2]=-reader.read<float>();
+        v.tc[0]=reader.read<float>();
+        v.tc[1]=1.0f-reader.read<float>();
+        reader.read<char>();
+        v.bone_idx=reader.read<int>();
+        reader.read<float>(); //edge
+    }
+
+    for(int i=0;i<materials_count;++i)
+    {
+        for(int j=0;j<2;++j)
+        {
+            const int name_len=reader.read<int>();
+            if(j==1)
+            {
+                std::string name((const char*)reader.get_data(),name_len);
+                out.names[i].assign(name.c_str());
+            }
+            reader.skip(name_len);
+        }
+    }
+}
+
+static void parse(const std::vector<char> &data,int verts_count,int materials_count,parsed &out)
+{
+    nya_memory::memory_reader reader(&data[0],data.size());
+    for(int i=0;i<verts_count;++i)
+    {
+        vert &v=out.verts[i];
+        float f[8];
+        reader.read_array(f,8);
+        v.pos[0]=f[0],v.pos[1]=f[1],v.pos[2]=-f[2];
+        v.normal[0]=f[3],v.normal[1]=f[4],v.normal[2]=-f[5];
+        v.tc[0]=f[6],v.tc[1]=1.0f-f[7];
+        reader.read<char>();
+        v.bone_idx=reader.read<int>();
+        reader.read<float>(); //edge
+    }
+
+    for(int i=0;i<materials_count;++i)
+    {
+        for(int j=0;j<2;++j)
+        {
+            const nya_memory::string_view name=reader.read_string_view<int>();
+            if(j==1)
+                out.names[i].assign(name.data?name.data:"",name.size);
+        }
+    }
+}
+
+static bool same(const parsed &a,const parsed &b)
+{
+    if(a.names!=b.names || a.verts.size()!=b.verts.size())
+        return false;
+
+    return a.verts.empty() || memcmp(&a.verts[0],&b.verts[0],a.verts.size()*sizeof(vert))==0;
+}
+
+int main(int argc,char **argv)
+{
+    int verts_count=100000,materials_count=2000;
+    unsigned long min_time=300;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-verts")==0 && i+1<argc)
+            verts_count=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-materials")==0 && i+1<argc)
+            materials_count=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(verts_count<0 || materials_count<0)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    //vertex: pos, normal, tc, skinning type 0, bone index, edge; material: local and global names
+    const size_t vert_size=sizeof(float)*8+1+sizeof(int)+sizeof(float);
+    const size_t name_size=24;
+    std::vector<char> data(verts_count*vert_size+materials_count*2*(sizeof(int)+name_size)+1);
+    nya_memory::memory_writer writer(&data[0],data.size());
+    srand(0);
+    for(int i=0;i<verts_count;++i)
+    {
+        for(int j=0;j<8;++j)
+            writer.write_float(rand()/(float)RAND_MAX);
+        writer.write_ubyte(0);
+        writer.write_uint(rand()%256);
+        writer.write_float(1.0f);
+    }
+
+    for(int i=0;i<materials_count;++i)
+    {
+        for(int j=0;j<2;++j)
+        {
+            char name[name_size+1];
+            sprintf(name,"material_%05d_name_%d___",i%100000,j);
+            writer.write_uint(name_size);
+            writer.write(name,name_size);
+        }
+    }
+
+    parsed reference,result;
+    reference.verts.resize(verts_count),result.verts.resize(verts_count);
+    reference.names.resize(materials_count),result.names.resize(materials_count);
+
+    unsigned long ref_time=0,time=0;
+    unsigned int ref_count=0,count=0;
+    for(unsigned long start=nya_system::get_time();(ref_time=nya_system::get_time()-start)<min_time;++ref_count)
+        reference_parse(data,verts_count,materials_count,reference);
+
+    for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++count)
+        parse(data,verts_count,materials_count,result);
+
+    const bool match=same(reference,result);
+    const double mb=writer.get_offset()/(1024.0*1024.0);
+    printf("%d verts, %d materials, %.1f MB: reference %7.1f MB/s, read_array and read_string_view %7.1f MB/s, %.2fx %s\n",
+           verts_count,materials_count,mb,mb*ref_count*1000.0/ref_time,mb*count*1000.0/time,
+           (double(ref_time)/ref_count)/(double(time)/count),match?"match":"MISMATCH");
+
+    return match?0:-1;
+}
@@ -0,0 +1,167 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include "resources/file_resources_provider.h"
+#include "system/system.h"
+
+#ifdef __linux__
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+const char *help="Usage: mmap_benchmark [-min_time %%ms%%] folder\n"
+                 "reads every file in the folder through file_resources_provider and sums its bytes,\n"
+                 "once copying it with read_all into a buffer and once in place with enable_mmap\n"
+                 "warm passes read the files from the os cache, cold passes evict them before each pass\n"
+                 "with posix_fadvise, cold passes are linux only\n"
+                 "\n";
+
+static unsigned long long sum_data(const void *data,size_t size)
+{
+    unsigned long long sum=0;
+    const unsigned char *d=(const unsigned char *)data;
+    for(size_t i=0;i<size;++i)
+        sum+=d[i];
+
+    return sum;
+}
+
+static bool evict(const std::string &folder,const std::vector<std::string> &names)
+{
+#ifdef __linux__
+    for(size_t i=0;i<names.size();++i)
+    {
+        const int fd=open((folder+"/"+names[i]).c_str(),O_RDONLY);
+        if(fd<0)
+            return false;
+
+        fdatasync(fd);
+        const int result=posix_fadvise(fd,0,0,POSIX_FADV_DONTNEED);
+        close(fd);
+        if(result!=0)
+            return false;
+    }
+
+    return true;
+#else
+    return false;
+#endif
+}
+
+static unsigned long long read_files(nya_resources::file_resources_provider &provider,const std::vector<std::string> &names,
+                                     bool mmap,std::vector<char> &buf)
+{
+    unsigned long long sum=0;
+    for(size_t i=0;i<names.size();++i)
+    {
+        nya_resources::resource_data *res=provider.access(names[i].c_str());
+        if(!res)
+            continue;
+
+        const size_t size=res->get_size();
+        const void *data=mmap?res->get_mapped_data():0;
+        if(!data)
+        {
+            if(buf.size()<size)
+                buf.resize(size);
+
+            if(size && res->read_all(&buf[0]))
+                data=&buf[0];
+        }
+
+        if(data)
+            sum+=sum_data(data,size);
+
+        res->release();
+    }
+
+    return sum;
+}
+
+int main(int argc,char **argv)
+{
+    unsigned long min_time=300;
+    const char *folder=0;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else if(argv[i][0]!='-' && !folder)
+            folder=argv[i];
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(!folder)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    nya_resources::file_resources_provider provider;
+    if(!provider.set_folder(folder))
+    {
+        printf("unable to open folder %s\n",folder);
+        return -1;
+    }
+
+    std::vector<std::string> names;
+    size_t total_size=0;
+    for(int i=0;i<provider.get_resources_count();++i)
+    {
+        names.push_back(provider.get_resource_name(i));
+        nya_resources::resource_data *res=provider.access(names.back().c_str());
+        if(res)
+            total_size+=res->get_size(),res->release();
+    }
+
+    const double mb=total_size/(1024.0*1024.0);
+    printf("%d files, %.1f MB\n",(int)names.size(),mb);
+
+    std::vector<char> buf;
+    unsigned long long sums[2]={0,0};
+    bool match=true;
+    for(int cold=1;cold>=0;--cold)
+    {
+        unsigned long times[2]={0,0};
+        unsigned int counts[2]={0,0};
+        for(int mmap=0;mmap<2;++mmap)
+        {
+            provider.enable_mmap(mmap!=0);
+            do
+            {
+                if(cold && !evict(folder,names))
+                    break;
+
+                const unsigned long start=nya_system::get_time();
+                sums[mmap]=read_files(provider,names,mmap!=0,buf);
+                times[mmap]+=nya_system::get_time()-start;
+                ++counts[mmap];
+            }
+            while(times[mmap]<min_time);
+        }
+
+        if(!counts[0] || !counts[1])
+        {
+            printf("%s: skipped, unable to evict files from the os cache\n",cold?"cold":"warm");
+            continue;
+        }
+
+        const double read_speed=mb*counts[0]*1000.0/(times[0]?times[0]:1);
+        const double mmap_speed=mb*counts[1]*1000.0/(times[1]?times[1]:1);
+        printf("%s: read_all %8.1f MB/s, mmap %8.1f MB/s, %.2fx\n",cold?"cold":"warm",read_speed,mmap_speed,mmap_speed/read_speed);
+
+        if(sums[0]!=sums[1])
+            match=false;
+    }
+
+    printf("%s\n",match?"match":"MISMATCH");
+    return match?0:-1;
+}
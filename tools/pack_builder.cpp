@@ -0,0 +1,192 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "resources/pack_resources_provider.h"
+#include "resources/file_resources_provider.h"
+#include "memory/lz4.h"
+#include "memory/tmp_buffer.h"
+
+const char *help="Usage: pack_builder [-raw] [-min_gain %%percent%%] %%src_dir%% %%out_file%%\n"
+                 "packs all files from src_dir recursively into a nya pack\n"
+                 "entries are compressed with lz4 if it saves at least min_gain percent, 10 by default\n"
+                 "-raw - store all entries uncompressed\n"
+                 "\n";
+
+typedef nya_resources::pack_resources_provider pack;
+
+struct item
+{
+    std::string name;
+    pack::entry e;
+
+    bool operator < (const item &other) const { return pack::is_name_less(e,name.c_str(),other.e,other.name.c_str()); }
+};
+
+bool write_padding(FILE *f,size_t size)
+{
+    static const char zero[pack::page_size]={0};
+    return size<=pack::page_size && fwrite(zero,1,size,f)==size;
+}
+
+int main(int argc,char **argv)
+{
+    bool raw=false;
+    int min_gain=10;
+    std::vector<const char *> args;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-raw")==0)
+            raw=true;
+        else if(strcmp(argv[i],"-min_gain")==0 && i+1<argc)
+            min_gain=atoi(argv[++i]);
+        else
+            args.push_back(argv[i]);
+    }
+
+    if(args.size()!=2)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    nya_resources::file_resources_provider fprov;
+    if(!fprov.set_folder(args[0]))
+    {
+        fprintf(stderr,"Error: invalid src_dir %s\n",args[0]);
+        return -1;
+    }
+
+    std::vector<item> items(fprov.get_resources_count());
+    for(size_t i=0;i<items.size();++i)
+    {
+        const char *name=fprov.get_resource_name((int)i);
+        while(*name=='/')
+            ++name;
+
+        items[i].name=name;
+        memset(&items[i].e,0,sizeof(pack::entry));
+        items[i].e.hash=pack::get_name_hash(items[i].name.c_str());
+    }
+
+    std::sort(items.begin(),items.end());
+
+    std::vector<char> names;
+    for(size_t i=0;i<items.size();++i)
+    {
+        items[i].e.name_offset=(unsigned int)names.size();
+        names.insert(names.end(),items[i].name.begin(),items[i].name.end());
+        names.push_back(0);
+    }
+
+    FILE *out=fopen(args[1],"wb");
+    if(!out)
+    {
+        fprintf(stderr,"Error: unable to open %s for writing\n",args[1]);
+        return -1;
+    }
+
+    const size_t toc_size=sizeof(pack::header)+items.size()*sizeof(pack::entry)+names.size();
+    size_t offset=(toc_size+pack::page_size-1)/pack::page_size*pack::page_size;
+    for(size_t i=0;i<offset;i+=pack::page_size)
+    {
+        if(!write_padding(out,pack::page_size))
+        {
+            fprintf(stderr,"Error: unable to write %s\n",args[1]);
+            fclose(out);
+            return -1;
+        }
+    }
+
+    size_t total_size=0,total_packed=0;
+    for(size_t i=0;i<items.size();++i)
+    {
+        item &it=items[i];
+
+        const size_t aligned=(offset+pack::page_size-1)/pack::page_size*pack::page_size;
+        if(!write_padding(out,aligned-offset))
+        {
+            fprintf(stderr,"Error: unable to write %s\n",args[1]);
+            fclose(out);
+            return -1;
+        }
+
+        offset=aligned;
+        it.e.page=(unsigned int)(offset/pack::page_size);
+
+        nya_resources::resource_data *res=fprov.access(it.name.c_str());
+        if(!res)
+        {
+            fprintf(stderr,"Error: unable to read %s\n",it.name.c_str());
+            fclose(out);
+            return -1;
+        }
+
+        const size_t size=res->get_size();
+        nya_memory::tmp_buffer_scoped buf(size);
+        const bool read_result=!size || res->read_all(buf.get_data());
+        res->release();
+        if(!read_result)
+        {
+            fprintf(stderr,"Error: unable to read %s\n",it.name.c_str());
+            fclose(out);
+            return -1;
+        }
+
+        const void *data=buf.get_data();
+        size_t packed_size=size;
+        it.e.compression=pack::compression_none;
+
+        nya_memory::tmp_buffer_scoped packed(raw || !size?1:nya_memory::lz4::get_max_compressed_size(size));
+        if(!raw && size)
+        {
+            const size_t compressed_size=nya_memory::lz4::compress(buf.get_data(),size,packed.get_data(),packed.get_size());
+            if(compressed_size && compressed_size<size-size*min_gain/100)
+            {
+                data=packed.get_data();
+                packed_size=compressed_size;
+                it.e.compression=pack::compression_lz4;
+            }
+        }
+
+        if(packed_size && fwrite(data,1,packed_size,out)!=packed_size)
+        {
+            fprintf(stderr,"Error: unable to write %s\n",args[1]);
+            fclose(out);
+            return -1;
+        }
+
+        it.e.packed_size=(unsigned int)packed_size;
+        it.e.unpacked_size=(unsigned int)size;
+        offset+=packed_size;
+        total_size+=size;
+        total_packed+=packed_size;
+    }
+
+    pack::header h;
+    memcpy(h.sign,"nyap",4);
+    h.version=pack::version;
+    h.entries_count=(unsigned int)items.size();
+    h.names_size=(unsigned int)names.size();
+
+    bool result=fseek(out,0,SEEK_SET)==0 && fwrite(&h,sizeof(h),1,out)==1;
+    for(size_t i=0;i<items.size() && result;++i)
+        result=fwrite(&items[i].e,sizeof(pack::entry),1,out)==1;
+
+    if(result && !names.empty())
+        result=fwrite(&names[0],1,names.size(),out)==names.size();
+
+    fclose(out);
+    if(!result)
+    {
+        fprintf(stderr,"Error: unable to write %s\n",args[1]);
+        return -1;
+    }
+
+    printf("packed %d files, %lu bytes to %lu bytes\n",(int)items.size(),(unsigned long)total_size,(unsigned long)total_packed);
+    return 0;
+}
@@ -0,0 +1,204 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+#include "memory/shared_ptr.h"
+#include "system/system.h"
+
+const char *help="Usage: shared_ptr_benchmark [-count %%count%%] [-min_time %%ms%%]\n"
+                 "creates (destroying the previous set), copies and dereferences shared pointers to small objects\n"
+                 "compares the single block shared_ptr, with and without thread_safe counting,\n"
+                 "against the reference one that allocates the object and its counter separately\n"
+                 "\n";
+
+//shared_ptr as it was before the single block allocation, kept for comparison
+
+template<typename t>
+class reference_shared_ptr
+{
+public:
+    t *operator -> () { return m_ref; };
+
+    void free()
+    {
+        if(!m_ref)
+            return;
+
+        if(--(*m_ref_count)<=0)
+        {
+            delete m_ref;
+            delete m_ref_count;
+        }
+
+        m_ref=0;
+    }
+
+    reference_shared_ptr(): m_ref(0) {}
+
+    explicit reference_shared_ptr(const t &obj)
+    {
+        m_ref=new t(obj);
+        m_ref_count=new int(1);
+    }
+
+    reference_shared_ptr(const reference_shared_ptr &p)
+    {
+        m_ref=p.m_ref;
+        m_ref_count=p.m_ref_count;
+        if(m_ref)
+            ++(*m_ref_count);
+    }
+
+    reference_shared_ptr &operator=(const reference_shared_ptr &p)
+    {
+        if(this==&p)
+            return *this;
+
+        free();
+        m_ref=p.m_ref;
+        if(m_ref)
+        {
+            m_ref_count=p.m_ref_count;
+            ++(*m_ref_count);
+        }
+
+        return *this;
+    }
+
+    ~reference_shared_ptr() { free(); }
+
+private:
+    t *m_ref;
+    int *m_ref_count;
+};
+
+struct object
+{
+    int value;
+    float data[3];
+};
+
+template<typename ptr> struct test
+{
+    std::vector<ptr> ptrs;
+    std::vector<ptr> copies;
+    std::vector<int> order;
+
+    void create(int count)
+    {
+        ptrs.clear();
+        for(int i=0;i<count;++i)
+        {
+            object o;
+            o.value=i;
+            o.data[0]=o.data[1]=o.data[2]=0.0f;
+            ptrs.push_back(ptr(o));
+        }
+    }
+
+    void copy()
+    {
+        copies.clear();
+        for(size_t i=0;i<order.size();++i)
+            copies.push_back(ptrs[order[i]]);
+        copies.clear();
+    }
+
+    long long sum()
+    {
+        long long s=0;
+        for(size_t i=0;i<order.size();++i)
+            s+=ptrs[order[i]]->value;
+        return s;
+    }
+
+    test(int count)
+    {
+        for(int i=0;i<count;++i)
+            order.push_back(i);
+        srand(0);
+        for(int i=count-1;i>0;--i)
+            std::swap(order[i],order[rand()%(i+1)]);
+        copies.reserve(count);
+    }
+};
+
+struct times
+{
+    double create;
+    double copy;
+    double sum;
+    long long check;
+};
+
+template<typename ptr> times measure(int count,unsigned long min_time)
+{
+    test<ptr> t(count);
+    times r;
+
+    unsigned long time=0;
+    unsigned int iterations=0;
+    for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++iterations)
+        t.create(count);
+    r.create=time*1000000.0/(double(iterations)*count);
+
+    iterations=0;
+    for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++iterations)
+        t.copy();
+    r.copy=time*1000000.0/(double(iterations)*count);
+
+    iterations=0;
+    r.check=0;
+    for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++iterations)
+        r.check+=t.sum();
+    r.sum=time*1000000.0/(double(iterations)*count);
+    r.check/=iterations;
+
+    return r;
+}
+
+static void print(const char *name,const times &t,const times &ref)
+{
+    printf("%-24s create %6.1f ns %5.2fx, copy %6.1f ns %5.2fx, dereference %6.1f ns %5.2fx\n",name,
+           t.create,ref.create/t.create,t.copy,ref.copy/t.copy,t.sum,ref.sum/t.sum);
+}
+
+int main(int argc,char **argv)
+{
+    int count=100000;
+    unsigned long min_time=300;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-count")==0 && i+1<argc)
+            count=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(count<=0)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    const times ref=measure<reference_shared_ptr<object> >(count,min_time);
+    const times single=measure<nya_memory::shared_ptr<object> >(count,min_time);
+    const times atomic=measure<nya_memory::shared_ptr<object,true> >(count,min_time);
+
+    printf("%d pointers, per pointer, speedup against the reference:\n",count);
+    print("reference",ref,ref);
+    print("shared_ptr",single,ref);
+    print("shared_ptr thread_safe",atomic,ref);
+
+    const bool match=ref.check==single.check && ref.check==atomic.check;
+    printf("%s\n",match?"match":"MISMATCH");
+    return match?0:-1;
+}
@@ -0,0 +1,313 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include "formats/tga.h"
+#include "memory/memory_writer.h"
+#include "system/system.h"
+
+const char *help="Usage: tga_benchmark [-min_time %%ms%%] file.tga [file2.tga ...]\n"
+                 "loads tga files the way scene::texture does: rle decode, flips and bgr to rgb swizzle\n"
+                 "compares the fused nya_formats::tga::decode against the reference per-step pipeline\n"
+                 "and the rle encoder against the reference one, checks that the outputs match\n"
+                 "\n";
+
+typedef unsigned char uchar;
+using nya_formats::tga;
+
+//byte at a time code as it was before the simd kernels, kept for comparison
+
+static bool reference_decode_rle(const tga &t,void *decoded_data)
+{
+    const uchar *cur=(uchar*)t.data;
+    const uchar *const last=(uchar*)t.data+t.compressed_size;
+    uchar *out=(uchar*)decoded_data;
+    const uchar *const out_last=out+t.uncompressed_size;
+
+    while(out<out_last)
+    {
+        if(cur>=last)
+            return false;
+
+        if(*cur & 0x80)
+        {
+            const uchar *to=out+(*cur++ -127)*t.channels;
+            if(cur+t.channels>last || to>out_last)
+                return false;
+
+            while(out<to) memcpy(out,cur,t.channels),out+=t.channels;
+            cur+=t.channels;
+        }
+        else
+        {
+            const size_t size=(*cur++ +1)*t.channels;
+            if(cur+size>last || out+size>out_last)
+                return false;
+
+            memcpy(out,cur,size);
+            cur+=size,out+=size;
+        }
+    }
+
+    return true;
+}
+
+static void reference_flip_vertical(const tga &t,uchar *data)
+{
+    const size_t line_size=t.width*t.channels;
+    std::vector<uchar> line(line_size);
+    for(int y=0;y<t.height/2;++y)
+    {
+        uchar *a=data+y*line_size, *b=data+(t.height-1-y)*line_size;
+        memcpy(&line[0],a,line_size);
+        memcpy(a,b,line_size);
+        memcpy(b,&line[0],line_size);
+    }
+}
+
+static void reference_flip_horisontal(const tga &t,uchar *data)
+{
+    const int line_size=t.width*t.channels;
+    uchar tmp[4];
+    for(size_t offset=0;offset<t.uncompressed_size;offset+=line_size)
+    {
+        uchar *ha=data+offset;
+        uchar *hb=ha+line_size-t.channels;
+        for(int w=0;w<line_size/2;w+=t.channels)
+        {
+            memcpy(tmp,ha+w,t.channels);
+            memcpy(ha+w,hb-w,t.channels);
+            memcpy(hb-w,tmp,t.channels);
+        }
+    }
+}
+
+static bool reference_load(const tga &t,uchar *out)
+{
+    if(t.rle)
+    {
+        if(!reference_decode_rle(t,out))
+            return false;
+    }
+    else
+        memcpy(out,t.data,t.uncompressed_size);
+
+    if(t.horisontal_flip)
+        reference_flip_horisontal(t,out);
+    if(t.vertical_flip)
+        reference_flip_vertical(t,out);
+
+    if(t.channels==3)
+    {
+        for(size_t i=0;i<t.uncompressed_size;i+=3)
+        {
+            const uchar tmp=out[i];
+            out[i]=out[i+2];
+            out[i+2]=tmp;
+        }
+    }
+
+    return true;
+}
+
+static bool reference_encode_rle(const tga &t,nya_memory::memory_writer &writer)
+{
+    const uchar *from=(uchar *)t.data;
+    const uchar *from_last=from+t.uncompressed_size;
+    const int channels=t.channels;
+
+    uchar raw[128*4];
+    memset(raw,0,sizeof(raw));
+
+    int curr_line=0;
+    for(int rle=1;from<from_last;from+=channels*rle,curr_line+=rle)
+    {
+        if(curr_line>=t.width)
+            curr_line-=t.width;
+
+        memcpy(raw,from,channels);
+
+        rle=1;
+        bool is_rle=false;
+        int max_rle=128;
+        if(curr_line+max_rle>t.width)
+            max_rle=t.width-curr_line;
+
+        for(const uchar *check=from+channels;check<from_last;++rle,check+=channels)
+        {
+            if(memcmp(raw,check,channels)!=0 || rle>=max_rle)
+            {
+                is_rle=rle>1;
+                break;
+            }
+        }
+
+        if(is_rle)
+        {
+            if(!writer.write_ubyte(128 | (rle-1)) || !writer.write(raw,channels))
+                return false;
+
+            continue;
+        }
+
+        rle=1;
+        uchar *raw_it=raw;
+        for(const uchar *check=from+channels;check<from_last;++rle,check+=channels)
+        {
+            if((memcmp(raw_it,check,channels)!=0 && rle<max_rle) || rle<3)
+            {
+                memcpy(raw_it+=channels,check,channels);
+                if(rle>=max_rle)
+                    break;
+
+                continue;
+            }
+
+            if(memcmp(raw_it,check,channels)!=0)
+                rle-=2;
+
+            break;
+        }
+
+        if(!writer.write_ubyte(rle-1) || !writer.write(raw,channels*rle))
+            return false;
+    }
+
+    return true;
+}
+
+static bool read_file(const char *name,std::vector<uchar> &data)
+{
+    FILE *f=fopen(name,"rb");
+    if(!f)
+        return false;
+
+    fseek(f,0,SEEK_END);
+    data.resize(ftell(f));
+    fseek(f,0,SEEK_SET);
+    const bool result=data.empty() || fread(&data[0],data.size(),1,f)==1;
+    fclose(f);
+    return result;
+}
+
+int main(int argc,char **argv)
+{
+    unsigned long min_time=300;
+    std::vector<const char *> files;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else if(argv[i][0]=='-')
+        {
+            printf("%s",help);
+            return 0;
+        }
+        else
+            files.push_back(argv[i]);
+    }
+
+    if(files.empty())
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    bool failed=false;
+    double total_mb=0.0,total_ref_time=0.0,total_time=0.0,total_ref_enc_time=0.0,total_enc_time=0.0;
+    for(size_t i=0;i<files.size();++i)
+    {
+        std::vector<uchar> file;
+        tga header;
+        if(!read_file(files[i],file) || file.empty() || !header.decode_header(&file[0],file.size()))
+        {
+            printf("%s: unable to read tga\n",files[i]);
+            failed=true;
+            continue;
+        }
+
+        if(!header.rle && header.compressed_size<header.uncompressed_size)
+        {
+            printf("%s: lack of data\n",files[i]);
+            failed=true;
+            continue;
+        }
+
+        std::vector<uchar> reference(header.uncompressed_size), decoded(header.uncompressed_size);
+        if(!reference_load(header,&reference[0]))
+        {
+            printf("%s: unable to decode rle\n",files[i]);
+            failed=true;
+            continue;
+        }
+
+        unsigned long ref_time=0, time=0;
+        unsigned int ref_count=0, count=0;
+        for(unsigned long start=nya_system::get_time();(ref_time=nya_system::get_time()-start)<min_time;++ref_count)
+            reference_load(header,&reference[0]);
+
+        bool decoded_ok=true;
+        for(unsigned long start=nya_system::get_time();(time=nya_system::get_time()-start)<min_time;++count)
+        {
+            tga t=header;
+            decoded_ok=decoded_ok && t.decode(&decoded[0],t.channels==3);
+        }
+
+        const bool same=decoded_ok && memcmp(&reference[0],&decoded[0],decoded.size())==0;
+
+        //encoders work on unflipped bgr data
+        tga raw=header;
+        std::vector<uchar> unpacked(header.uncompressed_size);
+        raw.decode(&unpacked[0]);
+
+        const size_t max_size=header.uncompressed_size+header.uncompressed_size/128+1024;
+        std::vector<uchar> ref_enc(max_size), enc(max_size);
+        size_t ref_enc_size=0, enc_size=0;
+
+        unsigned long ref_enc_time=0, enc_time=0;
+        unsigned int ref_enc_count=0, enc_count=0;
+        for(unsigned long start=nya_system::get_time();(ref_enc_time=nya_system::get_time()-start)<min_time;++ref_enc_count)
+        {
+            nya_memory::memory_writer writer(&ref_enc[0],ref_enc.size());
+            reference_encode_rle(raw,writer);
+            ref_enc_size=writer.get_offset();
+        }
+
+        for(unsigned long start=nya_system::get_time();(enc_time=nya_system::get_time()-start)<min_time;++enc_count)
+            enc_size=raw.encode_rle(&enc[0],enc.size());
+
+        tga packed=raw;
+        packed.rle=true;
+        packed.data=&enc[0];
+        packed.compressed_size=enc_size;
+        std::vector<uchar> round_trip(header.uncompressed_size);
+        const bool encoded_ok=enc_size && packed.decode_rle(&round_trip[0]) && round_trip==unpacked;
+
+        failed=failed || !same || !encoded_ok;
+
+        const double mb=decoded.size()/(1024.0*1024.0);
+        total_mb+=mb;
+        total_ref_time+=double(ref_time)/ref_count;
+        total_time+=double(time)/count;
+        total_ref_enc_time+=double(ref_enc_time)/ref_enc_count;
+        total_enc_time+=double(enc_time)/enc_count;
+
+        printf("%s %dx%d %d%s%s%s: load reference %7.1f MB/s, decode %7.1f MB/s %s; "
+               "encode reference %7.1f MB/s %u bytes, encode_rle %7.1f MB/s %u bytes %s\n",
+               files[i],header.width,header.height,header.channels*8,header.rle?" rle":"",
+               header.horisontal_flip?" hflip":"",header.vertical_flip?" vflip":"",
+               mb*ref_count*1000.0/ref_time,mb*count*1000.0/time,same?"match":"MISMATCH",
+               mb*ref_enc_count*1000.0/ref_enc_time,(unsigned int)ref_enc_size,
+               mb*enc_count*1000.0/enc_time,(unsigned int)enc_size,encoded_ok?"round trip ok":"ROUND TRIP FAILED");
+    }
+
+    if(total_time>0.0 && total_enc_time>0.0)
+    {
+        printf("corpus %.1f MB: load %.2fx, encode %.2fx faster than reference\n",total_mb,
+               total_ref_time/total_time,total_ref_enc_time/total_enc_time);
+    }
+
+    return failed?-1:0;
+}
@@ -0,0 +1,239 @@
+//https://code.google.com/p/nya-engine/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <vector>
+#include <list>
+#include "memory/tmp_buffer.h"
+#include "memory/thread_pool.h"
+#include "memory/mutex.h"
+#include "system/system.h"
+
+const char *help="Usage: tmp_buffer_benchmark [-threads %%count%%] [-live %%count%%] [-max_size %%bytes%%] [-min_time %%ms%%]\n"
+                 "each thread keeps live buffers and replaces a random one with a buffer of random size\n"
+                 "from 64 bytes to max_size, touching its first and last byte; buffers left live at the end\n"
+                 "are released from the main thread\n"
+                 "compares the size-classed tmp_buffer pool against the reference list pool behind a global mutex,\n"
+                 "the reference pool is not thread safe so that's how it has to be shared between threads\n"
+                 "\n";
+
+//list pool as tmp_buffer was before the size classes, kept for comparison
+
+class reference_buffer
+{
+public:
+    static reference_buffer *allocate_new(size_t size)
+    {
+        nya_memory::mutex_scoped_lock lock(get_mutex());
+
+        reference_buffer *min_suit_buf=0;
+        reference_buffer *max_buf=0;
+        for(buffers_list::iterator it=get_buffers().begin();it!=get_buffers().end();++it)
+        {
+            reference_buffer &buffer=*it;
+            if(buffer.m_used)
+                continue;
+
+            if(buffer.m_data.size()>=size && (!min_suit_buf || buffer.m_data.size()<min_suit_buf->m_data.size()))
+                min_suit_buf=&buffer;
+
+            if(!max_buf || buffer.m_data.size()>max_buf->m_data.size())
+                max_buf=&buffer;
+        }
+
+        reference_buffer *buf=min_suit_buf?min_suit_buf:max_buf;
+        if(!buf)
+        {
+            get_buffers().push_back(reference_buffer());
+            buf=&get_buffers().back();
+        }
+
+        if(size>buf->m_data.size())
+            buf->m_data.resize(size);
+
+        buf->m_size=size;
+        buf->m_used=true;
+        return buf;
+    }
+
+    void free()
+    {
+        nya_memory::mutex_scoped_lock lock(get_mutex());
+        m_size=0;
+        m_used=false;
+    }
+
+    void *get_data() { return m_size?&m_data[0]:0; }
+    size_t get_size() const { return m_size; }
+
+    static void force_free()
+    {
+        get_buffers().clear();
+    }
+
+    reference_buffer(): m_used(false),m_size(0) {}
+
+private:
+    typedef std::list<reference_buffer> buffers_list;
+    static buffers_list &get_buffers() { static buffers_list buffers; return buffers; }
+    static nya_memory::mutex &get_mutex() { static nya_memory::mutex m; return m; }
+
+private:
+    std::vector<char> m_data;
+    bool m_used;
+    size_t m_size;
+};
+
+struct reference_ref
+{
+    reference_buffer *buf;
+
+    void allocate(size_t size) { free(); buf=reference_buffer::allocate_new(size); }
+    void free() { if(buf) buf->free(); buf=0; }
+    void *get_data() const { return buf?buf->get_data():0; }
+    size_t get_size() const { return buf?buf->get_size():0; }
+
+    reference_ref(): buf(0) {}
+};
+
+struct task_data
+{
+    unsigned int seed;
+    unsigned int iterations;
+    size_t max_size;
+    std::vector<nya_memory::tmp_buffer_ref> refs;
+    std::vector<reference_ref> reference_refs;
+    bool failed;
+};
+
+static size_t random_size(unsigned int &seed,size_t max_size)
+{
+    //log-uniform from 64 bytes so that small and large classes are hit alike
+    seed=seed*1103515245+12345;
+    size_t size=64;
+    const unsigned int shift=(seed>>16)%16;
+    for(unsigned int i=0;i<shift && size*2<=max_size;++i)
+        size*=2;
+
+    seed=seed*1103515245+12345;
+    size+=(seed>>16)%size;
+    return size<max_size?size:max_size;
+}
+
+template<typename t> static bool touch(t &ref)
+{
+    char *data=(char *)ref.get_data();
+    if(!data)
+        return false;
+
+    data[0]=1;
+    data[ref.get_size()-1]=1;
+    return true;
+}
+
+template<typename t> static void run(t &refs,task_data &d)
+{
+    for(unsigned int i=0;i<d.iterations;++i)
+    {
+        d.seed=d.seed*1103515245+12345;
+        const size_t idx=(d.seed>>16)%refs.size();
+        refs[idx].free();
+        refs[idx].allocate(random_size(d.seed,d.max_size));
+        if(!touch(refs[idx]))
+            d.failed=true;
+    }
+}
+
+static void pool_task(void *data) { task_data &d=*(task_data *)data; run(d.refs,d); }
+static void reference_task(void *data) { task_data &d=*(task_data *)data; run(d.reference_refs,d); }
+
+static unsigned long measure(nya_memory::thread_pool &pool,std::vector<task_data> &tasks,bool reference,unsigned int &iterations)
+{
+    const unsigned long start=nya_system::get_time();
+    for(size_t i=0;i<tasks.size();++i)
+        pool.add_task(reference?reference_task:pool_task,&tasks[i]);
+
+    pool.wait_idle();
+    iterations+=tasks[0].iterations*(unsigned int)tasks.size();
+
+    //release from another thread than the one that allocated
+    for(size_t i=0;i<tasks.size();++i)
+    {
+        for(size_t j=0;j<tasks[i].refs.size();++j)
+            tasks[i].refs[j].free();
+        for(size_t j=0;j<tasks[i].reference_refs.size();++j)
+            tasks[i].reference_refs[j].free();
+    }
+
+    return nya_system::get_time()-start;
+}
+
+int main(int argc,char **argv)
+{
+    unsigned int threads=4,live=256;
+    size_t max_size=256*1024;
+    unsigned long min_time=300;
+    for(int i=1;i<argc;++i)
+    {
+        if(strcmp(argv[i],"-threads")==0 && i+1<argc)
+            threads=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-live")==0 && i+1<argc)
+            live=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-max_size")==0 && i+1<argc)
+            max_size=atoi(argv[++i]);
+        else if(strcmp(argv[i],"-min_time")==0 && i+1<argc)
+            min_time=atoi(argv[++i]);
+        else
+        {
+            printf("%s",help);
+            return 0;
+        }
+    }
+
+    if(!threads || !live || max_size<64)
+    {
+        printf("%s",help);
+        return 0;
+    }
+
+    nya_memory::thread_pool pool;
+    if(!pool.start(threads))
+    {
+        printf("unable to start threads\n");
+        return -1;
+    }
+
+    std::vector<task_data> tasks(threads);
+    for(unsigned int i=0;i<threads;++i)
+    {
+        tasks[i].seed=i+1;
+        tasks[i].iterations=10000;
+        tasks[i].max_size=max_size;
+        tasks[i].refs.resize(live);
+        tasks[i].reference_refs.resize(live);
+        tasks[i].failed=false;
+    }
+
+    unsigned long ref_time=0,time=0;
+    unsigned int ref_count=0,count=0;
+    while(ref_time<min_time)
+        ref_time+=measure(pool,tasks,true,ref_count);
+
+    while(time<min_time)
+        time+=measure(pool,tasks,false,count);
+
+    pool.stop();
+
+    bool failed=false;
+    for(unsigned int i=0;i<threads;++i)
+        failed=failed || tasks[i].failed;
+
+    printf("%u threads, %u live, up to %u bytes: reference %8.0f kops/s, tmp_buffer %8.0f kops/s, %.2fx, pool %.1f MB %s\n",
+           threads,live,(unsigned int)max_size,double(ref_count)/ref_time,double(count)/time,
+           (double(ref_time)/ref_count)/(double(time)/count),nya_memory::tmp_buffers::get_total_size()/(1024.0*1024.0),
+           failed?"FAILED":"ok");
+
+    reference_buffer::force_free();
+    return failed?-1:0;
+}
@@ -276,6 +276,12 @@ public:
 public:
     widget_proxy(): ptr() {}
     widget_proxy(const widget_proxy &p): ptr(p) {}
+    widget_proxy &operator=(const widget_proxy &p) { ptr::operator=(p); return *this; }
+
+#ifdef NYA_RVALUE_REFS
+    widget_proxy(widget_proxy &&p): ptr(static_cast<ptr&&>(p)) {}
+    widget_proxy &operator=(widget_proxy &&p) { ptr::operator=(static_cast<ptr&&>(p)); return *this; }
+#endif
 
 private:
     typedef nya_memory::shared_ptr<widget> ptr;
@@ -288,10 +294,7 @@ public:
     widget_base_proxy &create()
     {
         free();
-
-        m_ref=new t;
-        m_ref_count=new int(1);
-
+        create_as<t>();
         return *this;
     }
 